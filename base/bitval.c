@@ -178,6 +178,7 @@ bitval_write_ubits(struct bitval *bv, uintreg_t val, size_t n) {
 	while (n != 0) {
 		size_t wrt = sizeof(buffer_t)*8 - num;
 		if (wrt == 0) {
+			bv->num = num;
 			bitval_flush_write(bv);
 			num = 0;
 			wrt = sizeof(buffer_t)*8;
@@ -213,7 +214,7 @@ bitval_read_hbits(struct bitval *bv, size_t n) {
 		bitval_fill_hibuf(bv);
 	}
 
-	val |= (bv->buf & (~0 << (sizeof(buffer_t)*8 - n))) >> num;
+	val |= (bv->buf & (~(buffer_t)0 << (sizeof(buffer_t)*8 - n))) >> num;
 
 	bv->buf <<= n;
 	bv->num -= n;
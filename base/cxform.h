@@ -80,7 +80,7 @@ cxform_identify(struct cxform *cx) {
 	ux->u32.add[1] = ADD32;
 #elif defined(__LP64__)
 	ux->u64.mul[0] = MUL64;
-	ux->u64.add[0] = MUL64;
+	ux->u64.add[0] = ADD64;
 #endif
 }
 
@@ -16,7 +16,7 @@ fixed_mul(fixed_t ratio, intreg_t num) {
 
 static inline fixed_t
 fixed_div(fixed_t a, fixed_t b) {
-	return (fixed_t)(((int64_t)a << 16)/(int64_t)b);
+	return (fixed_t)(((int64_t)a * FIXED_1)/(int64_t)b);
 }
 
 #endif
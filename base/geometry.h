@@ -5,7 +5,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
-typedef uint32_t coord_t;
+typedef int32_t coord_t;
 
 struct point {
 	coord_t x;
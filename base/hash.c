@@ -0,0 +1,46 @@
+#include "hash.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// FNV-1a over 64-bit little endian words in four interleaved lanes, so that
+// multiplications of lanes overlap, finished with a mixer so that every
+// input bit affects all output bits.
+#define HASH_BASIS	UINT64_C(0xcbf29ce484222325)
+#define HASH_PRIME	UINT64_C(0x100000001b3)
+
+static inline uint64_t
+hash_word(const uint8_t *p) {
+	return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24 |
+		(uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+static inline uint64_t
+hash_mix(uint64_t h) {
+	h ^= h >> 33;
+	h *= UINT64_C(0xff51afd7ed558ccd);
+	h ^= h >> 33;
+	h *= UINT64_C(0xc4ceb9fe1a85ec53);
+	h ^= h >> 33;
+	return h;
+}
+
+uint64_t
+hash_bytes(const void *data, size_t size) {
+	const uint8_t *p = data;
+	uint64_t h[4] = {HASH_BASIS ^ (uint64_t)size, HASH_BASIS+1, HASH_BASIS+2, HASH_BASIS+3};
+	size_t n = size / 32;
+	for (size_t i=0; i<n; i++, p+=32) {
+		h[0] = (h[0] ^ hash_word(p)) * HASH_PRIME;
+		h[1] = (h[1] ^ hash_word(p+8)) * HASH_PRIME;
+		h[2] = (h[2] ^ hash_word(p+16)) * HASH_PRIME;
+		h[3] = (h[3] ^ hash_word(p+24)) * HASH_PRIME;
+	}
+	uint8_t tail[32] = {0};
+	memcpy(tail, p, size % 32);
+	for (size_t i=0; i<4; i++) {
+		h[i] = (h[i] ^ hash_word(tail+8*i)) * HASH_PRIME;
+	}
+	return hash_mix(hash_mix(h[0]) ^ hash_mix(h[1] + h[2]) ^ hash_mix(h[3]) * HASH_PRIME);
+}
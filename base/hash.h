@@ -0,0 +1,11 @@
+#ifndef __HASH_H
+#define __HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Non-cryptographic 64-bit hash of content, for identifying content
+// across processes. Result doesn't depend on alignment of data.
+uint64_t hash_bytes(const void *data, size_t size);
+
+#endif
@@ -0,0 +1,58 @@
+#include "hash.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void
+hash_test_stable(void) {
+	printf("hash_test_stable(), start.\n");
+	static const char text[] = "FWS hashed content, longer than a word";
+	uint64_t h = hash_bytes(text, sizeof(text));
+	assert(h == hash_bytes(text, sizeof(text)));
+	assert(h != hash_bytes(text, sizeof(text)-1));
+	assert(hash_bytes("", 0) != hash_bytes("\0", 1));
+	printf("hash_test_stable(), done.\n");
+}
+
+static void
+hash_test_unaligned(void) {
+	printf("hash_test_unaligned(), start.\n");
+	char buf[64+8];
+	for (size_t i=0; i<sizeof(buf); i++) {
+		buf[i] = (char)(i*7);
+	}
+	char copy[64+8];
+	for (size_t off=1; off<8; off++) {
+		memcpy(copy+off, buf, 64);
+		assert(hash_bytes(copy+off, 64) == hash_bytes(buf, 64));
+	}
+	printf("hash_test_unaligned(), done.\n");
+}
+
+static void
+hash_test_bits(void) {
+	printf("hash_test_bits(), start.\n");
+	unsigned char buf[24] = {0};
+	uint64_t h = hash_bytes(buf, sizeof(buf));
+	for (size_t i=0; i<sizeof(buf)*8; i++) {
+		buf[i/8] ^= (unsigned char)(1 << (i%8));
+		assert(hash_bytes(buf, sizeof(buf)) != h);
+		buf[i/8] ^= (unsigned char)(1 << (i%8));
+	}
+	printf("hash_test_bits(), done.\n");
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	setvbuf(stderr, NULL, _IONBF, 0);
+
+	printf("Test hash, start.\n");
+	hash_test_stable();
+	hash_test_unaligned();
+	hash_test_bits();
+	printf("Test hash, done.\n");
+	return 0;
+}
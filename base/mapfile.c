@@ -0,0 +1,78 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "mapfile.h"
+#include "compat.h"
+#include "hash.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const void *
+mapfile_open(const char *path, size_t *sizep) {
+	assert(path != NULL && sizep != NULL);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat st;
+	void *ptr = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	// Mapping holds its own reference to file.
+	close(fd);
+	if (ptr == MAP_FAILED) {
+		return NULL;
+	}
+	*sizep = (size_t)st.st_size;
+	return ptr;
+}
+
+void
+mapfile_close(const void *ptr, size_t size) {
+	if (ptr != NULL) {
+		munmap((void *)ptr, size);
+	}
+}
+
+uint64_t
+mapfile_stamp(const char *path) {
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		return 0;
+	}
+	uint64_t fields[4] = {(uint64_t)st.st_dev, (uint64_t)st.st_ino, (uint64_t)st.st_size, (uint64_t)st.st_mtime};
+	uint64_t stamp = hash_bytes(fields, sizeof(fields));
+	return stamp != 0 ? stamp : 1;
+}
+
+static int
+advice2posix(enum mapfile_advice adv) {
+	switch (adv) {
+	case MapfileAdviceSequential:
+		return POSIX_MADV_SEQUENTIAL;
+	case MapfileAdviceWillneed:
+		return POSIX_MADV_WILLNEED;
+	default:
+		return POSIX_MADV_NORMAL;
+	}
+}
+
+void
+mapfile_advise(const void *ptr, size_t size, size_t off, size_t len, enum mapfile_advice adv) {
+	if (off >= size) {
+		return;
+	}
+	if (len > size - off) {
+		len = size - off;
+	}
+	// Advised address must be page aligned.
+	uintptr_t mask = (uintptr_t)sysconf(_SC_PAGESIZE) - 1;
+	uintptr_t beg = ((uintptr_t)ptr + off) & ~mask;
+	uintptr_t end = (uintptr_t)ptr + off + len;
+	posix_madvise((void *)beg, (size_t)(end - beg), advice2posix(adv));
+}
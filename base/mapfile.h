@@ -0,0 +1,32 @@
+#ifndef __MAPFILE_H
+#define __MAPFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Read-only, shared mapping of a whole file. Pages of the same file are
+// shared through page cache among all processes mapping it.
+
+enum mapfile_advice {
+	MapfileAdviceNormal,
+	MapfileAdviceSequential,
+	MapfileAdviceWillneed,
+};
+
+// Map file at path, store its size in *sizep.
+// Return NULL if file can't be opened, is empty or can't be mapped.
+const void *mapfile_open(const char *path, size_t *sizep);
+
+// Ptr and size must be returned by mapfile_open().
+void mapfile_close(const void *ptr, size_t size);
+
+// Identify version of file at path by its device, inode, size and
+// modification time, which change when file is replaced or rewritten.
+// Return 0 if file can't be stat'ed.
+uint64_t mapfile_stamp(const char *path);
+
+// Hint kernel about access pattern of [ptr+off, ptr+off+len), clipped to size.
+// Hints are advisory, failure is ignored.
+void mapfile_advise(const void *ptr, size_t size, size_t off, size_t len, enum mapfile_advice adv);
+
+#endif
@@ -0,0 +1,75 @@
+#include "mapfile.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void
+mapfile_test_open(const char *path) {
+	printf("mapfile_test_open(), start.\n");
+	static const char content[] = "FWS mapped content";
+	FILE *fp = fopen(path, "wb");			assert(fp != NULL);
+	size_t n = fwrite(content, 1, sizeof(content), fp);	assert(n == sizeof(content));
+	fclose(fp);
+
+	size_t size = 0;
+	const void *ptr = mapfile_open(path, &size);	assert(ptr != NULL);
+	assert(size == sizeof(content));
+	assert(memcmp(ptr, content, size) == 0);
+	mapfile_advise(ptr, size, 0, size, MapfileAdviceSequential);
+	mapfile_advise(ptr, size, 4, 4096, MapfileAdviceWillneed);
+	mapfile_advise(ptr, size, size+1, 10, MapfileAdviceWillneed);
+	assert(memcmp(ptr, content, size) == 0);
+	mapfile_close(ptr, size);
+	remove(path);
+	printf("mapfile_test_open(), done.\n");
+}
+
+static void
+mapfile_test_stamp(const char *path) {
+	printf("mapfile_test_stamp(), start.\n");
+	remove(path);
+	assert(mapfile_stamp(path) == 0);
+
+	FILE *fp = fopen(path, "wb");			assert(fp != NULL);
+	fputs("FWS", fp);
+	fclose(fp);
+	uint64_t stamp = mapfile_stamp(path);		assert(stamp != 0);
+	assert(mapfile_stamp(path) == stamp);
+
+	fp = fopen(path, "ab");				assert(fp != NULL);
+	fputs(" grown", fp);
+	fclose(fp);
+	assert(mapfile_stamp(path) != stamp);
+	remove(path);
+	printf("mapfile_test_stamp(), done.\n");
+}
+
+static void
+mapfile_test_missing(const char *path) {
+	printf("mapfile_test_missing(), start.\n");
+	remove(path);
+	size_t size = 0;
+	const void *ptr = mapfile_open(path, &size);	assert(ptr == NULL);
+	assert(size == 0);
+
+	FILE *fp = fopen(path, "wb");			assert(fp != NULL);
+	fclose(fp);
+	ptr = mapfile_open(path, &size);		assert(ptr == NULL);
+	remove(path);
+	printf("mapfile_test_missing(), done.\n");
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	setvbuf(stderr, NULL, _IONBF, 0);
+
+	printf("Test mapfile, start.\n");
+	mapfile_test_open("mapfile_test.swf");
+	mapfile_test_missing("mapfile_test.swf");
+	mapfile_test_stamp("mapfile_test.swf");
+	printf("Test mapfile, done.\n");
+	return 0;
+}
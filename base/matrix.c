@@ -20,11 +20,32 @@ matrix_transform_ycoord(const struct matrix *mx, const struct point *pt) {
 void
 matrix_transform_point(const struct matrix *mx, struct point *pt) {
 	coord_t x = matrix_transform_xcoord(mx, pt);
-	coord_t y = matrix_transform_xcoord(mx, pt);
+	coord_t y = matrix_transform_ycoord(mx, pt);
 	pt->x = x;
 	pt->y = y;
 }
 
+void
+matrix_transform_rectangle(const struct matrix *mx, struct rectangle *rt) {
+	struct point pts[4] = {
+		{rt->xmin, rt->ymin},
+		{rt->xmax, rt->ymin},
+		{rt->xmin, rt->ymax},
+		{rt->xmax, rt->ymax},
+	};
+	for (size_t i=0; i<4; i++) {
+		matrix_transform_point(mx, &pts[i]);
+	}
+	rt->xmin = rt->xmax = pts[0].x;
+	rt->ymin = rt->ymax = pts[0].y;
+	for (size_t i=1; i<4; i++) {
+		rt->xmin = pts[i].x < rt->xmin ? pts[i].x : rt->xmin;
+		rt->xmax = pts[i].x > rt->xmax ? pts[i].x : rt->xmax;
+		rt->ymin = pts[i].y < rt->ymin ? pts[i].y : rt->ymin;
+		rt->ymax = pts[i].y > rt->ymax ? pts[i].y : rt->ymax;
+	}
+}
+
 void
 matrix_identify(struct matrix *mx) {
 	mx->sx = mx->sy = FIXED_1;
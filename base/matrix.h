@@ -25,6 +25,8 @@ void matrix_invert(struct matrix *mx);
 coord_t matrix_transform_xcoord(const struct matrix *mx, const struct point *pt);
 coord_t matrix_transform_ycoord(const struct matrix *mx, const struct point *pt);
 void matrix_transform_point(const struct matrix *mx, struct point *pt);
+// Bounding box of transformed rectangle.
+void matrix_transform_rectangle(const struct matrix *mx, struct rectangle *rt);
 
 struct bitval;
 void bitval_read_matrix(struct bitval *bv, struct matrix *mx);
@@ -0,0 +1,117 @@
+#include "region.h"
+
+#include <stdint.h>
+
+static inline int64_t
+rectangle_area(const struct rectangle *rt) {
+	return (int64_t)(rt->xmax - rt->xmin) * (int64_t)(rt->ymax - rt->ymin);
+}
+
+static inline void
+region_remove(struct region *rg, size_t i) {
+	rg->rects[i] = rg->rects[--rg->n];
+}
+
+void
+region_clear(struct region *rg) {
+	rg->n = 0;
+}
+
+void
+region_add(struct region *rg, const struct rectangle *rt) {
+	if (rectangle_empty(rt)) {
+		return;
+	}
+	struct rectangle in = *rt;
+	// Union may overlap rectangles passed over, so start again.
+	for (size_t i=0; i<rg->n; ) {
+		if (rectangle_intersect(&rg->rects[i], &in)) {
+			rectangle_union(&in, &rg->rects[i]);
+			region_remove(rg, i);
+			i = 0;
+		} else {
+			i++;
+		}
+	}
+	if (rg->n == REGION_NRECT) {
+		// Merge in pair of least wasted area, new rectangle included.
+		size_t bi = 0, bj = REGION_NRECT;
+		int64_t best = INT64_MAX;
+		for (size_t i=0; i<REGION_NRECT; i++) {
+			const struct rectangle *a = &rg->rects[i];
+			for (size_t j=i+1; j<=REGION_NRECT; j++) {
+				const struct rectangle *b = j == REGION_NRECT ? &in : &rg->rects[j];
+				struct rectangle u = *a;
+				rectangle_union(&u, b);
+				int64_t waste = rectangle_area(&u) - rectangle_area(a) - rectangle_area(b);
+				if (waste < best) {
+					best = waste;
+					bi = i;
+					bj = j;
+				}
+			}
+		}
+		struct rectangle u = rg->rects[bi];
+		if (bj == REGION_NRECT) {
+			rectangle_union(&u, &in);
+			region_remove(rg, bi);
+		} else {
+			rectangle_union(&u, &rg->rects[bj]);
+			// Remove higher index first, lower one is not moved then.
+			region_remove(rg, bj);
+			region_remove(rg, bi);
+			rg->rects[rg->n++] = in;
+		}
+		// Merged rectangle may overlap others.
+		region_add(rg, &u);
+		return;
+	}
+	rg->rects[rg->n++] = in;
+}
+
+void
+region_clip(struct region *rg, const struct rectangle *clip) {
+	for (size_t i=0; i<rg->n; ) {
+		struct rectangle *rt = &rg->rects[i];
+		rt->xmin = rt->xmin < clip->xmin ? clip->xmin : rt->xmin;
+		rt->xmax = rt->xmax > clip->xmax ? clip->xmax : rt->xmax;
+		rt->ymin = rt->ymin < clip->ymin ? clip->ymin : rt->ymin;
+		rt->ymax = rt->ymax > clip->ymax ? clip->ymax : rt->ymax;
+		if (rectangle_empty(rt)) {
+			region_remove(rg, i);
+		} else {
+			i++;
+		}
+	}
+}
+
+bool
+region_intersect(const struct region *rg, const struct rectangle *rt) {
+	for (size_t i=0; i<rg->n; i++) {
+		if (rectangle_intersect(&rg->rects[i], rt)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void
+region_bounds(const struct region *rg, struct rectangle *rt) {
+	if (rg->n == 0) {
+		rt->xmin = rt->xmax = rt->ymin = rt->ymax = 0;
+		return;
+	}
+	*rt = rg->rects[0];
+	for (size_t i=1; i<rg->n; i++) {
+		rectangle_union(rt, &rg->rects[i]);
+	}
+}
+
+size_t
+region_area(const struct region *rg) {
+	int64_t area = 0;
+	for (size_t i=0; i<rg->n; i++) {
+		area += rectangle_area(&rg->rects[i]);
+	}
+	return (size_t)area;
+}
@@ -0,0 +1,52 @@
+#ifndef __REGION_H
+#define __REGION_H
+
+#include "geometry.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define REGION_NRECT	8
+
+// Union of up to REGION_NRECT disjoint rectangles, half-open as
+// [xmin, xmax) x [ymin, ymax). Rectangles overlapping added one are merged
+// into it, rectangles wasting least area are merged once region is full.
+// So region covers all added rectangles, maybe with a bit more.
+struct region {
+	size_t n;
+	struct rectangle rects[REGION_NRECT];
+};
+
+void region_clear(struct region *rg);
+void region_add(struct region *rg, const struct rectangle *rt);
+// Intersect rectangles of region with clip.
+void region_clip(struct region *rg, const struct rectangle *clip);
+bool region_intersect(const struct region *rg, const struct rectangle *rt);
+// Bounds of region, empty rectangle at origin if region is empty.
+void region_bounds(const struct region *rg, struct rectangle *rt);
+size_t region_area(const struct region *rg);
+
+static inline bool
+rectangle_empty(const struct rectangle *rt) {
+	return rt->xmin >= rt->xmax || rt->ymin >= rt->ymax;
+}
+
+static inline bool
+rectangle_intersect(const struct rectangle *a, const struct rectangle *b) {
+	return a->xmin < b->xmax && b->xmin < a->xmax && a->ymin < b->ymax && b->ymin < a->ymax;
+}
+
+static inline void
+rectangle_union(struct rectangle *rt, const struct rectangle *in) {
+	rt->xmin = in->xmin < rt->xmin ? in->xmin : rt->xmin;
+	rt->xmax = in->xmax > rt->xmax ? in->xmax : rt->xmax;
+	rt->ymin = in->ymin < rt->ymin ? in->ymin : rt->ymin;
+	rt->ymax = in->ymax > rt->ymax ? in->ymax : rt->ymax;
+}
+
+static inline bool
+rectangle_contain(const struct rectangle *outer, const struct rectangle *rt) {
+	return outer->xmin <= rt->xmin && rt->xmax <= outer->xmax && outer->ymin <= rt->ymin && rt->ymax <= outer->ymax;
+}
+
+#endif
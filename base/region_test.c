@@ -0,0 +1,100 @@
+#include "region.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GRID	64
+
+static uint32_t
+region_test_random(uint32_t *seed) {
+	*seed = *seed*1103515245 + 12345;
+	return *seed >> 8;
+}
+
+static void
+region_test_merge(void) {
+	printf("region_test_merge(), start.\n");
+	struct region rg;
+	region_clear(&rg);
+	struct rectangle a = {0, 10, 0, 10};
+	struct rectangle b = {20, 30, 0, 10};
+	struct rectangle c = {5, 25, 5, 8};
+	struct rectangle e = {3, 3, 0, 10};
+	region_add(&rg, &a);
+	region_add(&rg, &e);
+	assert(rg.n == 1);
+	region_add(&rg, &b);
+	assert(rg.n == 2);
+	// Rectangles touching are kept apart.
+	struct rectangle d = {10, 20, 0, 10};
+	assert(!rectangle_intersect(&a, &d));
+	// Overlapping both of them.
+	region_add(&rg, &c);
+	assert(rg.n == 1);
+	struct rectangle rt;
+	region_bounds(&rg, &rt);
+	assert(rt.xmin == 0 && rt.xmax == 30 && rt.ymin == 0 && rt.ymax == 10);
+	struct rectangle clip = {-5, 15, 2, 4};
+	region_clip(&rg, &clip);
+	assert(rg.n == 1 && region_area(&rg) == 15*2);
+	region_clip(&rg, &b);
+	assert(rg.n == 0);
+	region_bounds(&rg, &rt);
+	assert(rectangle_empty(&rt));
+	printf("region_test_merge(), done.\n");
+}
+
+// Region covers all rectangles added, and its rectangles are disjoint.
+static void
+region_test_cover(void) {
+	printf("region_test_cover(), start.\n");
+	uint32_t seed = 17;
+	for (size_t round=0; round<500; round++) {
+		static bool covered[GRID][GRID];
+		memset(covered, 0, sizeof(covered));
+		struct region rg;
+		region_clear(&rg);
+		size_t n = region_test_random(&seed)%40;
+		for (size_t k=0; k<n; k++) {
+			struct rectangle rt;
+			rt.xmin = (coord_t)(region_test_random(&seed)%GRID);
+			rt.ymin = (coord_t)(region_test_random(&seed)%GRID);
+			rt.xmax = rt.xmin + (coord_t)(region_test_random(&seed)%(GRID-rt.xmin+1));
+			rt.ymax = rt.ymin + (coord_t)(region_test_random(&seed)%(GRID-rt.ymin+1));
+			region_add(&rg, &rt);
+			for (coord_t y=rt.ymin; y<rt.ymax; y++) {
+				for (coord_t x=rt.xmin; x<rt.xmax; x++) {
+					covered[y][x] = true;
+				}
+			}
+			assert(rg.n <= REGION_NRECT);
+		}
+		for (size_t i=0; i<rg.n; i++) {
+			assert(!rectangle_empty(&rg.rects[i]));
+			for (size_t j=i+1; j<rg.n; j++) {
+				assert(!rectangle_intersect(&rg.rects[i], &rg.rects[j]));
+			}
+		}
+		for (coord_t y=0; y<GRID; y++) {
+			for (coord_t x=0; x<GRID; x++) {
+				struct rectangle px = {x, x+1, y, y+1};
+				assert(!covered[y][x] || region_intersect(&rg, &px));
+			}
+		}
+	}
+	printf("region_test_cover(), done.\n");
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	setvbuf(stderr, NULL, _IONBF, 0);
+
+	printf("Test region, start.\n");
+	region_test_merge();
+	region_test_cover();
+	printf("Test region, done.\n");
+	return 0;
+}
@@ -0,0 +1,550 @@
+#include "span.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// x86 kernels are compiled for their isa by function attributes, so the
+// rest of the build keeps its baseline flags and cpu is probed at runtime.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPAN_X86
+#include <immintrin.h>
+#define SPAN_TARGET(isa)	__attribute__((target(isa)))
+#endif
+
+// Rounded x/255 for x in [0, 255*255].
+static inline uint32_t
+span_div255(uint32_t x) {
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static inline void
+span_over(struct rgba8 *d, struct rgba8 c, uint32_t cv) {
+	uint32_t a = (c.a*cv) >> 8;
+	uint32_t inv = 255 - a;
+	d->r = (uint8_t)(((c.r*cv) >> 8) + span_div255(d->r*inv));
+	d->g = (uint8_t)(((c.g*cv) >> 8) + span_div255(d->g*inv));
+	d->b = (uint8_t)(((c.b*cv) >> 8) + span_div255(d->b*inv));
+	d->a = (uint8_t)(a + span_div255(d->a*inv));
+}
+
+static void
+span_scalar_fill(struct rgba8 *dst, size_t n, struct rgba8 c) {
+	for (size_t i=0; i<n; i++) {
+		dst[i] = c;
+	}
+}
+
+static void
+span_scalar_blend(struct rgba8 *dst, size_t n, struct rgba8 c) {
+	if (c.a == 255) {
+		span_scalar_fill(dst, n, c);
+		return;
+	}
+	for (size_t i=0; i<n; i++) {
+		span_over(&dst[i], c, 256);
+	}
+}
+
+static size_t
+span_scalar_blend_cover(struct rgba8 *dst, uint16_t *cover, size_t n, struct rgba8 c) {
+	size_t covered = 0;
+	for (size_t i=0; i<n; i++) {
+		uint32_t cv = cover[i];
+		if (cv == 0) {
+			continue;
+		}
+		cover[i] = 0;
+		covered++;
+		span_over(&dst[i], c, cv > 256 ? 256 : cv);
+	}
+	return covered;
+}
+
+static size_t
+span_scalar_blend_cover_pixels(struct rgba8 *dst, uint16_t *cover, const struct rgba8 *src, size_t n) {
+	size_t covered = 0;
+	for (size_t i=0; i<n; i++) {
+		uint32_t cv = cover[i];
+		if (cv == 0) {
+			continue;
+		}
+		cover[i] = 0;
+		covered++;
+		span_over(&dst[i], src[i], cv > 256 ? 256 : cv);
+	}
+	return covered;
+}
+
+static void
+span_scalar_blend_pixels(struct rgba8 *dst, const struct rgba8 *src, size_t n) {
+	for (size_t i=0; i<n; i++) {
+		if (src[i].a == 255) {
+			dst[i] = src[i];
+		} else if (src[i].a != 0 || src[i].r != 0 || src[i].g != 0 || src[i].b != 0) {
+			span_over(&dst[i], src[i], 256);
+		}
+	}
+}
+
+static int32_t
+span_scalar_accumulate(uint16_t *cover, int32_t *dy, int32_t *area, size_t n, int32_t acc) {
+	for (size_t i=0; i<n; i++) {
+		acc += dy[i];
+		int32_t c = ((acc*512 - area[i]) >> 9) & 511;
+		cover[i] = (uint16_t)(c > 256 ? 512 - c : c);
+		dy[i] = 0;
+		area[i] = 0;
+	}
+	return acc;
+}
+
+static int32_t
+span_scalar_accumulate_nonzero(uint16_t *cover, int32_t *dy, int32_t *area, size_t n, int32_t acc) {
+	for (size_t i=0; i<n; i++) {
+		acc += dy[i];
+		int32_t c = abs((acc*512 - area[i]) >> 9);
+		cover[i] = (uint16_t)(c > 256 ? 256 : c);
+		dy[i] = 0;
+		area[i] = 0;
+	}
+	return acc;
+}
+
+static const struct spanface SpanScalar = {
+	.name = "scalar",
+	.fill = span_scalar_fill,
+	.blend = span_scalar_blend,
+	.blend_cover = span_scalar_blend_cover,
+	.blend_cover_pixels = span_scalar_blend_cover_pixels,
+	.blend_pixels = span_scalar_blend_pixels,
+	.accumulate = span_scalar_accumulate,
+	.accumulate_nonzero = span_scalar_accumulate_nonzero,
+};
+
+#ifdef SPAN_X86
+
+static inline uint32_t
+span_pack(struct rgba8 c) {
+	uint32_t u;
+	memcpy(&u, &c, sizeof(u));
+	return u;
+}
+
+// SSE2 kernels work on 4 pixels, 2 pixels per register after widening
+// channels to 16 bits.
+
+// Composite widened color c scaled by widened cover cv over widened d.
+SPAN_TARGET("sse2") static inline __m128i
+span_sse2_over(__m128i d, __m128i c, __m128i cv) {
+	__m128i s = _mm_srli_epi16(_mm_mullo_epi16(c, cv), 8);
+	__m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), s);
+	inv = _mm_shufflelo_epi16(inv, _MM_SHUFFLE(3, 3, 3, 3));
+	inv = _mm_shufflehi_epi16(inv, _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i x = _mm_add_epi16(_mm_mullo_epi16(d, inv), _mm_set1_epi16(128));
+	x = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+	return _mm_add_epi16(s, x);
+}
+
+SPAN_TARGET("sse2") static void
+span_sse2_fill(struct rgba8 *dst, size_t n, struct rgba8 c) {
+	__m128i solid = _mm_set1_epi32((int)span_pack(c));
+	size_t i = 0;
+	for (; i+4 <= n; i += 4) {
+		_mm_storeu_si128((__m128i *)(dst+i), solid);
+	}
+	span_scalar_fill(dst+i, n-i, c);
+}
+
+SPAN_TARGET("sse2") static void
+span_sse2_blend(struct rgba8 *dst, size_t n, struct rgba8 c) {
+	if (c.a == 255) {
+		span_sse2_fill(dst, n, c);
+		return;
+	}
+	const __m128i zero = _mm_setzero_si128();
+	__m128i color = _mm_unpacklo_epi8(_mm_set1_epi32((int)span_pack(c)), zero);
+	__m128i full = _mm_set1_epi16(256);
+	size_t i = 0;
+	for (; i+4 <= n; i += 4) {
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst+i));
+		__m128i lo = span_sse2_over(_mm_unpacklo_epi8(d, zero), color, full);
+		__m128i hi = span_sse2_over(_mm_unpackhi_epi8(d, zero), color, full);
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_packus_epi16(lo, hi));
+	}
+	span_scalar_blend(dst+i, n-i, c);
+}
+
+SPAN_TARGET("sse2") static size_t
+span_sse2_blend_cover(struct rgba8 *dst, uint16_t *cover, size_t n, struct rgba8 c) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi16(256);
+	__m128i solid = _mm_set1_epi32((int)span_pack(c));
+	__m128i color = _mm_unpacklo_epi8(solid, zero);
+	bool opaque = c.a == 255;
+	size_t covered = 0;
+	size_t i = 0;
+	for (; i+4 <= n; i += 4) {
+		__m128i cv = _mm_loadl_epi64((const __m128i *)(cover+i));
+		int empty = _mm_movemask_epi8(_mm_cmpeq_epi16(cv, zero)) & 0xFF;
+		if (empty == 0xFF) {
+			continue;
+		}
+		covered += 4 - (size_t)__builtin_popcount((unsigned)empty)/2;
+		_mm_storel_epi64((__m128i *)(cover+i), zero);
+		cv = _mm_min_epi16(cv, full);
+		if (opaque && (_mm_movemask_epi8(_mm_cmpeq_epi16(cv, full)) & 0xFF) == 0xFF) {
+			_mm_storeu_si128((__m128i *)(dst+i), solid);
+			continue;
+		}
+		// Each 32 bits holds cover of a pixel twice, duplicated again to
+		// cover 4 channels.
+		__m128i cv32 = _mm_unpacklo_epi16(cv, zero);
+		cv32 = _mm_or_si128(cv32, _mm_slli_epi32(cv32, 16));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst+i));
+		__m128i lo = span_sse2_over(_mm_unpacklo_epi8(d, zero), color, _mm_unpacklo_epi32(cv32, cv32));
+		__m128i hi = span_sse2_over(_mm_unpackhi_epi8(d, zero), color, _mm_unpackhi_epi32(cv32, cv32));
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_packus_epi16(lo, hi));
+	}
+	return covered + span_scalar_blend_cover(dst+i, cover+i, n-i, c);
+}
+
+SPAN_TARGET("sse2") static size_t
+span_sse2_blend_cover_pixels(struct rgba8 *dst, uint16_t *cover, const struct rgba8 *src, size_t n) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi16(256);
+	const __m128i ones = _mm_set1_epi32(-1);
+	const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+	size_t covered = 0;
+	size_t i = 0;
+	for (; i+4 <= n; i += 4) {
+		__m128i cv = _mm_loadl_epi64((const __m128i *)(cover+i));
+		int empty = _mm_movemask_epi8(_mm_cmpeq_epi16(cv, zero)) & 0xFF;
+		if (empty == 0xFF) {
+			continue;
+		}
+		covered += 4 - (size_t)__builtin_popcount((unsigned)empty)/2;
+		_mm_storel_epi64((__m128i *)(cover+i), zero);
+		cv = _mm_min_epi16(cv, full);
+		__m128i s = _mm_loadu_si128((const __m128i *)(src+i));
+		if ((_mm_movemask_epi8(_mm_cmpeq_epi16(cv, full)) & 0xFF) == 0xFF
+			&& _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_or_si128(s, rgb), ones)) == 0xFFFF) {
+			_mm_storeu_si128((__m128i *)(dst+i), s);
+			continue;
+		}
+		__m128i cv32 = _mm_unpacklo_epi16(cv, zero);
+		cv32 = _mm_or_si128(cv32, _mm_slli_epi32(cv32, 16));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst+i));
+		__m128i lo = span_sse2_over(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi32(cv32, cv32));
+		__m128i hi = span_sse2_over(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi32(cv32, cv32));
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_packus_epi16(lo, hi));
+	}
+	return covered + span_scalar_blend_cover_pixels(dst+i, cover+i, src+i, n-i);
+}
+
+// Runs of transparent pixels are skipped, runs of opaque ones copied.
+SPAN_TARGET("sse2") static void
+span_sse2_blend_pixels(struct rgba8 *dst, const struct rgba8 *src, size_t n) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi16(256);
+	const __m128i ones = _mm_set1_epi32(-1);
+	const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+	size_t i = 0;
+	for (; i+4 <= n; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src+i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xFFFF) {
+			continue;
+		}
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_or_si128(s, rgb), ones)) == 0xFFFF) {
+			_mm_storeu_si128((__m128i *)(dst+i), s);
+			continue;
+		}
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst+i));
+		__m128i lo = span_sse2_over(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), full);
+		__m128i hi = span_sse2_over(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), full);
+		_mm_storeu_si128((__m128i *)(dst+i), _mm_packus_epi16(lo, hi));
+	}
+	span_scalar_blend_pixels(dst+i, src+i, n-i);
+}
+
+// Prefix sum of 4 cells takes two shifted adds. Folded cover fits in 16
+// bits, where min(c, 512-c) folds it by even-odd rule, or min(|c|, 256) by
+// nonzero rule.
+SPAN_TARGET("sse2") static inline int32_t
+span_sse2_accumulate_rule(uint16_t *cover, int32_t *dy, int32_t *area, size_t n, int32_t acc, bool nonzero) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i mask = _mm_set1_epi32(511);
+	const __m128i period = _mm_set1_epi16(512);
+	const __m128i full = _mm_set1_epi16(256);
+	__m128i sum = _mm_set1_epi32(acc);
+	size_t i = 0;
+	for (; i+4 <= n; i += 4) {
+		__m128i d = _mm_loadu_si128((const __m128i *)(dy+i));
+		d = _mm_add_epi32(d, _mm_slli_si128(d, 4));
+		d = _mm_add_epi32(d, _mm_slli_si128(d, 8));
+		d = _mm_add_epi32(d, sum);
+		sum = _mm_shuffle_epi32(d, _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i v = _mm_sub_epi32(_mm_slli_epi32(d, 9), _mm_loadu_si128((const __m128i *)(area+i)));
+		__m128i c = _mm_srai_epi32(v, 9);
+		if (nonzero) {
+			__m128i sign = _mm_srai_epi32(c, 31);
+			c = _mm_sub_epi32(_mm_xor_si128(c, sign), sign);
+			c = _mm_packs_epi32(c, c);
+			c = _mm_min_epi16(c, full);
+		} else {
+			c = _mm_packs_epi32(_mm_and_si128(c, mask), c);
+			c = _mm_min_epi16(c, _mm_sub_epi16(period, c));
+		}
+		_mm_storel_epi64((__m128i *)(cover+i), c);
+		_mm_storeu_si128((__m128i *)(dy+i), zero);
+		_mm_storeu_si128((__m128i *)(area+i), zero);
+	}
+	acc = _mm_cvtsi128_si32(sum);
+	if (nonzero) {
+		return span_scalar_accumulate_nonzero(cover+i, dy+i, area+i, n-i, acc);
+	}
+	return span_scalar_accumulate(cover+i, dy+i, area+i, n-i, acc);
+}
+
+SPAN_TARGET("sse2") static int32_t
+span_sse2_accumulate(uint16_t *cover, int32_t *dy, int32_t *area, size_t n, int32_t acc) {
+	return span_sse2_accumulate_rule(cover, dy, area, n, acc, false);
+}
+
+SPAN_TARGET("sse2") static int32_t
+span_sse2_accumulate_nonzero(uint16_t *cover, int32_t *dy, int32_t *area, size_t n, int32_t acc) {
+	return span_sse2_accumulate_rule(cover, dy, area, n, acc, true);
+}
+
+static const struct spanface SpanSse2 = {
+	.name = "sse2",
+	.fill = span_sse2_fill,
+	.blend = span_sse2_blend,
+	.blend_cover = span_sse2_blend_cover,
+	.blend_cover_pixels = span_sse2_blend_cover_pixels,
+	.blend_pixels = span_sse2_blend_pixels,
+	.accumulate = span_sse2_accumulate,
+	.accumulate_nonzero = span_sse2_accumulate_nonzero,
+};
+
+// AVX2 kernels work on 8 pixels. Widening unpacks within 128 bits lanes,
+// so low half holds pixels 0, 1, 4, 5 and high half holds 2, 3, 6, 7.
+
+SPAN_TARGET("avx2") static inline __m256i
+span_avx2_over(__m256i d, __m256i c, __m256i cv) {
+	__m256i s = _mm256_srli_epi16(_mm256_mullo_epi16(c, cv), 8);
+	__m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(255), s);
+	inv = _mm256_shufflelo_epi16(inv, _MM_SHUFFLE(3, 3, 3, 3));
+	inv = _mm256_shufflehi_epi16(inv, _MM_SHUFFLE(3, 3, 3, 3));
+	__m256i x = _mm256_add_epi16(_mm256_mullo_epi16(d, inv), _mm256_set1_epi16(128));
+	x = _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+	return _mm256_add_epi16(s, x);
+}
+
+SPAN_TARGET("avx2") static void
+span_avx2_fill(struct rgba8 *dst, size_t n, struct rgba8 c) {
+	__m256i solid = _mm256_set1_epi32((int)span_pack(c));
+	size_t i = 0;
+	for (; i+8 <= n; i += 8) {
+		_mm256_storeu_si256((__m256i *)(dst+i), solid);
+	}
+	span_scalar_fill(dst+i, n-i, c);
+}
+
+SPAN_TARGET("avx2") static void
+span_avx2_blend(struct rgba8 *dst, size_t n, struct rgba8 c) {
+	if (c.a == 255) {
+		span_avx2_fill(dst, n, c);
+		return;
+	}
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i color = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)span_pack(c)), zero);
+	__m256i full = _mm256_set1_epi16(256);
+	size_t i = 0;
+	for (; i+8 <= n; i += 8) {
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst+i));
+		__m256i lo = span_avx2_over(_mm256_unpacklo_epi8(d, zero), color, full);
+		__m256i hi = span_avx2_over(_mm256_unpackhi_epi8(d, zero), color, full);
+		_mm256_storeu_si256((__m256i *)(dst+i), _mm256_packus_epi16(lo, hi));
+	}
+	span_scalar_blend(dst+i, n-i, c);
+}
+
+SPAN_TARGET("avx2") static size_t
+span_avx2_blend_cover(struct rgba8 *dst, uint16_t *cover, size_t n, struct rgba8 c) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m128i zero128 = _mm_setzero_si128();
+	const __m128i full128 = _mm_set1_epi16(256);
+	__m256i solid = _mm256_set1_epi32((int)span_pack(c));
+	__m256i color = _mm256_unpacklo_epi8(solid, zero);
+	bool opaque = c.a == 255;
+	size_t covered = 0;
+	size_t i = 0;
+	for (; i+8 <= n; i += 8) {
+		__m128i cv = _mm_loadu_si128((const __m128i *)(cover+i));
+		int empty = _mm_movemask_epi8(_mm_cmpeq_epi16(cv, zero128));
+		if (empty == 0xFFFF) {
+			continue;
+		}
+		covered += 8 - (size_t)__builtin_popcount((unsigned)empty)/2;
+		_mm_storeu_si128((__m128i *)(cover+i), zero128);
+		cv = _mm_min_epi16(cv, full128);
+		if (opaque && _mm_movemask_epi8(_mm_cmpeq_epi16(cv, full128)) == 0xFFFF) {
+			_mm256_storeu_si256((__m256i *)(dst+i), solid);
+			continue;
+		}
+		__m256i cv32 = _mm256_cvtepu16_epi32(cv);
+		cv32 = _mm256_or_si256(cv32, _mm256_slli_epi32(cv32, 16));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst+i));
+		__m256i lo = span_avx2_over(_mm256_unpacklo_epi8(d, zero), color, _mm256_unpacklo_epi32(cv32, cv32));
+		__m256i hi = span_avx2_over(_mm256_unpackhi_epi8(d, zero), color, _mm256_unpackhi_epi32(cv32, cv32));
+		_mm256_storeu_si256((__m256i *)(dst+i), _mm256_packus_epi16(lo, hi));
+	}
+	return covered + span_scalar_blend_cover(dst+i, cover+i, n-i, c);
+}
+
+SPAN_TARGET("avx2") static size_t
+span_avx2_blend_cover_pixels(struct rgba8 *dst, uint16_t *cover, const struct rgba8 *src, size_t n) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i ones = _mm256_set1_epi32(-1);
+	const __m256i rgb = _mm256_set1_epi32(0x00FFFFFF);
+	const __m128i zero128 = _mm_setzero_si128();
+	const __m128i full128 = _mm_set1_epi16(256);
+	size_t covered = 0;
+	size_t i = 0;
+	for (; i+8 <= n; i += 8) {
+		__m128i cv = _mm_loadu_si128((const __m128i *)(cover+i));
+		int empty = _mm_movemask_epi8(_mm_cmpeq_epi16(cv, zero128));
+		if (empty == 0xFFFF) {
+			continue;
+		}
+		covered += 8 - (size_t)__builtin_popcount((unsigned)empty)/2;
+		_mm_storeu_si128((__m128i *)(cover+i), zero128);
+		cv = _mm_min_epi16(cv, full128);
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src+i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(cv, full128)) == 0xFFFF
+			&& _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_or_si256(s, rgb), ones)) == -1) {
+			_mm256_storeu_si256((__m256i *)(dst+i), s);
+			continue;
+		}
+		__m256i cv32 = _mm256_cvtepu16_epi32(cv);
+		cv32 = _mm256_or_si256(cv32, _mm256_slli_epi32(cv32, 16));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst+i));
+		__m256i lo = span_avx2_over(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi32(cv32, cv32));
+		__m256i hi = span_avx2_over(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi32(cv32, cv32));
+		_mm256_storeu_si256((__m256i *)(dst+i), _mm256_packus_epi16(lo, hi));
+	}
+	return covered + span_scalar_blend_cover_pixels(dst+i, cover+i, src+i, n-i);
+}
+
+SPAN_TARGET("avx2") static void
+span_avx2_blend_pixels(struct rgba8 *dst, const struct rgba8 *src, size_t n) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i full = _mm256_set1_epi16(256);
+	const __m256i ones = _mm256_set1_epi32(-1);
+	const __m256i rgb = _mm256_set1_epi32(0x00FFFFFF);
+	size_t i = 0;
+	for (; i+8 <= n; i += 8) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src+i));
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(s, zero)) == -1) {
+			continue;
+		}
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_or_si256(s, rgb), ones)) == -1) {
+			_mm256_storeu_si256((__m256i *)(dst+i), s);
+			continue;
+		}
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst+i));
+		__m256i lo = span_avx2_over(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero), full);
+		__m256i hi = span_avx2_over(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero), full);
+		_mm256_storeu_si256((__m256i *)(dst+i), _mm256_packus_epi16(lo, hi));
+	}
+	span_scalar_blend_pixels(dst+i, src+i, n-i);
+}
+
+// Prefix sums run in 128 bits lanes, then last sum of low lane is carried
+// into high lane.
+SPAN_TARGET("avx2") static inline int32_t
+span_avx2_accumulate_rule(uint16_t *cover, int32_t *dy, int32_t *area, size_t n, int32_t acc, bool nonzero) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i mask = _mm256_set1_epi32(511);
+	const __m256i period = _mm256_set1_epi16(512);
+	const __m256i full = _mm256_set1_epi16(256);
+	const __m256i last = _mm256_set1_epi32(7);
+	__m256i sum = _mm256_set1_epi32(acc);
+	size_t i = 0;
+	for (; i+8 <= n; i += 8) {
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dy+i));
+		d = _mm256_add_epi32(d, _mm256_slli_si256(d, 4));
+		d = _mm256_add_epi32(d, _mm256_slli_si256(d, 8));
+		__m256i carry = _mm256_shuffle_epi32(d, _MM_SHUFFLE(3, 3, 3, 3));
+		d = _mm256_add_epi32(d, _mm256_permute2x128_si256(carry, carry, 0x08));
+		d = _mm256_add_epi32(d, sum);
+		sum = _mm256_permutevar8x32_epi32(d, last);
+		__m256i v = _mm256_sub_epi32(_mm256_slli_epi32(d, 9), _mm256_loadu_si256((const __m256i *)(area+i)));
+		__m256i c = _mm256_srai_epi32(v, 9);
+		c = nonzero ? _mm256_abs_epi32(c) : _mm256_and_si256(c, mask);
+		c = _mm256_permute4x64_epi64(_mm256_packs_epi32(c, c), _MM_SHUFFLE(3, 1, 2, 0));
+		c = nonzero ? _mm256_min_epi16(c, full) : _mm256_min_epi16(c, _mm256_sub_epi16(period, c));
+		_mm_storeu_si128((__m128i *)(cover+i), _mm256_castsi256_si128(c));
+		_mm256_storeu_si256((__m256i *)(dy+i), zero);
+		_mm256_storeu_si256((__m256i *)(area+i), zero);
+	}
+	acc = _mm256_cvtsi256_si32(sum);
+	if (nonzero) {
+		return span_scalar_accumulate_nonzero(cover+i, dy+i, area+i, n-i, acc);
+	}
+	return span_scalar_accumulate(cover+i, dy+i, area+i, n-i, acc);
+}
+
+SPAN_TARGET("avx2") static int32_t
+span_avx2_accumulate(uint16_t *cover, int32_t *dy, int32_t *area, size_t n, int32_t acc) {
+	return span_avx2_accumulate_rule(cover, dy, area, n, acc, false);
+}
+
+SPAN_TARGET("avx2") static int32_t
+span_avx2_accumulate_nonzero(uint16_t *cover, int32_t *dy, int32_t *area, size_t n, int32_t acc) {
+	return span_avx2_accumulate_rule(cover, dy, area, n, acc, true);
+}
+
+static const struct spanface SpanAvx2 = {
+	.name = "avx2",
+	.fill = span_avx2_fill,
+	.blend = span_avx2_blend,
+	.blend_cover = span_avx2_blend_cover,
+	.blend_cover_pixels = span_avx2_blend_cover_pixels,
+	.blend_pixels = span_avx2_blend_pixels,
+	.accumulate = span_avx2_accumulate,
+	.accumulate_nonzero = span_avx2_accumulate_nonzero,
+};
+
+#endif
+
+const struct spanface *
+span_face(enum span_isa isa) {
+	switch (isa) {
+	case SpanIsaScalar:
+		return &SpanScalar;
+#ifdef SPAN_X86
+	case SpanIsaSse2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse2") ? &SpanSse2 : NULL;
+	case SpanIsaAvx2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? &SpanAvx2 : NULL;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+const struct spanface *
+span_best(void) {
+	for (int isa=SpanIsaCount; isa-- > 0;) {
+		const struct spanface *sf = span_face((enum span_isa)isa);
+		if (sf != NULL) {
+			return sf;
+		}
+	}
+	return &SpanScalar;
+}
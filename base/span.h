@@ -0,0 +1,51 @@
+#ifndef __SPAN_H
+#define __SPAN_H
+
+#include "struct.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Kernels over horizontal spans of premultiplied rgba8 pixels. Colors
+// passed to them are premultiplied too. All implementations produce
+// identical pixels.
+
+enum span_isa {
+	SpanIsaScalar,
+	SpanIsaSse2,
+	SpanIsaAvx2,
+	SpanIsaCount,
+};
+
+struct spanface {
+	const char *name;
+	// Store c to n pixels.
+	void (*fill)(struct rgba8 *dst, size_t n, struct rgba8 c);
+	// Composite c over n pixels.
+	void (*blend)(struct rgba8 *dst, size_t n, struct rgba8 c);
+	// Composite c scaled by cover[i]/256 over dst[i], cover above 256 counts
+	// as 256. cover is zeroed, pixels with zero cover are untouched. Returns
+	// number of pixels with nonzero cover.
+	size_t (*blend_cover)(struct rgba8 *dst, uint16_t *cover, size_t n, struct rgba8 c);
+	// Same as blend_cover, but with color src[i] for dst[i].
+	size_t (*blend_cover_pixels)(struct rgba8 *dst, uint16_t *cover, const struct rgba8 *src, size_t n);
+	// Composite src[i] over dst[i].
+	void (*blend_pixels)(struct rgba8 *dst, const struct rgba8 *src, size_t n);
+	// Resolve cover of accumulated cells by prefix sum. Winding at right
+	// side of pixel i is acc plus dy[0] to dy[i], in 1/256 units, and
+	// area[i] is twice area of pixel i at left of edges, in 1/256 pixels
+	// wide units. cover[i] is then coverage of pixel i folded by even-odd
+	// rule, 256 is full coverage. dy and area are zeroed. Returns winding at
+	// right side of pixel n-1.
+	int32_t (*accumulate)(uint16_t *cover, int32_t *dy, int32_t *area, size_t n, int32_t acc);
+	// Same as accumulate, but cover is folded by nonzero rule.
+	int32_t (*accumulate_nonzero)(uint16_t *cover, int32_t *dy, int32_t *area, size_t n, int32_t acc);
+};
+
+// Kernels built for isa, NULL if either build or cpu lacks it.
+const struct spanface *span_face(enum span_isa isa);
+
+// Fastest kernels cpu supports.
+const struct spanface *span_best(void);
+
+#endif
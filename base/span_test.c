@@ -0,0 +1,187 @@
+#include "span.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NPIXEL	67
+
+static uint32_t
+span_test_random(uint32_t *seed) {
+	*seed = *seed*1103515245 + 12345;
+	return *seed >> 8;
+}
+
+static struct rgba8
+span_test_color(uint32_t *seed) {
+	struct rgba8 c;
+	uint32_t a = span_test_random(seed)%4 == 0 ? 255 : span_test_random(seed)%256;
+	c.a = (uint8_t)a;
+	c.r = (uint8_t)(span_test_random(seed)%(a+1));
+	c.g = (uint8_t)(span_test_random(seed)%(a+1));
+	c.b = (uint8_t)(span_test_random(seed)%(a+1));
+	return c;
+}
+
+static void
+span_test_values(void) {
+	printf("span_test_values(), start.\n");
+	const struct spanface *sf = span_face(SpanIsaScalar);
+	assert(sf != NULL);
+	struct rgba8 red = {255, 0, 0, 255};
+	struct rgba8 blue = {0, 0, 255, 255};
+	struct rgba8 px[2];
+	uint16_t cover[2] = {128, 0};
+	sf->fill(px, 2, blue);
+	assert(sf->blend_cover(px, cover, 2, red) == 1);
+	assert(px[0].r == 127 && px[0].g == 0 && px[0].b == 128 && px[0].a == 255);
+	assert(memcmp(&px[1], &blue, sizeof(blue)) == 0);
+	assert(cover[0] == 0 && cover[1] == 0);
+
+	struct rgba8 clear = {0, 0, 0, 0};
+	struct rgba8 half = {64, 0, 0, 128};
+	sf->fill(px, 2, clear);
+	sf->blend(px, 2, half);
+	assert(memcmp(&px[1], &half, sizeof(half)) == 0);
+	struct rgba8 src[2] = {clear, red};
+	sf->blend_pixels(px, src, 2);
+	assert(memcmp(&px[0], &half, sizeof(half)) == 0);
+	assert(memcmp(&px[1], &red, sizeof(red)) == 0);
+	printf("span_test_values(), done.\n");
+}
+
+static void
+span_test_isa(enum span_isa isa) {
+	const struct spanface *sf = span_face(isa);
+	const struct spanface *ref = span_face(SpanIsaScalar);
+	if (sf == NULL) {
+		printf("span_test_isa(%d), unsupported.\n", (int)isa);
+		return;
+	}
+	printf("span_test_isa(%s), start.\n", sf->name);
+	uint32_t seed = 7;
+	struct rgba8 dst0[NPIXEL], dst1[NPIXEL];
+	uint16_t cover0[NPIXEL], cover1[NPIXEL];
+	for (size_t round=0; round<2000; round++) {
+		size_t off = span_test_random(&seed)%4;
+		size_t n = span_test_random(&seed)%(NPIXEL-off);
+		for (size_t i=0; i<NPIXEL; i++) {
+			dst0[i] = span_test_color(&seed);
+			uint32_t r = span_test_random(&seed)%8;
+			cover0[i] = (uint16_t)(r < 3 ? 0 : r < 5 ? 256 : r == 5 ? 300 : span_test_random(&seed)%257);
+		}
+		// Runs of empty and full cover take fast paths.
+		if (round%3 == 0) {
+			size_t beg = span_test_random(&seed)%NPIXEL;
+			size_t end = beg + span_test_random(&seed)%(NPIXEL-beg);
+			uint16_t v = round%2 ? 0 : 256;
+			for (size_t i=beg; i<end; i++) {
+				cover0[i] = v;
+			}
+		}
+		memcpy(dst1, dst0, sizeof(dst0));
+		memcpy(cover1, cover0, sizeof(cover0));
+		struct rgba8 c = span_test_color(&seed);
+		struct rgba8 src[NPIXEL];
+		for (size_t i=0; i<NPIXEL; i++) {
+			src[i] = i%5 == 0 ? c : span_test_color(&seed);
+		}
+		// Runs of transparent and opaque pixels take fast paths.
+		if (round%7 < 2) {
+			struct rgba8 clear = {0, 0, 0, 0};
+			struct rgba8 run = round%7 == 0 ? clear : (struct rgba8){c.r, c.g, c.b, 255};
+			for (size_t i=NPIXEL/4; i<NPIXEL*3/4; i++) {
+				src[i] = run;
+			}
+		}
+		switch (round%5) {
+		case 0:
+			ref->fill(dst0+off, n, c);
+			sf->fill(dst1+off, n, c);
+			break;
+		case 1:
+			ref->blend(dst0+off, n, c);
+			sf->blend(dst1+off, n, c);
+			break;
+		case 2:
+			assert(ref->blend_cover(dst0+off, cover0+off, n, c) == sf->blend_cover(dst1+off, cover1+off, n, c));
+			break;
+		case 3:
+			ref->blend_pixels(dst0+off, src+off, n);
+			sf->blend_pixels(dst1+off, src+off, n);
+			break;
+		default:
+			assert(ref->blend_cover_pixels(dst0+off, cover0+off, src+off, n) == sf->blend_cover_pixels(dst1+off, cover1+off, src+off, n));
+			break;
+		}
+		assert(memcmp(dst0, dst1, sizeof(dst0)) == 0);
+		assert(memcmp(cover0, cover1, sizeof(cover0)) == 0);
+	}
+	printf("span_test_isa(%s), done.\n", sf->name);
+}
+
+static void
+span_test_accumulate(enum span_isa isa) {
+	const struct spanface *sf = span_face(isa);
+	const struct spanface *ref = span_face(SpanIsaScalar);
+	if (sf == NULL) {
+		return;
+	}
+	printf("span_test_accumulate(%s), start.\n", sf->name);
+	// Vertical edge at 1/4 of pixel 1, going down, then up at pixel 3.
+	int32_t dy[5] = {0, 256, 0, -256, 0};
+	int32_t area[5] = {0, 256*2*64, 0, -256*2*128, 0};
+	uint16_t cover[5];
+	assert(sf->accumulate(cover, dy, area, 5, 0) == 0);
+	assert(cover[0] == 0 && cover[1] == 192 && cover[2] == 256 && cover[3] == 128 && cover[4] == 0);
+	assert(dy[1] == 0 && area[3] == 0);
+	// Winding of two is even.
+	dy[0] = 512;
+	sf->accumulate(cover, dy, area, 1, 0);
+	assert(cover[0] == 0);
+	// But nonzero, and full as winding of one.
+	dy[0] = -512;
+	area[1] = 256*2*64;
+	assert(sf->accumulate_nonzero(cover, dy, area, 2, 0) == -512);
+	assert(cover[0] == 256 && cover[1] == 256);
+
+	uint32_t seed = 11;
+	int32_t dy0[NPIXEL], dy1[NPIXEL], area0[NPIXEL], area1[NPIXEL];
+	uint16_t cover0[NPIXEL], cover1[NPIXEL];
+	for (size_t round=0; round<2000; round++) {
+		size_t n = span_test_random(&seed)%NPIXEL;
+		int32_t acc = (int32_t)(span_test_random(&seed)%2048) - 1024;
+		for (size_t i=0; i<NPIXEL; i++) {
+			dy0[i] = span_test_random(&seed)%3 == 0 ? (int32_t)(span_test_random(&seed)%1025) - 512 : 0;
+			area0[i] = dy0[i]*(int32_t)(span_test_random(&seed)%513);
+		}
+		memcpy(dy1, dy0, sizeof(dy0));
+		memcpy(area1, area0, sizeof(area0));
+		if (round%2 == 0) {
+			assert(ref->accumulate(cover0, dy0, area0, n, acc) == sf->accumulate(cover1, dy1, area1, n, acc));
+		} else {
+			assert(ref->accumulate_nonzero(cover0, dy0, area0, n, acc) == sf->accumulate_nonzero(cover1, dy1, area1, n, acc));
+		}
+		assert(memcmp(cover0, cover1, sizeof(cover0[0])*n) == 0);
+		assert(memcmp(dy0, dy1, sizeof(dy0)) == 0);
+		assert(memcmp(area0, area1, sizeof(area0)) == 0);
+	}
+	printf("span_test_accumulate(%s), done.\n", sf->name);
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	setvbuf(stderr, NULL, _IONBF, 0);
+
+	printf("Test span, start.\n");
+	span_test_values();
+	for (int isa=0; isa<SpanIsaCount; isa++) {
+		span_test_isa((enum span_isa)isa);
+		span_test_accumulate((enum span_isa)isa);
+	}
+	assert(span_best() != NULL);
+	printf("Test span, done.\n");
+	return 0;
+}
@@ -0,0 +1,557 @@
+#ifndef __CORE_BENCH_H
+#define __CORE_BENCH_H
+
+// Helpers shared by benchmarks: plain memface, timer and a writer of
+// synthetic SWF movies.
+
+#include "swftag.h"
+#include "outline.h"
+#include <base/helper.h>
+#include <base/bitval.h>
+
+#include <zlib.h>
+#include <lzma.h>
+#include <time.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *
+bench_alloc(void *ctx, size_t size, const char *file, int line) {
+	(void)ctx; (void)file; (void)line;
+	void *ptr = malloc(size);
+	if (ptr == NULL) {
+		fprintf(stderr, "out of memory, size %zu.\n", size);
+		abort();
+	}
+	return ptr;
+}
+
+static void *
+bench_zalloc(void *ctx, size_t size, const char *file, int line) {
+	void *ptr = bench_alloc(ctx, size, file, line);
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+static void *
+bench_realloc(void *ctx, void *ptr, size_t size, const char *file, int line) {
+	(void)ctx; (void)file; (void)line;
+	return realloc(ptr, size);
+}
+
+static void
+bench_dealloc(void *ctx, void *ptr, const char *file, int line) {
+	(void)ctx; (void)file; (void)line;
+	free(ptr);
+}
+
+static int
+bench_log(void *ctx, const char *fmt, ...) {
+	(void)ctx; (void)fmt;
+	return 0;
+}
+
+static struct memface BenchMemface = {
+	.ctx = NULL,
+	.alloc = bench_alloc,
+	.zalloc = bench_zalloc,
+	.realloc = bench_realloc,
+	.dealloc = bench_dealloc,
+};
+
+static struct logface BenchLogface = {.ctx = NULL, .log = bench_log};
+static struct errface BenchErrface = {.ctx = NULL, .err = bench_log};
+
+// Milliseconds from an unspecified point.
+static double
+bench_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec*1e3 + (double)ts.tv_nsec/1e6;
+}
+
+// Deterministic pseudo random numbers, so runs are comparable.
+static uint32_t
+bench_random(uint32_t *seed) {
+	*seed = *seed * 1103515245u + 12345u;
+	return (*seed >> 8) & 0xFFFFFF;
+}
+
+// Number of bits to hold signed value.
+static size_t
+swfgen_sbits(intreg_t val) {
+	size_t n = 1;
+	while (val < -(1L << (n-1)) || val >= (1L << (n-1))) {
+		n++;
+	}
+	return n;
+}
+
+struct swfgen {
+	byte_t *buf;
+	size_t len;
+	size_t cap;
+	// End of first frame, maintained by writer's user.
+	size_t firstend;
+};
+
+static void
+swfgen_reserve(struct swfgen *sg, size_t n) {
+	if (sg->len + n > sg->cap) {
+		size_t cap = sg->cap*2 + n + 1024;
+		sg->buf = realloc(sg->buf, cap);
+		sg->cap = cap;
+	}
+}
+
+static void
+swfgen_bytes(struct swfgen *sg, const void *ptr, size_t n) {
+	if (n == 0) {
+		return;
+	}
+	swfgen_reserve(sg, n);
+	memcpy(sg->buf + sg->len, ptr, n);
+	sg->len += n;
+}
+
+static void
+swfgen_uint16(struct swfgen *sg, uintreg_t val) {
+	byte_t b[2] = {(byte_t)val, (byte_t)(val>>8)};
+	swfgen_bytes(sg, b, 2);
+}
+
+static void
+swfgen_uint32(struct swfgen *sg, uintreg_t val) {
+	byte_t b[4] = {(byte_t)val, (byte_t)(val>>8), (byte_t)(val>>16), (byte_t)(val>>24)};
+	swfgen_bytes(sg, b, 4);
+}
+
+// Uncompressed "FWS" header with twips stage size.
+// Length field is patched by swfgen_finish().
+static void
+swfgen_init(struct swfgen *sg, intreg_t width, intreg_t height, uintreg_t nframe) {
+	sg->buf = NULL;
+	sg->len = sg->cap = sg->firstend = 0;
+	swfgen_bytes(sg, "FWS", 3);
+	byte_t version = 10;
+	swfgen_bytes(sg, &version, 1);
+	swfgen_uint32(sg, 0);
+
+	byte_t rect[32];
+	bitval_t bv;
+	bitval_init_write(bv, rect, sizeof(rect));
+	size_t n = swfgen_sbits(width > height ? width : height);
+	bitval_write_ubits(bv, n, 5);
+	bitval_write_sbits(bv, 0, n);
+	bitval_write_sbits(bv, width, n);
+	bitval_write_sbits(bv, 0, n);
+	bitval_write_sbits(bv, height, n);
+	bitval_sync(bv);
+	swfgen_bytes(sg, rect, (size_t)(bitval_write_cursor(bv) - rect));
+	swfgen_uint16(sg, 24 << 8);
+	swfgen_uint16(sg, nframe);
+}
+
+static void
+swfgen_tag(struct swfgen *sg, enum swftag tag, const void *body, size_t len) {
+	if (len < 0x3F) {
+		swfgen_uint16(sg, ((uintreg_t)tag << 6) | len);
+	} else {
+		swfgen_uint16(sg, ((uintreg_t)tag << 6) | 0x3F);
+		swfgen_uint32(sg, len);
+	}
+	swfgen_bytes(sg, body, len);
+}
+
+static void
+swfgen_finish(struct swfgen *sg) {
+	swfgen_tag(sg, SwftagEnd, NULL, 0);
+	byte_t *ptr = sg->buf + 4;
+	ptr[0] = (byte_t)sg->len;
+	ptr[1] = (byte_t)(sg->len >> 8);
+	ptr[2] = (byte_t)(sg->len >> 16);
+	ptr[3] = (byte_t)(sg->len >> 24);
+}
+
+static void
+swfgen_free(struct swfgen *sg) {
+	free(sg->buf);
+	sg->buf = NULL;
+	sg->len = sg->cap = 0;
+}
+
+static void
+bitval_write_straight(struct bitval *bv, intreg_t dx, intreg_t dy) {
+	size_t nx = swfgen_sbits(dx), ny = swfgen_sbits(dy);
+	size_t n = nx > ny ? nx : ny;
+	if (n < 2) {
+		n = 2;
+	}
+	bitval_write_ubits(bv, 1, 1);	// Edge record.
+	bitval_write_ubits(bv, 1, 1);	// Straight edge.
+	bitval_write_ubits(bv, n-2, 4);
+	bitval_write_ubits(bv, 1, 1);	// General line.
+	bitval_write_sbits(bv, dx, n);
+	bitval_write_sbits(bv, dy, n);
+}
+
+static void
+bitval_write_curved(struct bitval *bv, intreg_t cx, intreg_t cy, intreg_t ax, intreg_t ay) {
+	size_t n = 2;
+	intreg_t deltas[4] = {cx, cy, ax, ay};
+	for (size_t i=0; i<4; i++) {
+		size_t m = swfgen_sbits(deltas[i]);
+		n = m > n ? m : n;
+	}
+	bitval_write_ubits(bv, 1, 1);	// Edge record.
+	bitval_write_ubits(bv, 0, 1);	// Curved edge.
+	bitval_write_ubits(bv, n-2, 4);
+	for (size_t i=0; i<4; i++) {
+		bitval_write_sbits(bv, deltas[i], n);
+	}
+}
+
+// Fill of generated shapes. Gradients go from rgb to rgb2 over a square of
+// size twips centered at shape origin.
+struct swfgen_fill {
+	enum fill_type type;
+	uint32_t rgb;
+	uint32_t rgb2;
+	intreg_t size;
+	uintreg_t spread;
+};
+
+static void
+bitval_write_rgb(struct bitval *bv, uint32_t rgb) {
+	bitval_write_uint8(bv, (rgb >> 16) & 0xFF);
+	bitval_write_uint8(bv, (rgb >> 8) & 0xFF);
+	bitval_write_uint8(bv, rgb & 0xFF);
+}
+
+static void
+bitval_write_fill(struct bitval *bv, const struct swfgen_fill *fill) {
+	bitval_write_uint8(bv, fill->type);
+	if (fill->type == FillStyleSolid) {
+		bitval_write_rgb(bv, fill->rgb);
+		return;
+	}
+	// Gradient square is 32768 twips.
+	intreg_t scale = fill->size*2;
+	size_t n = swfgen_sbits(scale);
+	bitval_write_ubits(bv, 1, 1);
+	bitval_write_ubits(bv, n, 5);
+	bitval_write_sbits(bv, scale, n);
+	bitval_write_sbits(bv, scale, n);
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, 1, 5);
+	bitval_write_sbits(bv, 0, 1);
+	bitval_write_sbits(bv, 0, 1);
+	bitval_sync(bv);
+	bitval_write_uint8(bv, (fill->spread << 6) | 2);
+	bitval_write_uint8(bv, 0);
+	bitval_write_rgb(bv, fill->rgb);
+	bitval_write_uint8(bv, 255);
+	bitval_write_rgb(bv, fill->rgb2);
+}
+
+// Shape bounds of points, grown by margin.
+static void
+bitval_write_bounds(struct bitval *bv, const intreg_t *pts, size_t npt, intreg_t margin) {
+	intreg_t xmin = pts[0], xmax = pts[0], ymin = pts[1], ymax = pts[1];
+	for (size_t i=1; i<npt; i++) {
+		intreg_t x = pts[2*i], y = pts[2*i+1];
+		xmin = x < xmin ? x : xmin;
+		xmax = x > xmax ? x : xmax;
+		ymin = y < ymin ? y : ymin;
+		ymax = y > ymax ? y : ymax;
+	}
+	size_t n = 1;
+	intreg_t bounds[4] = {xmin-margin, xmax+margin, ymin-margin, ymax+margin};
+	for (size_t i=0; i<4; i++) {
+		size_t m = swfgen_sbits(bounds[i]);
+		n = m > n ? m : n;
+	}
+	bitval_write_ubits(bv, n, 5);
+	for (size_t i=0; i<4; i++) {
+		bitval_write_sbits(bv, bounds[i], n);
+	}
+	bitval_sync(bv);
+}
+
+static void
+bitval_write_moveto(struct bitval *bv, intreg_t x, intreg_t y) {
+	size_t nm = swfgen_sbits(x);
+	size_t ny = swfgen_sbits(y);
+	nm = ny > nm ? ny : nm;
+	bitval_write_ubits(bv, nm, 5);
+	bitval_write_sbits(bv, x, nm);
+	bitval_write_sbits(bv, y, nm);
+}
+
+// Style change flag of fill style on inner side of closed path. Path goes
+// clockwise if its signed area is positive, y grows downward, then inner
+// side is right side, which is fill style 1.
+static uintreg_t
+swfgen_inner_fill(const intreg_t *pts, size_t npt) {
+	double area = 0;
+	for (size_t i=0; i<npt; i++) {
+		size_t j = (i+1) % npt;
+		area += (double)pts[2*i]*(double)pts[2*j+1] - (double)pts[2*j]*(double)pts[2*i+1];
+	}
+	return area > 0 ? 0x04 : 0x02;
+}
+
+// DefineShape of a closed path, points are twips coordinates in pairs, filled
+// on inner side. If curved is true, odd points are control points of
+// quadratic curves between even points, and npt is even.
+static void
+swfgen_shape_fill(struct swfgen *sg, uintreg_t id, const intreg_t *pts, size_t npt, const struct swfgen_fill *fill, bool curved) {
+	size_t cap = 96 + npt*12;
+	byte_t *body = malloc(cap);
+	bitval_t bv;
+	bitval_init_write(bv, body, cap);
+	bitval_write_uint16(bv, id);
+	bitval_write_bounds(bv, pts, npt, 0);
+
+	bitval_write_uint8(bv, 1);	// One fill.
+	bitval_write_fill(bv, fill);
+	bitval_write_uint8(bv, 0);	// No line styles.
+	bitval_write_uint8(bv, 1 << 4);	// One fill bit, zero line bits.
+
+	// Style change: move to first point, fill inner side.
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, swfgen_inner_fill(pts, npt) | 0x01, 5);
+	bitval_write_moveto(bv, pts[0], pts[1]);
+	bitval_write_ubits(bv, 1, 1);
+	if (curved) {
+		for (size_t i=1; i<=npt; i+=2) {
+			size_t j = (i+1) % npt;
+			bitval_write_curved(bv, pts[2*i] - pts[2*i-2], pts[2*i+1] - pts[2*i-1], pts[2*j] - pts[2*i], pts[2*j+1] - pts[2*i+1]);
+		}
+	} else {
+		for (size_t i=1; i<=npt; i++) {
+			size_t j = i % npt;
+			bitval_write_straight(bv, pts[2*j] - pts[2*i-2], pts[2*j+1] - pts[2*i-1]);
+		}
+	}
+	bitval_write_ubits(bv, 0, 6);	// End of shape.
+	bitval_sync(bv);
+	swfgen_tag(sg, SwftagDefineShape, body, (size_t)(bitval_write_cursor(bv) - body));
+	free(body);
+}
+
+// DefineShape of an open polyline stroked width twips wide, without fill.
+static void
+swfgen_stroke(struct swfgen *sg, uintreg_t id, const intreg_t *pts, size_t npt, uintreg_t width, uint32_t rgb) {
+	size_t cap = 96 + npt*12;
+	byte_t *body = malloc(cap);
+	bitval_t bv;
+	bitval_init_write(bv, body, cap);
+	bitval_write_uint16(bv, id);
+	bitval_write_bounds(bv, pts, npt, (intreg_t)(width+1)/2);
+
+	bitval_write_uint8(bv, 0);	// No fills.
+	bitval_write_uint8(bv, 1);	// One line style.
+	bitval_write_uint16(bv, width);
+	bitval_write_rgb(bv, rgb);
+	bitval_write_uint8(bv, 1);	// Zero fill bits, one line bit.
+
+	// Style change: move to first point, line style 1.
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, 0x08 | 0x01, 5);
+	bitval_write_moveto(bv, pts[0], pts[1]);
+	bitval_write_ubits(bv, 1, 1);
+	for (size_t i=1; i<npt; i++) {
+		bitval_write_straight(bv, pts[2*i] - pts[2*i-2], pts[2*i+1] - pts[2*i-1]);
+	}
+	bitval_write_ubits(bv, 0, 6);	// End of shape.
+	bitval_sync(bv);
+	swfgen_tag(sg, SwftagDefineShape, body, (size_t)(bitval_write_cursor(bv) - body));
+	free(body);
+}
+
+// Shape filled with a solid color.
+static void
+swfgen_shape(struct swfgen *sg, uintreg_t id, const intreg_t *pts, size_t npt, uint32_t rgb, bool curved) {
+	struct swfgen_fill fill = {.type = FillStyleSolid, .rgb = rgb};
+	swfgen_shape_fill(sg, id, pts, npt, &fill, curved);
+}
+
+static void
+swfgen_polygon(struct swfgen *sg, uintreg_t id, const intreg_t *pts, size_t npt, uint32_t rgb) {
+	swfgen_shape(sg, id, pts, npt, rgb, false);
+}
+
+// PlaceObject2 with translation only. If id is zero, move object at depth.
+static void
+swfgen_place(struct swfgen *sg, uintreg_t id, uintreg_t depth, intreg_t tx, intreg_t ty) {
+	byte_t body[32];
+	bitval_t bv;
+	bitval_init_write(bv, body, sizeof(body));
+	uintreg_t flag = 0x04;	// Has matrix.
+	flag |= id != 0 ? 0x02 : 0x01;
+	bitval_write_uint8(bv, flag);
+	bitval_write_uint16(bv, depth);
+	if (id != 0) {
+		bitval_write_uint16(bv, id);
+	}
+	size_t n = swfgen_sbits(tx);
+	size_t m = swfgen_sbits(ty);
+	n = m > n ? m : n;
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, n, 5);
+	bitval_write_sbits(bv, tx, n);
+	bitval_write_sbits(bv, ty, n);
+	bitval_sync(bv);
+	swfgen_tag(sg, SwftagPlaceObject2, body, (size_t)(bitval_write_cursor(bv) - body));
+}
+
+// PlaceObject3 of new object with translation only, cached as bitmap.
+static void
+swfgen_place_cached(struct swfgen *sg, uintreg_t id, uintreg_t depth, intreg_t tx, intreg_t ty) {
+	byte_t body[32];
+	bitval_t bv;
+	bitval_init_write(bv, body, sizeof(body));
+	bitval_write_uint8(bv, 0x02 | 0x04);	// Has character and matrix.
+	bitval_write_uint8(bv, 0x04);		// Has cacheAsBitmap.
+	bitval_write_uint16(bv, depth);
+	bitval_write_uint16(bv, id);
+	size_t n = swfgen_sbits(tx);
+	size_t m = swfgen_sbits(ty);
+	n = m > n ? m : n;
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, n, 5);
+	bitval_write_sbits(bv, tx, n);
+	bitval_write_sbits(bv, ty, n);
+	bitval_sync(bv);
+	bitval_write_uint8(bv, 1);
+	swfgen_tag(sg, SwftagPlaceObject3, body, (size_t)(bitval_write_cursor(bv) - body));
+}
+
+// PlaceObject2 of new mask with translation only, clipping objects above
+// it up to clipdepth.
+static void
+swfgen_place_mask(struct swfgen *sg, uintreg_t id, uintreg_t depth, uintreg_t clipdepth, intreg_t tx, intreg_t ty) {
+	byte_t body[32];
+	bitval_t bv;
+	bitval_init_write(bv, body, sizeof(body));
+	bitval_write_uint8(bv, 0x40 | 0x04 | 0x02);	// Has clip depth, matrix and character.
+	bitval_write_uint16(bv, depth);
+	bitval_write_uint16(bv, id);
+	size_t n = swfgen_sbits(tx);
+	size_t m = swfgen_sbits(ty);
+	n = m > n ? m : n;
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, n, 5);
+	bitval_write_sbits(bv, tx, n);
+	bitval_write_sbits(bv, ty, n);
+	bitval_sync(bv);
+	bitval_write_uint16(bv, clipdepth);
+	swfgen_tag(sg, SwftagPlaceObject2, body, (size_t)(bitval_write_cursor(bv) - body));
+}
+
+// PlaceObject2 replacing character of object at depth.
+static void
+swfgen_replace(struct swfgen *sg, uintreg_t id, uintreg_t depth) {
+	byte_t body[5] = {0x02 | 0x01, (byte_t)depth, (byte_t)(depth>>8), (byte_t)id, (byte_t)(id>>8)};
+	swfgen_tag(sg, SwftagPlaceObject2, body, sizeof(body));
+}
+
+static void
+swfgen_remove(struct swfgen *sg, uintreg_t depth) {
+	byte_t body[2] = {(byte_t)depth, (byte_t)(depth>>8)};
+	swfgen_tag(sg, SwftagRemoveObject2, body, sizeof(body));
+}
+
+static void
+swfgen_show(struct swfgen *sg) {
+	swfgen_tag(sg, SwftagShowFrame, NULL, 0);
+}
+
+// DefineSprite, whose tags are written to sg until swfgen_end_sprite().
+// Return position of its length field.
+static size_t
+swfgen_begin_sprite(struct swfgen *sg, uintreg_t id, uintreg_t nframe) {
+	swfgen_uint16(sg, ((uintreg_t)SwftagDefineSprite << 6) | 0x3F);
+	size_t pos = sg->len;
+	swfgen_uint32(sg, 0);
+	swfgen_uint16(sg, id);
+	swfgen_uint16(sg, nframe);
+	return pos;
+}
+
+static void
+swfgen_end_sprite(struct swfgen *sg, size_t pos) {
+	swfgen_tag(sg, SwftagEnd, NULL, 0);
+	size_t len = sg->len - pos - 4;
+	byte_t *ptr = sg->buf + pos;
+	ptr[0] = (byte_t)len;
+	ptr[1] = (byte_t)(len >> 8);
+	ptr[2] = (byte_t)(len >> 16);
+	ptr[3] = (byte_t)(len >> 24);
+}
+
+// Compress finished movie to "CWS" movie.
+static byte_t *
+swfgen_deflate(const struct swfgen *sg, size_t *lenp) {
+	uLongf len = compressBound((uLong)(sg->len - 8)) + 8;
+	byte_t *buf = malloc(len);
+	memcpy(buf, sg->buf, 8);
+	buf[0] = 'C';
+	uLongf zlen = len - 8;
+	if (compress2(buf+8, &zlen, sg->buf+8, (uLong)(sg->len - 8), Z_DEFAULT_COMPRESSION) != Z_OK) {
+		fprintf(stderr, "compress fail.\n");
+		abort();
+	}
+	*lenp = (size_t)zlen + 8;
+	return buf;
+}
+
+// Compress finished movie to "ZWS" movie: header, compressed length, lzma
+// properties and raw lzma data. Stream produced by lzma_alone_encoder() is
+// 5 bytes properties, 8 bytes uncompressed size and raw data.
+static byte_t *
+swfgen_lzma(const struct swfgen *sg, size_t *lenp) {
+	lzma_options_lzma opt;
+	lzma_lzma_preset(&opt, LZMA_PRESET_DEFAULT);
+	lzma_stream ls = LZMA_STREAM_INIT;
+	if (lzma_alone_encoder(&ls, &opt) != LZMA_OK) {
+		fprintf(stderr, "lzma init fail.\n");
+		abort();
+	}
+	size_t cap = sg->len + sg->len/2 + 1024;
+	byte_t *alone = malloc(cap);
+	ls.next_in = sg->buf + 8;
+	ls.avail_in = sg->len - 8;
+	ls.next_out = alone;
+	ls.avail_out = cap;
+	if (lzma_code(&ls, LZMA_FINISH) != LZMA_STREAM_END) {
+		fprintf(stderr, "lzma compress fail.\n");
+		abort();
+	}
+	size_t alen = cap - ls.avail_out;
+	lzma_end(&ls);
+
+	size_t zlen = alen - 13;
+	byte_t *buf = malloc(12 + 5 + zlen);
+	memcpy(buf, sg->buf, 8);
+	buf[0] = 'Z';
+	buf[8] = (byte_t)zlen;
+	buf[9] = (byte_t)(zlen >> 8);
+	buf[10] = (byte_t)(zlen >> 16);
+	buf[11] = (byte_t)(zlen >> 24);
+	memcpy(buf+12, alone, 5);
+	memcpy(buf+17, alone+13, zlen);
+	free(alone);
+	*lenp = 17 + zlen;
+	return buf;
+}
+
+#endif
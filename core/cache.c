@@ -0,0 +1,237 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "cache.h"
+#include "outline.h"
+#include <base/compat.h>
+#include <base/helper.h>
+#include <base/mapfile.h>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+static const char CacheMagic[4] = {'S', 'W', 'F', 'C'};
+
+// Directory, separator, 16 hex digits, suffix and temporary suffix.
+#define CACHE_PATHMAX	4096
+
+static bool
+cache_path(char *buf, size_t len, const char *dir, uint64_t key, const char *suffix) {
+	int n = snprintf(buf, len, "%s/%016" PRIx64 ".swfc%s", dir, key, suffix);
+	return n > 0 && (size_t)n < len;
+}
+
+// Sections are 8 bytes aligned, see cache_writer_append().
+static inline bool
+cache_range(size_t mapsize, uint32_t off, size_t len) {
+	return (off & 7) == 0 && off <= mapsize && len <= mapsize - off;
+}
+
+static bool
+cache_check_frames(const struct cache_header *ch, size_t mapsize, size_t ressize) {
+	if (ch->indexed == 0) {
+		return true;
+	}
+	if (!cache_range(mapsize, ch->frames, sizeof(uint32_t)*((size_t)ch->nframe+1))) {
+		return false;
+	}
+	if (ch->frameend > ressize || ch->scanpos > ressize) {
+		return false;
+	}
+	const uint32_t *frames = cache_section(ch, ch->frames);
+	for (size_t i=0; i<ch->nframe; i++) {
+		if (frames[i] > frames[i+1]) {
+			return false;
+		}
+	}
+	return frames[ch->nframe] <= ressize;
+}
+
+static bool
+cache_check_outline(const struct cache_header *ch, const struct cache_character *cc, size_t mapsize, size_t ressize) {
+	if (cc->outline == 0) {
+		return cc->nrecord == 0 && cc->npalette == 0;
+	}
+	if (!cache_range(mapsize, cc->outline, sizeof(struct outline_record)*(size_t)cc->nrecord) ||
+	    !cache_range(mapsize, cc->palettes, sizeof(uint32_t)*(size_t)cc->npalette)) {
+		return false;
+	}
+	const uint32_t *palettes = cache_section(ch, cc->palettes);
+	for (size_t i=0; i<cc->npalette; i++) {
+		if (palettes[i] >= ressize) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool
+cache_check_codes(const struct cache_header *ch, size_t mapsize, size_t ressize) {
+	if (!cache_range(mapsize, ch->codes, sizeof(struct cache_code)*(size_t)ch->ncode)) {
+		return false;
+	}
+	const struct cache_code *cd = cache_section(ch, ch->codes);
+	for (size_t i=0; i<ch->ncode; i++, cd++) {
+		if (cd->tagpos > cd->endpos || cd->endpos > ressize || (i != 0 && cd->tagpos <= cd[-1].tagpos)) {
+			return false;
+		}
+		if (cd->nop != 0 && !cache_range(mapsize, cd->ops, (size_t)ch->opsize*cd->nop)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool
+cache_check_records(const struct cache_header *ch, const struct cache_character *cc) {
+	const struct outline_record *rc = cache_section(ch, cc->outline);
+	for (size_t i=0; i<cc->nrecord; i++, rc++) {
+		if (rc->verb > OutlineVerbCurve) {
+			return false;
+		}
+		if (rc->verb == OutlineVerbStyle && (rc->u.style.flag & RecordStateNewStyles) && rc->u.style.palette >= cc->npalette) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Every offset is checked against cache or stream before it is used, a
+// damaged or foreign cache is rejected as a whole. Outline records and
+// frame ops are checked when they are restored.
+static bool
+cache_check(const struct cache_header *ch, size_t mapsize, uint64_t key, uint64_t size, size_t ressize) {
+	if (mapsize < sizeof(*ch) || memcmp(ch->magic, CacheMagic, sizeof(CacheMagic)) != 0) {
+		return false;
+	}
+	if (ch->version != CACHE_VERSION || ch->wordsize != sizeof(void *) || ch->recsize != sizeof(struct outline_record)) {
+		return false;
+	}
+	if (ch->key != key || ch->size != size) {
+		return false;
+	}
+	if (!cache_check_frames(ch, mapsize, ressize)) {
+		return false;
+	}
+	if (!cache_range(mapsize, ch->chars, sizeof(struct cache_character)*(size_t)ch->nchar)) {
+		return false;
+	}
+	const struct cache_character *cc = cache_section(ch, ch->chars);
+	for (size_t i=0; i<ch->nchar; i++, cc++) {
+		if (cc->data >= ressize || (i != 0 && cc->data <= cc[-1].data)) {
+			return false;
+		}
+		if (cc->nudef == 0 || !cache_range(mapsize, cc->udef, cc->nudef)) {
+			return false;
+		}
+		if (!cache_check_outline(ch, cc, mapsize, ressize)) {
+			return false;
+		}
+	}
+	return cache_check_codes(ch, mapsize, ressize);
+}
+
+const struct cache_header *
+cache_open(const char *dir, uint64_t key, uint64_t size, size_t ressize, size_t *mapsizep) {
+	char path[CACHE_PATHMAX];
+	if (!cache_path(path, sizeof(path), dir, key, "")) {
+		return NULL;
+	}
+	size_t mapsize;
+	const struct cache_header *ch = mapfile_open(path, &mapsize);
+	if (ch == NULL) {
+		return NULL;
+	}
+	if (!cache_check(ch, mapsize, key, size, ressize)) {
+		mapfile_close(ch, mapsize);
+		return NULL;
+	}
+	*mapsizep = mapsize;
+	return ch;
+}
+
+void
+cache_close(const struct cache_header *ch, size_t mapsize) {
+	mapfile_close(ch, mapsize);
+}
+
+struct cache_writer {
+	struct memface *memface;
+	uint8_t *buf;
+	size_t len;
+	size_t cap;
+};
+
+struct cache_writer *
+cache_writer_create(struct memface *mc) {
+	struct cache_writer *cw = mc->alloc(mc->ctx, sizeof(*cw), __FILE__, __LINE__);
+	cw->memface = mc;
+	cw->buf = NULL;
+	cw->len = cw->cap = 0;
+
+	struct cache_header ch;
+	memset(&ch, 0, sizeof(ch));
+	memcpy(ch.magic, CacheMagic, sizeof(CacheMagic));
+	ch.version = CACHE_VERSION;
+	ch.wordsize = sizeof(void *);
+	ch.recsize = sizeof(struct outline_record);
+	cache_writer_append(cw, &ch, sizeof(ch));
+	return cw;
+}
+
+void
+cache_writer_delete(struct cache_writer *cw) {
+	struct memface *mc = cw->memface;
+	if (cw->buf != NULL) {
+		mc->dealloc(mc->ctx, cw->buf, __FILE__, __LINE__);
+	}
+	mc->dealloc(mc->ctx, cw, __FILE__, __LINE__);
+}
+
+uint32_t
+cache_writer_append(struct cache_writer *cw, const void *ptr, size_t size) {
+	size_t off = (cw->len + 7) & ~(size_t)7;
+	if (off + size > cw->cap) {
+		size_t cap = cw->cap*2 + size + 4096;
+		cw->buf = cw->memface->realloc(cw->memface->ctx, cw->buf, cap, __FILE__, __LINE__);
+		cw->cap = cap;
+	}
+	memset(cw->buf + cw->len, 0, off - cw->len);
+	if (size != 0) {
+		memcpy(cw->buf + off, ptr, size);
+	}
+	cw->len = off + size;
+	return (uint32_t)off;
+}
+
+struct cache_header *
+cache_writer_header(struct cache_writer *cw) {
+	return (struct cache_header *)cw->buf;
+}
+
+bool
+cache_writer_commit(struct cache_writer *cw, const char *dir) {
+	const struct cache_header *ch = cache_writer_header(cw);
+	char path[CACHE_PATHMAX], temp[CACHE_PATHMAX];
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%ld", (long)getpid());
+	if (!cache_path(path, sizeof(path), dir, ch->key, "") ||
+	    !cache_path(temp, sizeof(temp), dir, ch->key, suffix)) {
+		return false;
+	}
+	FILE *fp = fopen(temp, "wb");
+	if (fp == NULL) {
+		return false;
+	}
+	bool ok = fwrite(cw->buf, 1, cw->len, fp) == cw->len;
+	ok = fclose(fp) == 0 && ok;
+	// Readers see either old or complete new cache.
+	if (!ok || rename(temp, path) != 0) {
+		remove(temp);
+		return false;
+	}
+	return true;
+}
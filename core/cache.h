@@ -0,0 +1,102 @@
+#ifndef __CORE_CACHE_H
+#define __CORE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct memface;
+
+// Parsed stream cache: frame index of main timeline, characters and their
+// decoded outlines, and compiled frames of all timelines, keyed by sampled
+// file content and file stamp, see parser_open_cache(). Cache file is
+// named after the key in cache directory, and mapped read-only when file
+// with same key is loaded.
+//
+// Cache is in native byte order and layout, it is rejected if version,
+// word size or outline record size differs. Frame ops are opaque to cache,
+// parser rejects them if opsize differs. Offsets named "data" or "pos" are
+// relative to stream resource, other offsets are relative to cache.
+
+#define CACHE_VERSION	4
+
+struct cache_character {
+	uint16_t id;
+	uint16_t tag;
+	uint32_t data;
+	// Shape bounds or sprite frame index, of nudef bytes.
+	uint32_t udef;
+	uint32_t nudef;
+	// Outline records and data offsets of new styles, zero if shape was
+	// not decoded.
+	uint32_t outline;
+	uint32_t nrecord;
+	uint32_t palettes;
+	uint32_t npalette;
+};
+
+// Compiled frame starting at tagpos, nop ops of opsize bytes.
+struct cache_code {
+	uint32_t tagpos;
+	uint32_t endpos;
+	uint32_t nop;
+	uint32_t ops;
+};
+
+struct cache_header {
+	char magic[4];
+	uint16_t version;
+	uint8_t wordsize;
+	uint8_t recsize;
+	uint64_t key;
+	uint64_t size;
+	// Frame index of main timeline, nframe+1 entries, and scanning
+	// position. It is valid if indexed is not zero, that is, whole stream
+	// was scanned.
+	uint32_t indexed;
+	uint32_t nframe;
+	uint32_t frames;
+	uint32_t frameend;
+	uint32_t scanpos;
+	// Characters ordered by data, that is, in definition order.
+	uint32_t nchar;
+	uint32_t noutline;
+	uint32_t chars;
+	// Compiled frames ordered by tagpos.
+	uint32_t opsize;
+	uint32_t ncode;
+	uint32_t codes;
+};
+
+// Return mapped cache matching key and size of stream content, NULL if
+// there is no valid one. Data offsets are checked against ressize, bytes
+// addressable from stream resource.
+const struct cache_header *cache_open(const char *dir, uint64_t key, uint64_t size, size_t ressize, size_t *mapsizep);
+void cache_close(const struct cache_header *ch, size_t mapsize);
+
+// Return false if outline records of cached character have unknown verbs
+// or palette indices. Records are checked when character is restored, so
+// that opening cache doesn't cost time in proportion to outlines.
+bool cache_check_records(const struct cache_header *ch, const struct cache_character *cc);
+
+static inline const void *
+cache_section(const struct cache_header *ch, uint32_t off) {
+	return (const char *)ch + off;
+}
+
+struct cache_writer;
+
+struct cache_writer *cache_writer_create(struct memface *mc);
+void cache_writer_delete(struct cache_writer *cw);
+
+// Append size bytes at 8 bytes aligned offset, which is returned.
+uint32_t cache_writer_append(struct cache_writer *cw, const void *ptr, size_t size);
+
+// Header in writer, valid until next append.
+struct cache_header *cache_writer_header(struct cache_writer *cw);
+
+// Write cache file atomically, replacing existing one.
+// Return false if it can't be written.
+bool cache_writer_commit(struct cache_writer *cw, const char *dir);
+
+#endif
@@ -0,0 +1,129 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "player.h"
+#include "muplex.h"
+#include "render.h"
+#include "common.h"
+#include <base/matrix.h>
+#include <base/cxform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Each frame defines a polygon with NPOINT points and replaces character
+// at depth 1 with it. First frame is rendered scaled down, so that decoding
+// its shape outweighs filling it. Later frames are advanced only, so that
+// time of loading them is not buried in rendering.
+#define NPOINT	64
+#define WIDTH	55
+#define HEIGHT	40
+
+static void
+build_movie(struct swfgen *sg, size_t nframe) {
+	uint32_t seed = 23;
+	intreg_t pts[2*NPOINT];
+	swfgen_init(sg, 550*20, 400*20, nframe);
+	for (size_t i=0; i<nframe; i++) {
+		for (size_t j=0; j<NPOINT; j++) {
+			pts[2*j] = (intreg_t)(bench_random(&seed) % 4000);
+			pts[2*j+1] = (intreg_t)(bench_random(&seed) % 4000);
+		}
+		uintreg_t id = (uintreg_t)i + 1;
+		swfgen_polygon(sg, id, pts, NPOINT, bench_random(&seed));
+		if (i == 0) {
+			swfgen_place(sg, id, 1, 0, 0);
+		} else {
+			swfgen_replace(sg, id, 1);
+		}
+		swfgen_show(sg);
+	}
+	swfgen_finish(sg);
+}
+
+struct timing {
+	double first;
+	double all;
+};
+
+static void
+play_file(const char *path, const char *cachedir, size_t nframe, struct timing *tm) {
+	struct bufctx bx;
+	bx.width = bx.stride = WIDTH;
+	bx.height = HEIGHT;
+	bx.pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	struct transform tsm;
+	matrix_identify(&tsm.matrix);
+	tsm.matrix.sx = tsm.matrix.sy = FIXED_1/10;
+	cxform_identify(&tsm.cxform);
+
+	double beg = bench_now();
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	mux->set_cache(mux->muplex, cachedir);
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, path, StreamFile);
+	player_advance(pl);
+	struct rectangle rt = {0, WIDTH, 0, HEIGHT};
+	player_render(pl, tsm, &bx, &rt);
+	tm->first = bench_now() - beg;
+	for (size_t i=1; i<nframe; i++) {
+		player_advance(pl);
+	}
+	tm->all = bench_now() - beg;
+	player_delete(pl);
+	mux->delete_muplex(mux->muplex);
+	free(bx.pixels);
+}
+
+static void
+bench_cache(const char *dir, size_t nframe) {
+	struct swfgen sg;
+	build_movie(&sg, nframe);
+	char path[256];
+	snprintf(path, sizeof(path), "%s/movie.swf", dir);
+	FILE *fp = fopen(path, "wb");
+	if (fp == NULL || fwrite(sg.buf, 1, sg.len, fp) != sg.len || fclose(fp) != 0) {
+		fprintf(stderr, "can't write %s.\n", path);
+		abort();
+	}
+
+	// Untimed run pages file in. First cached run writes cache when
+	// stream is deleted.
+	struct timing plain, cold, warm;
+	play_file(path, NULL, nframe, &plain);
+	play_file(path, NULL, nframe, &plain);
+	play_file(path, dir, nframe, &cold);
+	play_file(path, dir, nframe, &warm);
+
+	printf("%6zu frames, %8zu bytes\n", nframe, sg.len);
+	printf("\tno cache    first frame %9.3f ms, all frames advanced %9.3f ms\n", plain.first, plain.all);
+	printf("\tcold cache  first frame %9.3f ms, all frames advanced %9.3f ms\n", cold.first, cold.all);
+	printf("\twarm cache  first frame %9.3f ms, all frames advanced %9.3f ms\n", warm.first, warm.all);
+
+	char cmd[300];
+	snprintf(cmd, sizeof(cmd), "rm -f %s/*.swfc", dir);
+	if (system(cmd) != 0) {
+		fprintf(stderr, "can't clean %s.\n", dir);
+	}
+	remove(path);
+	swfgen_free(&sg);
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	char dir[] = "/tmp/swiff-cache-XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		fprintf(stderr, "can't create cache directory.\n");
+		return 1;
+	}
+	printf("Startup with stream cache, start.\n");
+	bench_cache(dir, 100);
+	bench_cache(dir, 1000);
+	bench_cache(dir, 10000);
+	printf("Startup with stream cache, done.\n");
+	rmdir(dir);
+	return 0;
+}
@@ -0,0 +1,277 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "cache.h"
+#include "player.h"
+#include "muplex.h"
+#include "render.h"
+#include "parser.h"
+#include "common.h"
+#include <base/hash.h>
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#define WIDTH		160
+#define HEIGHT		120
+#define NFRAME		24
+
+// Shapes and a sprite defined in first frame, objects moved in every frame.
+// Shape 1 is redefined in middle of movie, objects placed before keep the
+// old definition.
+static void
+cache_test_movie(struct swfgen *sg) {
+	uint32_t seed = 37;
+	static const intreg_t square[] = {0, 0, 600, 0, 600, 600, 0, 600};
+	static const intreg_t wedge[] = {0, 0, 800, 200, 200, 700};
+	swfgen_init(sg, WIDTH*20, HEIGHT*20, NFRAME);
+	swfgen_polygon(sg, 1, square, 4, 0xFF0000);
+	swfgen_polygon(sg, 2, wedge, 3, 0x00FF00);
+	size_t lenpos = swfgen_begin_sprite(sg, 3, 3);
+	for (intreg_t i=0; i<3; i++) {
+		if (i == 0) {
+			swfgen_place(sg, 2, 1, 0, 0);
+		} else {
+			swfgen_place(sg, 0, 1, 300*i, 200*i);
+		}
+		swfgen_show(sg);
+	}
+	swfgen_end_sprite(sg, lenpos);
+	for (size_t i=0; i<NFRAME; i++) {
+		if (i == NFRAME/2) {
+			swfgen_polygon(sg, 1, wedge, 3, 0x0000FF);
+			swfgen_place(sg, 1, 4, 1000, 1000);
+		}
+		for (uintreg_t d=1; d<=3; d++) {
+			intreg_t tx = (intreg_t)(bench_random(&seed) % (WIDTH*20));
+			intreg_t ty = (intreg_t)(bench_random(&seed) % (HEIGHT*20));
+			swfgen_place(sg, i == 0 ? d : 0, d, tx, ty);
+		}
+		if (i == NFRAME/2 + 2) {
+			swfgen_remove(sg, 2);
+		}
+		swfgen_show(sg);
+	}
+	swfgen_finish(sg);
+}
+
+// Hashes of frames of file played with cache in dir, and tags read.
+static size_t
+cache_test_play(const char *path, const char *dir, uint64_t *hashes) {
+	struct bufctx bx;
+	bx.width = bx.stride = WIDTH;
+	bx.height = HEIGHT;
+	bx.pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	struct transform tsm;
+	matrix_identify(&tsm.matrix);
+	cxform_identify(&tsm.cxform);
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	mux->set_cache(mux->muplex, dir);
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, path, StreamFile);
+	for (size_t i=0; i<NFRAME; i++) {
+		player_advance(pl);
+		struct rectangle rt = {0, WIDTH, 0, HEIGHT};
+		player_render(pl, tsm, &bx, &rt);
+		hashes[i] = hash_bytes(bx.pixels, sizeof(struct rgba8)*WIDTH*HEIGHT);
+	}
+	player_delete(pl);
+	const struct tagstat *ts = mux->tag_stats(mux->muplex);
+	size_t ntag = 0;
+	for (size_t i=0; i<SWFTAG_NCODE; i++) {
+		ntag += ts[i].count;
+	}
+	mux->delete_muplex(mux->muplex);
+	free(bx.pixels);
+	return ntag;
+}
+
+// Path of the only cache file in dir, false if there is none.
+static bool
+cache_test_find(const char *dir, char *path, size_t len) {
+	DIR *dp = opendir(dir);	assert(dp != NULL);
+	bool found = false;
+	struct dirent *de;
+	while ((de = readdir(dp)) != NULL) {
+		size_t n = strlen(de->d_name);
+		if (n > 5 && strcmp(de->d_name + n - 5, ".swfc") == 0) {
+			assert(!found);
+			snprintf(path, len, "%s/%s", dir, de->d_name);
+			found = true;
+		}
+	}
+	closedir(dp);
+	return found;
+}
+
+static void
+cache_test_write(const char *path, const void *data, size_t size) {
+	FILE *fp = fopen(path, "wb");	assert(fp != NULL);
+	size_t n = fwrite(data, 1, size, fp);	assert(n == size);
+	int err = fclose(fp);	assert(err == 0);
+	(void)n; (void)err;
+}
+
+static uint8_t *
+cache_test_read(const char *path, size_t *sizep) {
+	FILE *fp = fopen(path, "rb");	assert(fp != NULL);
+	fseek(fp, 0, SEEK_END);
+	size_t size = (size_t)ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	uint8_t *data = malloc(size);
+	size_t n = fread(data, 1, size, fp);	assert(n == size);
+	fclose(fp);
+	(void)n;
+	*sizep = size;
+	return data;
+}
+
+// Warm run restores every frame without reading tags, and draws same
+// frames as run without cache.
+static void
+cache_test_roundtrip(const char *dir, const char *path, const uint64_t *plain) {
+	printf("cache_test_roundtrip(), start.\n");
+	uint64_t hashes[NFRAME];
+	char cachepath[512];
+	assert(!cache_test_find(dir, cachepath, sizeof(cachepath)));
+	size_t ntag = cache_test_play(path, dir, hashes);
+	assert(ntag != 0);
+	assert(memcmp(hashes, plain, sizeof(hashes)) == 0);
+	assert(cache_test_find(dir, cachepath, sizeof(cachepath)));
+
+	assert(cache_test_play(path, dir, hashes) == 0);
+	assert(memcmp(hashes, plain, sizeof(hashes)) == 0);
+	printf("cache_test_roundtrip(), done.\n");
+}
+
+// Damaged caches are rejected as a whole when opened, damaged ops are
+// rejected per frame, those frames are compiled from tags.
+static void
+cache_test_corrupt(const char *dir, const char *path, const uint64_t *plain) {
+	printf("cache_test_corrupt(), start.\n");
+	uint64_t hashes[NFRAME];
+	char cachepath[512];
+	bool found = cache_test_find(dir, cachepath, sizeof(cachepath));	assert(found);
+	(void)found;
+	size_t size;
+	uint8_t *good = cache_test_read(cachepath, &size);
+	uint8_t *bad = malloc(size);
+	const struct cache_header *ch = (const void *)good;
+	assert(ch->ncode != 0 && ch->nchar != 0);
+
+	// Truncated, foreign version, characters out of order, frame index
+	// beyond stream, and frame ops beyond cache.
+	for (size_t n=0; n<5; n++) {
+		memcpy(bad, good, size);
+		struct cache_header *bh = (void *)bad;
+		struct cache_character *chars = (void *)(bad + bh->chars);
+		struct cache_code *codes = (void *)(bad + bh->codes);
+		size_t len = size;
+		switch (n) {
+		case 0:
+			len = size/2;
+			break;
+		case 1:
+			bh->version++;
+			break;
+		case 2:
+			chars[bh->nchar-1].data = chars[0].data;
+			break;
+		case 3:
+			((uint32_t *)(bad + bh->frames))[bh->nframe] = UINT32_MAX;
+			break;
+		case 4:
+			codes[bh->ncode-1].nop = UINT32_MAX;
+			break;
+		}
+		cache_test_write(cachepath, bad, len);
+		size_t ntag = cache_test_play(path, dir, hashes);
+		assert(ntag != 0);
+		assert(memcmp(hashes, plain, sizeof(hashes)) == 0);
+		// Rejected cache is rewritten.
+		assert(cache_test_play(path, dir, hashes) == 0);
+	}
+
+	// Unknown opcode and reference to character not defined yet.
+	for (size_t n=0; n<2; n++) {
+		memcpy(bad, good, size);
+		struct cache_header *bh = (void *)bad;
+		const struct cache_code *codes = (const void *)(bad + bh->codes);
+		const struct cache_character *chars = (const void *)(bad + bh->chars);
+		size_t k = 0;
+		while (codes[k].nop == 0) {
+			k++;
+		}
+		uintreg_t *op = (void *)(bad + codes[k].ops);
+		if (n == 0) {
+			op[0] = 99;
+		} else {
+			// Layout of struct frame_op in core/parser.c.
+			struct { uintreg_t code; struct place_info place; } *fo = (void *)op;
+			fo->place.character = chars[bh->nchar-1].data;
+		}
+		cache_test_write(cachepath, bad, size);
+		size_t ntag = cache_test_play(path, dir, hashes);
+		assert(ntag != 0);
+		assert(memcmp(hashes, plain, sizeof(hashes)) == 0);
+	}
+	free(bad);
+	free(good);
+	printf("cache_test_corrupt(), done.\n");
+}
+
+// Data streams have no stamp, they are not cached.
+static void
+cache_test_data(const char *dir, const struct swfgen *sg) {
+	printf("cache_test_data(), start.\n");
+	char cachepath[512];
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	mux->set_cache(mux->muplex, dir);
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, sg->buf, StreamData);
+	for (size_t i=0; i<NFRAME; i++) {
+		player_advance(pl);
+	}
+	player_delete(pl);
+	mux->delete_muplex(mux->muplex);
+	assert(!cache_test_find(dir, cachepath, sizeof(cachepath)));
+	printf("cache_test_data(), done.\n");
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	setvbuf(stderr, NULL, _IONBF, 0);
+
+	printf("Test cache, start.\n");
+	char dir[] = "/tmp/swiff-cache-test-XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		fprintf(stderr, "can't create cache directory.\n");
+		return 1;
+	}
+	char path[256];
+	snprintf(path, sizeof(path), "%s/movie.swf", dir);
+	struct swfgen sg;
+	cache_test_movie(&sg);
+	cache_test_write(path, sg.buf, sg.len);
+
+	cache_test_data(dir, &sg);
+	uint64_t plain[NFRAME];
+	cache_test_play(path, NULL, plain);
+	cache_test_roundtrip(dir, path, plain);
+	cache_test_corrupt(dir, path, plain);
+
+	char cachepath[512];
+	if (cache_test_find(dir, cachepath, sizeof(cachepath))) {
+		remove(cachepath);
+	}
+	remove(path);
+	rmdir(dir);
+	swfgen_free(&sg);
+	printf("Test cache, done.\n");
+	return 0;
+}
@@ -4,6 +4,13 @@ enum stream_type {
 	StreamInit,
 	StreamData,
 	StreamFile,
+	StreamFeed,
 	StreamUdef,
 };
+
+// Rasterizer engines, see raster.h.
+enum raster_engine {
+	RasterEngineScanline,
+	RasterEngineAccumulate,
+};
 #endif
@@ -5,9 +5,13 @@
 #include <base/intreg.h>
 #include <stdint.h>
 
+// Frame i of timeline starts at tagbeg + frames[i], frames[nframe] is end
+// of the last frame. For main timeline, only loaded frames are indexed,
+// entries of frames not loaded yet are zero.
 struct sprite_define {
 	uintptr_t tagbeg;
 	intreg_t nframe;
+	const uint32_t *frames;
 };
 
 struct stream_define {
@@ -15,6 +19,7 @@ struct stream_define {
 	uint16_t rate;
 	uint16_t nframe;
 	uintptr_t tagbeg;
+	const uint32_t *frames;
 };
 
 #endif
@@ -0,0 +1,84 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "bench.h"
+// Dictionary is private to parser, bench it in place.
+#include "parser.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Characters are defined with even ids spread over whole id space, so
+// lookups of odd ids miss in allocated pages. Lookup ids are generated
+// before timing.
+#define NLOOKUP		(1 << 20)
+#define NROUND		16
+
+// Keeps lookups from being optimized away.
+static volatile uintptr_t bench_sink;
+
+static double
+bench_search(struct dictionary *dc, const uint16_t *ids, bool hit) {
+	uintptr_t sum = 0;
+	double beg = bench_now();
+	for (size_t r=0; r<NROUND; r++) {
+		if (hit) {
+			for (size_t i=0; i<NLOOKUP; i++) {
+				sum += (uintptr_t)dictionary_get_char(dc, ids[i]);
+			}
+		} else {
+			// Missing ids take search path, dictionary_get_char()
+			// asserts on them.
+			for (size_t i=0; i<NLOOKUP; i++) {
+				sum += (uintptr_t)dictionary_search_char(dc, ids[i]);
+			}
+		}
+	}
+	double used = bench_now() - beg;
+	bench_sink += sum;
+	return used;
+}
+
+static void
+bench_lookup(size_t nchar) {
+	struct pxface *pf = parser_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct parser *px = pf->parser;
+	struct dictionary *dc = parser_create_dictionary(px);
+	uintreg_t step = (uintreg_t)(0x10000/nchar) & ~(uintreg_t)1;
+	for (size_t i=0; i<nchar; i++) {
+		struct character *ch = parser_define_character(px, dc, (uintreg_t)(i+1)*step);
+		ch->tag = SwftagEnd;
+		ch->data = ch->udef = 0;
+	}
+
+	uint32_t seed = 17;
+	uint16_t *hits = malloc(sizeof(uint16_t)*NLOOKUP);
+	uint16_t *misses = malloc(sizeof(uint16_t)*NLOOKUP);
+	for (size_t i=0; i<NLOOKUP; i++) {
+		uintreg_t id = (uintreg_t)(bench_random(&seed) % nchar + 1)*step;
+		hits[i] = (uint16_t)id;
+		misses[i] = (uint16_t)(id+1);
+	}
+
+	double hit = bench_search(dc, hits, true);
+	double miss = bench_search(dc, misses, false);
+	double n = (double)NLOOKUP*NROUND;
+	printf("\t%6zu characters: hit %6.2f ns/lookup, miss %6.2f ns/lookup\n",
+		nchar, hit*1e6/n, miss*1e6/n);
+
+	free(hits);
+	free(misses);
+	parser_delete_dictionary(px, dc);
+	pf->delete_parser(px);
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	printf("Character lookup, start.\n");
+	bench_lookup(100);
+	bench_lookup(1000);
+	bench_lookup(10000);
+	bench_lookup(30000);
+	printf("Character lookup, done.\n");
+	return 0;
+}
@@ -0,0 +1,145 @@
+#ifndef __CORE_EDGE_H
+#define __CORE_EDGE_H
+
+#include "render.h"
+#include <base/geometry.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Edges of textures built by render, shared with rasterizers.
+
+#define ac_type		ac_union._ac_info.__ac_type
+#define ac_transparent	ac_union._ac_info.__ac_transparent
+#define ac_winding	ac_union._ac_info.__ac_winding
+#define ac_init		ac_union._ac_init
+// Color is filled by nonzero winding rule of its edges if ac_winding is
+// set, as strokes are, otherwise by even-odd rule.
+struct active_color {
+	union {
+		struct {
+			uint8_t __ac_type;
+			uint8_t __ac_transparent;
+			uint8_t __ac_winding;
+		} _ac_info;
+		uint32_t _ac_init;
+	} ac_union;
+	union color ac_color[];
+};
+
+#define COLOR_OFFSET		offsetof(struct active_color, ac_color)
+#define COLOR2ACTIVE(co)	((struct active_color *)(((char*)co) - COLOR_OFFSET))
+
+// Edge in twips of target. ee_control is control point of EdgeTypeCurve
+// edge, ee_color1 is NULL unless fill rule is FillRuleSwfedge.
+struct edge {
+	uint8_t ee_edge_type;
+	uint8_t ee_fill_rule;
+	int16_t ee_direction;
+	struct point ee_anchor0;
+	struct point ee_anchor1;
+	struct point ee_control;
+	struct active_color *ee_color0;
+	struct active_color *ee_color1;
+};
+
+enum edge_type {
+	EdgeTypeLine	= 0,
+	EdgeTypeCurve	= 1,
+};
+
+enum fill_rule {
+	FillRuleEvenodd	= 0,
+	FillRuleSwfedge	= 2,
+	FillRuleWinding	= 4,
+};
+
+enum {
+	EdgeDirectionPositive	= 1,
+	EdgeDirectionNegative	= -1,
+};
+
+// Edges of a texture packed in one block after its header and colors.
+//
+// An edge is a run of units: head, indices of color0 and color1 in colors,
+// then anchor0, anchor1 and control of curve, x before y. Head is edge type
+// or-ed with fill rule, and EdgeHeadNegative if direction is negative.
+// Coordinates are twips from origin of texture, so moving origin moves all
+// edges. Units are 16 bits if texture spans no more than 65535 twips each
+// way and has no more colors, 32 bits otherwise.
+struct texture {
+	struct point origin;
+	// Edges lie in [0, width] and [0, height] from origin.
+	coord_t width;
+	coord_t height;
+	// Bits of a unit, 16 or 32.
+	uint32_t precision;
+	size_t nedge;
+	// Lines edges are flattened into.
+	size_t nline;
+	// Bytes of texture, header, colors and edges.
+	size_t size;
+	// Live textures of render.
+	struct texture *prev;
+	struct texture *next;
+	size_t ncolor;
+	// First color is NULL.
+	struct active_color *colors[];
+};
+
+#define EdgeHeadNegative	0x08
+#define EdgeLineUnits		7
+#define EdgeCurveUnits		9
+
+// Cursor of edges of a texture.
+struct edgeiter {
+	const struct texture *tu;
+	const char *next;
+	size_t left;
+};
+
+static inline void
+texture_iterate(const struct texture *tu, struct edgeiter *it) {
+	it->tu = tu;
+	it->next = (const char *)(tu->colors + tu->ncolor);
+	it->left = tu->nedge;
+}
+
+static inline uint32_t
+edgeiter_unit(const struct edgeiter *it, size_t i) {
+	if (it->tu->precision == 16) {
+		return ((const uint16_t *)it->next)[i];
+	}
+	return ((const uint32_t *)it->next)[i];
+}
+
+// Decode next edge into ee, false if there is none.
+static inline bool
+edgeiter_next(struct edgeiter *it, struct edge *ee) {
+	if (it->left == 0) {
+		return false;
+	}
+	const struct texture *tu = it->tu;
+	uint32_t head = edgeiter_unit(it, 0);
+	ee->ee_edge_type = (uint8_t)(head & EdgeTypeCurve);
+	ee->ee_fill_rule = (uint8_t)(head & (FillRuleSwfedge|FillRuleWinding));
+	ee->ee_direction = (head & EdgeHeadNegative) ? EdgeDirectionNegative : EdgeDirectionPositive;
+	ee->ee_color0 = tu->colors[edgeiter_unit(it, 1)];
+	ee->ee_color1 = tu->colors[edgeiter_unit(it, 2)];
+	ee->ee_anchor0.x = tu->origin.x + (coord_t)edgeiter_unit(it, 3);
+	ee->ee_anchor0.y = tu->origin.y + (coord_t)edgeiter_unit(it, 4);
+	ee->ee_anchor1.x = tu->origin.x + (coord_t)edgeiter_unit(it, 5);
+	ee->ee_anchor1.y = tu->origin.y + (coord_t)edgeiter_unit(it, 6);
+	size_t nunit = EdgeLineUnits;
+	if (ee->ee_edge_type == EdgeTypeCurve) {
+		ee->ee_control.x = tu->origin.x + (coord_t)edgeiter_unit(it, 7);
+		ee->ee_control.y = tu->origin.y + (coord_t)edgeiter_unit(it, 8);
+		nunit = EdgeCurveUnits;
+	}
+	it->next += nunit*tu->precision/8;
+	it->left--;
+	return true;
+}
+
+#endif
@@ -0,0 +1,148 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "bench.h"
+#include "player.h"
+#include "muplex.h"
+#include "common.h"
+
+#include <zlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Each frame defines a polygon with NPOINT points and places it at depth 1.
+#define NPOINT	64
+
+static void
+build_movie(struct swfgen *sg, size_t nframe) {
+	uint32_t seed = 7;
+	intreg_t pts[2*NPOINT];
+	swfgen_init(sg, 550*20, 400*20, nframe);
+	for (size_t i=0; i<nframe; i++) {
+		for (size_t j=0; j<NPOINT; j++) {
+			pts[2*j] = (intreg_t)(bench_random(&seed) % 4000);
+			pts[2*j+1] = (intreg_t)(bench_random(&seed) % 4000);
+		}
+		uintreg_t id = (uintreg_t)i + 1;
+		swfgen_polygon(sg, id, pts, NPOINT, bench_random(&seed));
+		if (i == 0) {
+			swfgen_place(sg, id, 1, 0, 0);
+		} else {
+			swfgen_place(sg, 0, 1, (intreg_t)(i%100)*20, 0);
+		}
+		swfgen_show(sg);
+		if (i == 0) {
+			sg->firstend = sg->len;
+		}
+	}
+	swfgen_finish(sg);
+}
+
+struct timing {
+	double first;
+	double all;
+};
+
+static void
+play_movie(const void *data, size_t nframe, struct timing *tm) {
+	double beg = bench_now();
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, data, StreamData);
+	player_advance(pl);
+	tm->first = bench_now() - beg;
+	for (size_t i=1; i<nframe; i++) {
+		player_advance(pl);
+	}
+	tm->all = bench_now() - beg;
+	player_delete(pl);
+	mux->delete_muplex(mux->muplex);
+}
+
+// Movie arrives in chunks, player advances after each chunk. First frame
+// is timed up to the chunk completing it.
+#define FEED_CHUNK	4096
+
+static void
+play_fed(const byte_t *data, size_t len, size_t firstend, size_t nframe, struct timing *tm) {
+	double beg = bench_now();
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, NULL, StreamFeed);
+	tm->first = 0;
+	for (size_t off=0; off<len; off+=FEED_CHUNK) {
+		size_t n = len-off < FEED_CHUNK ? len-off : FEED_CHUNK;
+		player_feed(pl, data+off, n);
+		player_advance(pl);
+		if (tm->first == 0 && off+n >= firstend) {
+			tm->first = bench_now() - beg;
+		}
+	}
+	for (size_t i=0; i<nframe; i++) {
+		player_advance(pl);
+	}
+	tm->all = bench_now() - beg;
+	player_delete(pl);
+	mux->delete_muplex(mux->muplex);
+}
+
+// Host inflates whole movie before loading it.
+static void
+play_inflated(const byte_t *zdata, size_t zlen, size_t len, size_t nframe, struct timing *tm) {
+	double beg = bench_now();
+	byte_t *buf = malloc(len);
+	memcpy(buf, zdata, 8);
+	buf[0] = 'F';
+	uLongf dlen = (uLongf)(len - 8);
+	uncompress(buf+8, &dlen, zdata+8, (uLong)(zlen - 8));
+	double inflated = bench_now() - beg;
+	play_movie(buf, nframe, tm);
+	tm->first += inflated;
+	tm->all += inflated;
+	free(buf);
+}
+
+static void
+bench_loading(size_t nframe) {
+	struct swfgen sg;
+	build_movie(&sg, nframe);
+	size_t zlen, lzlen;
+	byte_t *zdata = swfgen_deflate(&sg, &zlen);
+	byte_t *lzdata = swfgen_lzma(&sg, &lzlen);
+
+	struct timing eager, lazy, lzma, plain, fed, zfed;
+	play_movie(sg.buf, nframe, &plain);
+	play_inflated(zdata, zlen, sg.len, nframe, &eager);
+	play_movie(zdata, nframe, &lazy);
+	play_movie(lzdata, nframe, &lzma);
+	play_fed(sg.buf, sg.len, sg.firstend, nframe, &fed);
+	play_fed(zdata, zlen, zlen, nframe, &zfed);
+
+	printf("%6zu frames, %8zu bytes (%8zu zlib, %8zu lzma)\n", nframe, sg.len, zlen, lzlen);
+	printf("\tFWS                first frame %9.3f ms, all frames %9.3f ms\n", plain.first, plain.all);
+	printf("\tCWS inflate whole  first frame %9.3f ms, all frames %9.3f ms\n", eager.first, eager.all);
+	printf("\tCWS inflate lazy   first frame %9.3f ms, all frames %9.3f ms\n", lazy.first, lazy.all);
+	printf("\tZWS decode lazy    first frame %9.3f ms, all frames %9.3f ms\n", lzma.first, lzma.all);
+	printf("\tFWS fed in chunks  first frame %9.3f ms, all frames %9.3f ms\n", fed.first, fed.all);
+	printf("\tCWS fed in chunks                            all frames %9.3f ms\n", zfed.all);
+
+	free(lzdata);
+	free(zdata);
+	swfgen_free(&sg);
+}
+
+int
+main(int argc, char *argv[]) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	size_t nframe = argc > 1 ? (size_t)strtoul(argv[1], NULL, 10) : 0;
+	if (nframe != 0) {
+		bench_loading(nframe);
+		return 0;
+	}
+	printf("Time to first frame, start.\n");
+	bench_loading(100);
+	bench_loading(1000);
+	bench_loading(10000);
+	printf("Time to first frame, done.\n");
+	return 0;
+}
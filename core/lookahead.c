@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "lookahead.h"
+#include "outline.h"
+#include <base/compat.h>
+#include <base/helper.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// A queued, being decoded or decoded shape.
+struct prefetch {
+	struct prefetch *next;		// In hash chain.
+	struct prefetch *qnext;		// In queue, while not decoded.
+	const void *owner;
+	enum swftag tag;
+	const uint8_t *data;
+	struct outline *outline;
+};
+
+#define LOOKAHEAD_NSLOT	256
+
+struct lookahead {
+	struct memface *memface;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	// Signaled when shape queued or worker quits.
+	pthread_cond_t wakeup;
+	// Signaled when shape decoded.
+	pthread_cond_t decoded;
+	bool quit;
+	struct prefetch *queue;
+	struct prefetch **qtail;
+	struct prefetch *busy;
+	struct prefetch *slots[LOOKAHEAD_NSLOT];
+};
+
+static inline size_t
+lookahead_hash(const uint8_t *data) {
+	return (size_t)(((uintptr_t)data * (uintptr_t)2654435761u) >> 8) & (LOOKAHEAD_NSLOT-1);
+}
+
+static struct prefetch **
+lookahead_search(struct lookahead *la, const uint8_t *data) {
+	struct prefetch **pp = &la->slots[lookahead_hash(data)];
+	while (*pp != NULL && (*pp)->data != data) {
+		pp = &(*pp)->next;
+	}
+	return pp;
+}
+
+static void
+lookahead_dequeue(struct lookahead *la, struct prefetch *pf) {
+	struct prefetch **pp = &la->queue;
+	while (*pp != pf) {
+		pp = &(*pp)->qnext;
+	}
+	*pp = pf->qnext;
+	if (la->qtail == &pf->qnext) {
+		la->qtail = pp;
+	}
+}
+
+static void
+lookahead_free(struct lookahead *la, struct prefetch *pf) {
+	struct memface *mc = la->memface;
+	if (pf->outline != NULL) {
+		outline_delete(mc, pf->outline);
+	}
+	mc->dealloc(mc->ctx, pf, __FILE__, __LINE__);
+}
+
+static void *
+lookahead_main(void *arg) {
+	struct lookahead *la = arg;
+	pthread_mutex_lock(&la->lock);
+	for (;;) {
+		while (!la->quit && la->queue == NULL) {
+			pthread_cond_wait(&la->wakeup, &la->lock);
+		}
+		if (la->quit) {
+			break;
+		}
+		struct prefetch *pf = la->queue;
+		la->queue = pf->qnext;
+		if (la->queue == NULL) {
+			la->qtail = &la->queue;
+		}
+		la->busy = pf;
+		pthread_mutex_unlock(&la->lock);
+
+		struct outline *ol = outline_decode(la->memface, pf->tag, pf->data);
+
+		pthread_mutex_lock(&la->lock);
+		pf->outline = ol;
+		la->busy = NULL;
+		pthread_cond_broadcast(&la->decoded);
+	}
+	pthread_mutex_unlock(&la->lock);
+	return NULL;
+}
+
+struct lookahead *
+lookahead_create(struct memface *mc) {
+	struct lookahead *la = mc->zalloc(mc->ctx, sizeof(*la), __FILE__, __LINE__);
+	la->memface = mc;
+	la->qtail = &la->queue;
+	pthread_mutex_init(&la->lock, NULL);
+	pthread_cond_init(&la->wakeup, NULL);
+	pthread_cond_init(&la->decoded, NULL);
+	if (pthread_create(&la->thread, NULL, lookahead_main, la) != 0) {
+		pthread_cond_destroy(&la->decoded);
+		pthread_cond_destroy(&la->wakeup);
+		pthread_mutex_destroy(&la->lock);
+		mc->dealloc(mc->ctx, la, __FILE__, __LINE__);
+		return NULL;
+	}
+	return la;
+}
+
+void
+lookahead_delete(struct lookahead *la) {
+	pthread_mutex_lock(&la->lock);
+	la->quit = true;
+	pthread_cond_signal(&la->wakeup);
+	pthread_mutex_unlock(&la->lock);
+	pthread_join(la->thread, NULL);
+	for (size_t i=0; i<LOOKAHEAD_NSLOT; i++) {
+		struct prefetch *pf = la->slots[i];
+		while (pf != NULL) {
+			struct prefetch *next = pf->next;
+			lookahead_free(la, pf);
+			pf = next;
+		}
+	}
+	pthread_cond_destroy(&la->decoded);
+	pthread_cond_destroy(&la->wakeup);
+	pthread_mutex_destroy(&la->lock);
+	la->memface->dealloc(la->memface->ctx, la, __FILE__, __LINE__);
+}
+
+void
+lookahead_queue(struct lookahead *la, const void *owner, enum swftag tag, const uint8_t *data) {
+	pthread_mutex_lock(&la->lock);
+	struct prefetch **pp = lookahead_search(la, data);
+	if (*pp == NULL) {
+		struct memface *mc = la->memface;
+		struct prefetch *pf = mc->alloc(mc->ctx, sizeof(*pf), __FILE__, __LINE__);
+		pf->next = NULL;
+		pf->qnext = NULL;
+		pf->owner = owner;
+		pf->tag = tag;
+		pf->data = data;
+		pf->outline = NULL;
+		*pp = pf;
+		*la->qtail = pf;
+		la->qtail = &pf->qnext;
+		pthread_cond_signal(&la->wakeup);
+	}
+	pthread_mutex_unlock(&la->lock);
+}
+
+struct outline *
+lookahead_claim(struct lookahead *la, const uint8_t *data) {
+	pthread_mutex_lock(&la->lock);
+	struct prefetch **pp = lookahead_search(la, data);
+	struct prefetch *pf = *pp;
+	struct outline *ol = NULL;
+	if (pf != NULL) {
+		while (la->busy == pf) {
+			pthread_cond_wait(&la->decoded, &la->lock);
+		}
+		if (pf->outline == NULL) {
+			lookahead_dequeue(la, pf);
+		}
+		*pp = pf->next;
+		ol = pf->outline;
+		pf->outline = NULL;
+	}
+	pthread_mutex_unlock(&la->lock);
+	if (pf != NULL) {
+		lookahead_free(la, pf);
+	}
+	return ol;
+}
+
+void
+lookahead_cancel(struct lookahead *la, const void *owner) {
+	pthread_mutex_lock(&la->lock);
+	while (la->busy != NULL && la->busy->owner == owner) {
+		pthread_cond_wait(&la->decoded, &la->lock);
+	}
+	struct prefetch *trash = NULL;
+	for (size_t i=0; i<LOOKAHEAD_NSLOT; i++) {
+		struct prefetch **pp = &la->slots[i];
+		while (*pp != NULL) {
+			struct prefetch *pf = *pp;
+			if (pf->owner != owner) {
+				pp = &pf->next;
+				continue;
+			}
+			if (pf->outline == NULL) {
+				lookahead_dequeue(la, pf);
+			}
+			*pp = pf->next;
+			pf->next = trash;
+			trash = pf;
+		}
+	}
+	pthread_mutex_unlock(&la->lock);
+	while (trash != NULL) {
+		struct prefetch *next = trash->next;
+		lookahead_free(la, trash);
+		trash = next;
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef __CORE_LOOKAHEAD_H
+#define __CORE_LOOKAHEAD_H
+
+#include "swftag.h"
+#include <stddef.h>
+#include <stdint.h>
+
+struct memface;
+struct outline;
+struct lookahead;
+
+// Worker thread decoding shapes ahead of playing. Shapes are identified by
+// data given to outline_decode(), owner is stream containing data.
+// Memface must be safe to be called from worker thread.
+
+// Return NULL if worker thread can't be started.
+struct lookahead *lookahead_create(struct memface *mc);
+// Stop worker, outlines not claimed are deleted.
+void lookahead_delete(struct lookahead *la);
+
+// Queue shape for decoding. Shapes queued before are ignored.
+void lookahead_queue(struct lookahead *la, const void *owner, enum swftag tag, const uint8_t *data);
+
+// Return decoded outline of data, which belongs to caller then.
+// Return NULL if data was not queued or is still queued, queued one is
+// discarded. Shape being decoded is waited.
+struct outline *lookahead_claim(struct lookahead *la, const uint8_t *data);
+
+// Discard shapes of owner, waiting shape of owner being decoded.
+void lookahead_cancel(struct lookahead *la, const void *owner);
+
+#endif
@@ -0,0 +1,259 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "bench.h"
+#include "lookahead.h"
+#include "outline.h"
+#include "player.h"
+#include "muplex.h"
+#include "render.h"
+#include <base/helper.h>
+#include <base/hash.h>
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define NSHAPE		64
+
+// Memface counting blocks alive, safe to be called from worker thread.
+static pthread_mutex_t CountLock = PTHREAD_MUTEX_INITIALIZER;
+static size_t CountAlive;
+
+static void *
+count_alloc(void *ctx, size_t size, const char *file, int line) {
+	pthread_mutex_lock(&CountLock);
+	CountAlive++;
+	pthread_mutex_unlock(&CountLock);
+	return BenchMemface.alloc(ctx, size, file, line);
+}
+
+static void *
+count_zalloc(void *ctx, size_t size, const char *file, int line) {
+	void *ptr = count_alloc(ctx, size, file, line);
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+static void *
+count_realloc(void *ctx, void *ptr, size_t size, const char *file, int line) {
+	if (ptr == NULL) {
+		return count_alloc(ctx, size, file, line);
+	}
+	return BenchMemface.realloc(ctx, ptr, size, file, line);
+}
+
+static void
+count_dealloc(void *ctx, void *ptr, const char *file, int line) {
+	pthread_mutex_lock(&CountLock);
+	CountAlive--;
+	pthread_mutex_unlock(&CountLock);
+	BenchMemface.dealloc(ctx, ptr, file, line);
+}
+
+static struct memface CountMemface = {
+	.ctx = NULL,
+	.alloc = count_alloc,
+	.zalloc = count_zalloc,
+	.realloc = count_realloc,
+	.dealloc = count_dealloc,
+};
+
+// DefineShape tags of star polygons, data of shape i starts at shapes[i].
+static void
+lookahead_test_shapes(struct swfgen *sg, const uint8_t **shapes) {
+	uint32_t seed = 19;
+	intreg_t pts[2*32];
+	size_t offs[NSHAPE];
+	sg->buf = NULL;
+	sg->len = sg->cap = 0;
+	for (size_t i=0; i<NSHAPE; i++) {
+		for (size_t j=0; j<32; j++) {
+			pts[2*j] = (intreg_t)(bench_random(&seed) % 4000);
+			pts[2*j+1] = (intreg_t)(bench_random(&seed) % 4000);
+		}
+		size_t pos = sg->len;
+		swfgen_polygon(sg, (uintreg_t)i+1, pts, 32, bench_random(&seed));
+		size_t hdr = (sg->buf[pos] & 0x3F) == 0x3F ? 6 : 2;
+		// Bounds: 5 bits of field size and four fields.
+		size_t nbit = (size_t)(sg->buf[pos+hdr+2] >> 3);
+		offs[i] = pos + hdr + 2 + (5 + 4*nbit + 7)/8;
+	}
+	for (size_t i=0; i<NSHAPE; i++) {
+		shapes[i] = sg->buf + offs[i];
+	}
+}
+
+static void
+lookahead_test_same(const struct outline *a, const struct outline *b) {
+	assert(a->nrecord == b->nrecord && a->npalette == b->npalette);
+	for (size_t i=0; i<a->nrecord; i++) {
+		const struct outline_record *r0 = &a->records[i], *r1 = &b->records[i];
+		assert(r0->verb == r1->verb);
+		if (r0->verb == OutlineVerbStyle) {
+			assert(r0->u.style.flag == r1->u.style.flag);
+			assert(r0->u.style.fill0 == r1->u.style.fill0 && r0->u.style.fill1 == r1->u.style.fill1);
+			assert(r0->u.style.line == r1->u.style.line);
+		} else {
+			assert(r0->u.edge.anchor.x == r1->u.edge.anchor.x && r0->u.edge.anchor.y == r1->u.edge.anchor.y);
+			if (r0->verb == OutlineVerbCurve) {
+				assert(r0->u.edge.control.x == r1->u.edge.control.x && r0->u.edge.control.y == r1->u.edge.control.y);
+			}
+		}
+	}
+}
+
+// Claimed outlines are same as decoded in place, shapes not queued or
+// claimed twice are not found.
+static void
+lookahead_test_claim(void) {
+	printf("lookahead_test_claim(), start.\n");
+	struct swfgen sg;
+	const uint8_t *shapes[NSHAPE];
+	lookahead_test_shapes(&sg, shapes);
+	struct lookahead *la = lookahead_create(&CountMemface);	assert(la != NULL);
+	for (size_t i=0; i<NSHAPE; i+=2) {
+		lookahead_queue(la, &sg, SwftagDefineShape, shapes[i]);
+		lookahead_queue(la, &sg, SwftagDefineShape, shapes[i]);
+	}
+	for (size_t i=0; i<NSHAPE; i++) {
+		struct outline *ol = lookahead_claim(la, shapes[i]);
+		assert(ol == NULL || i%2 == 0);
+		if (ol != NULL) {
+			struct outline *in = outline_decode(&CountMemface, SwftagDefineShape, shapes[i]);
+			lookahead_test_same(ol, in);
+			outline_delete(&CountMemface, in);
+			outline_delete(&CountMemface, ol);
+		}
+		assert(lookahead_claim(la, shapes[i]) == NULL);
+	}
+	// Shapes queued long enough are decoded by worker.
+	for (size_t i=1; i<NSHAPE; i+=2) {
+		struct outline *ol;
+		do {
+			lookahead_queue(la, &sg, SwftagDefineShape, shapes[i]);
+			nanosleep(&(struct timespec){0, 1000000}, NULL);
+			ol = lookahead_claim(la, shapes[i]);
+		} while (ol == NULL);
+		struct outline *in = outline_decode(&CountMemface, SwftagDefineShape, shapes[i]);
+		lookahead_test_same(ol, in);
+		outline_delete(&CountMemface, in);
+		outline_delete(&CountMemface, ol);
+	}
+	lookahead_delete(la);
+	assert(CountAlive == 0);
+	swfgen_free(&sg);
+	printf("lookahead_test_claim(), done.\n");
+}
+
+// Cancelled shapes of an owner are discarded, shapes of other owners are
+// kept. Outlines not claimed are deleted with lookahead.
+static void
+lookahead_test_cancel(void) {
+	printf("lookahead_test_cancel(), start.\n");
+	struct swfgen sg;
+	const uint8_t *shapes[NSHAPE];
+	lookahead_test_shapes(&sg, shapes);
+	int owners[2];
+	for (size_t round=0; round<16; round++) {
+		struct lookahead *la = lookahead_create(&CountMemface);	assert(la != NULL);
+		for (size_t i=0; i<NSHAPE; i++) {
+			lookahead_queue(la, &owners[i%2], SwftagDefineShape, shapes[i]);
+		}
+		lookahead_cancel(la, &owners[0]);
+		for (size_t i=0; i<NSHAPE; i+=2) {
+			assert(lookahead_claim(la, shapes[i]) == NULL);
+		}
+		if (round%2 == 0) {
+			struct outline *ol = lookahead_claim(la, shapes[NSHAPE-1]);
+			if (ol != NULL) {
+				outline_delete(&CountMemface, ol);
+			}
+		}
+		lookahead_delete(la);
+		assert(CountAlive == 0);
+	}
+	swfgen_free(&sg);
+	printf("lookahead_test_cancel(), done.\n");
+}
+
+#define WIDTH		160
+#define HEIGHT		120
+#define NFRAME		40
+
+// Hash of frames of movie, whose every frame defines a shape and places
+// it, played with shapes of nframe frames decoded ahead.
+static uint64_t
+lookahead_test_play(const struct swfgen *sg, size_t nframe) {
+	struct muface *mux = muplex_create_default(&CountMemface, &BenchLogface, &BenchErrface);
+	bool started = mux->set_lookahead(mux->muplex, nframe);		assert(started);
+	(void)started;
+	struct player *pl = player_create(mux, &CountMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, sg->buf, StreamData);
+	struct bufctx bx;
+	bx.width = bx.stride = WIDTH;
+	bx.height = HEIGHT;
+	bx.pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	struct transform tsm;
+	matrix_identify(&tsm.matrix);
+	cxform_identify(&tsm.cxform);
+	uint64_t hash = 0;
+	// Stream is deleted in middle of movie, with shapes queued.
+	for (size_t i=0; i<NFRAME/2; i++) {
+		player_advance(pl);
+		struct rectangle rt = {0, WIDTH, 0, HEIGHT};
+		player_render(pl, tsm, &bx, &rt);
+		hash = hash*31 + hash_bytes(bx.pixels, sizeof(struct rgba8)*WIDTH*HEIGHT);
+	}
+	free(bx.pixels);
+	player_delete(pl);
+	mux->delete_muplex(mux->muplex);
+	assert(CountAlive == 0);
+	return hash;
+}
+
+// Frames played with shapes decoded ahead are same as ones decoded when
+// played, shapes of deleted streams are discarded.
+static void
+lookahead_test_player(void) {
+	printf("lookahead_test_player(), start.\n");
+	uint32_t seed = 31;
+	intreg_t pts[2*32];
+	struct swfgen sg;
+	swfgen_init(&sg, WIDTH*20, HEIGHT*20, NFRAME);
+	for (size_t i=0; i<NFRAME; i++) {
+		for (size_t j=0; j<32; j++) {
+			pts[2*j] = (intreg_t)(bench_random(&seed) % (WIDTH*20));
+			pts[2*j+1] = (intreg_t)(bench_random(&seed) % (HEIGHT*20));
+		}
+		swfgen_polygon(&sg, (uintreg_t)i+1, pts, 32, bench_random(&seed));
+		if (i < 4) {
+			swfgen_place(&sg, (uintreg_t)i+1, (uintreg_t)i+1, 0, 0);
+		} else {
+			swfgen_replace(&sg, (uintreg_t)i+1, (uintreg_t)i%4+1);
+		}
+		swfgen_show(&sg);
+	}
+	swfgen_finish(&sg);
+	uint64_t hash = lookahead_test_play(&sg, 0);
+	for (size_t nframe=1; nframe<=16; nframe*=4) {
+		assert(lookahead_test_play(&sg, nframe) == hash);
+	}
+	swfgen_free(&sg);
+	printf("lookahead_test_player(), done.\n");
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	setvbuf(stderr, NULL, _IONBF, 0);
+
+	printf("Test lookahead, start.\n");
+	lookahead_test_claim();
+	lookahead_test_cancel();
+	lookahead_test_player();
+	printf("Test lookahead, done.\n");
+	return 0;
+}
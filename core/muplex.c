@@ -19,16 +19,40 @@ muplex_create_stream(struct muplex *mux, const void *ud, enum stream_type ut, st
 	struct stream *stm = mux->malloc(mux->memctx, sizeof(*stm), __FILE__, __LINE__);
 	stm->type = ut;
 	stm->pxface = mux->default_parser;
-	stm->pxface->struct_stream(stm->pxface->parser, stm, ud, inf);
+	if (!stm->pxface->struct_stream(stm->pxface->parser, stm, ud, inf)) {
+		mux->free(mux->memctx, stm, __FILE__, __LINE__);
+		return NULL;
+	}
 	return stm;
 }
 
+static bool
+muplex_feed_stream(struct muplex *mux, struct stream *stm, const void *data, size_t size, struct stream_define *inf) {
+	(void)mux;
+	return stm->pxface->feed_stream(stm->pxface->parser, stm, data, size, inf);
+}
+
 static void
 muplex_delete_stream(struct muplex *mux, struct stream *stm) {
 	stm->pxface->finish_stream(stm->pxface->parser, stm);
 	mux->free(mux->memctx, stm, __FILE__, __LINE__);
 }
 
+static const struct tagstat *
+muplex_tag_stats(struct muplex *mux) {
+	return mux->default_parser->tag_stats(mux->default_parser->parser);
+}
+
+static bool
+muplex_set_lookahead(struct muplex *mux, size_t nframe) {
+	return mux->default_parser->set_lookahead(mux->default_parser->parser, nframe);
+}
+
+static bool
+muplex_set_cache(struct muplex *mux, const char *dir) {
+	return mux->default_parser->set_cache(mux->default_parser->parser, dir);
+}
+
 static void
 muplex_delete_default(struct muplex *mux) {
 	mux->default_parser->delete_parser(mux->default_parser->parser);
@@ -40,7 +64,11 @@ muplex_create_default(struct memface *mc, struct logface *lc, struct errface *ec
 	struct muplex *mux = mc->alloc(mc->ctx, sizeof(*mux), __FILE__, __LINE__);
 	mux->interface.muplex = mux;
 	mux->interface.create_stream = muplex_create_stream;
+	mux->interface.feed_stream = muplex_feed_stream;
 	mux->interface.delete_stream = muplex_delete_stream;
+	mux->interface.tag_stats = muplex_tag_stats;
+	mux->interface.set_lookahead = muplex_set_lookahead;
+	mux->interface.set_cache = muplex_set_cache;
 	mux->interface.delete_muplex = muplex_delete_default;
 	mux->memctx = mc->ctx;
 	mux->malloc = mc->alloc;
@@ -69,6 +97,16 @@ stream_change_graph(struct stream *stm, struct render *rd, const struct transfor
 	return stm->pxface->change_graph(stm->pxface->parser, stm, rd, tsm, chptr, gh);
 }
 
+void
+stream_bound_graph(struct stream *stm, const struct transform *tsm, uintptr_t chptr, struct rectangle *rt) {
+	stm->pxface->bound_graph(stm->pxface->parser, stm, tsm, chptr, rt);
+}
+
+bool
+stream_opaque_graph(struct stream *stm, struct graph *gh, struct rectangle *rt) {
+	return stm->pxface->opaque_graph(stm->pxface->parser, stm, gh, rt);
+}
+
 void
 stream_render_graph(struct stream *stm, struct render *rd, struct graph *gh) {
 	stm->pxface->render_graph(stm->pxface->parser, stm, rd, gh);
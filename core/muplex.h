@@ -2,7 +2,9 @@
 #define __CORE_MUPLEX_H
 
 #include "common.h"
+#include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 struct memface;
 struct logface;
@@ -11,15 +13,39 @@ struct sprite;
 struct graph;
 struct render;
 struct transform;
+struct rectangle;
 struct stream;
 struct muplex;
 struct sprite_define;
 struct stream_define;
+struct tagstat;
 
 struct muface {
 	struct muplex *muplex;
+	// For StreamData, ud points to SWF data in memory, which must outlive stream.
+	// For StreamFile, ud is path of SWF file, which is mapped read-only.
+	// For StreamFeed, ud is ignored, SWF data is appended by feed_stream,
+	// inf->tagbeg is zero until stream header is fed.
+	// Return NULL if ud can't be loaded.
 	struct stream * (*create_stream)(struct muplex *mux, const void *ud, enum stream_type ut, struct stream_define *inf);
+	// Append data to StreamFeed stream. Frames are playable once all their
+	// tags are fed. inf is filled once stream header is available.
+	// Return false if data can't be loaded.
+	bool (*feed_stream)(struct muplex *mux, struct stream *stm, const void *data, size_t size, struct stream_define *inf);
 	void (*delete_stream)(struct muplex *mux, struct stream *stm);
+	// Per tag statistics, indexed by tag code.
+	const struct tagstat * (*tag_stats)(struct muplex *mux);
+	// Decode shapes of nframe upcoming frames in a worker thread, so that
+	// structing them later picks up decoded outlines. Memface must be
+	// thread safe if nframe is not zero. Zero nframe, the default, stops
+	// worker.
+	// Return false if worker can't be started.
+	bool (*set_lookahead)(struct muplex *mux, size_t nframe);
+	// Save parsed StreamFile streams to directory dir when they are
+	// deleted, and restore them when same files, identified by stamps and
+	// sampled content, are loaded. NULL dir, the default, disables
+	// caching.
+	bool (*set_cache)(struct muplex *mux, const char *dir);
 	void (*delete_muplex)(struct muplex *mux);
 };
 
@@ -29,9 +55,11 @@ uintptr_t stream_progress_frame(struct stream *stm, struct sprite *si, uintptr_t
 
 void stream_struct_sprite(struct stream *stm, uintptr_t chptr, struct sprite_define *inf);
 
-struct graph *stream_struct_shape(struct stream *stm, struct render *rd, const struct transform *tsm, uintptr_t chptr, struct graph *gh);
-struct graph *stream_change_style(struct stream *stm, struct render *rd, const struct transform *tsm, uintptr_t chptr, struct graph *gh);
+struct graph *stream_struct_graph(struct stream *stm, struct render *rd, const struct transform *tsm, uintptr_t chptr, struct graph *gh);
+struct graph *stream_change_graph(struct stream *stm, struct render *rd, const struct transform *tsm, uintptr_t chptr, struct graph *gh);
 
+void stream_bound_graph(struct stream *stm, const struct transform *tsm, uintptr_t chptr, struct rectangle *rt);
+bool stream_opaque_graph(struct stream *stm, struct graph *gh, struct rectangle *rt);
 void stream_render_graph(struct stream *stm, struct render *rd, struct graph *gh);
 void stream_delete_graph(struct stream *stm, struct render *rd, struct graph *gh);
 #endif
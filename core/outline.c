@@ -0,0 +1,190 @@
+#include "outline.h"
+#include <base/compat.h>
+#include <base/helper.h>
+#include <base/matrix.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+static size_t
+bitval_read_stylecount(struct bitval *bv, enum swftag tag) {
+	size_t n = bitval_read_uint8(bv);
+	if (n == 0xFF && tag >= SwftagDefineShape2) {
+		n = bitval_read_uint16(bv);
+	}
+	return n;
+}
+
+// Skip fill and line styles arrays.
+static void
+bitval_skip_styles(struct bitval *bv, enum swftag tag) {
+	size_t ncolor = tag >= SwftagDefineShape3 ? 4 : 3;
+	size_t i, n;
+	n = bitval_read_stylecount(bv, tag);
+	for (i=0; i<n; i++) {
+		uintreg_t type = bitval_read_uint8(bv);
+		switch (type) {
+		case FillStyleSolid:
+			bitval_skip_bytes(bv, ncolor);
+			break;
+		case FillStyleLinearGradient:
+		case FillStyleRadialGradient:
+		case FillStyleFocalRadialGradient:
+			bitval_skip_matrix(bv);
+			bitval_sync(bv);
+			bitval_skip_bytes(bv, (bitval_read_uint8(bv) & 0x0F)*(1+ncolor));
+			if (type == FillStyleFocalRadialGradient) {
+				bitval_skip_bytes(bv, 2);
+			}
+			break;
+		case FillStyleRepeatingBitmap:
+		case FillStyleClippedBitmap:
+		case FillStyleNonSmoothedRepeatingBitmap:
+		case FillStyleNonSmoothedClippedBitmap:
+			bitval_skip_bytes(bv, 2);
+			bitval_skip_matrix(bv);
+			bitval_sync(bv);
+			break;
+		default:
+			assert(!"unsupported fill style");
+			break;
+		}
+	}
+	n = bitval_read_stylecount(bv, tag);
+	bitval_skip_bytes(bv, n*(2+ncolor));
+}
+
+static struct outline_record *
+outline_new_record(struct memface *mc, struct outline *ol, size_t *maxp) {
+	if (ol->nrecord == *maxp) {
+		*maxp = *maxp*2 + 16;
+		ol->records = mc->realloc(mc->ctx, ol->records, sizeof(struct outline_record)*(*maxp), __FILE__, __LINE__);
+	}
+	return &ol->records[ol->nrecord++];
+}
+
+static size_t
+outline_new_palette(struct memface *mc, struct outline *ol, const struct bitval *bv) {
+	ol->palettes = mc->realloc(mc->ctx, ol->palettes, sizeof(struct bitval)*(ol->npalette+1), __FILE__, __LINE__);
+	bitval_copy(&ol->palettes[ol->npalette], bv);
+	return ol->npalette++;
+}
+
+#define READ_NUM_BITS(bv, nfill, nline)		\
+do {						\
+	uintreg_t __n = bitval_read_uint8(bv);	\
+	nline = __n & 0x0F;			\
+	nfill = __n >> 4;			\
+} while (0)
+
+struct outline *
+outline_decode(struct memface *mc, enum swftag tag, const uint8_t *data) {
+	struct outline *ol = mc->alloc(mc->ctx, sizeof(*ol), __FILE__, __LINE__);
+	ol->nrecord = ol->npalette = 0;
+	ol->borrowed = false;
+	ol->records = NULL;
+	ol->palettes = NULL;
+	size_t maxrecord = 0;
+
+	size_t nfillbits, nlinebits;
+	size_t fill0index, fill1index, lineindex;
+	struct point anchor0;
+	anchor0.x = anchor0.y = 0;
+	fill0index = fill1index = lineindex = 0;
+
+	bitval_t bv;
+	bitval_init_read(bv, data, (size_t)-1);
+	bitval_skip_styles(bv, tag);
+	READ_NUM_BITS(bv, nfillbits, nlinebits);
+	for (;;) {
+		uintreg_t flag = bitval_read_ubits(bv, 6);
+		if (flag == 0) {
+			return ol;
+		} else if ((flag & RecordTypeEdge) == 0) {
+			if ((flag & RecordStateMoveTo)) {
+				size_t n = bitval_read_ubits(bv, 5);
+				anchor0.x = bitval_read_sbits(bv, n);
+				anchor0.y = bitval_read_sbits(bv, n);
+			}
+			if ((flag & RecordStateFillStyle0)) {
+				fill0index = bitval_read_ubits(bv, nfillbits);
+			}
+			if ((flag & RecordStateFillStyle1)) {
+				fill1index = bitval_read_ubits(bv, nfillbits);
+			}
+			if ((flag & RecordStateLineStyle)) {
+				lineindex = bitval_read_ubits(bv, nlinebits);
+			}
+			struct outline_record *rc = outline_new_record(mc, ol, &maxrecord);
+			rc->verb = OutlineVerbStyle;
+			rc->u.style.flag = flag;
+			rc->u.style.fill0 = fill0index;
+			rc->u.style.fill1 = fill1index;
+			rc->u.style.line = lineindex;
+			rc->u.style.palette = 0;
+			if ((flag & RecordStateNewStyles)) {
+				// New styles are byte aligned.
+				bitval_sync(bv);
+				rc->u.style.palette = outline_new_palette(mc, ol, bv);
+				bitval_skip_styles(bv, tag);
+				READ_NUM_BITS(bv, nfillbits, nlinebits);
+			}
+			if ((flag & RecordStateMoveTo)) {
+				rc = outline_new_record(mc, ol, &maxrecord);
+				rc->verb = OutlineVerbMove;
+				rc->u.edge.anchor = anchor0;
+			}
+		} else {
+			struct outline_record *rc = outline_new_record(mc, ol, &maxrecord);
+			size_t n = (size_t)((flag & 0x0F) + 2);
+			if ((flag & RecordEdgeLine) == 0) {
+				struct point control;
+				control.x = anchor0.x + bitval_read_sbits(bv, n);
+				control.y = anchor0.y + bitval_read_sbits(bv, n);
+				anchor0.x = control.x + bitval_read_sbits(bv, n);
+				anchor0.y = control.y + bitval_read_sbits(bv, n);
+				rc->verb = OutlineVerbCurve;
+				rc->u.edge.control = control;
+			} else {
+				if (bitval_read_bit(bv)) {
+					anchor0.x += bitval_read_sbits(bv, n);
+					anchor0.y += bitval_read_sbits(bv, n);
+				} else if (bitval_read_bit(bv)) {
+					anchor0.y += bitval_read_sbits(bv, n);
+				} else {
+					anchor0.x += bitval_read_sbits(bv, n);
+				}
+				rc->verb = OutlineVerbLine;
+			}
+			rc->u.edge.anchor = anchor0;
+		}
+	}
+}
+
+struct outline *
+outline_borrow(struct memface *mc, const struct outline_record *records, size_t nrecord, const uint8_t *base, const uint32_t *palettes, size_t npalette) {
+	struct outline *ol = mc->alloc(mc->ctx, sizeof(*ol), __FILE__, __LINE__);
+	ol->nrecord = nrecord;
+	ol->npalette = npalette;
+	ol->borrowed = true;
+	ol->records = (struct outline_record *)records;
+	ol->palettes = NULL;
+	if (npalette != 0) {
+		ol->palettes = mc->alloc(mc->ctx, sizeof(struct bitval)*npalette, __FILE__, __LINE__);
+		for (size_t i=0; i<npalette; i++) {
+			bitval_init_read(&ol->palettes[i], base + palettes[i], (size_t)-1);
+		}
+	}
+	return ol;
+}
+
+void
+outline_delete(struct memface *mc, struct outline *ol) {
+	if (ol->records != NULL && !ol->borrowed) {
+		mc->dealloc(mc->ctx, ol->records, __FILE__, __LINE__);
+	}
+	if (ol->palettes != NULL) {
+		mc->dealloc(mc->ctx, ol->palettes, __FILE__, __LINE__);
+	}
+	mc->dealloc(mc->ctx, ol, __FILE__, __LINE__);
+}
@@ -0,0 +1,87 @@
+#ifndef __CORE_OUTLINE_H
+#define __CORE_OUTLINE_H
+
+#include "swftag.h"
+#include <base/bitval.h>
+#include <base/geometry.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct memface;
+
+enum fill_type {
+	FillStyleSolid,
+	FillStyleLinearGradient			= 0x10,
+	FillStyleRadialGradient			= 0x12,
+	FillStyleFocalRadialGradient		= 0x13,
+	FillStyleRepeatingBitmap		= 0x40,
+	FillStyleClippedBitmap			= 0x41,
+	FillStyleNonSmoothedRepeatingBitmap	= 0x42,
+	FillStyleNonSmoothedClippedBitmap	= 0x43,
+};
+
+#define RecordTypeEdge		0x20
+#define RecordEdgeLine		0x10
+
+#define RecordStateMoveTo	0x01
+#define RecordStateFillStyle0	0x02
+#define RecordStateFillStyle1	0x04
+#define RecordStateLineStyle	0x08
+#define RecordStateNewStyles	0x10
+
+#define RecordStateFillChange	(RecordStateFillStyle0|RecordStateFillStyle1)
+#define RecordStateLineChange	(RecordStateMoveTo|RecordStateLineStyle)
+#define RecordStatePathChange	(RecordStateMoveTo|RecordStateFillChange|RecordStateLineChange)
+
+enum outline_verb {
+	OutlineVerbStyle,
+	OutlineVerbMove,
+	OutlineVerbLine,
+	OutlineVerbCurve,
+};
+
+// Style change record is followed by a move record if it moves pen.
+// Style indices are values in effect after the change, new styles are
+// read from palettes[palette] if flag has RecordStateNewStyles.
+struct outline_record {
+	uintreg_t verb;
+	union {
+		struct {
+			struct point control;
+			struct point anchor;
+		} edge;
+		struct {
+			uintreg_t flag;
+			size_t fill0;
+			size_t fill1;
+			size_t line;
+			size_t palette;
+		} style;
+	} u;
+};
+
+// Shape records of DefineShape decoded in shape space. Styles are left
+// encoded, since colors depend on render and transform.
+struct outline {
+	size_t nrecord;
+	size_t npalette;
+	// Records are not owned by outline if borrowed is true.
+	bool borrowed;
+	struct outline_record *records;
+	// Readers positioned at new styles.
+	struct bitval *palettes;
+};
+
+// data points to styles following shape bounds of DefineShape, DefineShape2
+// or DefineShape3 tag.
+// It uses nothing but mc, so it may run in any thread mc is safe in.
+struct outline *outline_decode(struct memface *mc, enum swftag tag, const uint8_t *data);
+void outline_delete(struct memface *mc, struct outline *ol);
+
+// Outline on records decoded before, which must outlive it. New styles are
+// read from base+palettes[i].
+struct outline *outline_borrow(struct memface *mc, const struct outline_record *records, size_t nrecord, const uint8_t *base, const uint32_t *palettes, size_t npalette);
+
+#endif
@@ -5,22 +5,88 @@
 #include "swftag.h"
 #include "player.h"
 #include "common.h"
+#include "unpack.h"
+#include "outline.h"
+#include "lookahead.h"
+#include "cache.h"
+#include "stroke.h"
 #include <base/helper.h>
 #include <base/bitval.h>
 #include <base/matrix.h>
 #include <base/cxform.h>
+#include <base/mapfile.h>
+#include <base/slab.h>
+#include <base/hash.h>
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <math.h>
 
 struct memory;
+struct stream;
+struct frame_op;
+
+// Tag handlers are called when frame containing tag is compiled, control
+// tags are decoded into op.
+typedef void (*TagFunc_t)(struct stream *stm, enum swftag tag, const uint8_t *pos, size_t len, struct frame_op *op);
+
+struct taghandler {
+	TagFunc_t func;
+	// Number of ops emitted by func, zero or one.
+	uintreg_t nop;
+};
 
 struct parser {
 	struct pxface interface;
+	// Indexed by tag code, tags without handler are skipped.
+	struct taghandler tags[SWFTAG_NCODE];
+	struct tagstat tagstats[SWFTAG_NCODE];
 	struct memory *memctx;
 	MemfaceAllocFunc_t malloc;
 	MemfaceAllocFunc_t zalloc;
 	MemfaceDeallocFunc_t dealloc;
+	struct memface *memface;
+	struct errface *errface;
+	// Shapes in lookahead_nframe frames after compiled frames are decoded
+	// by lookahead if it is not NULL.
+	struct lookahead *lookahead;
+	size_t lookahead_nframe;
+	// Directory of parsed stream caches, NULL if caching is disabled.
+	char *cachedir;
+	// Strokes of style layer being replayed, drawn after its fills.
+	struct strokeuse *strokeuses;
+	size_t nstrokeuse;
+	size_t strokeusecap;
+};
+
+// Strokes of a line style expanded into fill at width, in shape space.
+// They are kept by character, so shapes moved or recolored do not expand
+// their strokes again. A line style keeps its last STROKE_NWIDTH widths,
+// so instances of a shape at a few scales share them.
+#define STROKE_NWIDTH	4
+
+struct stroke {
+	struct stroke *next;
+	size_t palette;
+	size_t line;
+	coord_t width;
+	// NULL if line style draws nothing.
+	struct outline *outline;
+};
+
+// Shape of one convex contour of lines filled by one fill style. Objects
+// under opaque ones are hidden by them.
+struct hull {
+	size_t fill;
+	size_t npoint;
+	struct point points[];
+};
+
+struct strokeuse {
+	const struct stroke *stroke;
+	union color *color;
 };
 
 struct character {
@@ -28,35 +94,47 @@ struct character {
 	uint16_t tag;
 	uintptr_t data;
 	uintptr_t udef;
+	// Decoded shape records, NULL until shape is structed.
+	struct outline *outline;
+	// Expanded strokes of shape.
+	struct stroke *strokes;
+	// Convex polygon filled by shape, NULL if shape is not one, valid
+	// after hulled.
+	struct hull *hull;
+	bool hulled;
+	// udef and outline records are mapped from stream cache.
+	bool cached;
 	struct character *next;
 };
 
-#define DICT_SIZE	128
-#define DICT_MASK	(DICT_SIZE-1)
+// Character ids are 16 bits, the high 8 bits select a page of 256
+// characters, pages are allocated when first character in them defined.
+#define DICT_PAGE_BITS	8
+#define DICT_PAGE_SIZE	(1 << DICT_PAGE_BITS)
+#define DICT_PAGE_MASK	(DICT_PAGE_SIZE-1)
+#define DICT_NPAGE	(0x10000 >> DICT_PAGE_BITS)
+
+// Number of characters per slab chunk.
+#define DICT_SLAB_NITEM	256
 
 struct dictionary {
 	size_t nchar;
-	struct character *chars[DICT_SIZE];
+	struct slab *slab;
+	struct character **pages[DICT_NPAGE];
 };
 
-static void
-dictionary_add_char(struct dictionary *dc, uintreg_t id, struct character *ch) {
-	size_t idx = id & DICT_MASK;
-	ch->next = dc->chars[idx];
-	dc->chars[idx] = ch;
+static inline struct character *
+dictionary_search_char(struct dictionary *dc, uintreg_t id) {
+	assert(id <= 0xFFFF);
+	struct character **page = dc->pages[id >> DICT_PAGE_BITS];
+	return page != NULL ? page[id & DICT_PAGE_MASK] : NULL;
 }
 
 static struct character *
 dictionary_get_char(struct dictionary *dc, uintreg_t id) {
-	struct character *ch = dc->chars[id & DICT_MASK];
-	while (ch != NULL) {
-		if (ch->id == id) {
-			return ch;
-		}
-		ch = ch->next;
-	}
-	assert(!"character non found");
-	return NULL;
+	struct character *ch = dictionary_search_char(dc, id);
+	assert(ch != NULL || !"character non found");
+	return ch;
 }
 
 static enum character_type
@@ -74,21 +152,13 @@ tag2type(intreg_t tag) {
 	}
 }
 
-// For shape, return struct character;
-// For sprite, return underlying data.
+// Return struct character, which carries underlying data and structures
+// built at definition.
 static uintptr_t
 dictionary_get_mark(struct dictionary *dc, uintreg_t id, uintreg_t *type) {
 	struct character *ch = dictionary_get_char(dc, id);
 	*type = tag2type(ch->tag);
-	uintptr_t mark;
-	switch (*type) {
-	case CharacterShape:
-		mark = (uintptr_t)ch;
-		break;
-	case CharacterSprite:
-		mark = (uintptr_t)ch->data;
-	}
-	return mark;
+	return (uintptr_t)ch;
 }
 
 static inline void *
@@ -106,14 +176,89 @@ parser_dealloc(struct parser *px, void *ptr, const void *file, int line) {
 	px->dealloc(px->memctx, ptr, file, line);
 }
 
+static void
+parser_error(struct parser *px, const char *fmt, ...) {
+	struct errface *ec = px->errface;
+	if (ec != NULL && ec->err != NULL) {
+		char buf[256];
+		va_list args;
+		va_start(args, fmt);
+		vsnprintf(buf, sizeof(buf), fmt, args);
+		va_end(args);
+		ec->err(ec->ctx, "%s", buf);
+	}
+}
+
+// Redefined character shadows the old one, which is chained by next,
+// since it may still be referenced by objects.
 static struct character *
-parser_malloc_character(struct parser *px) {
-	return parser_malloc(px, sizeof(struct character), __FILE__, __LINE__);
+parser_define_character(struct parser *px, struct dictionary *dc, uintreg_t id) {
+	assert(id <= 0xFFFF);
+	struct character ***pagep = &dc->pages[id >> DICT_PAGE_BITS];
+	if (*pagep == NULL) {
+		*pagep = parser_zalloc(px, sizeof(struct character *)*DICT_PAGE_SIZE, __FILE__, __LINE__);
+	}
+	struct character **chp = &(*pagep)[id & DICT_PAGE_MASK];
+	struct character *ch = slab_alloc(dc->slab);
+	ch->id = (uint16_t)id;
+	ch->outline = NULL;
+	ch->strokes = NULL;
+	ch->hull = NULL;
+	ch->hulled = false;
+	ch->cached = false;
+	ch->next = *chp;
+	*chp = ch;
+	dc->nchar++;
+	return ch;
+}
+
+// Index of first cached character whose data is not below off, hint is
+// tried before searching.
+static size_t
+parser_search_cached(const struct cache_header *ch, uint32_t off, size_t hint) {
+	const struct cache_character *chars = cache_section(ch, ch->chars);
+	if (hint <= ch->nchar && (hint == 0 || chars[hint-1].data < off) && (hint == ch->nchar || chars[hint].data >= off)) {
+		return hint;
+	}
+	size_t lo = 0, hi = ch->nchar;
+	while (lo < hi) {
+		size_t mid = lo + (hi-lo)/2;
+		if (chars[mid].data < off) {
+			lo = mid+1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+// Cached characters are ordered by data. Character is restored when its
+// definition tag is executed, so redefined ids follow tag order. Cached
+// character must match tag and size of udef built from tag.
+static const struct cache_character *
+parser_cached_character(const struct stream *stm, uintreg_t id, uintreg_t tag, uintptr_t data, size_t nudef) {
+	const struct cache_header *ch = stm->cache;
+	if (ch == NULL) {
+		return NULL;
+	}
+	const struct cache_character *chars = cache_section(ch, ch->chars);
+	uint32_t off = (uint32_t)(data - stm->resource);
+	size_t i = parser_search_cached(ch, off, stm->cachechar);
+	if (i == ch->nchar || chars[i].data != off || chars[i].id != id || chars[i].tag != tag || chars[i].nudef != nudef) {
+		return NULL;
+	}
+	return &chars[i];
 }
 
 static void
-parser_dealloc_character(struct parser *px, struct character *ch) {
-	parser_dealloc(px, ch, __FILE__, __LINE__);
+parser_restore_character(struct parser *px, struct stream *stm, struct character *c, const struct cache_character *cc) {
+	const struct cache_header *ch = stm->cache;
+	c->udef = (uintptr_t)cache_section(ch, cc->udef);
+	c->cached = true;
+	if (cc->outline != 0) {
+		c->outline = outline_borrow(px->memface, cache_section(ch, cc->outline), cc->nrecord,
+			(const uint8_t *)stm->resource, cache_section(ch, cc->palettes), cc->npalette);
+	}
 }
 
 static struct rectangle *
@@ -126,124 +271,269 @@ parser_dealloc_rectangle(struct parser *px, struct rectangle *rt) {
 	parser_dealloc(px, rt, __FILE__, __LINE__);
 }
 
+static void
+parser_delete_strokes(struct parser *px, struct stroke *sk) {
+	while (sk != NULL) {
+		struct stroke *ne = sk->next;
+		if (sk->outline != NULL) {
+			outline_delete(px->memface, sk->outline);
+		}
+		parser_dealloc(px, sk, __FILE__, __LINE__);
+		sk = ne;
+	}
+}
+
 static struct dictionary *
 parser_create_dictionary(struct parser *px) {
-	return parser_zalloc(px, sizeof(struct dictionary), __FILE__, __LINE__);
+	struct dictionary *dc = parser_zalloc(px, sizeof(struct dictionary), __FILE__, __LINE__);
+	dc->slab = slab_create(px->memface, DICT_SLAB_NITEM, sizeof(struct character));
+	return dc;
 }
 
 static void
 parser_delete_dictionary(struct parser *px, struct dictionary *dc) {
-	// XXX Dealloc udef in here ?
-	size_t i, n, nchar;
-	nchar = dc->nchar;
-	for (i=0, n=DICT_SIZE; i<n; i++) {
-		struct character *ch = dc->chars[i];
+	size_t nchar = dc->nchar;
+	for (size_t i=0; i<DICT_NPAGE*DICT_PAGE_SIZE; i++) {
+		struct character **page = dc->pages[i >> DICT_PAGE_BITS];
+		if (page == NULL) {
+			i |= DICT_PAGE_MASK;
+			continue;
+		}
+		struct character *ch = page[i & DICT_PAGE_MASK];
 		while (ch != NULL) {
 			struct character *ne = ch->next;
 			switch (ch->tag) {
 			case SwftagDefineShape:
 			case SwftagDefineShape2:
 			case SwftagDefineShape3:
-				parser_dealloc_rectangle(px, (void *)ch->udef);
+				if (!ch->cached) {
+					parser_dealloc_rectangle(px, (void *)ch->udef);
+				}
+				if (ch->outline != NULL) {
+					outline_delete(px->memface, ch->outline);
+				}
+				parser_delete_strokes(px, ch->strokes);
+				if (ch->hull != NULL) {
+					parser_dealloc(px, ch->hull, __FILE__, __LINE__);
+				}
+				break;
+			case SwftagDefineSprite:
+				if (!ch->cached) {
+					parser_dealloc(px, (void *)ch->udef, __FILE__, __LINE__);
+				}
 				break;
 			default:
 				break;
 			}
-			parser_dealloc_character(px, ch);
 			nchar--;
 			ch = ne;
 		}
 	}
 	assert(nchar == 0);
+	for (size_t i=0; i<DICT_NPAGE; i++) {
+		if (dc->pages[i] != NULL) {
+			parser_dealloc(px, dc->pages[i], __FILE__, __LINE__);
+		}
+	}
+	slab_delete(dc->slab);
 	parser_dealloc(px, dc, __FILE__, __LINE__);
 }
 
+enum frame_opcode {
+	FrameOpPlace,
+	FrameOpRemove,
+};
+
+// Decoded control tag, FrameOpRemove removes object at place.chardepth.
+struct frame_op {
+	uintreg_t code;
+	struct place_info place;
+};
+
 static void
-DefineShape(struct stream *stm, enum swftag tag, const uint8_t *pos, size_t len) {
+DefineShape(struct stream *stm, enum swftag tag, const uint8_t *pos, size_t len, struct frame_op *op) {
+	(void)op;
 	bitval_t bv;
 	bitval_init_read(bv, (byte_t*)pos, len);
 	uintreg_t id = bitval_read_uint16(bv);
-	struct character *ch = parser_malloc_character(stm->pxface->parser);
-	struct rectangle *rt = parser_malloc_rectangle(stm->pxface->parser, 1);
-	bitval_read_rectangle(bv, rt);
+	struct rectangle bounds;
+	bitval_read_rectangle(bv, &bounds);
 	bitval_sync(bv);
-	dictionary_add_char(stm->dictionary, id, ch);
-	ch->id = id;
+	uintptr_t data = (uintptr_t)bitval_read_cursor(bv);
+	struct character *ch = parser_define_character(stm->pxface->parser, stm->dictionary, id);
 	ch->tag = tag;
-	ch->data = (uintptr_t)bitval_read_cursor(bv);
+	ch->data = data;
+	const struct cache_character *cc = parser_cached_character(stm, id, tag, data, sizeof(struct rectangle));
+	if (cc != NULL && cache_check_records(stm->cache, cc)) {
+		parser_restore_character(stm->pxface->parser, stm, ch, cc);
+		return;
+	}
+	struct rectangle *rt = parser_malloc_rectangle(stm->pxface->parser, 1);
+	*rt = bounds;
 	ch->udef = (uintptr_t)rt;
 }
 
+// Control tags are decoded into place_info, and executed by
+// parser_progress_frame().
+
 static void
-PlaceObject(struct sprite *si, struct stream *stm, const uint8_t *pos, size_t len) {
-	struct place_info pi;
-	pi.flag = 0;
-	pi.character = dictionary_get_mark(stm->dictionary, read_uint16((byte_t*)pos), &pi.type);
-	pi.chardepth = read_uint16((byte_t*)(pos+2));
-	pi.clipdepth = 0;
-	pi.stepratio = 0;
+PlaceObject(struct stream *stm, enum swftag tag, const uint8_t *pos, size_t len, struct frame_op *op) {
+	(void)tag;
+	struct place_info *pi = &op->place;
+	op->code = FrameOpPlace;
+	pi->flag = 0;
+	pi->character = dictionary_get_mark(stm->dictionary, read_uint16((byte_t*)pos), &pi->type);
+	pi->chardepth = read_uint16((byte_t*)(pos+2));
+	pi->clipdepth = 0;
+	pi->stepratio = 0;
+	pi->moviename.str = NULL;
+	pi->moviename.len = 0;
+	pi->bitmapcache = 0;
 
 	bitval_t bv;
 	bitval_init_read(bv, (byte_t*)(pos+4), len-4);
-	bitval_read_matrix(bv, &pi.transform.matrix);
+	matrix_identify(&pi->transform.matrix);
+	bitval_read_matrix(bv, &pi->transform.matrix);
 	bitval_sync(bv);
-	cxform_identify(&pi.transform.cxform);
+	cxform_identify(&pi->transform.cxform);
 	if (bitval_remain_bytes(bv) > 0) {
-		bitval_read_cxform_without_alpha(bv, &pi.transform.cxform);
+		bitval_read_cxform_without_alpha(bv, &pi->transform.cxform);
 	}
-	sprite_place_object(si, &pi);
 }
 
+// Fields of PlaceObject2 and PlaceObject3 from character id to clip depth.
 static void
-PlaceObject2(struct sprite *si, struct stream *stm, const uint8_t *pos, size_t len) {
-	bitval_t bv;
-	bitval_init_read(bv, (byte_t*)pos, len);
-
-	struct place_info pi;
-	uintreg_t flag = pi.flag = bitval_read_uint8(bv);
-	pi.chardepth = bitval_read_uint16(bv);
-
+bitval_read_place(struct bitval *bv, struct stream *stm, struct place_info *pi) {
+	uintreg_t flag = pi->flag;
+	pi->type = 0;
+	pi->character = 0;
 	if ((flag & PlaceFlagHasCharacter) != 0) {
 		uintreg_t id = bitval_read_uint16(bv);
-		pi.character = dictionary_get_mark(stm->dictionary, id, &pi.type);
+		pi->character = dictionary_get_mark(stm->dictionary, id, &pi->type);
 	}
 
-	matrix_identify(&pi.transform.matrix);
+	matrix_identify(&pi->transform.matrix);
 	if ((flag & PlaceFlagHasMatrix) != 0) {
-		bitval_read_matrix(bv, &pi.transform.matrix);
+		bitval_read_matrix(bv, &pi->transform.matrix);
 		bitval_sync(bv);
 	}
 
-	cxform_identify(&pi.transform.cxform);
+	cxform_identify(&pi->transform.cxform);
 	if ((flag & PlaceFlagHasCxform) != 0) {
-		bitval_read_cxform(bv, &pi.transform.cxform);
+		bitval_read_cxform(bv, &pi->transform.cxform);
 		bitval_sync(bv);
 	}
 
-	pi.stepratio = 0;
+	pi->stepratio = 0;
 	if ((flag & PlaceFlagHasRatio) != 0) {
-		pi.stepratio = bitval_read_uint16(bv);
+		pi->stepratio = bitval_read_uint16(bv);
 	}
 
-	pi.moviename.str = NULL;
-	pi.moviename.len = 0;
+	pi->moviename.str = NULL;
+	pi->moviename.len = 0;
 	if ((flag & PlaceFlagHasName) != 0) {
-		pi.moviename.str = bitval_read_string(bv, &pi.moviename.len);
+		pi->moviename.str = bitval_read_string(bv, &pi->moviename.len);
+	}
+
+	pi->clipdepth = 0;
+	if ((flag & PlaceFlagHasClipDepth) != 0) {
+		pi->clipdepth = bitval_read_uint16(bv);
 	}
+	pi->bitmapcache = 0;
+}
+
+static void
+PlaceObject2(struct stream *stm, enum swftag tag, const uint8_t *pos, size_t len, struct frame_op *op) {
+	(void)tag;
+	struct place_info *pi = &op->place;
+	op->code = FrameOpPlace;
+	bitval_t bv;
+	bitval_init_read(bv, (byte_t*)pos, len);
+
+	pi->flag = bitval_read_uint8(bv);
+	pi->chardepth = bitval_read_uint16(bv);
+	bitval_read_place(bv, stm, pi);
+}
+
+// Filters are not drawn yet, they are skipped to reach fields after them.
+static void
+bitval_skip_filters(struct bitval *bv) {
+	uintreg_t n = bitval_read_uint8(bv);
+	for (uintreg_t i=0; i<n; i++) {
+		switch (bitval_read_uint8(bv)) {
+		case 0:	// DropShadow
+			bitval_skip_bytes(bv, 23);
+			break;
+		case 1:	// Blur
+			bitval_skip_bytes(bv, 9);
+			break;
+		case 2:	// Glow
+			bitval_skip_bytes(bv, 15);
+			break;
+		case 3:	// Bevel
+			bitval_skip_bytes(bv, 27);
+			break;
+		case 4:	// GradientGlow
+		case 7:	// GradientBevel
+			bitval_skip_bytes(bv, 5*bitval_read_uint8(bv) + 19);
+			break;
+		case 5: {	// Convolution
+			uintreg_t x = bitval_read_uint8(bv);
+			uintreg_t y = bitval_read_uint8(bv);
+			bitval_skip_bytes(bv, 8 + 4*x*y + 5);
+		} break;
+		case 6:	// ColorMatrix
+			bitval_skip_bytes(bv, 80);
+			break;
+		default:
+			assert(!"unknown filter");
+			return;
+		}
+	}
+}
 
-	sprite_place_object(si, &pi);
+static void
+PlaceObject3(struct stream *stm, enum swftag tag, const uint8_t *pos, size_t len, struct frame_op *op) {
+	(void)tag;
+	struct place_info *pi = &op->place;
+	op->code = FrameOpPlace;
+	bitval_t bv;
+	bitval_init_read(bv, (byte_t*)pos, len);
+
+	uintreg_t flag = bitval_read_uint8(bv);
+	flag |= bitval_read_uint8(bv) << 8;
+	pi->chardepth = bitval_read_uint16(bv);
+	if ((flag & PlaceFlagHasClassName) != 0 || ((flag & PlaceFlagHasImage) != 0 && (flag & PlaceFlagHasCharacter) != 0)) {
+		bitval_skip_string(bv);
+	}
+	pi->flag = flag;
+	bitval_read_place(bv, stm, pi);
+	if ((flag & PlaceFlagHasFilterList) != 0) {
+		bitval_skip_filters(bv);
+	}
+	if ((flag & PlaceFlagHasBlendMode) != 0) {
+		bitval_skip_bytes(bv, 1);
+	}
+	if ((flag & PlaceFlagHasCacheAsBit) != 0) {
+		// Some writers set flag without value.
+		pi->bitmapcache = bitval_remain_bytes(bv) > 0 ? bitval_read_uint8(bv) : 1;
+	}
 }
 
 static void
-RemoveObject2(struct sprite *si, const uint8_t *pos, size_t len) {
+RemoveObject2(struct stream *stm, enum swftag tag, const uint8_t *pos, size_t len, struct frame_op *op) {
 	assert(len == 2);
-	sprite_remove_object(si, read_uint16((byte_t*)pos));
+	(void)stm; (void)tag; (void)len;
+	op->code = FrameOpRemove;
+	op->place.chardepth = read_uint16((byte_t*)pos);
 }
 
 static void
-RemoveObject(struct sprite *si, const uint8_t *pos, size_t len) {
+RemoveObject(struct stream *stm, enum swftag tag, const uint8_t *pos, size_t len, struct frame_op *op) {
 	assert(len == 4);
-	sprite_remove_object(si, read_uint16((byte_t*)(pos+2)));
+	(void)stm; (void)tag; (void)len;
+	op->code = FrameOpRemove;
+	op->place.chardepth = read_uint16((byte_t*)(pos+2));
 }
 
 static enum swftag
@@ -258,87 +548,1118 @@ bitval_read_swftag(struct bitval *bv, size_t *lenp) {
 	return (enum swftag)(u16 >> 6);
 }
 
-static uintptr_t
-parser_progress_frame(struct parser *px, struct stream *stm, struct sprite *si, uintptr_t tagpos) {
-	(void)px;
-	bitval_t bv;
-	bitval_init_read(bv, (byte_t*)tagpos, (size_t)-1);
+// Window of mapped file advised to be read ahead of playing frame.
+#define READAHEAD_SIZE	(64*1024)
+
+static void
+parser_readahead_stream(struct stream *stm, uintptr_t tagpos) {
+	if (tagpos + READAHEAD_SIZE/2 < stm->readahead) {
+		return;
+	}
+	uintptr_t beg = tagpos > stm->readahead ? tagpos : stm->readahead;
+	mapfile_advise((void *)stm->resource, stm->ressize, beg - stm->resource, READAHEAD_SIZE, MapfileAdviceWillneed);
+	stm->readahead = beg + READAHEAD_SIZE;
+}
+
+// Size of "ZWS" fields following 8 bytes header: length of compressed data
+// and lzma properties.
+#define LZMA_HEADER_SIZE	(4+5)
+
+// Decompressing state of compressed stream. Whole uncompressed movie is
+// allocated at creation and filled chunk by chunk when frames are needed,
+// so characters and timelines never move.
+//
+// StreamFeed streams also use it to receive appended bytes, unpack is NULL
+// for uncompressed feeding.
+struct inflow {
+	struct unpack *unpack;
+	const byte_t *input;
+	size_t inlen;
+	// Mapped compressed file, released after decompression.
+	const void *mapping;
+	size_t mapsize;
+	// Input is appended by parser_feed_stream(), running out of input
+	// is not end of stream.
+	bool feeding;
+	// Headers received before resource allocated.
+	size_t nhead;
+	byte_t head[8+LZMA_HEADER_SIZE];
+};
+
+#define INFLATE_CHUNK	(64*1024)
+
+// Signature, version, length, maximum rectangle, rate and frame count.
+#define HEADER_MAXSIZE	(8+17+4)
+
+// Return size of whole tag at pos, or zero if it is not complete before end.
+static size_t
+parser_measure_tag(const byte_t *pos, const byte_t *end, enum swftag *tag) {
+	if (end - pos < 2) {
+		return 0;
+	}
+	uintreg_t u16 = read_uint16(pos);
+	size_t hdr = 2;
+	size_t len = (size_t)(u16 & 0x3F);
+	if (len == 0x3F) {
+		if (end - pos < 6) {
+			return 0;
+		}
+		len = (size_t)read_uint32(pos+2);
+		hdr = 6;
+	}
+	if ((size_t)(end - pos) - hdr < len) {
+		return 0;
+	}
+	*tag = (enum swftag)(u16 >> 6);
+	return hdr + len;
+}
+
+// Count frames of main timeline whose tags are all available, and index
+// their positions.
+static void
+parser_scan_frames(struct stream *stm) {
+	struct loading *ld = &stm->loading;
+	const byte_t *pos = (byte_t *)ld->scanpos;
+	const byte_t *end = (byte_t *)stm->resource + ld->nbyte;
 	for (;;) {
-		size_t len;
-		enum swftag tag = bitval_read_swftag(bv, &len);
-		void *pos = (void *)bitval_read_cursor(bv);
+		enum swftag tag;
+		size_t n = parser_measure_tag(pos, end, &tag);
+		if (n == 0) {
+			break;
+		}
+		pos += n;
+		if (tag == SwftagShowFrame) {
+			ld->nframe++;
+			ld->frameend = (uintptr_t)pos;
+			if (ld->nframe < ld->maxframe) {
+				ld->frames[ld->nframe] = (uint32_t)((uintptr_t)pos - ld->tagbeg);
+			}
+		} else if (tag == SwftagEnd) {
+			ld->frameend = (uintptr_t)pos;
+			break;
+		}
+	}
+	ld->scanpos = (uintptr_t)pos;
+}
+
+// Index frames of sprite whose tags are in [pos, end).
+// Frames beyond nframe are ignored, missing frames start at end.
+static uint32_t *
+parser_index_sprite(struct parser *px, const byte_t *pos, const byte_t *end, size_t nframe) {
+	uint32_t *frames = parser_malloc(px, sizeof(uint32_t)*(nframe+1), __FILE__, __LINE__);
+	const byte_t *beg = pos;
+	size_t i = 0;
+	frames[0] = 0;
+	while (i < nframe) {
+		enum swftag tag;
+		size_t n = parser_measure_tag(pos, end, &tag);
+		if (n == 0 || tag == SwftagEnd) {
+			break;
+		}
+		pos += n;
+		if (tag == SwftagShowFrame) {
+			frames[++i] = (uint32_t)(pos - beg);
+		}
+	}
+	while (i < nframe) {
+		frames[++i] = (uint32_t)(end - beg);
+	}
+	return frames;
+}
+
+// Cached frame index must stay in sprite's tags of nbyte bytes.
+static bool
+parser_check_sprite(const uint32_t *frames, size_t nframe, size_t nbyte) {
+	for (size_t i=0; i<nframe; i++) {
+		if (frames[i] > frames[i+1]) {
+			return false;
+		}
+	}
+	return frames[0] == 0 && frames[nframe] <= nbyte;
+}
+
+// Sprite's frames are indexed at definition, ch->data points to frame count
+// followed by sprite's tags.
+static void
+DefineSprite(struct stream *stm, enum swftag tag, const uint8_t *pos, size_t len, struct frame_op *op) {
+	(void)tag; (void)op;
+	struct parser *px = stm->pxface->parser;
+	uintreg_t id = read_uint16((byte_t*)pos);
+	size_t nframe = (size_t)read_uint16((byte_t*)(pos+2));
+	struct character *ch = parser_define_character(px, stm->dictionary, id);
+	ch->tag = SwftagDefineSprite;
+	ch->data = (uintptr_t)(pos+2);
+	const struct cache_character *cc = parser_cached_character(stm, id, SwftagDefineSprite, ch->data, sizeof(uint32_t)*(nframe+1));
+	if (cc != NULL && parser_check_sprite(cache_section(stm->cache, cc->udef), nframe, len-4)) {
+		parser_restore_character(px, stm, ch, cc);
+		return;
+	}
+	ch->udef = (uintptr_t)parser_index_sprite(px, pos+4, pos+len, nframe);
+}
+
+static void
+parser_finish_inflow(struct inflow *fw) {
+	if (fw->unpack != NULL) {
+		unpack_delete(fw->unpack);
+		fw->unpack = NULL;
+	}
+	if (fw->mapping != NULL) {
+		mapfile_close(fw->mapping, fw->mapsize);
+		fw->mapping = NULL;
+	}
+}
+
+// Decompress next chunk of stream.
+// Return false if no more data can be decompressed.
+static bool
+parser_inflate_stream(struct parser *px, struct stream *stm) {
+	struct loading *ld = &stm->loading;
+	struct inflow *fw = ld->inflow;
+	if (fw == NULL || fw->unpack == NULL) {
+		return false;
+	}
+	uint8_t *out = (uint8_t *)stm->resource + ld->nbyte;
+	size_t want = stm->ressize - ld->nbyte;
+	if (want > INFLATE_CHUNK) {
+		want = INFLATE_CHUNK;
+	}
+	size_t outlen = want;
+	enum unpack_status status = unpack_run(fw->unpack, &fw->input, &fw->inlen, &out, &outlen);
+	ld->nbyte += want - outlen;
+	if (status == UnpackStatusError) {
+		parser_error(px, "[%s()] corrupted compressed stream.\n", __func__);
+	}
+	if (status != UnpackStatusMore || ld->nbyte == stm->ressize || (outlen == want && !fw->feeding)) {
+		parser_finish_inflow(fw);
+	}
+	// Scanning starts after header parsed.
+	if (ld->scanpos != 0) {
+		parser_scan_frames(stm);
+	}
+	return outlen != want;
+}
+
+// Ensure frame starting at tagpos is available.
+static inline bool
+parser_require_frame(struct parser *px, struct stream *stm, uintptr_t tagpos) {
+	while (tagpos >= stm->loading.frameend) {
+		if (!parser_inflate_stream(px, stm)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Control tags of a frame, compiled when the frame is played first time.
+// Definition tags are executed while compiling only, replaying a frame
+// executes its ops without touching tags.
+struct frame_code {
+	struct frame_code *next;
+	uintptr_t tagpos;
+	uintptr_t endpos;
+	size_t nop;
+	struct frame_op ops[];
+};
+
+// Compiled frames of all timelines in stream, hashed by frame position.
+struct codebook {
+	size_t ncode;
+	size_t nslot;
+	struct frame_code **slots;
+};
+
+#define CODEBOOK_SIZE	64
+
+static inline size_t
+codebook_hash(uintptr_t tagpos, size_t nslot) {
+	return (size_t)((tagpos * (uintptr_t)2654435761u) >> 4) & (nslot-1);
+}
+
+static struct codebook *
+parser_create_codebook(struct parser *px) {
+	struct codebook *cb = parser_malloc(px, sizeof(*cb), __FILE__, __LINE__);
+	cb->ncode = 0;
+	cb->nslot = CODEBOOK_SIZE;
+	cb->slots = parser_zalloc(px, sizeof(struct frame_code *)*cb->nslot, __FILE__, __LINE__);
+	return cb;
+}
+
+static void
+parser_delete_codebook(struct parser *px, struct codebook *cb) {
+	for (size_t i=0; i<cb->nslot; i++) {
+		struct frame_code *fc = cb->slots[i];
+		while (fc != NULL) {
+			struct frame_code *next = fc->next;
+			parser_dealloc(px, fc, __FILE__, __LINE__);
+			fc = next;
+		}
+	}
+	parser_dealloc(px, cb->slots, __FILE__, __LINE__);
+	parser_dealloc(px, cb, __FILE__, __LINE__);
+}
+
+static inline struct frame_code *
+codebook_search(const struct codebook *cb, uintptr_t tagpos) {
+	struct frame_code *fc = cb->slots[codebook_hash(tagpos, cb->nslot)];
+	while (fc != NULL && fc->tagpos != tagpos) {
+		fc = fc->next;
+	}
+	return fc;
+}
+
+static void
+parser_insert_code(struct parser *px, struct codebook *cb, struct frame_code *fc) {
+	if (cb->ncode >= cb->nslot) {
+		size_t nslot = cb->nslot*2;
+		struct frame_code **slots = parser_zalloc(px, sizeof(struct frame_code *)*nslot, __FILE__, __LINE__);
+		for (size_t i=0; i<cb->nslot; i++) {
+			struct frame_code *it = cb->slots[i];
+			while (it != NULL) {
+				struct frame_code *next = it->next;
+				size_t h = codebook_hash(it->tagpos, nslot);
+				it->next = slots[h];
+				slots[h] = it;
+				it = next;
+			}
+		}
+		parser_dealloc(px, cb->slots, __FILE__, __LINE__);
+		cb->slots = slots;
+		cb->nslot = nslot;
+	}
+	size_t h = codebook_hash(fc->tagpos, cb->nslot);
+	fc->next = cb->slots[h];
+	cb->slots[h] = fc;
+	cb->ncode++;
+}
+
+// Queue shapes defined in frames following pos for decoding by lookahead.
+// Only loaded tags are scanned.
+static void
+parser_scout_frames(struct parser *px, struct stream *stm, uintptr_t pos) {
+	const byte_t *ptr = (const byte_t *)pos;
+	const byte_t *end = (const byte_t *)stm->resource + stm->loading.nbyte;
+	size_t nframe = px->lookahead_nframe;
+	while (nframe != 0) {
+		enum swftag tag;
+		size_t n = parser_measure_tag(ptr, end, &tag);
+		if (n == 0 || tag == SwftagEnd) {
+			break;
+		}
 		switch (tag) {
-		case SwftagEnd:
 		case SwftagShowFrame:
-			return (uintptr_t)pos;
+			nframe--;
+			break;
 		case SwftagDefineShape:
 		case SwftagDefineShape2:
 		case SwftagDefineShape3:
-			DefineShape(stm, tag, pos, len);
+			if (px->tags[tag].func != NULL) {
+				size_t hdr = (read_uint16(ptr) & 0x3F) == 0x3F ? 6 : 2;
+				struct rectangle rt;
+				bitval_t bv;
+				bitval_init_read(bv, ptr+hdr+2, n-hdr-2);
+				bitval_read_rectangle(bv, &rt);
+				bitval_sync(bv);
+				// Cached outlines are borrowed at definition.
+				const struct cache_character *cc = parser_cached_character(stm, read_uint16(ptr+hdr), tag, (uintptr_t)bitval_read_cursor(bv), sizeof(struct rectangle));
+				if (cc == NULL || cc->outline == 0) {
+					lookahead_queue(px->lookahead, stm, tag, bitval_read_cursor(bv));
+				}
+			}
 			break;
-		case SwftagPlaceObject:
-			PlaceObject(si, stm, pos, len);
+		default:
 			break;
-		case SwftagPlaceObject2:
-			PlaceObject2(si, stm, pos, len);
+		}
+		ptr += n;
+	}
+}
+
+// End tag holds timeline, there is nothing after it. Frame ended by End
+// tag moves to it, so that its ops are applied once and the empty frame
+// starting at End tag holds. Tags are read up to available bytes only, a
+// tag running past them ends frame as End tag does.
+static struct frame_code *
+parser_compile_frame(struct parser *px, struct stream *stm, uintptr_t tagpos) {
+	const byte_t *end = (const byte_t *)stm->resource + stm->loading.nbyte;
+	const byte_t *pos = (const byte_t *)tagpos;
+	size_t nop = 0;
+	bool shown = false;
+	for (;;) {
+		enum swftag tag;
+		size_t n = parser_measure_tag(pos, end, &tag);
+		if (n == 0 || tag == SwftagEnd) {
 			break;
-		case SwftagRemoveObject:
-			RemoveObject(si, pos, len);
+		}
+		pos += n;
+		if (tag == SwftagShowFrame) {
+			shown = true;
 			break;
-		case SwftagRemoveObject2:
-			RemoveObject2(si, pos, len);
+		}
+		nop += px->tags[tag].nop;
+	}
+
+	struct frame_code *fc = parser_malloc(px, sizeof(*fc) + sizeof(struct frame_op)*nop, __FILE__, __LINE__);
+	fc->tagpos = tagpos;
+	fc->endpos = (uintptr_t)pos;
+	fc->nop = nop;
+	struct frame_op *op = fc->ops;
+	if (pos != (const byte_t *)tagpos) {
+		bitval_t bv;
+		bitval_init_read(bv, (byte_t*)tagpos, (size_t)(pos - (const byte_t *)tagpos));
+		while (bitval_remain_bytes(bv) != 0) {
+			size_t len;
+			enum swftag tag = bitval_read_swftag(bv, &len);
+			const uint8_t *body = bitval_read_cursor(bv);
+			struct tagstat *ts = &px->tagstats[tag];
+			ts->count++;
+			ts->bytes += len;
+			const struct taghandler *th = &px->tags[tag];
+			if (th->func != NULL) {
+				th->func(stm, tag, body, len, op);
+				op += th->nop;
+			}
+			bitval_skip_bytes(bv, len);
+		}
+	}
+	assert(op == fc->ops + nop);
+	parser_insert_code(px, stm->codebook, fc);
+	if (px->lookahead != NULL && shown) {
+		parser_scout_frames(px, stm, fc->endpos);
+	}
+	return fc;
+}
+
+// Character of id defined at data offset off, NULL if it is not defined
+// yet. Redefined ids are chained, their definitions tell them apart.
+static struct character *
+parser_defined_character(struct stream *stm, uintreg_t id, uint32_t off) {
+	struct character *c = dictionary_search_char(stm->dictionary, id);
+	while (c != NULL && c->data != stm->resource + off) {
+		c = c->next;
+	}
+	return c;
+}
+
+// Index of cached character defined at off, in frame or earlier, nchar if
+// there is none. Characters defined in frame are few, they are scanned.
+static size_t
+parser_find_cached(const struct cache_header *ch, size_t defbeg, size_t defend, uint32_t off) {
+	const struct cache_character *chars = cache_section(ch, ch->chars);
+	size_t i = defbeg;
+	if (defbeg == defend || off < chars[defbeg].data) {
+		i = parser_search_cached(ch, off, 0);
+	}
+	while (i < defend && chars[i].data < off) {
+		i++;
+	}
+	return i < ch->nchar && chars[i].data == off ? i : ch->nchar;
+}
+
+// Characters defined in frame are cached ones whose data lie in it, they
+// must be restorable as their definition tags would restore them.
+static bool
+parser_check_definitions(const struct stream *stm, const struct cache_code *cd, size_t defbeg, size_t defend) {
+	const struct cache_header *ch = stm->cache;
+	const struct cache_character *cc = cache_section(ch, ch->chars);
+	for (size_t i=defbeg; i<defend; i++) {
+		switch (cc[i].tag) {
+		case SwftagDefineShape:
+		case SwftagDefineShape2:
+		case SwftagDefineShape3:
+			if (cc[i].nudef != sizeof(struct rectangle) || !cache_check_records(ch, &cc[i])) {
+				return false;
+			}
 			break;
+		case SwftagDefineSprite: {
+			size_t nframe = (size_t)read_uint16((byte_t *)stm->resource + cc[i].data);
+			if (cc[i].data + 2 > cd->endpos || cc[i].nudef != sizeof(uint32_t)*(nframe+1) ||
+			    !parser_check_sprite(cache_section(ch, cc[i].udef), nframe, cd->endpos - cc[i].data - 2)) {
+				return false;
+			}
+		} break;
 		default:
-			assert(!"unsupported tag format");
+			return false;
+		}
+	}
+	return true;
+}
+
+// Ops refer characters by data offsets of their definitions, which are
+// in frame or defined before, and movie names by offsets in stream.
+static bool
+parser_check_ops(struct stream *stm, const struct cache_code *cd, const struct frame_op *ops, size_t defbeg, size_t defend) {
+	const struct cache_header *ch = stm->cache;
+	const struct cache_character *chars = cache_section(ch, ch->chars);
+	for (size_t i=0; i<cd->nop; i++) {
+		const struct place_info *pi = &ops[i].place;
+		if (ops[i].code == FrameOpRemove) {
+			continue;
+		}
+		if (ops[i].code != FrameOpPlace) {
+			return false;
+		}
+		uintptr_t off = pi->character;
+		if (off >= stm->ressize) {
+			return false;
+		}
+		if (off != 0) {
+			size_t j = parser_find_cached(ch, defbeg, defend, (uint32_t)off);
+			if (j == ch->nchar) {
+				return false;
+			}
+			if ((j < defbeg || j >= defend) && parser_defined_character(stm, chars[j].id, (uint32_t)off) == NULL) {
+				return false;
+			}
+		}
+		uintptr_t name = (uintptr_t)pi->moviename.str;
+		if (name != 0 && (name > stm->ressize || pi->moviename.len > stm->ressize - name)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Frame compiled in an earlier run is restored from cache without reading
+// its tags: characters defined in it are restored from their cached ones,
+// and its ops are copied with character references resolved. Return NULL
+// if frame is not cached or can't be restored, it is compiled then.
+// Frames are mostly played in order, next ones in cache are tried first.
+static struct frame_code *
+parser_restore_frame(struct parser *px, struct stream *stm, uintptr_t tagpos) {
+	const struct cache_header *ch = stm->cache;
+	if (ch == NULL || ch->ncode == 0) {
+		return NULL;
+	}
+	const struct cache_code *codes = cache_section(ch, ch->codes);
+	uint32_t off = (uint32_t)(tagpos - stm->resource);
+	size_t k = stm->cachecode;
+	if (k >= ch->ncode || codes[k].tagpos != off) {
+		size_t lo = 0, hi = ch->ncode;
+		while (lo < hi) {
+			size_t mid = lo + (hi-lo)/2;
+			if (codes[mid].tagpos < off) {
+				lo = mid+1;
+			} else {
+				hi = mid;
+			}
+		}
+		k = lo;
+	}
+	if (k == ch->ncode || codes[k].tagpos != off || codes[k].endpos > stm->loading.nbyte) {
+		return NULL;
+	}
+	const struct cache_code *cd = &codes[k];
+	const struct frame_op *ops = cd->nop != 0 ? cache_section(ch, cd->ops) : NULL;
+	const struct cache_character *chars = cache_section(ch, ch->chars);
+	size_t defbeg = parser_search_cached(ch, cd->tagpos, stm->cachechar);
+	size_t defend = defbeg;
+	while (defend < ch->nchar && chars[defend].data < cd->endpos) {
+		defend++;
+	}
+	if (!parser_check_definitions(stm, cd, defbeg, defend) || !parser_check_ops(stm, cd, ops, defbeg, defend)) {
+		return NULL;
+	}
+	stm->cachecode = k+1;
+	stm->cachechar = defend;
+
+	for (size_t i=defbeg; i<defend; i++) {
+		struct character *c = parser_define_character(px, stm->dictionary, chars[i].id);
+		c->tag = chars[i].tag;
+		c->data = stm->resource + chars[i].data;
+		parser_restore_character(px, stm, c, &chars[i]);
+	}
+	struct frame_code *fc = parser_malloc(px, sizeof(*fc) + sizeof(struct frame_op)*cd->nop, __FILE__, __LINE__);
+	fc->tagpos = tagpos;
+	fc->endpos = stm->resource + cd->endpos;
+	fc->nop = cd->nop;
+	for (size_t i=0; i<cd->nop; i++) {
+		struct frame_op *op = &fc->ops[i];
+		*op = ops[i];
+		if (op->code != FrameOpPlace) {
+			continue;
+		}
+		struct place_info *pi = &op->place;
+		if (pi->character != 0) {
+			uint32_t data = (uint32_t)pi->character;
+			struct character *c = parser_defined_character(stm, chars[parser_find_cached(ch, defbeg, defend, data)].id, data);
+			pi->character = (uintptr_t)c;
+			pi->type = tag2type(c->tag);
+		}
+		if (pi->moviename.str != NULL) {
+			pi->moviename.str = (const char *)stm->resource + (uintptr_t)pi->moviename.str;
+		}
+	}
+	parser_insert_code(px, stm->codebook, fc);
+	if (px->lookahead != NULL) {
+		parser_scout_frames(px, stm, fc->endpos);
+	}
+	return fc;
+}
+
+static uintptr_t
+parser_progress_frame(struct parser *px, struct stream *stm, struct sprite *si, uintptr_t tagpos) {
+	if (!parser_require_frame(px, stm, tagpos)) {
+		// Hold on frames not loaded.
+		return tagpos;
+	}
+	struct frame_code *fc = codebook_search(stm->codebook, tagpos);
+	if (fc == NULL) {
+		if (stm->type == StreamFile && stm->loading.inflow == NULL) {
+			parser_readahead_stream(stm, tagpos);
+		}
+		fc = parser_restore_frame(px, stm, tagpos);
+		if (fc == NULL) {
+			fc = parser_compile_frame(px, stm, tagpos);
+		}
+	}
+	const struct frame_op *op = fc->ops;
+	for (size_t i=0, n=fc->nop; i<n; i++, op++) {
+		switch (op->code) {
+		case FrameOpPlace:
+			sprite_place_object(si, &op->place);
+			break;
+		case FrameOpRemove:
+			sprite_remove_object(si, op->place.chardepth);
+			break;
+		}
+	}
+	return fc->endpos;
+}
+
+static void
+parser_struct_sprite(struct parser *px, struct stream *stm, uintptr_t chptr, struct sprite_define *def) {
+	(void)px; (void)stm;
+	const struct character *ch = (void *)chptr;
+	const uint8_t *pos = (void *)ch->data;
+	def->nframe = (intreg_t)read_uint16((byte_t*)pos);
+	def->tagbeg = (uintptr_t)(pos+2);
+	def->frames = (const uint32_t *)ch->udef;
+}
+
+static struct unpack *
+parser_create_unpack(struct parser *px, const byte_t *head) {
+	if (head[0] == 'Z') {
+		return unpack_create(px->memface, UnpackLzma, head+12, 5);
+	}
+	return unpack_create(px->memface, UnpackZlib, NULL, 0);
+}
+
+static struct inflow *
+parser_create_inflow(struct parser *px, struct stream *stm) {
+	struct inflow *fw = parser_malloc(px, sizeof(*fw), __FILE__, __LINE__);
+	fw->unpack = NULL;
+	fw->input = NULL;
+	fw->inlen = 0;
+	fw->mapping = NULL;
+	fw->mapsize = 0;
+	fw->feeding = false;
+	fw->nhead = 0;
+	stm->loading.inflow = fw;
+	return fw;
+}
+
+// Allocate whole uncompressed movie, whose length is given in header.
+static void
+parser_alloc_resource(struct parser *px, struct stream *stm, const byte_t *head) {
+	byte_t *buf = parser_malloc(px, (size_t)stm->userdef, __FILE__, __LINE__);
+	memcpy(buf, head, 8);
+	stm->resource = (uintptr_t)buf;
+	stm->ressize = (size_t)stm->userdef;
+	stm->loading.nbyte = 8;
+}
+
+// Prepare decompressing of compressed movie, whose 8 bytes header is
+// uncompressed. "CWS" is followed by zlib stream, "ZWS" is followed by
+// lzma header and raw lzma data.
+static bool
+parser_struct_inflow(struct parser *px, struct stream *stm, const byte_t *data, size_t size) {
+	if (stm->userdef < 8) {
+		return false;
+	}
+	const byte_t *input = data + 8;
+	// Size of StreamData is unknown, decompressing stops at end of compressed data.
+	size_t inlen = size - 8;
+	if (data[0] == 'Z') {
+		if (size < 8 + LZMA_HEADER_SIZE) {
+			return false;
+		}
+		size_t zlen = (size_t)read_uint32(data+8);
+		input += LZMA_HEADER_SIZE;
+		inlen -= LZMA_HEADER_SIZE;
+		inlen = zlen < inlen ? zlen : inlen;
+	}
+	struct unpack *up = parser_create_unpack(px, data);
+	if (up == NULL) {
+		return false;
+	}
+	struct inflow *fw = parser_create_inflow(px, stm);
+	fw->unpack = up;
+	fw->input = input;
+	fw->inlen = inlen;
+	if (stm->type == StreamFile) {
+		fw->mapping = data;
+		fw->mapsize = size;
+	}
+	parser_alloc_resource(px, stm, data);
+
+	size_t need = stm->ressize < HEADER_MAXSIZE ? stm->ressize : HEADER_MAXSIZE;
+	while (stm->loading.nbyte < need) {
+		if (!parser_inflate_stream(px, stm)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void
+parser_delete_inflow(struct parser *px, struct stream *stm) {
+	struct inflow *fw = stm->loading.inflow;
+	parser_finish_inflow(fw);
+	parser_dealloc(px, fw, __FILE__, __LINE__);
+	if (stm->resource != 0) {
+		parser_dealloc(px, (void *)stm->resource, __FILE__, __LINE__);
+	}
+	stm->loading.inflow = NULL;
+}
+
+static bool
+parser_check_signature(const byte_t *data) {
+	return memcmp(data, "FWS", 3) == 0 || memcmp(data, "CWS", 3) == 0 || memcmp(data, "ZWS", 3) == 0;
+}
+
+// Parse header, and start indexing frames of main timeline.
+// Frame index in cache is used if whole stream is available.
+static bool
+parser_restore_frames(struct stream *stm) {
+	const struct cache_header *ch = stm->cache;
+	struct loading *ld = &stm->loading;
+	if (ch->indexed == 0 || ld->nbyte != stm->ressize || ch->nframe >= ld->maxframe) {
+		return false;
+	}
+	const uint32_t *frames = cache_section(ch, ch->frames);
+	if (ld->tagbeg + frames[ch->nframe] > stm->resource + stm->ressize) {
+		return false;
+	}
+	memcpy(ld->frames, frames, sizeof(uint32_t)*((size_t)ch->nframe+1));
+	ld->nframe = ch->nframe;
+	ld->frameend = stm->resource + ch->frameend;
+	ld->scanpos = stm->resource + ch->scanpos;
+	return true;
+}
+
+// Files are keyed by content sampled at fixed points, so that keying costs
+// the same for files of any size. Small files are hashed whole.
+#define CACHE_SAMPLE_NBLOCK	64
+#define CACHE_SAMPLE_SIZE	256
+
+static uint64_t
+parser_sample_content(const byte_t *data, size_t size) {
+	if (size <= 2*CACHE_SAMPLE_NBLOCK*CACHE_SAMPLE_SIZE) {
+		return hash_bytes(data, size);
+	}
+	// First block covers stream header, last block ends at stream end.
+	uint64_t hashes[CACHE_SAMPLE_NBLOCK];
+	size_t step = (size - CACHE_SAMPLE_SIZE) / (CACHE_SAMPLE_NBLOCK-1);
+	for (size_t i=0; i<CACHE_SAMPLE_NBLOCK-1; i++) {
+		hashes[i] = hash_bytes(data + i*step, CACHE_SAMPLE_SIZE);
+	}
+	hashes[CACHE_SAMPLE_NBLOCK-1] = hash_bytes(data + size - CACHE_SAMPLE_SIZE, CACHE_SAMPLE_SIZE);
+	return hash_bytes(hashes, sizeof(hashes)) ^ (uint64_t)size;
+}
+
+// Only files are cached. They are also keyed by their stamps, so that
+// rewritten files miss even if sampled content is unchanged. StreamData
+// has no stamp, sampling alone would restore stale characters of data
+// changed between samples, and hashing it whole costs more than cache
+// saves.
+static void
+parser_open_cache(struct parser *px, struct stream *stm, const void *ud, const byte_t *data, size_t size) {
+	stm->contentkey = 0;
+	stm->contentsize = 0;
+	stm->cache = NULL;
+	stm->cachesize = 0;
+	stm->cachecode = 0;
+	stm->cachechar = 0;
+	if (px->cachedir == NULL || stm->type != StreamFile) {
+		return;
+	}
+	uint64_t key[2];
+	key[1] = mapfile_stamp(ud);
+	if (key[1] == 0) {
+		return;
+	}
+	key[0] = parser_sample_content(data, size);
+	stm->contentsize = size;
+	stm->contentkey = hash_bytes(key, sizeof(key));
+	// Compressed file inflates to size in its header.
+	size_t ressize = data[0] == 'F' ? size : (size_t)read_uint32(data+4);
+	const struct cache_header *ch = cache_open(px->cachedir, stm->contentkey, size, ressize, &stm->cachesize);
+	if (ch != NULL && ch->opsize != sizeof(struct frame_op)) {
+		cache_close(ch, stm->cachesize);
+		ch = NULL;
+	}
+	stm->cache = ch;
+}
+
+static void
+parser_save_character(struct parser *px, struct stream *stm, struct cache_writer *cw, const struct character *ch, struct cache_character *cc) {
+	cc->id = ch->id;
+	cc->tag = ch->tag;
+	cc->data = (uint32_t)(ch->data - stm->resource);
+	cc->udef = cc->outline = cc->palettes = 0;
+	cc->nudef = cc->nrecord = cc->npalette = 0;
+	switch (ch->tag) {
+	case SwftagDefineShape:
+	case SwftagDefineShape2:
+	case SwftagDefineShape3:
+		cc->nudef = sizeof(struct rectangle);
+		cc->udef = cache_writer_append(cw, (void *)ch->udef, cc->nudef);
+		break;
+	case SwftagDefineSprite:
+		cc->nudef = (uint32_t)(sizeof(uint32_t)*(read_uint16((byte_t *)ch->data)+1));
+		cc->udef = cache_writer_append(cw, (void *)ch->udef, cc->nudef);
+		break;
+	default:
+		break;
+	}
+	const struct outline *ol = ch->outline;
+	if (ol != NULL) {
+		cc->outline = cache_writer_append(cw, ol->records, sizeof(struct outline_record)*ol->nrecord);
+		cc->nrecord = (uint32_t)ol->nrecord;
+		if (ol->npalette != 0) {
+			uint32_t *palettes = parser_malloc(px, sizeof(uint32_t)*ol->npalette, __FILE__, __LINE__);
+			for (size_t i=0; i<ol->npalette; i++) {
+				palettes[i] = (uint32_t)((uintptr_t)bitval_read_cursor(&ol->palettes[i]) - stm->resource);
+			}
+			cc->palettes = cache_writer_append(cw, palettes, sizeof(uint32_t)*ol->npalette);
+			cc->npalette = (uint32_t)ol->npalette;
+			parser_dealloc(px, palettes, __FILE__, __LINE__);
+		}
+	}
+}
+
+static int
+cache_character_compare(const void *a, const void *b) {
+	uint32_t d0 = ((const struct cache_character *)a)->data;
+	uint32_t d1 = ((const struct cache_character *)b)->data;
+	return d0 < d1 ? -1 : d0 > d1;
+}
+
+// Characters of ops are saved as data offsets of their definitions, see
+// parser_restore_frame().
+static void
+parser_save_code(struct stream *stm, struct cache_writer *cw, const struct frame_code *fc, struct cache_code *cd) {
+	cd->tagpos = (uint32_t)(fc->tagpos - stm->resource);
+	cd->endpos = (uint32_t)(fc->endpos - stm->resource);
+	cd->nop = (uint32_t)fc->nop;
+	cd->ops = 0;
+	for (size_t i=0; i<fc->nop; i++) {
+		const struct frame_op *op = &fc->ops[i];
+		struct frame_op saved;
+		memset(&saved, 0, sizeof(saved));
+		saved.code = op->code;
+		if (op->code == FrameOpPlace) {
+			saved.place = op->place;
+			saved.place.type = 0;
+			if (op->place.character != 0) {
+				saved.place.character = ((const struct character *)op->place.character)->data - stm->resource;
+			}
+			if (op->place.moviename.str != NULL) {
+				saved.place.moviename.str = (const char *)((uintptr_t)op->place.moviename.str - stm->resource);
+			}
+		} else {
+			saved.place.chardepth = op->place.chardepth;
+		}
+		uint32_t off = cache_writer_append(cw, &saved, sizeof(saved));
+		if (i == 0) {
+			cd->ops = off;
 		}
 	}
 }
 
-static void
-parser_struct_sprite(struct parser *px, struct stream *stm, uintptr_t chptr, struct sprite_define *def) {
-	(void)px; (void)stm;
-	const uint8_t *pos = (void *)chptr;
-	def->nframe = (intreg_t)read_uint16((byte_t*)pos);
-	def->tagbeg = (uintptr_t)(pos+2);
+static int
+cache_code_compare(const void *a, const void *b) {
+	uint32_t p0 = ((const struct cache_code *)a)->tagpos;
+	uint32_t p1 = ((const struct cache_code *)b)->tagpos;
+	return p0 < p1 ? -1 : p0 > p1;
 }
 
+// Cache is written if stream knows more than its cache.
 static void
-parser_struct_stream(struct parser *px, struct stream *stm, const void *ud, struct stream_define *def) {
-	// TODO Support StreamFile.
-	assert(stm->type != StreamFile);
-	assert(memcmp(ud, "FWS", 3) == 0);
+parser_save_cache(struct parser *px, struct stream *stm) {
+	struct dictionary *dc = stm->dictionary;
+	struct loading *ld = &stm->loading;
+	const struct cache_header *old = stm->cache;
+	bool indexed = ld->nbyte == stm->ressize && ld->nframe < ld->maxframe;
+	size_t noutline = 0;
+	for (size_t i=0; i<DICT_NPAGE*DICT_PAGE_SIZE; i++) {
+		struct character **page = dc->pages[i >> DICT_PAGE_BITS];
+		if (page == NULL) {
+			i |= DICT_PAGE_MASK;
+			continue;
+		}
+		for (struct character *ch = page[i & DICT_PAGE_MASK]; ch != NULL; ch = ch->next) {
+			noutline += ch->outline != NULL;
+		}
+	}
+	struct codebook *cb = stm->codebook;
+	if (old != NULL && old->nchar >= dc->nchar && old->noutline >= noutline && old->ncode >= cb->ncode && (old->indexed != 0 || !indexed)) {
+		return;
+	}
 
-	bitval_t bv;
-	bitval_init_read(bv, (byte_t*)ud, (size_t)-1);
-	bitval_skip_bytes(bv, 3);
-	stm->version = bitval_read_uint8(bv);
-	stm->resource = (uintptr_t)ud;
-	stm->userdef = (uintptr_t)bitval_read_uint32(bv);
-	stm->dictionary = parser_create_dictionary(px);
+	struct cache_writer *cw = cache_writer_create(px->memface);
+	uint32_t frames = indexed ? cache_writer_append(cw, ld->frames, sizeof(uint32_t)*(ld->nframe+1)) : 0;
+	struct cache_character *chars = parser_malloc(px, sizeof(struct cache_character)*(dc->nchar+1), __FILE__, __LINE__);
+	size_t nchar = 0;
+	for (size_t i=0; i<DICT_NPAGE*DICT_PAGE_SIZE; i++) {
+		struct character **page = dc->pages[i >> DICT_PAGE_BITS];
+		if (page == NULL) {
+			i |= DICT_PAGE_MASK;
+			continue;
+		}
+		for (struct character *ch = page[i & DICT_PAGE_MASK]; ch != NULL; ch = ch->next) {
+			parser_save_character(px, stm, cw, ch, &chars[nchar++]);
+		}
+	}
+	qsort(chars, nchar, sizeof(struct cache_character), cache_character_compare);
+	uint32_t offset = cache_writer_append(cw, chars, sizeof(struct cache_character)*nchar);
+	parser_dealloc(px, chars, __FILE__, __LINE__);
+
+	// Ops are appended contiguously per frame, codes after them.
+	struct cache_code *codes = parser_malloc(px, sizeof(struct cache_code)*(cb->ncode+1), __FILE__, __LINE__);
+	size_t ncode = 0;
+	for (size_t i=0; i<cb->nslot; i++) {
+		for (const struct frame_code *fc = cb->slots[i]; fc != NULL; fc = fc->next) {
+			parser_save_code(stm, cw, fc, &codes[ncode++]);
+		}
+	}
+	assert(ncode == cb->ncode);
+	qsort(codes, ncode, sizeof(struct cache_code), cache_code_compare);
+	uint32_t codeoff = cache_writer_append(cw, codes, sizeof(struct cache_code)*ncode);
+	parser_dealloc(px, codes, __FILE__, __LINE__);
+
+	struct cache_header *ch = cache_writer_header(cw);
+	ch->key = stm->contentkey;
+	ch->size = stm->contentsize;
+	if (indexed) {
+		ch->indexed = 1;
+		ch->nframe = (uint32_t)ld->nframe;
+		ch->frames = frames;
+		ch->frameend = (uint32_t)(ld->frameend - stm->resource);
+		ch->scanpos = (uint32_t)(ld->scanpos - stm->resource);
+	}
+	ch->nchar = (uint32_t)nchar;
+	ch->noutline = (uint32_t)noutline;
+	ch->chars = offset;
+	ch->opsize = sizeof(struct frame_op);
+	ch->ncode = (uint32_t)ncode;
+	ch->codes = codeoff;
+	if (!cache_writer_commit(cw, px->cachedir)) {
+		parser_error(px, "[%s()] can't write stream cache in %s.\n", __func__, px->cachedir);
+	}
+	cache_writer_delete(cw);
+}
 
+static void
+parser_struct_header(struct parser *px, struct stream *stm, struct stream_define *def) {
+	bitval_t bv;
+	bitval_init_read(bv, (byte_t *)stm->resource + 8, stm->loading.nbyte - 8);
 	bitval_read_rectangle(bv, &def->size);
 	bitval_sync(bv);
 	def->rate = bitval_read_uint16(bv);
 	def->nframe = bitval_read_uint16(bv);
 	def->tagbeg = (uintptr_t)bitval_read_cursor(bv);
+	stm->readahead = def->tagbeg;
+
+	struct loading *ld = &stm->loading;
+	ld->scanpos = ld->tagbeg = def->tagbeg;
+	ld->maxframe = (size_t)def->nframe + 1;
+	ld->frames = parser_zalloc(px, sizeof(uint32_t)*ld->maxframe, __FILE__, __LINE__);
+	def->frames = ld->frames;
+	if (stm->cache == NULL || !parser_restore_frames(stm)) {
+		parser_scan_frames(stm);
+	}
+}
+
+static bool
+parser_struct_stream(struct parser *px, struct stream *stm, const void *ud, struct stream_define *def) {
+	memset(&stm->loading, 0, sizeof(stm->loading));
+	if (stm->type == StreamFeed) {
+		// Nothing is known before bytes fed.
+		(void)ud;
+		stm->version = 0;
+		stm->userdef = 0;
+		stm->resource = 0;
+		stm->ressize = 0;
+		stm->readahead = 0;
+		memset(def, 0, sizeof(*def));
+		parser_create_inflow(px, stm)->feeding = true;
+		parser_open_cache(px, stm, NULL, NULL, 0);
+		stm->dictionary = parser_create_dictionary(px);
+		stm->codebook = parser_create_codebook(px);
+		return true;
+	}
+
+	const byte_t *data = ud;
+	size_t size = (size_t)-1;
+	if (stm->type == StreamFile) {
+		// Mapped pages are referenced by characters and timelines directly,
+		// there is no copy of file content.
+		data = mapfile_open(ud, &size);
+		if (data == NULL) {
+			parser_error(px, "[%s()] can't map file %s.\n", __func__, (const char *)ud);
+			return false;
+		}
+		mapfile_advise(data, size, 0, size, MapfileAdviceSequential);
+	}
+	if (size < 8 || !parser_check_signature(data)) {
+		parser_error(px, "[%s()] unsupported stream signature.\n", __func__);
+		if (stm->type == StreamFile) {
+			mapfile_close(data, size);
+		}
+		return false;
+	}
+
+	stm->version = (int)read_uint8(data+3);
+	stm->userdef = (uintptr_t)read_uint32(data+4);
+	parser_open_cache(px, stm, ud, data, size);
+	if (data[0] != 'F') {
+		if (!parser_struct_inflow(px, stm, data, size)) {
+			parser_error(px, "[%s()] can't decompress stream.\n", __func__);
+			if (stm->cache != NULL) {
+				cache_close(stm->cache, stm->cachesize);
+			}
+			if (stm->loading.inflow != NULL) {
+				parser_delete_inflow(px, stm);
+			} else if (stm->type == StreamFile) {
+				mapfile_close(data, size);
+			}
+			return false;
+		}
+	} else {
+		// Mapped file must hold whole movie, tags are read from mapped
+		// pages up to its end only.
+		if (stm->type == StreamFile && (size_t)stm->userdef > size) {
+			parser_error(px, "[%s()] stream length %zu exceeds file size %zu.\n", __func__, (size_t)stm->userdef, size);
+			if (stm->cache != NULL) {
+				cache_close(stm->cache, stm->cachesize);
+			}
+			mapfile_close(data, size);
+			return false;
+		}
+		stm->resource = (uintptr_t)data;
+		stm->ressize = stm->type == StreamFile ? size : (size_t)stm->userdef;
+		stm->loading.nbyte = stm->ressize;
+	}
+	stm->dictionary = parser_create_dictionary(px);
+	stm->codebook = parser_create_codebook(px);
+	parser_struct_header(px, stm, def);
+	return true;
+}
+
+// Receive headers of fed stream: 8 bytes for "FWS" and "CWS", 8 bytes plus
+// lzma header for "ZWS". Return number of bytes consumed.
+static size_t
+parser_feed_head(struct parser *px, struct stream *stm, const byte_t *data, size_t size) {
+	struct inflow *fw = stm->loading.inflow;
+	size_t need = fw->nhead >= 3 && fw->head[0] == 'Z' ? 8 + LZMA_HEADER_SIZE : 8;
+	size_t n = need - fw->nhead;
+	n = n < size ? n : size;
+	memcpy(fw->head + fw->nhead, data, n);
+	fw->nhead += n;
+	if (fw->nhead >= 3 && !parser_check_signature(fw->head)) {
+		parser_error(px, "[%s()] unsupported stream signature.\n", __func__);
+		return (size_t)-1;
+	}
+	if (fw->nhead == need && need == 8 && fw->head[0] == 'Z') {
+		// Lzma header follows.
+		return n + parser_feed_head(px, stm, data+n, size-n);
+	}
+	if (fw->nhead < need) {
+		return n;
+	}
+	stm->version = (int)read_uint8(fw->head+3);
+	stm->userdef = (uintptr_t)read_uint32(fw->head+4);
+	if (stm->userdef < 8) {
+		parser_error(px, "[%s()] invalid stream length.\n", __func__);
+		return (size_t)-1;
+	}
+	if (fw->head[0] != 'F') {
+		fw->unpack = parser_create_unpack(px, fw->head);
+		if (fw->unpack == NULL) {
+			parser_error(px, "[%s()] can't decompress stream.\n", __func__);
+			return (size_t)-1;
+		}
+	}
+	parser_alloc_resource(px, stm, fw->head);
+	return n;
+}
+
+// Append bytes to StreamFeed stream. Compressed bytes are decompressed
+// at once, since they are not kept.
+static bool
+parser_feed_stream(struct parser *px, struct stream *stm, const void *data, size_t size, struct stream_define *def) {
+	struct loading *ld = &stm->loading;
+	struct inflow *fw = ld->inflow;
+	assert(stm->type == StreamFeed && fw != NULL && fw->feeding);
+	const byte_t *ptr = data;
+	if (stm->resource == 0) {
+		size_t n = parser_feed_head(px, stm, ptr, size);
+		if (n == (size_t)-1) {
+			return false;
+		}
+		ptr += n;
+		size -= n;
+	}
+	if (stm->resource == 0) {
+		return true;
+	}
+	if (fw->unpack != NULL) {
+		fw->input = ptr;
+		fw->inlen = size;
+		while (fw->inlen != 0 && parser_inflate_stream(px, stm)) {
+		}
+		fw->input = NULL;
+		fw->inlen = 0;
+	} else if (fw->head[0] == 'F') {
+		size_t n = stm->ressize - ld->nbyte;
+		n = n < size ? n : size;
+		memcpy((byte_t *)stm->resource + ld->nbyte, ptr, n);
+		ld->nbyte += n;
+	}
+	if (ld->scanpos == 0) {
+		size_t need = stm->ressize < HEADER_MAXSIZE ? stm->ressize : HEADER_MAXSIZE;
+		if (ld->nbyte < need) {
+			return true;
+		}
+		parser_struct_header(px, stm, def);
+	} else {
+		parser_scan_frames(stm);
+	}
+	return true;
 }
 
 static void
 parser_finish_stream(struct parser *px, struct stream *stm) {
+	if (px->lookahead != NULL) {
+		lookahead_cancel(px->lookahead, stm);
+	}
+	if (px->cachedir != NULL && stm->contentkey != 0) {
+		parser_save_cache(px, stm);
+	}
 	parser_delete_dictionary(px, stm->dictionary);
-	// TODO resource ?
-}
-
-enum fill_type {
-	FillStyleSolid,
-	FillStyleLinearGradient			= 0x10,
-	FillStyleRadialGradient			= 0x12,
-	FillStyleFocalRadialGradient		= 0x13,
-	FillStyleRepeatingBitmap		= 0x40,
-	FillStyleClippedBitmap			= 0x41,
-	FillStyleNonSmoothedRepeatingBitmap	= 0x42,
-	FillStyleNonSmoothedClippedBitmap	= 0x43,
-};
+	if (stm->cache != NULL) {
+		cache_close(stm->cache, stm->cachesize);
+	}
+	parser_delete_codebook(px, stm->codebook);
+	if (stm->loading.frames != NULL) {
+		parser_dealloc(px, stm->loading.frames, __FILE__, __LINE__);
+	}
+	if (stm->loading.inflow != NULL) {
+		parser_delete_inflow(px, stm);
+	} else if (stm->type == StreamFile) {
+		mapfile_close((void *)stm->resource, stm->ressize);
+	}
+}
 
 static enum color_type
 fill2color(enum fill_type type) {
@@ -348,10 +1669,11 @@ fill2color(enum fill_type type) {
 	case FillStyleLinearGradient:
 		return ColorTypeLinearGradient;
 	case FillStyleRadialGradient:
+	case FillStyleFocalRadialGradient:
 		return ColorTypeRadialGradient;
 	default:
-		assert(!"unsupported fill palette");
-		return -1;
+		// Bitmap fills are not supported, they are transparent.
+		return ColorTypeSolid;
 	}
 }
 
@@ -366,9 +1688,19 @@ struct palette {
 };
 
 struct graph {
-	struct texture *texture;
+	// Fills then strokes of every style layer, layers replaced by
+	// RecordStateNewStyles are drawn in order, under ones after them.
+	struct texture **textures;
+	size_t ntexture;
+	size_t texturecap;
 	struct palette *lineset;
 	struct palette *fillset;
+	// Transform textures are built at, and bounds of them in twips of
+	// target.
+	struct matrix matrix;
+	struct rectangle bounds;
+	// Wholly covered by opaque fill, in twips of target, or empty.
+	struct rectangle opaque;
 };
 
 struct state;
@@ -378,7 +1710,7 @@ typedef union color * (*GetColorFunc_t)(struct state *st, size_t idx, struct ren
 struct state {
 	struct palette **fillptr;
 	struct palette **lineptr;
-	struct texture **texture;
+	struct graph *graph;
 	enum swftag tag;
 	const struct transform *txform;
 	void (*read_rgba8)(struct bitval *bv, struct rgba8 *c);
@@ -388,9 +1720,11 @@ struct state {
 
 static inline void
 graph_init(struct graph *gh) {
-	gh->texture = NULL;
+	gh->textures = NULL;
+	gh->ntexture = gh->texturecap = 0;
 	gh->fillset = NULL;
 	gh->lineset = NULL;
+	gh->opaque = (struct rectangle){0, 0, 0, 0};
 }
 
 static void
@@ -406,9 +1740,38 @@ style_fini(struct palette *st, struct parser *px, struct render *rd) {
 	}
 }
 
+static void
+graph_delete_textures(struct graph *gh, struct render *rd) {
+	for (size_t i=0; i<gh->ntexture; i++) {
+		render_delete_texture(rd, gh->textures[i]);
+	}
+	gh->ntexture = 0;
+}
+
+static void
+graph_add_texture(struct graph *gh, struct parser *px, struct texture *tu) {
+	if (tu == NULL) {
+		return;
+	}
+	if (gh->ntexture == gh->texturecap) {
+		size_t cap = gh->texturecap == 0 ? 2 : 2*gh->texturecap;
+		struct texture **textures = parser_malloc(px, sizeof(*textures)*cap, __FILE__, __LINE__);
+		if (gh->textures != NULL) {
+			memcpy(textures, gh->textures, sizeof(*textures)*gh->ntexture);
+			parser_dealloc(px, gh->textures, __FILE__, __LINE__);
+		}
+		gh->textures = textures;
+		gh->texturecap = cap;
+	}
+	gh->textures[gh->ntexture++] = tu;
+}
+
 static void
 graph_fini(struct graph *gh, struct parser *px, struct render *rd) {
-	render_delete_texture(rd, gh->texture);
+	graph_delete_textures(gh, rd);
+	if (gh->textures != NULL) {
+		parser_dealloc(px, gh->textures, __FILE__, __LINE__);
+	}
 	style_fini(gh->fillset, px, rd);
 	style_fini(gh->lineset, px, rd);
 	graph_init(gh);
@@ -424,6 +1787,7 @@ state_new_fills(struct state *st, struct parser *px, size_t nfill) {
 		pa->next = NULL;
 		pa->ncolor = n;
 		pa->colors[0] = NULL;
+		*(st->fillptr) = pa;
 	}
 	st->fillptr = &pa->next;
 }
@@ -438,6 +1802,7 @@ state_new_lines(struct state *st, struct parser *px, size_t nline) {
 		pa->next = NULL;
 		pa->ncolor = n;
 		pa->colors[0] = NULL;
+		*(st->lineptr) = pa;
 	}
 	st->lineptr = &pa->next;
 	return (struct style *)&pa->colors[n];
@@ -467,16 +1832,18 @@ state_more_palette(struct state *st) {
 	return pa != NULL;
 }
 
+// Style indices out of palette select no style, they are not checked when
+// shape records are decoded or restored from cache.
 static inline union color *
 state_index_fillcolor(struct state *st, size_t idx) {
-	union color **cos = _state_get_fillcolors(st);
-	return cos[idx];
+	struct palette *pa = (struct palette *)st->fillptr;
+	return idx < pa->ncolor ? pa->colors[idx] : NULL;
 }
 
 static union color *
 state_index_linecolor(struct state *st, size_t idx) {
-	union color **cos = _state_get_linecolors(st);
-	return cos[idx];
+	struct palette *pa = (struct palette *)st->lineptr;
+	return idx < pa->ncolor ? pa->colors[idx] : NULL;
 }
 
 static struct style *
@@ -519,7 +1886,7 @@ static inline void
 state_init_struct(struct state *st, struct graph *gh, const struct transform *tsm, enum swftag tag) {
 	st->fillptr = &gh->fillset;
 	st->lineptr = &gh->lineset;
-	st->texture = &gh->texture;
+	st->graph = gh;
 	st->tag = tag;
 	st->txform = tsm;
 	st->read_rgba8 = bitval_read_rgba8_non_alpha;
@@ -534,7 +1901,7 @@ static inline void
 state_init_change(struct state *st, struct graph *gh, const struct transform *tsm, enum swftag tag) {
 	st->fillptr = &gh->fillset;
 	st->lineptr = &gh->lineset;
-	st->texture = &gh->texture;
+	st->graph = gh;
 	st->tag = tag;
 	st->txform = tsm;
 	st->read_rgba8 = bitval_read_rgba8_non_alpha;
@@ -555,8 +1922,22 @@ bitval_read_rgba8_state(struct bitval *bv, struct rgba8 *c, struct state *st) {
 	return rgba8_transparent(c);
 }
 
+// Ramps are premultiplied after interpolation, as SWF interpolates
+// straight colors.
+static inline void
+gradient_premultiply(struct gradient *gd) {
+	for (size_t i=0; i<256; i++) {
+		struct rgba8 *c = &gd->ramps[i];
+		uint32_t a = c->a;
+		uint32_t r = c->r*a + 128, g = c->g*a + 128, b = c->b*a + 128;
+		c->r = (uint8_t)((r + (r >> 8)) >> 8);
+		c->g = (uint8_t)((g + (g >> 8)) >> 8);
+		c->b = (uint8_t)((b + (b >> 8)) >> 8);
+	}
+}
+
 static inline bool
-bitval_read_gradient_state(struct bitval *bv, struct gradient *gd, struct state *st) {
+bitval_read_gradient_state(struct bitval *bv, struct gradient *gd, struct state *st, bool focal) {
 	bool transparent;
 	struct rgba8 colori, colorz;
 	intreg_t ratioi;
@@ -565,13 +1946,21 @@ bitval_read_gradient_state(struct bitval *bv, struct gradient *gd, struct state
 	intreg_t r, g, b, a;
 
 	struct matrix mx;
+	matrix_identify(&mx);
 	bitval_read_matrix(bv, &mx);
 	bitval_sync(bv);
 
-	matrix_concat(&gd->invmat, &st->txform->matrix);
+	gd->invmat = st->txform->matrix;
 	matrix_concat(&gd->invmat, &mx);
+	matrix_invert(&gd->invmat);
 
+	// Interpolation mode is ignored, ramps are interpolated in sRGB.
 	n = bitval_read_uint8(bv);
+	gd->spread = (enum gradient_spread)(n >> 6);
+	if (gd->spread > GradientSpreadRepeat) {
+		gd->spread = GradientSpreadPad;
+	}
+	n &= 0x0F;
 	ratioi = bitval_read_uint8(bv);
 	transparent = bitval_read_rgba8_state(bv, &colori, st);
 	for (i=0; i<=ratioi; i++) {	// inclusive
@@ -593,17 +1982,24 @@ bitval_read_gradient_state(struct bitval *bv, struct gradient *gd, struct state
 				g += dg;
 				b += db;
 				a += da;
-				ramps[ratioi].r = (uint8_t)r;
-				ramps[ratioi].g = (uint8_t)g;
-				ramps[ratioi].b = (uint8_t)b;
-				ramps[ratioi].a = (uint8_t)a;
+				ramps[ratioi].r = (uint8_t)(r >> 16);
+				ramps[ratioi].g = (uint8_t)(g >> 16);
+				ramps[ratioi].b = (uint8_t)(b >> 16);
+				ramps[ratioi].a = (uint8_t)(a >> 16);
 			}
+			ramps[ratioz] = colorz;
+			r = colorz.r<<16; g = colorz.g<<16; b = colorz.b<<16; a = colorz.a<<16;
 			colori = colorz;
 		}
 	}
 	for (i=ratioi+1; i<256; i++) {
 		ramps[i] = colori;
 	}
+	gd->focal = 0;
+	if (focal) {
+		gd->focal = (fixed_t)bitval_read_int16(bv)*256;
+	}
+	gradient_premultiply(gd);
 	return transparent;
 }
 
@@ -633,7 +2029,7 @@ parser_struct_palette(struct parser *px, struct render *rd, struct bitval *bv, s
 		case FillStyleLinearGradient:
 		case FillStyleRadialGradient:
 		case FillStyleFocalRadialGradient:
-			ci.transparent = bitval_read_gradient_state(bv, &co->gradient, st);
+			ci.transparent = bitval_read_gradient_state(bv, &co->gradient, st, type == FillStyleFocalRadialGradient);
 			break;
 		case FillStyleRepeatingBitmap:
 		case FillStyleClippedBitmap:
@@ -642,6 +2038,8 @@ parser_struct_palette(struct parser *px, struct render *rd, struct bitval *bv, s
 			bitval_skip_bytes(bv, 2);
 			bitval_skip_matrix(bv);
 			bitval_sync(bv);
+			co->solid = (struct rgba8){0, 0, 0, 0};
+			ci.transparent = true;
 			break;
 		default:
 			break;
@@ -664,107 +2062,193 @@ do {						\
 	nfill = __n >> 4;			\
 } while (0)
 
-#define RecordTypeEdge		0x20
-#define RecordEdgeLine		0x10
+// Shape decoded by lookahead is picked up, otherwise it is decoded now.
+static const struct outline *
+parser_shape_outline(struct parser *px, struct character *ch) {
+	if (ch->outline == NULL && px->lookahead != NULL) {
+		ch->outline = lookahead_claim(px->lookahead, (const uint8_t *)ch->data);
+	}
+	if (ch->outline == NULL) {
+		ch->outline = outline_decode(px->memface, (enum swftag)ch->tag, (const uint8_t *)ch->data);
+	}
+	return ch->outline;
+}
+
+static void
+parser_replay_edge(struct render *rd, const struct outline_record *rc, const struct matrix *mx) {
+	struct point control, anchor;
+	switch (rc->verb) {
+	case OutlineVerbMove:
+		anchor = rc->u.edge.anchor;
+		matrix_transform_point(mx, &anchor);
+		render_move_to(rd, &anchor);
+		break;
+	case OutlineVerbLine:
+		anchor = rc->u.edge.anchor;
+		matrix_transform_point(mx, &anchor);
+		render_line_to(rd, &anchor);
+		break;
+	case OutlineVerbCurve:
+		control = rc->u.edge.control;
+		anchor = rc->u.edge.anchor;
+		matrix_transform_point(mx, &control);
+		matrix_transform_point(mx, &anchor);
+		render_curve_to(rd, &control, &anchor);
+		break;
+	default:
+		break;
+	}
+}
+
+// Ratio of lengths in target to lengths in shape, averaged over directions.
+static double
+parser_matrix_scale(const struct matrix *mx) {
+	double det = ((double)mx->sx*mx->sy - (double)mx->shx*mx->shy)/((double)FIXED_1*FIXED_1);
+	return sqrt(fabs(det));
+}
 
-#define RecordStateMoveTo	0x01
-#define RecordStateFillStyle0	0x02
-#define RecordStateFillStyle1	0x04
-#define RecordStateLineStyle	0x08
-#define RecordStateNewStyles	0x10
+// Strokes narrower than one pixel after transform are drawn one pixel wide.
+static coord_t
+parser_stroke_width(const struct matrix *mx, coord_t width) {
+	double scale = parser_matrix_scale(mx);
+	if (scale == 0) {
+		return 0;
+	}
+	coord_t thin = (coord_t)ceil(20/scale);
+	return width > thin ? width : thin;
+}
 
-#define RecordStateFillChange	(RecordStateFillStyle0|RecordStateFillStyle1)
-#define RecordStateLineChange	(RecordStateMoveTo|RecordStateLineStyle)
-#define RecordStatePathChange	(RecordStateMoveTo|RecordStateFillChange|RecordStateLineChange)
+// Strokes of character are kept most recently used first. A line style
+// missing width replaces its least recently used one if it has
+// STROKE_NWIDTH widths.
+static const struct stroke *
+parser_shape_stroke(struct parser *px, struct character *ch, size_t palette, size_t line, coord_t width) {
+	struct stroke **link = &ch->strokes, **last = NULL;
+	size_t nwidth = 0;
+	struct stroke *sk;
+	for (; (sk = *link) != NULL; link = &sk->next) {
+		if (sk->palette != palette || sk->line != line) {
+			continue;
+		}
+		if (sk->width == width) {
+			break;
+		}
+		nwidth++;
+		last = link;
+	}
+	if (sk == NULL && nwidth >= STROKE_NWIDTH) {
+		link = last;
+		sk = *link;
+		if (sk->outline != NULL) {
+			outline_delete(px->memface, sk->outline);
+		}
+		sk->width = width;
+		sk->outline = stroke_expand(px->memface, ch->outline, palette, line, width);
+	}
+	if (sk == NULL) {
+		sk = parser_malloc(px, sizeof(*sk), __FILE__, __LINE__);
+		sk->palette = palette;
+		sk->line = line;
+		sk->width = width;
+		sk->outline = stroke_expand(px->memface, ch->outline, palette, line, width);
+	} else {
+		*link = sk->next;
+	}
+	sk->next = ch->strokes;
+	ch->strokes = sk;
+	return sk;
+}
 
 static void
-parser_struct_texture(struct parser *px, struct render *rd, struct bitval *bv, struct state *st) {
-	size_t nfillbits, nlinebits;
-	size_t fill0index, fill1index, lineindex;
-	struct point anchor0;
-	anchor0.x = anchor0.y = 0;
-	fill0index = fill1index = lineindex = 0;
-	READ_NUM_BITS(bv, nfillbits, nlinebits);
-	render_struct_texture(rd);
-	for (;;) {
-		uintreg_t flag = bitval_read_ubits(bv, 6);
-		if (flag == 0) {
-			render_close_stroke(rd);
-			*(st->texture) = render_return_texture(rd);
+parser_use_stroke(struct parser *px, const struct stroke *sk, union color *co) {
+	for (size_t i=0; i<px->nstrokeuse; i++) {
+		if (px->strokeuses[i].stroke == sk && px->strokeuses[i].color == co) {
 			return;
-		} else if ((flag & RecordTypeEdge) == 0) {
-			if ((flag & RecordStateMoveTo)) {
-				size_t n = bitval_read_ubits(bv, 5);
-				anchor0.x = bitval_read_sbits(bv, n);
-				anchor0.y = bitval_read_sbits(bv, n);
-			}
-			if ((flag & RecordStateFillStyle0)) {
-				fill0index = bitval_read_ubits(bv, nfillbits);
-			}
-			if ((flag & RecordStateFillStyle1)) {
-				fill1index = bitval_read_ubits(bv, nfillbits);
-			}
-			if ((flag & RecordStateLineStyle)) {
-				lineindex = bitval_read_ubits(bv, nlinebits);
-			}
-			if ((flag & RecordStateNewStyles)) {
-				parser_struct_palette(px, rd, bv, st);
-				READ_NUM_BITS(bv, nfillbits, nlinebits);
-			}
-			if ((flag & RecordStateFillChange)) {
-				union color *fill0 = state_index_fillcolor(st, fill0index);
-				union color *fill1 = state_index_fillcolor(st, fill1index);
-				render_set_fillcolor(rd, fill0, fill1);
-			}
-			if ((flag & RecordStateLineChange)) {
-				render_close_stroke(rd);
-				union color *co = state_index_linecolor(st, lineindex);
-				if (co != NULL) {
-					// XXX transform linewidth
-					struct style *lo = state_index_linestyle(st, lineindex);
-					render_set_linewidth(rd, lo->width);
-					render_start_stroke(rd, co);
-				}
-			}
-			if ((flag & RecordStatePathChange)) {
-				// Start a new path.
-				render_struct_texture(rd);
-			} else if ((flag & RecordStateMoveTo)) {
-				struct point anchor1 = anchor0;
-				matrix_transform_point(&st->txform->matrix, &anchor1);
-				render_move_to(rd, &anchor1);
-			}
-		} else {
-			struct point anchor1;
-			size_t n = (size_t)((flag & 0x0F) + 2);
-			if ((flag & RecordEdgeLine) == 0) {
-				struct point control;
-				control.x = anchor0.x + bitval_read_sbits(bv, n);
-				control.y = anchor0.y + bitval_read_sbits(bv, n);
-				anchor1.x = anchor1.x + bitval_read_sbits(bv, n);
-				anchor1.y = anchor1.y + bitval_read_sbits(bv, n);
-				anchor0 = anchor1;
-				matrix_transform_point(&st->txform->matrix, &control);
-				matrix_transform_point(&st->txform->matrix, &anchor1);
-				render_curve_to(rd, &control, &anchor1);
-			} else {
-				bool general, vert;
-				if ((general = bitval_read_bit(bv))) {
-					anchor1.x = anchor0.x + bitval_read_sbits(bv, n);
-					anchor1.y = anchor0.y + bitval_read_sbits(bv, n);
-				} else if ((vert = bitval_read_bit(bv))) {
-					anchor1.x = anchor0.x;
-					anchor1.y = anchor0.y + bitval_read_sbits(bv, n);
-				} else {
-					anchor1.x = anchor0.x + bitval_read_sbits(bv, n);
-					anchor1.y = anchor0.y;
+		}
+	}
+	if (px->nstrokeuse == px->strokeusecap) {
+		size_t cap = px->strokeusecap == 0 ? 8 : 2*px->strokeusecap;
+		struct strokeuse *uses = parser_malloc(px, sizeof(*uses)*cap, __FILE__, __LINE__);
+		if (px->strokeuses != NULL) {
+			memcpy(uses, px->strokeuses, sizeof(*uses)*px->nstrokeuse);
+			parser_dealloc(px, px->strokeuses, __FILE__, __LINE__);
+		}
+		px->strokeuses = uses;
+		px->strokeusecap = cap;
+	}
+	px->strokeuses[px->nstrokeuse].stroke = sk;
+	px->strokeuses[px->nstrokeuse].color = co;
+	px->nstrokeuse++;
+}
+
+// Fills of style layer replayed so far go into one texture, strokes of it
+// expanded in shape space into another over them.
+static void
+parser_replay_layer(struct parser *px, struct render *rd, const struct matrix *mx, struct graph *gh) {
+	graph_add_texture(gh, px, render_return_texture(rd));
+	if (px->nstrokeuse == 0) {
+		return;
+	}
+	render_struct_texture(rd);
+	for (size_t i=0; i<px->nstrokeuse; i++) {
+		const struct outline *so = px->strokeuses[i].stroke->outline;
+		render_start_stroke(rd, px->strokeuses[i].color);
+		for (size_t j=0; j<so->nrecord; j++) {
+			parser_replay_edge(rd, &so->records[j], mx);
+		}
+		render_close_stroke(rd);
+	}
+	graph_add_texture(gh, px, render_return_texture(rd));
+	px->nstrokeuse = 0;
+}
+
+// Fills are replayed at transform, style layer by style layer, each
+// followed by its strokes.
+static void
+parser_replay_outline(struct parser *px, struct render *rd, struct character *ch, struct state *st) {
+	const struct outline *ol = parser_shape_outline(px, ch);
+	const struct matrix *mx = &st->txform->matrix;
+	size_t palette = 0;
+	px->nstrokeuse = 0;
+	render_struct_texture(rd);
+	const struct outline_record *rc = ol->records;
+	for (size_t i=0, n=ol->nrecord; i<n; i++, rc++) {
+		if (rc->verb != OutlineVerbStyle) {
+			parser_replay_edge(rd, rc, mx);
+			continue;
+		}
+		uintreg_t flag = rc->u.style.flag;
+		if ((flag & RecordStateNewStyles)) {
+			parser_replay_layer(px, rd, mx, st->graph);
+			bitval_t bv;
+			bitval_copy(bv, &ol->palettes[rc->u.style.palette]);
+			parser_struct_palette(px, rd, bv, st);
+			palette = rc->u.style.palette + 1;
+		}
+		if ((flag & RecordStateFillChange)) {
+			union color *fill0 = state_index_fillcolor(st, rc->u.style.fill0);
+			union color *fill1 = state_index_fillcolor(st, rc->u.style.fill1);
+			render_set_fillcolor(rd, fill0, fill1);
+		}
+		if ((flag & (RecordStateLineStyle|RecordStateNewStyles)) && rc->u.style.line != 0) {
+			union color *co = state_index_linecolor(st, rc->u.style.line);
+			if (co != NULL) {
+				struct style *lo = state_index_linestyle(st, rc->u.style.line);
+				coord_t width = parser_stroke_width(mx, lo->width);
+				if (width != 0) {
+					const struct stroke *sk = parser_shape_stroke(px, ch, palette, rc->u.style.line, width);
+					if (sk->outline != NULL) {
+						parser_use_stroke(px, sk, co);
+					}
 				}
-				anchor0 = anchor1;
-				matrix_transform_point(&st->txform->matrix, &anchor1);
-				render_line_to(rd, &anchor1);
 			}
 		}
+		if ((flag & RecordStatePathChange)) {
+			// Start a new path.
+			render_struct_texture(rd);
+		}
 	}
+	parser_replay_layer(px, rd, mx, st->graph);
 }
 
 static void
@@ -828,26 +2312,261 @@ parser_dealloc_graph(struct parser *px, struct graph *gh) {
 	parser_dealloc(px, gh, __FILE__, __LINE__);
 }
 
+static inline double
+point_cross(const struct point *o, const struct point *a, const struct point *b) {
+	return (double)(a->x - o->x)*(double)(b->y - o->y) - (double)(a->y - o->y)*(double)(b->x - o->x);
+}
+
+// Polygon is convex if it turns one way, and once around, in which its
+// edges go leftward and rightward once each.
+static bool
+polygon_convex(const struct point *pts, size_t n) {
+	double sign = 0;
+	coord_t dx0 = 0;
+	size_t nflip = 0;
+	for (size_t i=0; i<n; i++) {
+		const struct point *a = &pts[i], *b = &pts[(i+1)%n], *c = &pts[(i+2)%n];
+		double cross = point_cross(a, b, c);
+		if (cross != 0) {
+			if (sign*cross < 0) {
+				return false;
+			}
+			sign = cross;
+		}
+		coord_t dx = b->x - a->x;
+		if (dx != 0) {
+			if ((dx < 0) != (dx0 < 0) && dx0 != 0) {
+				nflip++;
+			}
+			dx0 = dx;
+		}
+	}
+	// Flip from last edge to first one is counted from second round.
+	for (size_t i=0; i<n; i++) {
+		coord_t dx = pts[(i+1)%n].x - pts[i].x;
+		if (dx != 0) {
+			if ((dx < 0) != (dx0 < 0)) {
+				nflip++;
+			}
+			break;
+		}
+	}
+	return sign != 0 && nflip <= 2;
+}
+
+static bool
+polygon_inside(const struct point *pts, size_t n, double sign, double x, double y) {
+	for (size_t i=0; i<n; i++) {
+		const struct point *a = &pts[i], *b = &pts[(i+1)%n];
+		double cross = (double)(b->x - a->x)*(y - a->y) - (double)(b->y - a->y)*(x - a->x);
+		if (sign*cross < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Signed area of polygon, doubled. It is positive if polygon goes
+// clockwise, y grows downward.
+static double
+polygon_area(const struct point *pts, size_t n) {
+	double area = 0;
+	for (size_t i=0; i<n; i++) {
+		const struct point *a = &pts[i], *b = &pts[(i+1)%n];
+		area += (double)a->x*(double)b->y - (double)b->x*(double)a->y;
+	}
+	return area;
+}
+
+// Shapes of one closed contour of lines, filled by same fill style on
+// inner side, and turning one way, are convex. Fill style 1 is on right
+// side of edges, which is inner side if contour goes clockwise.
+static struct hull *
+parser_shape_hull(struct parser *px, struct character *ch) {
+	if (ch->hulled) {
+		return ch->hull;
+	}
+	ch->hulled = true;
+	const struct outline *ol = parser_shape_outline(px, ch);
+	size_t fill0 = 0, fill1 = 0, npoint = 0, nmove = 0;
+	const struct outline_record *rc = ol->records;
+	for (size_t i=0; i<ol->nrecord; i++, rc++) {
+		switch (rc->verb) {
+		case OutlineVerbStyle:
+			if ((rc->u.style.flag & RecordStateNewStyles)) {
+				return NULL;
+			}
+			if (npoint != 0 && (rc->u.style.fill0 != fill0 || rc->u.style.fill1 != fill1)) {
+				return NULL;
+			}
+			fill0 = rc->u.style.fill0;
+			fill1 = rc->u.style.fill1;
+			break;
+		case OutlineVerbMove:
+			if (nmove++ != 0 && npoint != 0) {
+				return NULL;
+			}
+			break;
+		case OutlineVerbLine:
+			npoint++;
+			break;
+		default:
+			return NULL;
+		}
+	}
+	if (npoint < 3 || (fill0 == 0) == (fill1 == 0)) {
+		return NULL;
+	}
+	struct hull *hu = parser_malloc(px, sizeof(*hu) + sizeof(struct point)*npoint, __FILE__, __LINE__);
+	hu->fill = fill0 != 0 ? fill0 : fill1;
+	hu->npoint = 0;
+	struct point start = {0, 0};
+	rc = ol->records;
+	for (size_t i=0; i<ol->nrecord; i++, rc++) {
+		if (rc->verb == OutlineVerbMove) {
+			start = rc->u.edge.anchor;
+		} else if (rc->verb == OutlineVerbLine) {
+			hu->points[hu->npoint++] = rc->u.edge.anchor;
+		}
+	}
+	const struct point *last = &hu->points[npoint-1];
+	if (last->x != start.x || last->y != start.y || !polygon_convex(hu->points, npoint) || (polygon_area(hu->points, npoint) > 0) != (fill1 != 0)) {
+		parser_dealloc(px, hu, __FILE__, __LINE__);
+		return NULL;
+	}
+	ch->hull = hu;
+	return hu;
+}
+
+// Largest box around center of hull, scaled from its bounds, is inside
+// transformed hull, as its corners are.
+static void
+parser_hull_opaque(struct parser *px, const struct hull *hu, const struct matrix *mx, struct rectangle *rt) {
+	struct point buf[32];
+	struct point *pts = buf;
+	size_t n = hu->npoint;
+	if (n > sizeof(buf)/sizeof(buf[0])) {
+		pts = parser_malloc(px, sizeof(struct point)*n, __FILE__, __LINE__);
+	}
+	assert(n >= 3);
+	pts[0] = hu->points[0];
+	matrix_transform_point(mx, &pts[0]);
+	double cx = pts[0].x, cy = pts[0].y;
+	struct rectangle bounds = {pts[0].x, pts[0].x, pts[0].y, pts[0].y};
+	for (size_t i=1; i<n; i++) {
+		pts[i] = hu->points[i];
+		matrix_transform_point(mx, &pts[i]);
+		cx += pts[i].x;
+		cy += pts[i].y;
+		bounds.xmin = pts[i].x < bounds.xmin ? pts[i].x : bounds.xmin;
+		bounds.xmax = pts[i].x > bounds.xmax ? pts[i].x : bounds.xmax;
+		bounds.ymin = pts[i].y < bounds.ymin ? pts[i].y : bounds.ymin;
+		bounds.ymax = pts[i].y > bounds.ymax ? pts[i].y : bounds.ymax;
+	}
+	cx /= (double)n;
+	cy /= (double)n;
+	double sign = 0;
+	for (size_t i=0; i<n && sign == 0; i++) {
+		sign = point_cross(&pts[i], &pts[(i+1)%n], &pts[(i+2)%n]);
+	}
+	double lo = 0, hi = 1;
+	for (int k=0; k<16; k++) {
+		double s = (lo + hi)/2;
+		double x0 = cx + s*(bounds.xmin - cx), x1 = cx + s*(bounds.xmax - cx);
+		double y0 = cy + s*(bounds.ymin - cy), y1 = cy + s*(bounds.ymax - cy);
+		if (polygon_inside(pts, n, sign, x0, y0) && polygon_inside(pts, n, sign, x1, y0)
+		    && polygon_inside(pts, n, sign, x0, y1) && polygon_inside(pts, n, sign, x1, y1)) {
+			lo = s;
+		} else {
+			hi = s;
+		}
+	}
+	rt->xmin = (coord_t)ceil(cx + lo*(bounds.xmin - cx));
+	rt->xmax = (coord_t)floor(cx + lo*(bounds.xmax - cx));
+	rt->ymin = (coord_t)ceil(cy + lo*(bounds.ymin - cy));
+	rt->ymax = (coord_t)floor(cy + lo*(bounds.ymax - cy));
+	if (pts != buf) {
+		parser_dealloc(px, pts, __FILE__, __LINE__);
+	}
+}
+
+// Bounds of shape in target, grown by strokes widened to one pixel.
+static void
+parser_graph_bounds(const struct character *ch, const struct matrix *mx, struct rectangle *rt) {
+	*rt = *(const struct rectangle *)ch->udef;
+	matrix_transform_rectangle(mx, rt);
+	coord_t pad = 20 + (coord_t)ceil(parser_matrix_scale(mx));
+	rt->xmin -= pad;
+	rt->xmax += pad;
+	rt->ymin -= pad;
+	rt->ymax += pad;
+}
+
+// Textures of graph translated are same as ones built at mx.
+static bool
+parser_graph_translatable(const struct graph *gh, const struct matrix *mx) {
+	const struct matrix *old = &gh->matrix;
+	return old->sx == mx->sx && old->sy == mx->sy && old->shx == mx->shx && old->shy == mx->shy;
+}
+
+// Colors of new styles are changed to transform, as if outline is replayed.
+static void
+parser_change_palettes(struct parser *px, struct render *rd, const struct outline *ol, struct state *st) {
+	for (size_t i=0; i<ol->npalette; i++) {
+		bitval_t bv;
+		bitval_copy(bv, &ol->palettes[i]);
+		parser_struct_palette(px, rd, bv, st);
+	}
+}
+
+// Outline of shape is decoded once and replayed at transforms. Objects
+// moved without scaling, rotating or skewing, which is most of tweens,
+// only move edges built at last transform.
 static struct graph *
 parser_struct_graph(struct parser *px, struct stream *stm, struct render *rd, const struct transform *tsm, uintptr_t chptr, struct graph *in) {
 	(void)stm;
 	struct graph gh;
 	struct state st;
-	const struct character *ch = (void *)chptr;
+	struct character *ch = (void *)chptr;
+	struct rectangle bounds;
+	parser_graph_bounds(ch, &tsm->matrix, &bounds);
+	bool translated = in != NULL && parser_graph_translatable(in, &tsm->matrix);
 	if (in == NULL) {
 		graph_init(&gh);
 		state_init_struct(&st, &gh, tsm, ch->tag);
 		in = parser_malloc_graph(px);
 	} else {
 		gh = *in;
-		render_delete_texture(rd, gh.texture);
-		gh.texture = NULL;
 		state_init_change(&st, &gh, tsm, ch->tag);
 	}
 	bitval_t bv;
 	bitval_init_read(bv, (byte_t*)ch->data, (size_t)-1);
 	parser_struct_palette(px, rd, bv, &st);
-	parser_struct_texture(px, rd, bv, &st);
+	if (translated) {
+		coord_t dx = tsm->matrix.tx - gh.matrix.tx;
+		coord_t dy = tsm->matrix.ty - gh.matrix.ty;
+		if (dx != 0 || dy != 0) {
+			for (size_t i=0; i<gh.ntexture; i++) {
+				render_translate_texture(rd, gh.textures[i], dx, dy);
+			}
+		}
+		parser_change_palettes(px, rd, parser_shape_outline(px, ch), &st);
+	} else {
+		graph_delete_textures(&gh, rd);
+		parser_replay_outline(px, rd, ch, &st);
+	}
+	gh.matrix = tsm->matrix;
+	gh.bounds = bounds;
+	gh.opaque = (struct rectangle){0, 0, 0, 0};
+	const struct hull *hu = parser_shape_hull(px, ch);
+	if (hu != NULL && hu->fill < gh.fillset->ncolor) {
+		// Fill of hull is in first palette.
+		st.fillptr = &gh.fillset->next;
+		const union color *co = state_index_fillcolor(&st, hu->fill);
+		if (co != NULL && !render_color_transparent(rd, co)) {
+			parser_hull_opaque(px, hu, &tsm->matrix, &gh.opaque);
+		}
+	}
 	*in = gh;
 	return in;
 }
@@ -866,10 +2585,25 @@ parser_change_graph(struct parser *px, struct stream *stm, struct render *rd, co
 	return gh;
 }
 
+static void
+parser_bound_graph(struct parser *px, struct stream *stm, const struct transform *tsm, uintptr_t chptr, struct rectangle *rt) {
+	(void)px; (void)stm;
+	parser_graph_bounds((const struct character *)chptr, &tsm->matrix, rt);
+}
+
+static bool
+parser_opaque_graph(struct parser *px, struct stream *stm, struct graph *gh, struct rectangle *rt) {
+	(void)px; (void)stm;
+	*rt = gh->opaque;
+	return rt->xmin < rt->xmax && rt->ymin < rt->ymax;
+}
+
 static void
 parser_render_graph(struct parser *px, struct stream *stm, struct render *rd, struct graph *gh) {
 	(void)px; (void)stm;
-	render_commit_texture(rd, gh->texture);
+	for (size_t i=0; i<gh->ntexture; i++) {
+		render_commit_texture(rd, gh->textures[i]);
+	}
 }
 
 static void
@@ -879,8 +2613,61 @@ parser_delete_graph(struct parser *px, struct stream *stm, struct render *rd, st
 	parser_dealloc_graph(px, gh);
 }
 
+static const struct taghandler TagHandlers[SWFTAG_NCODE] = {
+	[SwftagDefineShape]	= {DefineShape, 0},
+	[SwftagDefineShape2]	= {DefineShape, 0},
+	[SwftagDefineShape3]	= {DefineShape, 0},
+	[SwftagDefineSprite]	= {DefineSprite, 0},
+	[SwftagPlaceObject]	= {PlaceObject, 1},
+	[SwftagPlaceObject2]	= {PlaceObject2, 1},
+	[SwftagPlaceObject3]	= {PlaceObject3, 1},
+	[SwftagRemoveObject]	= {RemoveObject, 1},
+	[SwftagRemoveObject2]	= {RemoveObject2, 1},
+};
+
+static const struct tagstat *
+parser_tag_stats(struct parser *px) {
+	return px->tagstats;
+}
+
+static bool
+parser_set_cache(struct parser *px, const char *dir) {
+	if (px->cachedir != NULL) {
+		parser_dealloc(px, px->cachedir, __FILE__, __LINE__);
+		px->cachedir = NULL;
+	}
+	if (dir != NULL) {
+		size_t len = strlen(dir);
+		px->cachedir = parser_malloc(px, len+1, __FILE__, __LINE__);
+		memcpy(px->cachedir, dir, len+1);
+	}
+	return true;
+}
+
+static bool
+parser_set_lookahead(struct parser *px, size_t nframe) {
+	if (nframe == 0) {
+		if (px->lookahead != NULL) {
+			lookahead_delete(px->lookahead);
+			px->lookahead = NULL;
+		}
+	} else if (px->lookahead == NULL) {
+		px->lookahead = lookahead_create(px->memface);
+		if (px->lookahead == NULL) {
+			return false;
+		}
+	}
+	px->lookahead_nframe = nframe;
+	return true;
+}
+
 void
 parser_delete_default(struct parser *px) {
+	parser_set_lookahead(px, 0);
+	parser_set_cache(px, NULL);
+	if (px->strokeuses != NULL) {
+		parser_dealloc(px, px->strokeuses, __FILE__, __LINE__);
+	}
 	parser_dealloc(px, px, __FILE__, __LINE__);
 }
 
@@ -891,16 +2678,31 @@ parser_create_default(struct memface *mem, struct logface *log, struct errface *
 	px->interface.progress_frame = parser_progress_frame;
 	px->interface.struct_graph = parser_struct_graph;
 	px->interface.change_graph = parser_change_graph;
+	px->interface.bound_graph = parser_bound_graph;
+	px->interface.opaque_graph = parser_opaque_graph;
 	px->interface.render_graph = parser_render_graph;
 	px->interface.delete_graph = parser_delete_graph;
 	px->interface.struct_stream = parser_struct_stream;
 	px->interface.finish_stream = parser_finish_stream;
+	px->interface.feed_stream = parser_feed_stream;
 	px->interface.struct_sprite = parser_struct_sprite;
+	px->interface.tag_stats = parser_tag_stats;
+	px->interface.set_lookahead = parser_set_lookahead;
+	px->interface.set_cache = parser_set_cache;
 	px->interface.delete_parser = parser_delete_default;
+	memcpy(px->tags, TagHandlers, sizeof(px->tags));
+	memset(px->tagstats, 0, sizeof(px->tagstats));
 	px->memctx = mem->ctx;
 	px->malloc = mem->alloc;
 	px->zalloc = mem->zalloc;
 	px->dealloc = mem->dealloc;
-	(void)log; (void)err;
+	px->memface = mem;
+	px->errface = err;
+	px->lookahead = NULL;
+	px->lookahead_nframe = 0;
+	px->cachedir = NULL;
+	px->strokeuses = NULL;
+	px->nstrokeuse = px->strokeusecap = 0;
+	(void)log;
 	return &px->interface;
 }
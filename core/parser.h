@@ -3,12 +3,14 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 struct sprite;
 struct stream;
 struct render;
 struct parser;
 struct transform;
+struct rectangle;
 struct sprite_define;
 struct stream_define;
 struct graph;
@@ -16,6 +18,14 @@ struct memface;
 struct logface;
 struct errface;
 
+// Tags met by parser, counted when frames containing them are first played.
+// Frames restored from stream cache are not read, their tags are not
+// counted.
+struct tagstat {
+	size_t count;
+	size_t bytes;
+};
+
 struct pxface {
 	struct parser *parser;
 
@@ -24,12 +34,35 @@ struct pxface {
 	struct graph * (*struct_graph)(struct parser *px, struct stream *stm, struct render *rd, const struct transform *tsm, uintptr_t chptr, struct graph *gh);
 	struct graph * (*change_graph)(struct parser *px, struct stream *stm, struct render *rd, const struct transform *tsm, uintptr_t chptr, struct graph *gh);
 
+	// Bounds of shape chptr drawn at tsm in twips of target, strokes
+	// included.
+	void (*bound_graph)(struct parser *px, struct stream *stm, const struct transform *tsm, uintptr_t chptr, struct rectangle *rt);
+	// Rectangle wholly covered by opaque fill of graph in twips of target.
+	// Return false if there is none.
+	bool (*opaque_graph)(struct parser *px, struct stream *stm, struct graph *gh, struct rectangle *rt);
+
 	void (*render_graph)(struct parser *px, struct stream *stm, struct render *rd, struct graph *gh);
 	void (*delete_graph)(struct parser *px, struct stream *stm, struct render *rd, struct graph *gh);
 
 	void (*struct_sprite)(struct parser *px, struct stream *stm, uintptr_t chptr, struct sprite_define *inf);
-	void (*struct_stream)(struct parser *px, struct stream *stm, const void *ud, struct stream_define *inf);
+	// Return false if ud can't be loaded as a stream.
+	bool (*struct_stream)(struct parser *px, struct stream *stm, const void *ud, struct stream_define *inf);
 	void (*finish_stream)(struct parser *px, struct stream *stm);
+	// Append bytes to StreamFeed stream, inf is filled once stream header
+	// is available. Return false if bytes can't be loaded.
+	bool (*feed_stream)(struct parser *px, struct stream *stm, const void *data, size_t size, struct stream_define *inf);
+	// Statistics indexed by tag code, SWFTAG_NCODE entries.
+	const struct tagstat * (*tag_stats)(struct parser *px);
+	// Decode shapes defined in nframe frames after compiled frames in a
+	// worker thread, memface must be thread safe then. Zero nframe, the
+	// default, stops worker.
+	// Return false if worker can't be started.
+	bool (*set_lookahead)(struct parser *px, size_t nframe);
+	// Cache parsed streams in directory dir, which must exist. Streams
+	// created later with same content restore frame index, characters,
+	// decoded outlines and compiled frames from cache. NULL dir, the
+	// default, disables caching. Only StreamFile streams are cached.
+	bool (*set_cache)(struct parser *px, const char *dir);
 	void (*delete_parser)(struct parser *px);
 };
 
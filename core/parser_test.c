@@ -0,0 +1,469 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "bench.h"
+// Loading of streams is private to parser, test it in place.
+#include "parser.c"
+#include "player.h"
+#include "muplex.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NFRAME		8
+// Frames of movies larger than a chunk decompressed at once.
+#define NFRAME_LARGE	12000
+
+// Polygon placed in first frame and moved in every frame.
+static void
+parser_test_movie(struct swfgen *sg, size_t nframe) {
+	static const intreg_t pts[] = {0, 0, 400, 0, 400, 300, 0, 300};
+	swfgen_init(sg, 550*20, 400*20, nframe);
+	swfgen_polygon(sg, 1, pts, 4, 0xFF0000);
+	for (size_t i=0; i<nframe; i++) {
+		swfgen_place(sg, i == 0 ? 1 : 0, 1, (intreg_t)i*20, 0);
+		swfgen_show(sg);
+	}
+	swfgen_finish(sg);
+}
+
+static struct stream *
+parser_test_open(struct pxface *pf, const void *ud, enum stream_type type, struct stream_define *def) {
+	struct stream *stm = malloc(sizeof(*stm));
+	stm->type = type;
+	stm->pxface = pf;
+	if (!pf->struct_stream(pf->parser, stm, ud, def)) {
+		free(stm);
+		return NULL;
+	}
+	return stm;
+}
+
+static void
+parser_test_close(struct pxface *pf, struct stream *stm) {
+	pf->finish_stream(pf->parser, stm);
+	free(stm);
+}
+
+static void
+parser_test_write(const char *path, const byte_t *data, size_t size) {
+	FILE *fp = fopen(path, "wb");			assert(fp != NULL);
+	size_t n = fwrite(data, 1, size, fp);		assert(n == size);
+	(void)n;
+	fclose(fp);
+}
+
+// Mapped file shorter than length in its header is rejected, file with
+// bytes after End tag is loaded whole.
+static void
+parser_test_mapped(const char *path) {
+	printf("parser_test_mapped(), start.\n");
+	struct pxface *pf = parser_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct swfgen sg;
+	parser_test_movie(&sg, NFRAME);
+	struct stream_define def;
+
+	parser_test_write(path, sg.buf, sg.len);
+	struct stream *stm = parser_test_open(pf, path, StreamFile, &def);	assert(stm != NULL);
+	assert(def.nframe == NFRAME);
+	assert(stm->loading.nframe == NFRAME);
+	parser_test_close(pf, stm);
+
+	parser_test_write(path, sg.buf, sg.len/2);
+	stm = parser_test_open(pf, path, StreamFile, &def);	assert(stm == NULL);
+	parser_test_write(path, sg.buf, sg.len-1);
+	stm = parser_test_open(pf, path, StreamFile, &def);	assert(stm == NULL);
+
+	byte_t *padded = malloc(sg.len + 100);
+	memcpy(padded, sg.buf, sg.len);
+	memset(padded + sg.len, 0xFF, 100);
+	parser_test_write(path, padded, sg.len + 100);
+	stm = parser_test_open(pf, path, StreamFile, &def);	assert(stm != NULL);
+	assert(stm->loading.nframe == NFRAME);
+	assert(stm->loading.frameend == stm->resource + sg.len);
+	parser_test_close(pf, stm);
+	free(padded);
+
+	remove(path);
+	swfgen_free(&sg);
+	pf->delete_parser(pf->parser);
+	printf("parser_test_mapped(), done.\n");
+}
+
+// Compressed stream is decompressed chunk by chunk as frames are required,
+// into same bytes and frame index as uncompressed one.
+static void
+parser_test_decode(struct pxface *pf, const byte_t *data, const struct swfgen *sg) {
+	struct stream_define plain, def;
+	struct stream *fws = parser_test_open(pf, sg->buf, StreamData, &plain);	assert(fws != NULL);
+	struct stream *stm = parser_test_open(pf, data, StreamData, &def);	assert(stm != NULL);
+	assert(stm->loading.inflow != NULL);
+	assert(stm->ressize == sg->len);
+	assert(stm->loading.nbyte < stm->ressize);
+	assert(stm->loading.nframe < NFRAME_LARGE);
+	assert(def.nframe == plain.nframe);
+	assert(def.tagbeg - stm->resource == plain.tagbeg - fws->resource);
+
+	size_t nframe = stm->loading.nframe;
+	while (parser_inflate_stream(pf->parser, stm)) {
+		assert(stm->loading.nframe >= nframe);
+		nframe = stm->loading.nframe;
+	}
+	assert(stm->loading.nbyte == stm->ressize);
+	assert(stm->loading.nframe == NFRAME_LARGE);
+	assert(memcmp((byte_t *)stm->resource + 8, sg->buf + 8, sg->len - 8) == 0);
+	assert(memcmp(stm->loading.frames, fws->loading.frames, sizeof(uint32_t)*(NFRAME_LARGE+1)) == 0);
+	assert(stm->loading.frameend - stm->resource == fws->loading.frameend - fws->resource);
+	parser_test_close(pf, stm);
+	parser_test_close(pf, fws);
+}
+
+static void
+parser_test_compressed(void) {
+	printf("parser_test_compressed(), start.\n");
+	struct pxface *pf = parser_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct swfgen sg;
+	parser_test_movie(&sg, NFRAME_LARGE);
+	size_t zlen;
+	byte_t *zdata = swfgen_deflate(&sg, &zlen);
+	parser_test_decode(pf, zdata, &sg);
+	size_t lzlen;
+	byte_t *lzdata = swfgen_lzma(&sg, &lzlen);
+	parser_test_decode(pf, lzdata, &sg);
+	free(lzdata);
+
+	free(zdata);
+	swfgen_free(&sg);
+	pf->delete_parser(pf->parser);
+	printf("parser_test_compressed(), done.\n");
+}
+
+// Feed data to StreamFeed stream in chunks of chunk bytes. Frames become
+// available only once all their tags are fed, frame index is same as the
+// one of uncompressed stream.
+static void
+parser_test_feed_chunks(struct pxface *pf, const byte_t *data, size_t len, size_t chunk, const struct stream *fws) {
+	struct stream_define def;
+	struct stream *stm = parser_test_open(pf, NULL, StreamFeed, &def);	assert(stm != NULL);
+	def.tagbeg = 0;
+	size_t nframe = 0;
+	for (size_t off=0; off<len; off+=chunk) {
+		size_t n = len-off < chunk ? len-off : chunk;
+		bool ok = pf->feed_stream(pf->parser, stm, data+off, n, &def);	assert(ok);
+		(void)ok;
+		const struct loading *ld = &stm->loading;
+		assert(ld->nframe >= nframe);
+		nframe = ld->nframe;
+		if (nframe != 0) {
+			assert(def.tagbeg != 0);
+			assert(ld->frameend <= stm->resource + ld->nbyte);
+			// End tag ends last frame.
+			assert(nframe == fws->loading.nframe || ld->frameend - ld->tagbeg == fws->loading.frames[nframe]);
+		}
+	}
+	assert(stm->loading.nbyte == fws->ressize);
+	assert(stm->loading.nframe == fws->loading.nframe);
+	assert(stm->loading.frameend - stm->resource == fws->loading.frameend - fws->resource);
+	assert(memcmp((byte_t *)stm->resource + 8, (byte_t *)fws->resource + 8, fws->ressize - 8) == 0);
+	parser_test_close(pf, stm);
+}
+
+// Hashes of pixels of every frame of player, reached by seeking.
+static void
+parser_test_render(struct player *pl, size_t nframe, uint64_t *hashes) {
+	struct bufctx bx;
+	bx.width = bx.stride = 550;
+	bx.height = 400;
+	bx.pixels = malloc(sizeof(struct rgba8)*550*400);
+	struct transform tsm;
+	matrix_identify(&tsm.matrix);
+	cxform_identify(&tsm.cxform);
+	for (size_t i=0; i<nframe; i++) {
+		player_goto_frame(pl, (intreg_t)i);
+		struct rectangle rt = {0, 550, 0, 400};
+		player_render(pl, tsm, &bx, &rt);
+		hashes[i] = hash_bytes(bx.pixels, sizeof(struct rgba8)*550*400);
+	}
+	free(bx.pixels);
+}
+
+// Movie fed to player in chunks plays same frames as one loaded whole.
+static void
+parser_test_feed_player(const struct swfgen *sg) {
+	uint64_t whole[NFRAME], fed[NFRAME];
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, sg->buf, StreamData);
+	parser_test_render(pl, NFRAME, whole);
+	player_delete(pl);
+
+	pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, NULL, StreamFeed);
+	for (size_t off=0; off<sg->len; off+=5) {
+		size_t n = sg->len-off < 5 ? sg->len-off : 5;
+		bool ok = player_feed(pl, sg->buf+off, n);	assert(ok);
+		(void)ok;
+		player_advance(pl);
+	}
+	parser_test_render(pl, NFRAME, fed);
+	player_delete(pl);
+	mux->delete_muplex(mux->muplex);
+	assert(memcmp(whole, fed, sizeof(whole)) == 0);
+	for (size_t i=1; i<NFRAME; i++) {
+		assert(whole[i] != whole[i-1]);
+	}
+}
+
+static void
+parser_test_feed(void) {
+	printf("parser_test_feed(), start.\n");
+	struct pxface *pf = parser_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct swfgen sg;
+	parser_test_movie(&sg, NFRAME_LARGE);
+	struct stream_define def;
+	struct stream *fws = parser_test_open(pf, sg.buf, StreamData, &def);	assert(fws != NULL);
+	size_t zlen, lzlen;
+	byte_t *zdata = swfgen_deflate(&sg, &zlen);
+	byte_t *lzdata = swfgen_lzma(&sg, &lzlen);
+	static const size_t Chunks[] = {1, 7, 4096, 100000};
+	for (size_t i=0; i<sizeof(Chunks)/sizeof(Chunks[0]); i++) {
+		parser_test_feed_chunks(pf, sg.buf, sg.len, Chunks[i], fws);
+		parser_test_feed_chunks(pf, zdata, zlen, Chunks[i], fws);
+		parser_test_feed_chunks(pf, lzdata, lzlen, Chunks[i], fws);
+	}
+	free(lzdata);
+	free(zdata);
+	parser_test_close(pf, fws);
+	swfgen_free(&sg);
+
+	// Bad signature is refused.
+	struct stream *stm = parser_test_open(pf, NULL, StreamFeed, &def);	assert(stm != NULL);
+	bool ok = pf->feed_stream(pf->parser, stm, "XWS", 3, &def);		assert(!ok);
+	(void)ok;
+	parser_test_close(pf, stm);
+	pf->delete_parser(pf->parser);
+
+	parser_test_movie(&sg, NFRAME);
+	parser_test_feed_player(&sg);
+	swfgen_free(&sg);
+	printf("parser_test_feed(), done.\n");
+}
+
+// Frames of main timeline and sprites are indexed by positions their
+// ShowFrame tags end at, relative to their first tags.
+static void
+parser_test_index(void) {
+	printf("parser_test_index(), start.\n");
+	static const intreg_t pts[] = {0, 0, 400, 0, 400, 300, 0, 300};
+	uint32_t ends[NFRAME+1], sprite[4];
+	struct swfgen sg;
+	swfgen_init(&sg, 550*20, 400*20, NFRAME);
+	size_t tagbeg = sg.len;
+	ends[0] = 0;
+	swfgen_polygon(&sg, 1, pts, 4, 0xFF0000);
+	// Sprite claims one frame more than it has.
+	size_t spritepos = sg.len;
+	size_t lenpos = swfgen_begin_sprite(&sg, 2, 4);
+	size_t spritebeg = sg.len;
+	sprite[0] = 0;
+	for (size_t i=1; i<=3; i++) {
+		swfgen_place(&sg, i == 1 ? 1 : 0, 1, (intreg_t)i*40, 0);
+		swfgen_show(&sg);
+		sprite[i] = (uint32_t)(sg.len - spritebeg);
+	}
+	swfgen_end_sprite(&sg, lenpos);
+	for (size_t i=1; i<=NFRAME; i++) {
+		swfgen_place(&sg, i == 1 ? 2 : 0, 1, (intreg_t)i*20, 0);
+		swfgen_show(&sg);
+		ends[i] = (uint32_t)(sg.len - tagbeg);
+	}
+	swfgen_finish(&sg);
+
+	struct pxface *pf = parser_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct stream_define def;
+	struct stream *stm = parser_test_open(pf, sg.buf, StreamData, &def);	assert(stm != NULL);
+	assert(def.tagbeg == stm->resource + tagbeg);
+	assert(def.nframe == NFRAME);
+	assert(stm->loading.nframe == NFRAME);
+	assert(memcmp(def.frames, ends, sizeof(ends)) == 0);
+	assert(stm->loading.frameend == stm->resource + sg.len);
+
+	assert(read_uint16(sg.buf + spritepos) >> 6 == SwftagDefineSprite);
+	const byte_t *pos = sg.buf + spritepos + 6;
+	size_t len = (size_t)read_uint32(sg.buf + spritepos + 2);
+	DefineSprite(stm, SwftagDefineSprite, pos, len, NULL);
+	struct sprite_define sd;
+	pf->struct_sprite(pf->parser, stm, (uintptr_t)dictionary_get_char(stm->dictionary, 2), &sd);
+	assert(sd.nframe == 4);
+	assert(sd.tagbeg == (uintptr_t)(pos + 4));
+	assert(memcmp(sd.frames, sprite, sizeof(sprite)) == 0);
+	// Missing frame starts at end of sprite.
+	assert(sd.frames[4] == len - 4);
+	parser_test_close(pf, stm);
+	pf->delete_parser(pf->parser);
+	swfgen_free(&sg);
+	printf("parser_test_index(), done.\n");
+}
+
+// Frame ended by End tag instead of ShowFrame moves to End tag once its ops
+// are applied, frame starting at End tag holds timeline without ops.
+static void
+parser_test_end(void) {
+	printf("parser_test_end(), start.\n");
+	static const intreg_t pts[] = {0, 0, 400, 0, 400, 300, 0, 300};
+	struct swfgen sg;
+	swfgen_init(&sg, 550*20, 400*20, 3);
+	swfgen_polygon(&sg, 1, pts, 4, 0xFF0000);
+	swfgen_place(&sg, 1, 1, 0, 0);
+	swfgen_show(&sg);
+	size_t second = sg.len;
+	swfgen_place(&sg, 0, 1, 20, 0);
+	swfgen_remove(&sg, 1);
+	size_t end = sg.len;
+	swfgen_finish(&sg);
+
+	struct pxface *pf = parser_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct parser *px = pf->parser;
+	struct stream_define def;
+	struct stream *stm = parser_test_open(pf, sg.buf, StreamData, &def);	assert(stm != NULL);
+	assert(stm->loading.nframe == 1);
+	assert(stm->loading.frameend == stm->resource + sg.len);
+
+	struct frame_code *fc = parser_compile_frame(px, stm, def.tagbeg);
+	assert(fc->nop == 1);
+	assert(fc->endpos == stm->resource + second);
+	fc = parser_compile_frame(px, stm, fc->endpos);
+	assert(fc->nop == 2);
+	assert(fc->ops[0].code == FrameOpPlace);
+	assert(fc->ops[1].code == FrameOpRemove);
+	assert(fc->endpos == stm->resource + end);
+	fc = parser_compile_frame(px, stm, fc->endpos);
+	assert(fc->nop == 0);
+	assert(fc->endpos == fc->tagpos);
+	assert(codebook_search(stm->codebook, fc->tagpos) == fc);
+	assert(pf->progress_frame(px, stm, NULL, fc->tagpos) == fc->tagpos);
+	assert(stm->codebook->ncode == 3);
+
+	parser_test_close(pf, stm);
+	pf->delete_parser(px);
+	swfgen_free(&sg);
+	printf("parser_test_end(), done.\n");
+}
+
+// Characters are found by id in pages of dictionary. Redefined character
+// shadows old one in tag order, old one is kept for objects referencing it.
+static void
+parser_test_dictionary(void) {
+	printf("parser_test_dictionary(), start.\n");
+	static const intreg_t pts[] = {0, 0, 400, 0, 400, 300, 0, 300};
+	static const uintreg_t Ids[] = {0, 1, 255, 256, 4097, 0xFFFF};
+	struct swfgen sg;
+	size_t nid = sizeof(Ids)/sizeof(Ids[0]);
+	swfgen_init(&sg, 550*20, 400*20, 2);
+	// Definition tags of characters span [tags[i], tags[i+1]).
+	size_t tags[sizeof(Ids)/sizeof(Ids[0])+2];
+	for (size_t i=0; i<nid; i++) {
+		tags[i] = sg.len;
+		swfgen_polygon(&sg, Ids[i], pts, 4, 0xFF0000);
+	}
+	tags[nid] = sg.len;
+	swfgen_show(&sg);
+	size_t second = sg.len;
+	swfgen_polygon(&sg, 256, pts, 3, 0x0000FF);
+	tags[nid+1] = sg.len;
+	swfgen_show(&sg);
+	swfgen_finish(&sg);
+
+	struct pxface *pf = parser_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct parser *px = pf->parser;
+	struct stream_define def;
+	struct stream *stm = parser_test_open(pf, sg.buf, StreamData, &def);	assert(stm != NULL);
+	struct dictionary *dc = stm->dictionary;
+	struct frame_code *fc = parser_compile_frame(px, stm, def.tagbeg);
+	assert(dc->nchar == nid);
+	for (size_t i=0; i<nid; i++) {
+		struct character *ch = dictionary_search_char(dc, Ids[i]);
+		assert(ch != NULL && ch->id == Ids[i] && ch->next == NULL);
+		assert(ch->tag == SwftagDefineShape);
+		assert(ch->data > stm->resource + tags[i] && ch->data < stm->resource + tags[i+1]);
+		assert(dictionary_search_char(dc, Ids[i] ^ 2) == NULL);
+	}
+	size_t npage = 0;
+	for (size_t i=0; i<DICT_NPAGE; i++) {
+		npage += dc->pages[i] != NULL;
+	}
+	assert(npage == 4);
+
+	struct character *old = dictionary_search_char(dc, 256);
+	parser_compile_frame(px, stm, fc->endpos);
+	assert(dc->nchar == nid+1);
+	struct character *ch = dictionary_get_char(dc, 256);
+	assert(ch != old && ch->next == old);
+	assert(ch->data > stm->resource + second && ch->data < stm->resource + tags[nid+1]);
+	uintreg_t type;
+	assert(dictionary_get_mark(dc, 256, &type) == (uintptr_t)ch);
+	assert(type == CharacterShape);
+
+	parser_test_close(pf, stm);
+	pf->delete_parser(px);
+	swfgen_free(&sg);
+	printf("parser_test_dictionary(), done.\n");
+}
+
+// Tags without handler are skipped by their length, all tags of compiled
+// frames are counted.
+static void
+parser_test_skip(void) {
+	printf("parser_test_skip(), start.\n");
+	static const intreg_t pts[] = {0, 0, 400, 0, 400, 300, 0, 300};
+	static const byte_t label[] = "first";
+	byte_t action[100];
+	memset(action, 0, sizeof(action));
+	struct swfgen sg;
+	swfgen_init(&sg, 550*20, 400*20, 1);
+	swfgen_tag(&sg, SwftagSetBackgroundColor, "\xFF\xFF\xFF", 3);
+	swfgen_tag(&sg, SwftagFrameLabel, label, sizeof(label));
+	swfgen_polygon(&sg, 1, pts, 4, 0xFF0000);
+	swfgen_tag(&sg, SwftagDoAction, action, sizeof(action));
+	swfgen_place(&sg, 1, 1, 0, 0);
+	swfgen_tag(&sg, (enum swftag)1000, action, 10);
+	swfgen_show(&sg);
+	swfgen_finish(&sg);
+
+	struct pxface *pf = parser_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct parser *px = pf->parser;
+	struct stream_define def;
+	struct stream *stm = parser_test_open(pf, sg.buf, StreamData, &def);	assert(stm != NULL);
+	struct frame_code *fc = parser_compile_frame(px, stm, def.tagbeg);
+	assert(fc->nop == 1 && fc->ops[0].code == FrameOpPlace);
+	assert(fc->endpos == stm->resource + sg.len - 2);
+	assert(dictionary_search_char(stm->dictionary, 1) != NULL);
+	const struct tagstat *ts = pf->tag_stats(px);
+	assert(ts[SwftagDoAction].count == 1 && ts[SwftagDoAction].bytes == sizeof(action));
+	assert(ts[SwftagFrameLabel].count == 1 && ts[SwftagFrameLabel].bytes == sizeof(label));
+	assert(ts[1000].count == 1 && ts[1000].bytes == 10);
+	assert(ts[SwftagPlaceObject2].count == 1);
+	assert(ts[SwftagShowFrame].count == 1);
+	parser_test_close(pf, stm);
+	pf->delete_parser(px);
+	swfgen_free(&sg);
+	printf("parser_test_skip(), done.\n");
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	setvbuf(stderr, NULL, _IONBF, 0);
+
+	printf("Test parser, start.\n");
+	parser_test_mapped("parser_test.swf");
+	parser_test_compressed();
+	parser_test_feed();
+	parser_test_index();
+	parser_test_end();
+	parser_test_dictionary();
+	parser_test_skip();
+	printf("Test parser, done.\n");
+	return 0;
+}
@@ -4,6 +4,8 @@
 #include <base/intreg.h>
 #include <base/cxform.h>
 #include <base/matrix.h>
+#include "common.h"
+#include <stdbool.h>
 
 struct transform {
 	struct matrix matrix;
@@ -28,16 +30,61 @@ void player_delete(struct player *pl);
 
 void player_load(struct player *pl, const struct string target, void *stream);
 
+// Load ud as _level0, see muface.create_stream for ud.
+void player_load0(struct player *pl, const void *ud, enum stream_type ut);
+
+// Append data to stream loaded as StreamFeed. Playing holds on the last
+// frame whose tags are all fed.
+// Return false if data is corrupted.
+bool player_feed(struct player *pl, const void *data, size_t size);
+
 void player_advance(struct player *pl);
 
+// Seek main timeline to frame, frames are counted from zero.
+void player_goto_frame(struct player *pl, intreg_t frame);
+
+// Keep display list snapshots of timelines every interval frames, so that
+// seeking backward replays less than interval frames. Snapshots stop being
+// taken once they occupy maxsize bytes. Zero interval, the default,
+// disables snapshots. It must be set before loading.
+void player_set_snapshot(struct player *pl, size_t interval, size_t maxsize);
+size_t player_snapshot_size(const struct player *pl);
+
+// Sprites placed with cacheAsBitmap are drawn into layers, which are
+// reused while they are only moved. Pixels of layers take no more than
+// maxsize bytes, sprites beyond that are drawn shape by shape.
+void player_set_layer_cache(struct player *pl, size_t maxsize);
+size_t player_layer_size(const struct player *pl);
+
 struct bufctx;
 struct rectangle;
+struct region;
 
-// rt is a value-result argument.
+// rt is a value-result argument, in pixels of bx.
 // As input, rt is the minimum region needed to be redrawn.
 // As output, rt is the region needed to be refresh.
+// tsm maps stage to bx in twips, 20 twips per pixel. Redrawn region is
+// cleared to transparent before objects are drawn.
+// Pixels of bx are kept from last frame, only pixels under objects added,
+// changed or removed since then are redrawn, besides rt. All pixels are
+// redrawn if bx or tsm changes.
 void player_render(struct player *pl, struct transform tsm, struct bufctx *bx, struct rectangle *rt);
 
+// Rectangles redrawn by last player_render(), rt is bounds of them.
+const struct region *player_damage(const struct player *pl);
+
+// Rasterize frames in tiles on nthread threads, including caller of
+// player_render(). Memface must be thread safe if nthread is above one.
+// One, the default, rasterizes frames in caller only.
+// Return false if threads can't be started.
+bool player_set_threads(struct player *pl, size_t nthread);
+
+// Select rasterizer engine, RasterEngineScanline by default.
+void player_set_engine(struct player *pl, enum raster_engine engine);
+
+struct render_stat;
+const struct render_stat *player_render_stat(const struct player *pl);
+
 enum place_flag {
 	PlaceFlagMove			= 1 << 0,
 	PlaceFlagHasCharacter		= 1 << 1,
@@ -75,6 +122,8 @@ struct place_info {
 	uintreg_t chardepth;
 	uintreg_t stepratio;
 	struct string moviename;
+	// Value of PlaceFlagHasCacheAsBit, nonzero caches object as bitmap.
+	uintreg_t bitmapcache;
 };
 
 void sprite_place_object(struct sprite *si, const struct place_info *pi);
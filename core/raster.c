@@ -0,0 +1,925 @@
+#include "raster.h"
+#include "shader.h"
+#include "render.h"
+#include "edge.h"
+#include <base/compat.h>
+#include <base/helper.h>
+#include <base/geometry.h>
+#include <base/span.h>
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Twips per pixel.
+#define RASTER_TWIPS		20
+// Coverage of a pixel crossed by a sub-scanline, 256 is full coverage.
+#define RASTER_SAMPLE_COVER	(256/RASTER_NSAMPLE)
+// Sub-pixels per pixel of accumulation engine.
+#define RASTER_ONE		256
+
+// Line in pixel space, alive from sub-scanline sbeg until send. x is 16.16
+// fixed point pixels at current sub-scanline, dx is its step.
+struct segment {
+	int32_t sbeg;
+	int32_t send;
+	// Direction of edge, downward is positive.
+	int32_t winding;
+	int64_t x;
+	int64_t dx;
+	struct active_color *color0;
+	struct active_color *color1;
+};
+
+// Line of accumulation engine in sub-pixels, y0 < y1, crossing pixel rows
+// [ry0, ry1) of clip. sign is direction of edge.
+struct aline {
+	int32_t x0;
+	int32_t y0;
+	int32_t x1;
+	int32_t y1;
+	int32_t ry0;
+	int32_t ry1;
+	int32_t sign;
+	struct active_color *color0;
+	struct active_color *color1;
+};
+
+// Coverage of a color accumulated in current pixel row, dirty in
+// [xmin, xmax). Accumulation engine accumulates cells of pixel x in dy[x+1]
+// and area[x+1] first, cells left of clip fold into dy[cx0].
+struct layer {
+	struct active_color *color;
+	// Index of color in colors of texture, layers are composited in it.
+	size_t rank;
+	uint16_t *cover;
+	int32_t *dy;
+	int32_t *area;
+	int32_t xmin;
+	int32_t xmax;
+};
+
+// Color with nonzero winding at current crossing of sub-scanline.
+struct inside {
+	struct active_color *color;
+	int32_t winding;
+};
+
+struct raster {
+	struct memface *memface;
+	enum raster_engine engine;
+	struct aline *alines;
+	size_t nline;
+	size_t linecap;
+	struct aline **lactives;
+	size_t lactcap;
+	struct segment *segments;
+	size_t nsegment;
+	size_t segcap;
+	struct segment **actives;
+	size_t actcap;
+	// Lines of curve being flattened.
+	struct rasterline *flat;
+	size_t flatcap;
+	// Segments or lines in order of their first row, and their counts by row.
+	void **order;
+	size_t ordcap;
+	size_t *buckets;
+	size_t bucketcap;
+	// Texture being filled.
+	const struct texture *texture;
+	// Colors inside which current sub-scanline walks.
+	struct inside *insides;
+	size_t inscap;
+	struct layer *layers;
+	size_t nlayer;
+	size_t laycap;
+	// Width of cover buffers of layers.
+	size_t width;
+	const struct spanface *span;
+	const struct shaderface *shader;
+	// Gradient pixels of a layer, as wide as cover buffers.
+	struct rgba8 *shade;
+	// Clip in 16.16 fixed point pixels.
+	int64_t xmin;
+	int64_t xmax;
+	struct render_stat stat;
+};
+
+static inline void *
+raster_malloc(struct raster *ra, size_t size) {
+	return ra->memface->alloc(ra->memface->ctx, size, __FILE__, __LINE__);
+}
+
+static inline void
+raster_dealloc(struct raster *ra, void *ptr) {
+	if (ptr != NULL) {
+		ra->memface->dealloc(ra->memface->ctx, ptr, __FILE__, __LINE__);
+	}
+}
+
+// Grow array at *ptr to hold n items of isize bytes, keeping its items.
+static void
+raster_reserve(struct raster *ra, void **ptr, size_t *cap, size_t n, size_t isize) {
+	if (n <= *cap) {
+		return;
+	}
+	size_t ncap = *cap*2 > n ? *cap*2 : n + 16;
+	void *p = raster_malloc(ra, ncap*isize);
+	if (*cap != 0) {
+		memcpy(p, *ptr, *cap*isize);
+	}
+	raster_dealloc(ra, *ptr);
+	*ptr = p;
+	*cap = ncap;
+}
+
+static inline int32_t
+raster_item_key(const void *items, size_t i, size_t isize, size_t koff) {
+	int32_t key;
+	memcpy(&key, (const char *)items + i*isize + koff, sizeof(key));
+	return key;
+}
+
+// Order n items of isize bytes by int32_t key at offset koff into
+// ra->order, by counting sort over keys from smallest to largest. Items
+// of same key keep their order. Edges are sorted once per fill, in time
+// linear to their number and rows they span.
+static void
+raster_bucket_sort(struct raster *ra, void *items, size_t n, size_t isize, size_t koff) {
+	assert(n != 0);
+	int32_t kmin = raster_item_key(items, 0, isize, koff), kmax = kmin;
+	for (size_t i=1; i<n; i++) {
+		int32_t key = raster_item_key(items, i, isize, koff);
+		kmin = key < kmin ? key : kmin;
+		kmax = key > kmax ? key : kmax;
+	}
+	size_t nbucket = (size_t)(kmax - kmin) + 1;
+	raster_reserve(ra, (void **)&ra->order, &ra->ordcap, n, sizeof(void *));
+	raster_reserve(ra, (void **)&ra->buckets, &ra->bucketcap, nbucket, sizeof(size_t));
+	size_t *buckets = ra->buckets;
+	memset(buckets, 0, nbucket*sizeof(size_t));
+	for (size_t i=0; i<n; i++) {
+		buckets[raster_item_key(items, i, isize, koff) - kmin]++;
+	}
+	size_t sum = 0;
+	for (size_t k=0; k<nbucket; k++) {
+		size_t count = buckets[k];
+		buckets[k] = sum;
+		sum += count;
+	}
+	for (size_t i=0; i<n; i++) {
+		ra->order[buckets[raster_item_key(items, i, isize, koff) - kmin]++] = (char *)items + i*isize;
+	}
+}
+
+struct raster *
+raster_create(struct memface *mc) {
+	struct raster *ra = mc->alloc(mc->ctx, sizeof(*ra), __FILE__, __LINE__);
+	memset(ra, 0, sizeof(*ra));
+	ra->memface = mc;
+	ra->span = span_best();
+	ra->shader = shader_best();
+	return ra;
+}
+
+static void
+raster_free_layers(struct raster *ra) {
+	for (size_t i=0; i<ra->laycap; i++) {
+		raster_dealloc(ra, ra->layers[i].cover);
+		raster_dealloc(ra, ra->layers[i].dy);
+		raster_dealloc(ra, ra->layers[i].area);
+		ra->layers[i].cover = NULL;
+		ra->layers[i].dy = NULL;
+		ra->layers[i].area = NULL;
+	}
+	raster_dealloc(ra, ra->shade);
+	ra->shade = NULL;
+}
+
+void
+raster_delete(struct raster *ra) {
+	raster_free_layers(ra);
+	raster_dealloc(ra, ra->layers);
+	raster_dealloc(ra, ra->insides);
+	raster_dealloc(ra, ra->actives);
+	raster_dealloc(ra, ra->segments);
+	raster_dealloc(ra, ra->lactives);
+	raster_dealloc(ra, ra->alines);
+	raster_dealloc(ra, ra->flat);
+	raster_dealloc(ra, ra->order);
+	raster_dealloc(ra, ra->buckets);
+	raster_dealloc(ra, ra);
+}
+
+void
+raster_set_engine(struct raster *ra, enum raster_engine engine) {
+	ra->engine = engine;
+}
+
+const struct render_stat *
+raster_stat(const struct raster *ra) {
+	return &ra->stat;
+}
+
+// First sub-scanline whose center is not above y twips.
+static inline int32_t
+raster_sample_ceil(double y) {
+	return (int32_t)ceil(y*RASTER_NSAMPLE/RASTER_TWIPS - 0.5);
+}
+
+static void
+raster_add_segment(struct raster *ra, const struct rasterline *ln, int32_t smin, int32_t smax) {
+	double x0 = ln->x0, y0 = ln->y0, x1 = ln->x1, y1 = ln->y1;
+	int32_t winding = ln->direction;
+	if (y0 > y1) {
+		double t;
+		t = x0; x0 = x1; x1 = t;
+		t = y0; y0 = y1; y1 = t;
+		winding = -winding;
+	}
+	int32_t sbeg = raster_sample_ceil(y0);
+	int32_t send = raster_sample_ceil(y1);
+	if (sbeg >= send || sbeg >= smax || send <= smin) {
+		return;
+	}
+	raster_reserve(ra, (void **)&ra->segments, &ra->segcap, ra->nsegment+1, sizeof(struct segment));
+	struct segment *sg = &ra->segments[ra->nsegment++];
+	double slope = (x1 - x0)/(y1 - y0);
+	double yc = ((double)sbeg + 0.5)*RASTER_TWIPS/RASTER_NSAMPLE;
+	sg->x = (int64_t)llround((x0 + (yc - y0)*slope)*65536.0/RASTER_TWIPS);
+	sg->dx = (int64_t)llround(slope*65536.0/RASTER_NSAMPLE);
+	// Clipped segment steps to its first sub-scanline, so it crosses same x
+	// whatever clip is.
+	if (sbeg < smin) {
+		sg->x += (int64_t)(smin - sbeg)*sg->dx;
+		sbeg = smin;
+	}
+	sg->sbeg = sbeg;
+	sg->send = send > smax ? smax : send;
+	sg->winding = winding;
+	sg->color0 = ln->color0;
+	sg->color1 = ln->color1;
+}
+
+// Order of segments crossing a sub-scanline. Segments crossing at same x
+// are ordered by their content, not by their history, which depends on
+// clip, so that colors are entered in same order whatever clip is.
+static inline bool
+raster_segment_after(const struct segment *a, const struct segment *b) {
+	if (a->x != b->x) {
+		return a->x > b->x;
+	}
+	if (a->dx != b->dx) {
+		return a->dx > b->dx;
+	}
+	if (a->color0 != b->color0) {
+		return (uintptr_t)a->color0 > (uintptr_t)b->color0;
+	}
+	return (uintptr_t)a->color1 > (uintptr_t)b->color1;
+}
+
+size_t
+raster_edge_lines(const struct edge *ee) {
+	if (ee->ee_edge_type != EdgeTypeCurve) {
+		return 1;
+	}
+	// Distance between curve and its chord is a quarter of second
+	// difference of its points, n lines get a n*n-th of it.
+	double ax = ee->ee_anchor0.x - 2.0*ee->ee_control.x + ee->ee_anchor1.x;
+	double ay = ee->ee_anchor0.y - 2.0*ee->ee_control.y + ee->ee_anchor1.y;
+	return 1 + (size_t)sqrt(hypot(ax, ay)/(4*RASTER_CURVE_TOLERANCE*RASTER_TWIPS));
+}
+
+static inline void
+raster_edge_line(const struct edge *ee, struct rasterline *ln) {
+	ln->x0 = ee->ee_anchor0.x;
+	ln->y0 = ee->ee_anchor0.y;
+	ln->x1 = ee->ee_anchor1.x;
+	ln->y1 = ee->ee_anchor1.y;
+	ln->color0 = ee->ee_color0;
+	ln->color1 = ee->ee_color1;
+	ln->direction = ee->ee_direction;
+}
+
+// Flatten curve into n lines of equal steps of t, by forward differencing.
+// Last line ends at anchor1 exactly.
+static void
+raster_flatten_curve(const struct edge *ce, size_t n, struct rasterline *lines) {
+	double x0 = ce->ee_anchor0.x, y0 = ce->ee_anchor0.y;
+	double cx = ce->ee_control.x, cy = ce->ee_control.y;
+	double h = 1.0/(double)n;
+	// Curve is x0 + 2*(cx-x0)*t + (x0-2*cx+x1)*t*t.
+	double ddx = 2*(x0 - 2*cx + ce->ee_anchor1.x)*h*h;
+	double ddy = 2*(y0 - 2*cy + ce->ee_anchor1.y)*h*h;
+	double dx = 2*(cx - x0)*h + ddx/2;
+	double dy = 2*(cy - y0)*h + ddy/2;
+	double px = x0, py = y0;
+	for (size_t i=0; i<n; i++) {
+		struct rasterline *ln = &lines[i];
+		raster_edge_line(ce, ln);
+		ln->x0 = px;
+		ln->y0 = py;
+		if (i+1 < n) {
+			ln->x1 = px + dx;
+			ln->y1 = py + dy;
+		}
+		px = ln->x1;
+		py = ln->y1;
+		dx += ddx;
+		dy += ddy;
+	}
+}
+
+size_t
+raster_flatten_texture(const struct texture *tu, struct rasterline *lines) {
+	struct rasterline *ln = lines;
+	struct edgeiter it;
+	struct edge edge, *ee = &edge;
+	texture_iterate(tu, &it);
+	while (edgeiter_next(&it, ee)) {
+		if (ee->ee_edge_type == EdgeTypeCurve) {
+			size_t n = raster_edge_lines(ee);
+			raster_flatten_curve(ee, n, ln);
+			ln += n;
+		} else {
+			raster_edge_line(ee, ln++);
+		}
+	}
+	return (size_t)(ln - lines);
+}
+
+// Lines of curve in scratch of ra, valid until next curve.
+static struct rasterline *
+raster_flatten(struct raster *ra, const struct edge *ce, size_t n) {
+	raster_reserve(ra, (void **)&ra->flat, &ra->flatcap, n, sizeof(struct rasterline));
+	raster_flatten_curve(ce, n, ra->flat);
+	return ra->flat;
+}
+
+// Flatten y-monotone quadratic curve into n segments.
+static void
+raster_add_curve(struct raster *ra, const struct edge *ce, size_t n, int32_t smin, int32_t smax) {
+	double y0 = ce->ee_anchor0.y, cy = ce->ee_control.y, y2 = ce->ee_anchor1.y;
+	// Curve lies inside hull of its points, those outside clip rows have no
+	// segments.
+	if (raster_sample_ceil(fmax(fmax(y0, cy), y2)) <= smin || raster_sample_ceil(fmin(fmin(y0, cy), y2)) >= smax) {
+		return;
+	}
+	const struct rasterline *lines = raster_flatten(ra, ce, n);
+	for (size_t i=0; i<n; i++) {
+		raster_add_segment(ra, &lines[i], smin, smax);
+	}
+}
+
+static void
+raster_reset_layers(struct raster *ra, size_t width) {
+	if (width > ra->width) {
+		raster_free_layers(ra);
+		ra->width = width;
+		ra->shade = raster_malloc(ra, sizeof(struct rgba8)*(width+1));
+	}
+	ra->nlayer = 0;
+}
+
+static struct layer *
+raster_get_layer(struct raster *ra, struct active_color *ac) {
+	for (size_t i=ra->nlayer; i-- > 0;) {
+		if (ra->layers[i].color == ac) {
+			return &ra->layers[i];
+		}
+	}
+	if (ra->nlayer == ra->laycap) {
+		size_t cap = ra->laycap;
+		raster_reserve(ra, (void **)&ra->layers, &ra->laycap, ra->nlayer+1, sizeof(struct layer));
+		for (size_t i=cap; i<ra->laycap; i++) {
+			ra->layers[i].cover = NULL;
+			ra->layers[i].dy = NULL;
+			ra->layers[i].area = NULL;
+		}
+	}
+	struct layer *ly = &ra->layers[ra->nlayer++];
+	const struct texture *tu = ra->texture;
+	ly->rank = 1;
+	while (ly->rank < tu->ncolor && tu->colors[ly->rank] != ac) {
+		ly->rank++;
+	}
+	assert(ly->rank < tu->ncolor);
+	if (ly->cover == NULL) {
+		ly->cover = raster_malloc(ra, sizeof(uint16_t)*(ra->width+1));
+		memset(ly->cover, 0, sizeof(uint16_t)*(ra->width+1));
+	}
+	if (ly->dy == NULL && ra->engine == RasterEngineAccumulate) {
+		ly->dy = raster_malloc(ra, sizeof(int32_t)*(ra->width+2));
+		ly->area = raster_malloc(ra, sizeof(int32_t)*(ra->width+2));
+		memset(ly->dy, 0, sizeof(int32_t)*(ra->width+2));
+		memset(ly->area, 0, sizeof(int32_t)*(ra->width+2));
+	}
+	ly->color = ac;
+	ly->xmin = INT32_MAX;
+	ly->xmax = INT32_MIN;
+	return ly;
+}
+
+// Accumulate coverage of [x0, x1) on a sub-scanline, x0 < x1 and both are
+// inside clip.
+static void
+raster_cover_span(struct raster *ra, struct active_color *ac, int64_t x0, int64_t x1) {
+	struct layer *ly = raster_get_layer(ra, ac);
+	uint16_t *cover = ly->cover;
+	int32_t i0 = (int32_t)(x0 >> 16), i1 = (int32_t)(x1 >> 16);
+	uint32_t f0 = (uint32_t)(x0 & 0xFFFF), f1 = (uint32_t)(x1 & 0xFFFF);
+	if (i0 == i1) {
+		cover[i0] += (uint16_t)(((f1 - f0)*RASTER_SAMPLE_COVER) >> 16);
+	} else {
+		cover[i0] += (uint16_t)(((0x10000 - f0)*RASTER_SAMPLE_COVER) >> 16);
+		for (int32_t i=i0+1; i<i1; i++) {
+			cover[i] += RASTER_SAMPLE_COVER;
+		}
+		cover[i1] += (uint16_t)((f1*RASTER_SAMPLE_COVER) >> 16);
+	}
+	if (i0 < ly->xmin) {
+		ly->xmin = i0;
+	}
+	if (i1+1 > ly->xmax) {
+		ly->xmax = i1+1;
+	}
+}
+
+static inline void
+raster_emit_span(struct raster *ra, struct active_color *ac, int64_t x0, int64_t x1) {
+	x0 = x0 < ra->xmin ? ra->xmin : x0;
+	x1 = x1 > ra->xmax ? ra->xmax : x1;
+	if (x0 < x1) {
+		raster_cover_span(ra, ac, x0, x1);
+	}
+}
+
+// Wind color by crossing. Even-odd colors leave at next crossing, nonzero
+// ones when winding sums to zero.
+// Winding lives in insides, not in colors, since colors are shared with
+// rasterizers of other threads.
+static size_t
+raster_toggle(struct raster *ra, size_t ninside, struct active_color *ac, int32_t winding) {
+	if (ac == NULL) {
+		return ninside;
+	}
+	for (size_t i=ninside; i-- > 0;) {
+		struct inside *in = &ra->insides[i];
+		if (in->color == ac) {
+			if (ac->ac_winding && (in->winding += winding) != 0) {
+				return ninside;
+			}
+			memmove(in, in+1, sizeof(*in)*(ninside-i-1));
+			return ninside-1;
+		}
+	}
+	ra->insides[ninside] = (struct inside){ac, winding};
+	return ninside+1;
+}
+
+static void
+raster_walk_sample(struct raster *ra, struct segment **actives, size_t nactive) {
+	size_t ninside = 0;
+	int64_t x = 0;
+	for (size_t i=0; i<nactive; i++) {
+		struct segment *sg = actives[i];
+		if (sg->x > x) {
+			for (size_t j=0; j<ninside; j++) {
+				raster_emit_span(ra, ra->insides[j].color, x, sg->x);
+			}
+		}
+		x = sg->x;
+		ninside = raster_toggle(ra, ninside, sg->color0, sg->winding);
+		ninside = raster_toggle(ra, ninside, sg->color1, sg->winding);
+	}
+}
+
+static inline uint32_t
+raster_premultiply(uint32_t c, uint32_t a) {
+	c = c*a + 128;
+	return (c + (c >> 8)) >> 8;
+}
+
+// Layers are composited in order of their colors in texture, not of their
+// entering, which depends on clip and engine.
+static void
+raster_sort_layers(struct layer *layers, size_t n) {
+	for (size_t i=1; i<n; i++) {
+		struct layer ly = layers[i];
+		size_t j = i;
+		while (j > 0 && layers[j-1].rank > ly.rank) {
+			layers[j] = layers[j-1];
+			j--;
+		}
+		layers[j] = ly;
+	}
+}
+
+static void
+raster_composite_row(struct raster *ra, struct bufctx *bx, int32_t y) {
+	struct rgba8 *row = bx->pixels + (size_t)y*bx->stride;
+	// Layers end one past pixel of last crossing, which may be outside clip
+	// and owned by other thread.
+	int32_t xmax = (int32_t)(ra->xmax >> 16);
+	raster_sort_layers(ra->layers, ra->nlayer);
+	for (size_t i=0; i<ra->nlayer; i++) {
+		struct layer *ly = &ra->layers[i];
+		struct active_color *ac = ly->color;
+		ly->xmax = ly->xmax > xmax ? xmax : ly->xmax;
+		if (ly->xmin >= ly->xmax) {
+			continue;
+		}
+		size_t n = (size_t)(ly->xmax - ly->xmin);
+		if (ac->ac_type != ColorTypeSolid) {
+			shader_paint(ra->shader, &ac->ac_color[0].gradient, ac->ac_type, ly->xmin, y, ra->shade, n);
+			ra->stat.npixel += ra->span->blend_cover_pixels(row+ly->xmin, ly->cover+ly->xmin, ra->shade, n);
+			continue;
+		}
+		struct rgba8 c = ac->ac_color[0].solid;
+		c.r = (uint8_t)raster_premultiply(c.r, c.a);
+		c.g = (uint8_t)raster_premultiply(c.g, c.a);
+		c.b = (uint8_t)raster_premultiply(c.b, c.a);
+		ra->stat.npixel += ra->span->blend_cover(row+ly->xmin, ly->cover+ly->xmin, n, c);
+	}
+	ra->nlayer = 0;
+}
+
+static void
+raster_insert_sort(struct segment **actives, size_t n) {
+	for (size_t i=1; i<n; i++) {
+		struct segment *sg = actives[i];
+		size_t j = i;
+		while (j > 0 && raster_segment_after(actives[j-1], sg)) {
+			actives[j] = actives[j-1];
+			j--;
+		}
+		actives[j] = sg;
+	}
+}
+
+// Scan segments added since ra->nsegment was reset.
+static void
+raster_scan_segments(struct raster *ra, struct bufctx *bx) {
+	size_t nsegment = ra->nsegment;
+	if (nsegment == 0) {
+		return;
+	}
+	raster_bucket_sort(ra, ra->segments, nsegment, sizeof(struct segment), offsetof(struct segment, sbeg));
+	raster_reserve(ra, (void **)&ra->actives, &ra->actcap, nsegment, sizeof(struct segment *));
+	raster_reserve(ra, (void **)&ra->insides, &ra->inscap, 2*nsegment, sizeof(struct inside));
+	raster_reset_layers(ra, (size_t)(ra->xmax >> 16));
+
+	struct segment **segments = (struct segment **)ra->order;
+	struct segment **actives = ra->actives;
+	size_t next = 0, nactive = 0;
+	int32_t s = segments[0]->sbeg;
+	int32_t y = s/RASTER_NSAMPLE;
+	s = y*RASTER_NSAMPLE;
+	while (next < nsegment || nactive != 0) {
+		// Skip rows crossed by nothing.
+		if (nactive == 0 && segments[next]->sbeg/RASTER_NSAMPLE > y) {
+			y = segments[next]->sbeg/RASTER_NSAMPLE;
+			s = y*RASTER_NSAMPLE;
+		}
+		for (int32_t k=0; k<RASTER_NSAMPLE; k++, s++) {
+			while (next < nsegment && segments[next]->sbeg == s) {
+				actives[nactive++] = segments[next++];
+			}
+			size_t n = 0;
+			for (size_t i=0; i<nactive; i++) {
+				if (actives[i]->send > s) {
+					actives[n++] = actives[i];
+				}
+			}
+			nactive = n;
+			if (nactive == 0) {
+				continue;
+			}
+			raster_insert_sort(actives, nactive);
+			raster_walk_sample(ra, actives, nactive);
+			for (size_t i=0; i<nactive; i++) {
+				actives[i]->x += actives[i]->dx;
+			}
+		}
+		raster_composite_row(ra, bx, y);
+		y++;
+	}
+}
+
+static void
+raster_scan_texture(struct raster *ra, const struct texture *tu, struct bufctx *bx, int32_t cy0, int32_t cy1) {
+	int32_t smin = cy0*RASTER_NSAMPLE, smax = cy1*RASTER_NSAMPLE;
+	ra->nsegment = 0;
+	struct edgeiter it;
+	struct edge edge, *ee = &edge;
+	texture_iterate(tu, &it);
+	while (edgeiter_next(&it, ee)) {
+		size_t n = raster_edge_lines(ee);
+		ra->stat.nedge++;
+		ra->stat.nline += n;
+		if (ee->ee_edge_type == EdgeTypeCurve) {
+			raster_add_curve(ra, ee, n, smin, smax);
+		} else {
+			struct rasterline ln;
+			raster_edge_line(ee, &ln);
+			raster_add_segment(ra, &ln, smin, smax);
+		}
+	}
+	raster_scan_segments(ra, bx);
+}
+
+// Accumulation engine adds signed area of edges to cells of pixels they
+// cross, in exact integer sub-pixels, and resolves coverage of rows by
+// prefix sums, so edges are never sorted along x. Colors overlapping each other
+// are all painted, in composite order of layers.
+
+// Largest integer not above a/b, b is positive.
+static inline int64_t
+raster_floor_div(int64_t a, int64_t b) {
+	int64_t q = a/b;
+	return q*b > a ? q-1 : q;
+}
+
+static void
+raster_add_aline(struct raster *ra, const struct rasterline *rl, int32_t cy0, int32_t cy1) {
+	struct aline ln;
+	ln.x0 = (int32_t)llround(rl->x0*RASTER_ONE/RASTER_TWIPS);
+	ln.y0 = (int32_t)llround(rl->y0*RASTER_ONE/RASTER_TWIPS);
+	ln.x1 = (int32_t)llround(rl->x1*RASTER_ONE/RASTER_TWIPS);
+	ln.y1 = (int32_t)llround(rl->y1*RASTER_ONE/RASTER_TWIPS);
+	ln.sign = rl->direction;
+	if (ln.y0 == ln.y1) {
+		return;
+	}
+	if (ln.y0 > ln.y1) {
+		int32_t t;
+		t = ln.x0; ln.x0 = ln.x1; ln.x1 = t;
+		t = ln.y0; ln.y0 = ln.y1; ln.y1 = t;
+		ln.sign = -ln.sign;
+	}
+	int32_t ry0 = (int32_t)raster_floor_div(ln.y0, RASTER_ONE);
+	int32_t ry1 = (int32_t)raster_floor_div(ln.y1 + RASTER_ONE - 1, RASTER_ONE);
+	ln.ry0 = ry0 < cy0 ? cy0 : ry0;
+	ln.ry1 = ry1 > cy1 ? cy1 : ry1;
+	if (ln.ry0 >= ln.ry1) {
+		return;
+	}
+	ln.color0 = rl->color0;
+	ln.color1 = rl->color1;
+	raster_reserve(ra, (void **)&ra->alines, &ra->linecap, ra->nline+1, sizeof(struct aline));
+	ra->alines[ra->nline++] = ln;
+}
+
+static void
+raster_add_acurve(struct raster *ra, const struct edge *ce, size_t n, int32_t cy0, int32_t cy1) {
+	double y0 = ce->ee_anchor0.y, cy = ce->ee_control.y, y2 = ce->ee_anchor1.y;
+	if (fmax(fmax(y0, cy), y2) <= cy0*RASTER_TWIPS || fmin(fmin(y0, cy), y2) >= cy1*RASTER_TWIPS) {
+		return;
+	}
+	const struct rasterline *lines = raster_flatten(ra, ce, n);
+	for (size_t i=0; i<n; i++) {
+		raster_add_aline(ra, &lines[i], cy0, cy1);
+	}
+}
+
+// x of line at y, y0 <= y <= y1.
+static inline int32_t
+raster_aline_x(const struct aline *ln, int32_t y) {
+	return ln->x0 + (int32_t)raster_floor_div((int64_t)(ln->x1 - ln->x0)*(y - ln->y0), ln->y1 - ln->y0);
+}
+
+// y of piece from (xa, ya) to (xb, yb) at x, xa != xb.
+static inline int32_t
+raster_piece_y(int32_t xa, int32_t ya, int32_t xb, int32_t yb, int32_t x) {
+	int64_t n = (int64_t)(x - xa)*(yb - ya);
+	return ya + (int32_t)(xb > xa ? raster_floor_div(n, xb - xa) : raster_floor_div(-n, xa - xb));
+}
+
+static inline void
+raster_mark_cells(struct layer *ly, int32_t x0, int32_t x1) {
+	ly->xmin = x0 < ly->xmin ? x0 : ly->xmin;
+	ly->xmax = x1 > ly->xmax ? x1 : ly->xmax;
+}
+
+// Accumulate piece of line from (xa, ya) to (xb, yb) inside a pixel row,
+// ya < yb in sub-pixels from row top. Cells are walked from left, with y at
+// their boundaries computed from piece ends, so a cell gets same value
+// whatever clip is. Cells right of clip are dropped, those left of it fold
+// into one, as only their sum matters.
+static void
+raster_accumulate_piece(struct raster *ra, struct layer *ly, int32_t xa, int32_t ya, int32_t xb, int32_t yb, int32_t sign) {
+	int32_t cx0 = (int32_t)(ra->xmin >> 16), cx1 = (int32_t)(ra->xmax >> 16);
+	int32_t xl = xa < xb ? xa : xb, xr = xa < xb ? xb : xa;
+	if (xl >= cx1*RASTER_ONE) {
+		return;
+	}
+	int32_t *dy = ly->dy + 1, *area = ly->area + 1;
+	if (xl == xr) {
+		int32_t ex = (int32_t)raster_floor_div(xl, RASTER_ONE);
+		int32_t d = sign*(yb - ya);
+		if (ex < cx0) {
+			dy[cx0-1] += d;
+			raster_mark_cells(ly, cx0-1, cx0);
+		} else {
+			dy[ex] += d;
+			area[ex] += d*2*(xl - ex*RASTER_ONE);
+			raster_mark_cells(ly, ex, ex+1);
+		}
+		return;
+	}
+	// Ends of piece take no division.
+	int32_t yl = xl == xa ? ya : yb, yr = xl == xa ? yb : ya;
+	int32_t x = xl, y = yl;
+	int32_t ex = (int32_t)raster_floor_div(xl, RASTER_ONE);
+	int32_t ex1 = (int32_t)raster_floor_div(xr-1, RASTER_ONE);
+	ex1 = ex1 < cx1 ? ex1 : cx1-1;
+	int32_t mark = ex;
+	if (ex < cx0) {
+		int32_t bx = xr < cx0*RASTER_ONE ? xr : cx0*RASTER_ONE;
+		int32_t by = bx == xr ? yr : raster_piece_y(xa, ya, xb, yb, bx);
+		dy[cx0-1] += sign*abs(by - y);
+		x = bx;
+		y = by;
+		ex = cx0;
+		mark = cx0-1;
+	}
+	for (; ex <= ex1; ex++) {
+		int32_t bx = (ex+1)*RASTER_ONE < xr ? (ex+1)*RASTER_ONE : xr;
+		int32_t by = bx == xr ? yr : raster_piece_y(xa, ya, xb, yb, bx);
+		int32_t d = sign*abs(by - y);
+		dy[ex] += d;
+		area[ex] += d*((x - ex*RASTER_ONE) + (bx - ex*RASTER_ONE));
+		x = bx;
+		y = by;
+	}
+	raster_mark_cells(ly, mark, ex > mark ? ex : mark+1);
+}
+
+static void
+raster_accumulate_row(struct raster *ra, const struct aline *ln, int32_t row) {
+	int32_t top = row*RASTER_ONE;
+	int32_t ya = ln->y0 > top ? ln->y0 : top;
+	int32_t yb = ln->y1 < top+RASTER_ONE ? ln->y1 : top+RASTER_ONE;
+	if (ya >= yb) {
+		return;
+	}
+	int32_t xa = raster_aline_x(ln, ya), xb = raster_aline_x(ln, yb);
+	raster_accumulate_piece(ra, raster_get_layer(ra, ln->color0), xa, ya-top, xb, yb-top, ln->sign);
+	if (ln->color1 != NULL) {
+		raster_accumulate_piece(ra, raster_get_layer(ra, ln->color1), xa, ya-top, xb, yb-top, ln->sign);
+	}
+}
+
+// Resolve cells of layers into cover of pixels.
+static void
+raster_resolve_row(struct raster *ra) {
+	int32_t cx0 = (int32_t)(ra->xmin >> 16), cx1 = (int32_t)(ra->xmax >> 16);
+	for (size_t i=0; i<ra->nlayer; i++) {
+		struct layer *ly = &ra->layers[i];
+		int32_t x0 = ly->xmin < cx0 ? cx0 : ly->xmin;
+		int32_t x1 = ly->xmax > x0 ? ly->xmax : x0;
+		int32_t acc = ly->dy[cx0];
+		ly->dy[cx0] = 0;
+		bool nonzero = ly->color->ac_winding;
+		if (x0 < x1) {
+			size_t n = (size_t)(x1 - x0);
+			if (nonzero) {
+				acc = ra->span->accumulate_nonzero(ly->cover+x0, ly->dy+x0+1, ly->area+x0+1, n, acc);
+			} else {
+				acc = ra->span->accumulate(ly->cover+x0, ly->dy+x0+1, ly->area+x0+1, n, acc);
+			}
+		}
+		// Pixels right of cells are inside edges right of clip, or outside.
+		int32_t c;
+		if (nonzero) {
+			c = abs(acc);
+			c = c > 256 ? 256 : c;
+		} else {
+			c = acc & 511;
+			c = c > 256 ? 512 - c : c;
+		}
+		if (c != 0) {
+			for (int32_t x=x1; x<cx1; x++) {
+				ly->cover[x] = (uint16_t)c;
+			}
+			x1 = cx1;
+		}
+		ly->xmin = x0;
+		ly->xmax = x1;
+	}
+}
+
+// Accumulate lines added since ra->nline was reset.
+static void
+raster_accumulate_lines(struct raster *ra, struct bufctx *bx) {
+	size_t nline = ra->nline;
+	if (nline == 0) {
+		return;
+	}
+	raster_bucket_sort(ra, ra->alines, nline, sizeof(struct aline), offsetof(struct aline, ry0));
+	raster_reserve(ra, (void **)&ra->lactives, &ra->lactcap, nline, sizeof(struct aline *));
+	raster_reset_layers(ra, (size_t)(ra->xmax >> 16));
+
+	struct aline **lines = (struct aline **)ra->order;
+	struct aline **actives = ra->lactives;
+	size_t next = 0, nactive = 0;
+	int32_t y = lines[0]->ry0;
+	while (next < nline || nactive != 0) {
+		if (nactive == 0 && lines[next]->ry0 > y) {
+			y = lines[next]->ry0;
+		}
+		while (next < nline && lines[next]->ry0 == y) {
+			actives[nactive++] = lines[next++];
+		}
+		size_t n = 0;
+		for (size_t i=0; i<nactive; i++) {
+			if (actives[i]->ry1 > y) {
+				actives[n++] = actives[i];
+				raster_accumulate_row(ra, actives[i], y);
+			}
+		}
+		nactive = n;
+		raster_resolve_row(ra);
+		raster_composite_row(ra, bx, y);
+		y++;
+	}
+}
+
+static void
+raster_accumulate_texture(struct raster *ra, const struct texture *tu, struct bufctx *bx, int32_t cy0, int32_t cy1) {
+	ra->nline = 0;
+	struct edgeiter it;
+	struct edge edge, *ee = &edge;
+	texture_iterate(tu, &it);
+	while (edgeiter_next(&it, ee)) {
+		size_t n = raster_edge_lines(ee);
+		ra->stat.nedge++;
+		ra->stat.nline += n;
+		if (ee->ee_edge_type == EdgeTypeCurve) {
+			raster_add_acurve(ra, ee, n, cy0, cy1);
+		} else {
+			struct rasterline ln;
+			raster_edge_line(ee, &ln);
+			raster_add_aline(ra, &ln, cy0, cy1);
+		}
+	}
+	raster_accumulate_lines(ra, bx);
+}
+
+// Clip in pixels, inside target. Return false if it is empty.
+static bool
+raster_set_clip(struct raster *ra, struct bufctx *bx, const struct rectangle *clip, int32_t *cy0, int32_t *cy1) {
+	int32_t cx0 = clip->xmin < 0 ? 0 : clip->xmin;
+	int32_t cx1 = clip->xmax > (coord_t)bx->width ? (coord_t)bx->width : clip->xmax;
+	*cy0 = clip->ymin < 0 ? 0 : clip->ymin;
+	*cy1 = clip->ymax > (coord_t)bx->height ? (coord_t)bx->height : clip->ymax;
+	if (cx0 >= cx1 || *cy0 >= *cy1) {
+		return false;
+	}
+	ra->xmin = (int64_t)cx0 << 16;
+	ra->xmax = (int64_t)cx1 << 16;
+	return true;
+}
+
+void
+raster_fill_texture(struct raster *ra, const struct texture *tu, struct bufctx *bx, const struct rectangle *clip) {
+	int32_t cy0, cy1;
+	if (!raster_set_clip(ra, bx, clip, &cy0, &cy1)) {
+		return;
+	}
+	ra->stat.ntexture++;
+	ra->texture = tu;
+	if (ra->engine == RasterEngineAccumulate) {
+		raster_accumulate_texture(ra, tu, bx, cy0, cy1);
+	} else {
+		raster_scan_texture(ra, tu, bx, cy0, cy1);
+	}
+}
+
+void
+raster_fill_lines(struct raster *ra, const struct texture *tu, const struct rasterline *lines, const size_t *index, size_t n, struct bufctx *bx, const struct rectangle *clip) {
+	int32_t cy0, cy1;
+	if (!raster_set_clip(ra, bx, clip, &cy0, &cy1)) {
+		return;
+	}
+	ra->stat.ntexture++;
+	ra->texture = tu;
+	ra->stat.nline += n;
+	if (ra->engine == RasterEngineAccumulate) {
+		ra->nline = 0;
+		for (size_t i=0; i<n; i++) {
+			raster_add_aline(ra, &lines[index[i]], cy0, cy1);
+		}
+		raster_accumulate_lines(ra, bx);
+	} else {
+		int32_t smin = cy0*RASTER_NSAMPLE, smax = cy1*RASTER_NSAMPLE;
+		ra->nsegment = 0;
+		for (size_t i=0; i<n; i++) {
+			raster_add_segment(ra, &lines[index[i]], smin, smax);
+		}
+		raster_scan_segments(ra, bx);
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef __CORE_RASTER_H
+#define __CORE_RASTER_H
+
+#include "common.h"
+#include <stddef.h>
+#include <stdint.h>
+
+struct memface;
+struct edge;
+struct active_color;
+struct texture;
+struct bufctx;
+struct rectangle;
+struct render_stat;
+struct raster;
+
+// Active edge table scanline rasterizer.
+//
+// Edges are sampled on RASTER_NSAMPLE sub-scanlines per pixel row, and
+// coverage along sub-scanlines is exact, so edges are anti-aliased. Each
+// color is filled by even-odd rule of edges bounding it, that is, color0 of
+// FillRuleEvenodd edges, color0 and color1 of FillRuleSwfedge edges. Where
+// regions of colors overlap, all are painted, later colors of texture over
+// earlier ones, and colors of texture are in order of their first edges.
+// Edges enter
+// active edge table from buckets of their first sub-scanline, filled by a
+// counting sort, and only actives are kept sorted along x.
+//
+// A pixel comes out same whatever clip it is rasterized in, so a frame can
+// be rasterized piece by piece. Rasterizers of different threads can share
+// edges and colors.
+//
+// RasterEngineAccumulate instead adds signed area of edges to cells of
+// pixels they cross, at 256 sub-pixels each way, and resolves rows by prefix
+// sums of cells, without sorting edges. Colors are filled and overlapped by
+// same rules.
+
+#define RASTER_NSAMPLE	4
+
+// Maximum distance in pixels between a curve and its flattened lines.
+#define RASTER_CURVE_TOLERANCE	0.1
+
+// Edge or piece of flattened curve, in twips of target.
+struct rasterline {
+	double x0;
+	double y0;
+	double x1;
+	double y1;
+	struct active_color *color0;
+	struct active_color *color1;
+	int32_t direction;
+};
+
+struct raster *raster_create(struct memface *mc);
+void raster_delete(struct raster *ra);
+
+// RasterEngineScanline is the default.
+void raster_set_engine(struct raster *ra, enum raster_engine engine);
+
+// Composite edges of texture over pixels of bx inside clip, which is in
+// pixels.
+void raster_fill_texture(struct raster *ra, const struct texture *tu, struct bufctx *bx, const struct rectangle *clip);
+
+// Number of lines edge is flattened into.
+size_t raster_edge_lines(const struct edge *ee);
+
+// Flatten edges of texture into lines, which must hold tu->nline lines,
+// same as raster_fill_texture() does. Return number of lines.
+size_t raster_flatten_texture(const struct texture *tu, struct rasterline *lines);
+
+// Composite lines[index[i]], 0 <= i < n, flattened from tu, over pixels of
+// bx inside clip. Pixels are same as raster_fill_texture() of tu, if lines
+// crossing clip are all indexed in order.
+void raster_fill_lines(struct raster *ra, const struct texture *tu, const struct rasterline *lines, const size_t *index, size_t n, struct bufctx *bx, const struct rectangle *clip);
+
+const struct render_stat *raster_stat(const struct raster *ra);
+
+#endif
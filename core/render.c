@@ -1,121 +1,28 @@
 #include "render.h"
+#include "edge.h"
+#include "raster.h"
+#include "tiler.h"
 #include <base/slab.h>
 #include <base/compat.h>
 #include <base/helper.h>
 #include <base/geometry.h>
+#include <base/span.h>
 
 #include <stddef.h>
 #include <stdint.h>
 
-#define ac_type		ac_union._ac_info.__ac_type
-#define ac_transparent	ac_union._ac_info.__ac_transparent
-#define ac_visnum	ac_union._ac_info.__ac_visnum
-#define ac_init		ac_union._ac_init
-struct active_color {
-	union {
-		struct {
-			uint8_t __ac_type;
-			uint8_t __ac_transparent;
-			int16_t __ac_visnum;
-		} _ac_info;
-		uint32_t _ac_init;
-	} ac_union;
-	union color ac_color[];
-};
-
 #define SolidColorSize		(sizeof(struct active_color)+sizeof(struct rgba8))
-#define GradientColorSize	(sizeof(struct active_color)+sizeof(struct rgba8))
-
-#define COLOR_OFFSET		offsetof(struct active_color, ac_color)
-#define COLOR2ACTIVE(co)	((struct active_color *)(((char*)co) - COLOR_OFFSET))
-
-struct spoint {
-	int16_t x;
-	int16_t y;
-};
+#define GradientColorSize	(sizeof(struct active_color)+sizeof(struct gradient))
 
-static inline void
-spoint_import_point(struct spoint *po, const struct point *pt) {
-	po->x = (int16_t)pt->x;
-	po->y = (int16_t)pt->y;
-}
-
-static inline void
-spoint_export_point(const struct spoint *po, struct point *pt) {
-	pt->x = (coord_t)po->x;
-	pt->y = (coord_t)po->y;
-}
-
-#define EdgeCommonFields(prefix)	\
-struct edge * prefix ## next;		\
-uint8_t prefix ## edge_type;		\
-uint8_t prefix ## fill_rule;		\
-int16_t prefix ## direction;		\
-struct spoint prefix ## anchor0;	\
-struct spoint prefix ## anchor1;	\
-struct active_color * prefix ## color0
-
-struct curve {
-	EdgeCommonFields(ce_);
-	struct spoint ce_control;
-	struct active_color *ce_color1;
-};
-
-struct line {
-	EdgeCommonFields(le_);
-	struct active_color *le_color1;
-};
-
-struct edge {
-	EdgeCommonFields(ee_);
-};
-
-// line + evenodd	0
-// curve + evenodd	1
-// line + swfedge	2
-// curve + swfedge	3
-
-#define EdgeSlabIndex0Isize	offsetof(struct line, le_color1)
-#define EdgeSlabIndex1Isize	offsetof(struct curve, ce_color1)
-#define EdgeSlabIndex2Isize	sizeof(struct line)
-#define EdgeSlabIndex3Isize	sizeof(struct curve)
-
-#define EdgeSlabIndex0Nitem	30
-#define EdgeSlabIndex1Nitem	30
-#define EdgeSlabIndex2Nitem	15
-#define EdgeSlabIndex3Nitem	15
-
-#define EdgeSlabIndexz		4
-
-enum edge_type {
-	EdgeTypeLine	= 0,
-	EdgeTypeCurve	= 1,
-};
-
-enum fill_rule {
-	FillRuleEvenodd	= 0,
-	FillRuleSwfedge	= 2,
-	FillRuleWinding	= 4,
-};
-
-enum {
-	EdgeDirectionPositive	= 1,
-	EdgeDirectionNegative	= -1,
-};
-
-static inline size_t
-edge_slab_index(enum edge_type type, enum fill_rule rule) {
-	size_t index = (size_t)((type+rule) & 0x03);
-	return index;
-}
-
-#define edge2texture(ee)	((struct texture *)ee);
-#define texture2edge(tu)	((struct edge*)tu)
+// Coordinates of edges are clamped to this many twips, so that textures
+// span no more than 32 bits and rasterizers don't overflow.
+#define RenderCoordLimit	(1 << 26)
 
 // We don't care about edge order in same layer.
 struct painter {
-	struct edge *pn_first;
-	struct edge **pn_inset;
+	struct edge *pn_edges;
+	size_t pn_nedge;
+	size_t pn_edgecap;
 	struct render *pn_render;
 	enum fill_rule pn_fill_rule;
 	struct active_color *pn_color0;
@@ -125,54 +32,53 @@ struct painter {
 
 static inline void
 painter_init(struct painter *pn) {
-	pn->pn_inset = &pn->pn_first;
-}
-
-static inline void
-painter_inset(struct painter *pn, struct edge *ee) {
-	*pn->pn_inset = ee;
-	pn->pn_inset = &ee->ee_next;
-}
-
-static inline struct edge *
-painter_spawn(struct painter *pn, struct edge ***inset) {
-	if (pn->pn_inset != &pn->pn_first) {
-		*inset = pn->pn_inset;
-		pn->pn_inset = &pn->pn_first;
-		return pn->pn_first;
-	}
-	return NULL;
+	pn->pn_edges = NULL;
+	pn->pn_nedge = 0;
+	pn->pn_edgecap = 0;
 }
 
-#define sk_closeo	sk_painter.pn_anchor0
+// Strokes come expanded into fills, which are filled by nonzero rule in
+// stroke color. Path is fed to stroker between render_start_stroke() and
+// render_close_stroke().
 struct stroker {
 	struct painter sk_painter;
-	struct point sk_closel;
-	struct point sk_closer;
-	struct point sk_startl;
-	struct point sk_starto;
-	struct point sk_startr;
 };
 
-static inline void
-stroker_inset(struct stroker *sk, struct edge *ee) {
-	painter_inset(&sk->sk_painter, ee);
-}
-
-static inline struct edge *
-stroker_spawn(struct stroker *sk, struct edge ***inset) {
-	return painter_spawn(&sk->sk_painter, inset);
-}
-
 struct render {
 	struct painter rd_painter;
 	struct stroker rd_stroker;
-	struct texture *current_texture;
+	// Edges of current texture, in batches spawned by painters. Batches
+	// spawned later come first in texture.
+	struct edge *edges;
+	size_t nedge;
+	size_t edgecap;
+	size_t *batches;
+	size_t nbatch;
+	size_t batchcap;
+	// Colors of texture being packed.
+	struct active_color **colors;
+	size_t colorcap;
+	// Textures not deleted yet.
+	struct texture *textures;
 	struct memory *memctx;
 	MemfaceAllocFunc_t malloc;
 	MemfaceDeallocFunc_t dealloc;
 	struct slab *active_color_slabs[ColorTypeNumber];
-	struct slab *edge_slabs[EdgeSlabIndexz];
+	struct memface *memface;
+	struct raster *raster;
+	enum raster_engine engine;
+	// Textures are queued to tiler instead of rasterized at once, if it is
+	// not NULL.
+	struct tiler *tiler;
+	// Work of deleted tilers.
+	struct render_stat tiled;
+	// Work of all rasterizers, summed up by render_stat().
+	struct render_stat stat;
+	struct bufctx *target;
+	struct rectangle clip;
+	// Kernels and pixels of blits.
+	const struct spanface *span;
+	size_t nblit;
 };
 
 static inline void *
@@ -182,49 +88,228 @@ render_malloc(struct render *rd, size_t size, const char *file, int line) {
 
 static inline void
 render_dealloc(struct render *rd, void *ptr, const char *file, int line) {
-	rd->dealloc(rd->memctx, ptr, file, line);
+	if (ptr != NULL) {
+		rd->dealloc(rd->memctx, ptr, file, line);
+	}
+}
+
+// Grow array at *ptr to hold n items of isize bytes, keeping its items.
+static void
+render_reserve(struct render *rd, void **ptr, size_t *cap, size_t n, size_t isize) {
+	if (n <= *cap) {
+		return;
+	}
+	size_t ncap = *cap*2 > n ? *cap*2 : n + 16;
+	void *p = render_malloc(rd, ncap*isize, __FILE__, __LINE__);
+	if (*cap != 0) {
+		memcpy(p, *ptr, *cap*isize);
+	}
+	render_dealloc(rd, *ptr, __FILE__, __LINE__);
+	*ptr = p;
+	*cap = ncap;
 }
 
 static struct edge *
-render_create_edge(struct render *rd, enum edge_type type, enum fill_rule rule) {
-	size_t idx = edge_slab_index(type, rule);
-	return slab_alloc(rd->edge_slabs[idx]);
+painter_create_edge(struct painter *pn, enum edge_type type) {
+	struct render *rd = pn->pn_render;
+	render_reserve(rd, (void **)&pn->pn_edges, &pn->pn_edgecap, pn->pn_nedge+1, sizeof(struct edge));
+	struct edge *ee = &pn->pn_edges[pn->pn_nedge++];
+	ee->ee_edge_type = (uint8_t)type;
+	ee->ee_fill_rule = (uint8_t)pn->pn_fill_rule;
+	ee->ee_color0 = pn->pn_color0;
+	ee->ee_color1 = pn->pn_fill_rule == FillRuleSwfedge ? pn->pn_color1 : NULL;
+	return ee;
 }
 
+// Move edges of painter to a new batch of current texture.
 static void
-render_delete_edge(struct render *rd, struct edge *ee) {
-	size_t idx = edge_slab_index((enum edge_type)ee->ee_edge_type, (enum fill_rule)ee->ee_fill_rule);
-	slab_dealloc(rd->edge_slabs[idx], ee);
+painter_spawn(struct painter *pn) {
+	if (pn->pn_nedge == 0) {
+		return;
+	}
+	struct render *rd = pn->pn_render;
+	render_reserve(rd, (void **)&rd->edges, &rd->edgecap, rd->nedge+pn->pn_nedge, sizeof(struct edge));
+	render_reserve(rd, (void **)&rd->batches, &rd->batchcap, rd->nbatch+1, sizeof(size_t));
+	memcpy(rd->edges+rd->nedge, pn->pn_edges, pn->pn_nedge*sizeof(struct edge));
+	rd->batches[rd->nbatch++] = rd->nedge;
+	rd->nedge += pn->pn_nedge;
+	pn->pn_nedge = 0;
+}
+
+static inline void
+point_clamp(struct point *po, const struct point *pt) {
+	po->x = pt->x < -RenderCoordLimit ? -RenderCoordLimit : pt->x > RenderCoordLimit ? RenderCoordLimit : pt->x;
+	po->y = pt->y < -RenderCoordLimit ? -RenderCoordLimit : pt->y > RenderCoordLimit ? RenderCoordLimit : pt->y;
 }
 
 void
 render_struct_texture(struct render *rd) {
-	struct edge *first, **inset;
-	if ((first = painter_spawn(&rd->rd_painter, &inset)) != NULL) {
-		*inset = texture2edge(rd->current_texture);
-		rd->current_texture = edge2texture(first);
+	painter_spawn(&rd->rd_painter);
+	painter_spawn(&rd->rd_stroker.sk_painter);
+}
+
+static inline void
+bounds_extend(struct rectangle *rt, const struct point *pt) {
+	rt->xmin = pt->x < rt->xmin ? pt->x : rt->xmin;
+	rt->xmax = pt->x > rt->xmax ? pt->x : rt->xmax;
+	rt->ymin = pt->y < rt->ymin ? pt->y : rt->ymin;
+	rt->ymax = pt->y > rt->ymax ? pt->y : rt->ymax;
+}
+
+// Index of color in colors of texture being packed, added if it is new.
+// Neighbouring edges mostly share colors, so search starts at last hit.
+static uint32_t
+render_index_color(struct render *rd, size_t *ncolor, size_t *hint, struct active_color *ac) {
+	if (rd->colors[*hint] == ac) {
+		return (uint32_t)*hint;
 	}
-	if ((first = stroker_spawn(&rd->rd_stroker, &inset)) != NULL) {
-		*inset = texture2edge(rd->current_texture);
-		rd->current_texture = edge2texture(first);
+	for (size_t i=0; i<*ncolor; i++) {
+		if (rd->colors[i] == ac) {
+			*hint = i;
+			return (uint32_t)i;
+		}
 	}
+	render_reserve(rd, (void **)&rd->colors, &rd->colorcap, *ncolor+1, sizeof(struct active_color *));
+	rd->colors[*ncolor] = ac;
+	*hint = (*ncolor)++;
+	return (uint32_t)*hint;
 }
 
+static inline void
+texture_put_unit(void *units, uint32_t precision, size_t i, uint32_t v) {
+	if (precision == 16) {
+		((uint16_t *)units)[i] = (uint16_t)v;
+	} else {
+		((uint32_t *)units)[i] = v;
+	}
+}
+
+// Pack edges of batches into a texture, see edge.h. Batches spawned later
+// come first.
 struct texture *
 render_return_texture(struct render *rd) {
 	render_struct_texture(rd);
-	struct texture *tu = rd->current_texture;
-	rd->current_texture = NULL;
+	if (rd->nedge == 0) {
+		return NULL;
+	}
+	struct rectangle bounds = {INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN};
+	size_t ncolor = 0, hint = 0, nline = 0, nunit = 0;
+	render_reserve(rd, (void **)&rd->colors, &rd->colorcap, 1, sizeof(struct active_color *));
+	rd->colors[ncolor++] = NULL;
+	for (size_t i=0; i<rd->nedge; i++) {
+		struct edge *ee = &rd->edges[i];
+		bounds_extend(&bounds, &ee->ee_anchor0);
+		bounds_extend(&bounds, &ee->ee_anchor1);
+		nunit += EdgeLineUnits;
+		if (ee->ee_edge_type == EdgeTypeCurve) {
+			bounds_extend(&bounds, &ee->ee_control);
+			nunit += EdgeCurveUnits - EdgeLineUnits;
+		}
+		render_index_color(rd, &ncolor, &hint, ee->ee_color0);
+		render_index_color(rd, &ncolor, &hint, ee->ee_color1);
+		nline += raster_edge_lines(ee);
+	}
+	coord_t width = bounds.xmax - bounds.xmin;
+	coord_t height = bounds.ymax - bounds.ymin;
+	uint32_t precision = width <= UINT16_MAX && height <= UINT16_MAX && ncolor <= UINT16_MAX+1 ? 16 : 32;
+	size_t size = sizeof(struct texture) + ncolor*sizeof(struct active_color *) + nunit*precision/8;
+	struct texture *tu = render_malloc(rd, size, __FILE__, __LINE__);
+	tu->origin.x = bounds.xmin;
+	tu->origin.y = bounds.ymin;
+	tu->width = width;
+	tu->height = height;
+	tu->precision = precision;
+	tu->nedge = rd->nedge;
+	tu->nline = nline;
+	tu->size = size;
+	tu->ncolor = ncolor;
+	memcpy(tu->colors, rd->colors, ncolor*sizeof(struct active_color *));
+	char *units = (char *)(tu->colors + ncolor);
+	hint = 0;
+	for (size_t b=rd->nbatch; b-- > 0;) {
+		size_t end = b+1 < rd->nbatch ? rd->batches[b+1] : rd->nedge;
+		for (size_t i=rd->batches[b]; i<end; i++) {
+			const struct edge *ee = &rd->edges[i];
+			uint32_t head = (uint32_t)(ee->ee_edge_type | ee->ee_fill_rule);
+			if (ee->ee_direction < 0) {
+				head |= EdgeHeadNegative;
+			}
+			texture_put_unit(units, precision, 0, head);
+			texture_put_unit(units, precision, 1, render_index_color(rd, &ncolor, &hint, ee->ee_color0));
+			texture_put_unit(units, precision, 2, render_index_color(rd, &ncolor, &hint, ee->ee_color1));
+			texture_put_unit(units, precision, 3, (uint32_t)(ee->ee_anchor0.x - bounds.xmin));
+			texture_put_unit(units, precision, 4, (uint32_t)(ee->ee_anchor0.y - bounds.ymin));
+			texture_put_unit(units, precision, 5, (uint32_t)(ee->ee_anchor1.x - bounds.xmin));
+			texture_put_unit(units, precision, 6, (uint32_t)(ee->ee_anchor1.y - bounds.ymin));
+			size_t n = EdgeLineUnits;
+			if (ee->ee_edge_type == EdgeTypeCurve) {
+				texture_put_unit(units, precision, 7, (uint32_t)(ee->ee_control.x - bounds.xmin));
+				texture_put_unit(units, precision, 8, (uint32_t)(ee->ee_control.y - bounds.ymin));
+				n = EdgeCurveUnits;
+			}
+			units += n*precision/8;
+		}
+	}
+	rd->nedge = 0;
+	rd->nbatch = 0;
+	tu->prev = NULL;
+	tu->next = rd->textures;
+	if (rd->textures != NULL) {
+		rd->textures->prev = tu;
+	}
+	rd->textures = tu;
 	return tu;
 }
 
+static void
+render_flush(struct render *rd) {
+	if (rd->tiler != NULL && rd->target != NULL) {
+		tiler_flush(rd->tiler, rd->target, &rd->clip);
+	}
+}
+
+static void
+render_free_texture(struct render *rd, struct texture *tu) {
+	if (tu->prev != NULL) {
+		tu->prev->next = tu->next;
+	} else {
+		rd->textures = tu->next;
+	}
+	if (tu->next != NULL) {
+		tu->next->prev = tu->prev;
+	}
+	render_dealloc(rd, tu, __FILE__, __LINE__);
+}
+
 void
 render_delete_texture(struct render *rd, struct texture *tu) {
-	struct edge *ee = texture2edge(tu);
-	while (ee != NULL) {
-		struct edge *ne = ee->ee_next;
-		render_delete_edge(rd, ee);
-		ee = ne;
+	if (tu == NULL) {
+		return;
+	}
+	// Texture may be queued.
+	render_flush(rd);
+	render_free_texture(rd, tu);
+}
+
+void
+render_translate_texture(struct render *rd, struct texture *tu, coord_t dx, coord_t dy) {
+	if (tu == NULL) {
+		return;
+	}
+	// Texture may be queued.
+	render_flush(rd);
+	tu->origin.x += dx;
+	tu->origin.y += dy;
+}
+
+void
+render_texture_report(const struct texture *tu, struct texture_report *rp) {
+	memset(rp, 0, sizeof(*rp));
+	if (tu != NULL) {
+		rp->nedge = tu->nedge;
+		rp->ncolor = tu->ncolor - 1;
+		rp->precision = tu->precision;
+		rp->size = tu->size;
 	}
 }
 
@@ -238,10 +323,29 @@ render_create(struct memface *mem, struct logface *log, struct errface *err) {
 	rd->active_color_slabs[ColorTypeSolid] = slab_create(mem, 30, SolidColorSize);
 	rd->active_color_slabs[ColorTypeLinearGradient] = slab_create(mem, 5, GradientColorSize);
 	rd->active_color_slabs[ColorTypeRadialGradient] = rd->active_color_slabs[ColorTypeLinearGradient];
-	rd->edge_slabs[0] = slab_create(mem, EdgeSlabIndex0Nitem, EdgeSlabIndex0Isize);
-	rd->edge_slabs[1] = slab_create(mem, EdgeSlabIndex1Nitem, EdgeSlabIndex1Isize);
-	rd->edge_slabs[2] = slab_create(mem, EdgeSlabIndex2Nitem, EdgeSlabIndex2Isize);
-	rd->edge_slabs[3] = slab_create(mem, EdgeSlabIndex3Nitem, EdgeSlabIndex3Isize);
+	rd->edges = NULL;
+	rd->nedge = rd->edgecap = 0;
+	rd->batches = NULL;
+	rd->nbatch = rd->batchcap = 0;
+	rd->colors = NULL;
+	rd->colorcap = 0;
+	rd->textures = NULL;
+	rd->memface = mem;
+	rd->raster = raster_create(mem);
+	rd->engine = RasterEngineScanline;
+	rd->tiler = NULL;
+	memset(&rd->tiled, 0, sizeof(rd->tiled));
+	rd->target = NULL;
+	rd->span = span_best();
+	rd->nblit = 0;
+	painter_init(&rd->rd_painter);
+	rd->rd_painter.pn_render = rd;
+	rd->rd_painter.pn_fill_rule = FillRuleEvenodd;
+	rd->rd_painter.pn_color0 = rd->rd_painter.pn_color1 = NULL;
+	painter_init(&rd->rd_stroker.sk_painter);
+	rd->rd_stroker.sk_painter.pn_render = rd;
+	rd->rd_stroker.sk_painter.pn_fill_rule = FillRuleEvenodd;
+	rd->rd_stroker.sk_painter.pn_color0 = rd->rd_stroker.sk_painter.pn_color1 = NULL;
 	return rd;
 }
 
@@ -249,6 +353,18 @@ void
 render_delete(struct render *rd) {
 	slab_delete(rd->active_color_slabs[ColorTypeSolid]);
 	slab_delete(rd->active_color_slabs[ColorTypeLinearGradient]);
+	if (rd->tiler != NULL) {
+		tiler_delete(rd->tiler);
+	}
+	while (rd->textures != NULL) {
+		render_free_texture(rd, rd->textures);
+	}
+	render_dealloc(rd, rd->rd_painter.pn_edges, __FILE__, __LINE__);
+	render_dealloc(rd, rd->rd_stroker.sk_painter.pn_edges, __FILE__, __LINE__);
+	render_dealloc(rd, rd->edges, __FILE__, __LINE__);
+	render_dealloc(rd, rd->batches, __FILE__, __LINE__);
+	render_dealloc(rd, rd->colors, __FILE__, __LINE__);
+	raster_delete(rd->raster);
 	render_dealloc(rd, rd, __FILE__, __LINE__);
 }
 
@@ -263,21 +379,23 @@ render_malloc_color(struct render *rd, enum color_type type) {
 
 void
 render_dealloc_color(struct render *rd, union color *co) {
+	render_flush(rd);
 	struct active_color *ac = COLOR2ACTIVE(co);
 	slab_dealloc(rd->active_color_slabs[ac->ac_type], ac);
 }
 
-static void
-point_average(const struct point *anchor0, const struct point *anchor1, struct point *control) {
-	control->x = (anchor0->x + anchor1->x) >> 1;
-	control->y = (anchor0->y + anchor1->y) >> 1;
+void
+render_change_cinfo(struct render *rd, union color *co, struct cinfo *ci) {
+	(void)rd;
+	struct active_color *ac = COLOR2ACTIVE(co);
+	ac->ac_transparent = ci->transparent;
 }
 
-static void
-curve_divide(const struct point *anchor0, const struct point *control, const struct point *anchor1, struct point *control0, struct point *anchorz, struct point *control1) {
-	point_average(anchor0, control, control0);
-	point_average(control, anchor1, control1);
-	point_average(control0, control1, anchorz);
+bool
+render_color_transparent(struct render *rd, const union color *co) {
+	(void)rd;
+	const struct active_color *ac = (const struct active_color *)(((const char *)co) - COLOR_OFFSET);
+	return ac->ac_transparent != 0;
 }
 
 static void
@@ -296,20 +414,16 @@ curve_divide_ratio(const struct point *anchor0, const struct point *control, con
 static void
 painter_add_line(struct painter *pn, const struct point *anchor0, const struct point *anchor1, intreg_t direction) {
 	assert(anchor0->y < anchor1->y);
-	enum fill_rule rule = pn->pn_fill_rule;
-	struct line *le = (void*)render_create_edge(pn->pn_render, EdgeTypeLine, rule);
-	le->le_direction = direction;
-	spoint_import_point(&le->le_anchor0, anchor0);
-	spoint_import_point(&le->le_anchor1, anchor1);
-	le->le_color0 = pn->pn_color0;
-	if (rule == FillRuleSwfedge) {
-		le->le_color1 = pn->pn_color1;
+	if (pn->pn_color0 == NULL) {
+		return;
 	}
-	painter_inset(pn, (struct edge *)le);
+	struct edge *ee = painter_create_edge(pn, EdgeTypeLine);
+	ee->ee_direction = (int16_t)direction;
+	point_clamp(&ee->ee_anchor0, anchor0);
+	point_clamp(&ee->ee_anchor1, anchor1);
 }
 
 #define CurveMaxError	3
-#define CurveMaxDelta	256
 
 static void
 painter_add_curve(struct painter *pn, const struct point *anchor0, struct point *control, const struct point *anchor1, intreg_t direction) {
@@ -325,35 +439,27 @@ painter_add_curve(struct painter *pn, const struct point *anchor0, struct point
 			fixed_t ratio = fixed_div((fixed_t)b, (fixed_t)a);
 			struct point control0[1], anchorz[1], control1[1];
 			curve_divide_ratio(anchor0, control, anchor1, ratio, control0, anchorz, control1);
+			// Curve turns at anchorz, the turned half is reversed.
 			if (anchorz->y < anchor0->y) {
-				direction = -direction;
+				painter_add_curve(pn, anchorz, control0, anchor0, -direction);
+				painter_add_curve(pn, anchorz, control1, anchor1, direction);
+			} else {
+				painter_add_curve(pn, anchor0, control0, anchorz, direction);
+				painter_add_curve(pn, anchor1, control1, anchorz, -direction);
 			}
-			painter_add_curve(pn, anchor0, control0, anchorz, direction);
-			painter_add_curve(pn, anchorz, control1, anchor1, -direction);
 			return;
 		}
 	}
-	if (anchor1->y - anchor0->y > CurveMaxDelta) {
-		coord_t a = anchor1->y - anchor0->y;
-		coord_t b = control->y - anchor0->y;
-		fixed_t ratio = fixed_div((fixed_t)b, (fixed_t)a);
-		struct point control0[1], anchorz[1], control1[1];
-		curve_divide_ratio(anchor0, control, anchor1, ratio, control0, anchorz, control1);
-		painter_add_curve(pn, anchor0, control0, anchorz, direction);
-		painter_add_curve(pn, anchorz, control1, anchor1, direction);
+	// Curves are flattened by rasterizer in pixels of target, so a
+	// y-monotone curve is kept whole whatever its size.
+	if (pn->pn_color0 == NULL) {
 		return;
 	}
-	enum fill_rule rule = pn->pn_fill_rule;
-	struct curve *ce = (void*)render_create_edge(pn->pn_render, EdgeTypeCurve, rule);
-	ce->ce_direction = direction;
-	spoint_import_point(&ce->ce_anchor0, anchor0);
-	spoint_import_point(&ce->ce_control, control);
-	spoint_import_point(&ce->ce_anchor1, anchor1);
-	ce->ce_color0 = pn->pn_color0;
-	if (rule == FillRuleSwfedge) {
-		ce->ce_color1 = pn->pn_color1;
-	}
-	painter_inset(pn, (struct edge *)ce);
+	struct edge *ee = painter_create_edge(pn, EdgeTypeCurve);
+	ee->ee_direction = (int16_t)direction;
+	point_clamp(&ee->ee_anchor0, anchor0);
+	point_clamp(&ee->ee_control, control);
+	point_clamp(&ee->ee_anchor1, anchor1);
 }
 
 static inline void
@@ -403,15 +509,135 @@ painter_set_fillcolor(struct painter *pn, struct active_color *color0, struct ac
 	}
 	pn->pn_color0 = color0;
 	pn->pn_color1 = color1;
-	if (color1 != NULL) {
-		pn->pn_fill_rule = FillRuleSwfedge;
-	}
+	pn->pn_fill_rule = color1 != NULL ? FillRuleSwfedge : FillRuleEvenodd;
 }
 
 void
 render_set_fillcolor(struct render *rd, union color *fill0, union color *fill1) {
 	struct active_color *color0, *color1;
-	color0 = COLOR2ACTIVE(fill0);
-	color1 = COLOR2ACTIVE(fill1);
+	color0 = fill0 != NULL ? COLOR2ACTIVE(fill0) : NULL;
+	color1 = fill1 != NULL ? COLOR2ACTIVE(fill1) : NULL;
 	painter_set_fillcolor(&rd->rd_painter, color0, color1);
 }
+
+void
+render_start_stroke(struct render *rd, union color *co) {
+	struct active_color *ac = COLOR2ACTIVE(co);
+	ac->ac_winding = 1;
+	painter_set_fillcolor(&rd->rd_stroker.sk_painter, ac, NULL);
+}
+
+void
+render_close_stroke(struct render *rd) {
+	painter_set_fillcolor(&rd->rd_stroker.sk_painter, NULL, NULL);
+}
+
+static inline struct painter *
+render_painter(struct render *rd) {
+	struct painter *sk = &rd->rd_stroker.sk_painter;
+	return sk->pn_color0 != NULL ? sk : &rd->rd_painter;
+}
+
+void
+render_move_to(struct render *rd, struct point *pt) {
+	painter_move_to(render_painter(rd), pt);
+}
+
+void
+render_line_to(struct render *rd, struct point *pt) {
+	painter_line_to(render_painter(rd), pt);
+}
+
+void
+render_curve_to(struct render *rd, struct point *control, struct point *anchor1) {
+	painter_curve_to(render_painter(rd), control, anchor1);
+}
+
+bool
+render_set_threads(struct render *rd, size_t nthread) {
+	render_flush(rd);
+	if (rd->tiler != NULL) {
+		tiler_stat(rd->tiler, &rd->tiled);
+		tiler_delete(rd->tiler);
+		rd->tiler = NULL;
+	}
+	if (nthread > 1) {
+		rd->tiler = tiler_create(rd->memface, nthread);
+		if (rd->tiler == NULL) {
+			return false;
+		}
+		tiler_set_engine(rd->tiler, rd->engine);
+	}
+	return true;
+}
+
+void
+render_set_engine(struct render *rd, enum raster_engine engine) {
+	render_flush(rd);
+	rd->engine = engine;
+	raster_set_engine(rd->raster, engine);
+	if (rd->tiler != NULL) {
+		tiler_set_engine(rd->tiler, engine);
+	}
+}
+
+void
+render_set_target(struct render *rd, struct bufctx *bx, const struct rectangle *clip) {
+	render_flush(rd);
+	rd->target = bx;
+	if (bx != NULL) {
+		rd->clip = *clip;
+	}
+}
+
+void
+render_commit_texture(struct render *rd, struct texture *tu) {
+	if (rd->target == NULL || tu == NULL) {
+		return;
+	}
+	if (rd->tiler != NULL) {
+		tiler_queue(rd->tiler, tu);
+	} else {
+		raster_fill_texture(rd->raster, tu, rd->target, &rd->clip);
+	}
+}
+
+void
+render_blit(struct render *rd, const struct bufctx *src, coord_t x, coord_t y) {
+	if (rd->target == NULL) {
+		return;
+	}
+	// Textures committed before are under src.
+	render_flush(rd);
+	const struct rectangle *clip = &rd->clip;
+	coord_t xmin = x > clip->xmin ? x : clip->xmin;
+	coord_t ymin = y > clip->ymin ? y : clip->ymin;
+	coord_t xmax = x + (coord_t)src->width;
+	coord_t ymax = y + (coord_t)src->height;
+	xmax = xmax < clip->xmax ? xmax : clip->xmax;
+	ymax = ymax < clip->ymax ? ymax : clip->ymax;
+	if (xmin >= xmax || ymin >= ymax) {
+		return;
+	}
+	size_t n = (size_t)(xmax - xmin);
+	for (coord_t j=ymin; j<ymax; j++) {
+		struct rgba8 *dst = rd->target->pixels + (size_t)j*rd->target->stride + xmin;
+		const struct rgba8 *row = src->pixels + (size_t)(j-y)*src->stride + (xmin-x);
+		rd->span->blend_pixels(dst, row, n);
+	}
+	rd->nblit += n*(size_t)(ymax - ymin);
+}
+
+const struct render_stat *
+render_stat(struct render *rd) {
+	rd->stat = *raster_stat(rd->raster);
+	rd->stat.npixel += rd->nblit;
+	rd->stat.ntexture += rd->tiled.ntexture;
+	rd->stat.nedge += rd->tiled.nedge;
+	rd->stat.nline += rd->tiled.nline;
+	rd->stat.npixel += rd->tiled.npixel;
+	if (rd->tiler != NULL) {
+		tiler_stat(rd->tiler, &rd->stat);
+	}
+	return &rd->stat;
+}
@@ -4,6 +4,7 @@
 #include <base/intreg.h>
 #include <base/matrix.h>
 #include <base/struct.h>
+#include "common.h"
 
 struct memface;
 struct logface;
@@ -19,9 +20,83 @@ struct texture *render_return_texture(struct render *rd);
 
 void render_commit_texture(struct render *rd, struct texture *ca);
 void render_delete_texture(struct render *rd, struct texture *ca);
+// Move edges of texture by dx and dy twips.
+void render_translate_texture(struct render *rd, struct texture *ca, coord_t dx, coord_t dy);
 
+// Storage of a texture. Coordinates of edges take 16 bits if texture spans
+// no more than 65535 twips, about 3276 pixels, each way, 32 bits otherwise.
+struct texture_report {
+	size_t nedge;
+	size_t ncolor;
+	// Bits per coordinate.
+	size_t precision;
+	// Bytes of texture, edges, colors and header.
+	size_t size;
+};
+
+// Report storage of ca, all zero if ca is NULL.
+void render_texture_report(const struct texture *ca, struct texture_report *rp);
+
+// Premultiplied pixels, row after row. Stride is number of pixels from a
+// row to the next.
+struct bufctx {
+	struct rgba8 *pixels;
+	size_t width;
+	size_t height;
+	size_t stride;
+};
+
+struct rectangle;
+
+// Textures committed later are rasterized into bx, clipped to clip in
+// pixels. Texture coordinates are twips of bx, 20 twips per pixel. NULL bx
+// stops rasterizing.
+void render_set_target(struct render *rd, struct bufctx *bx, const struct rectangle *clip);
+
+// Composite premultiplied pixels of src over target, with top left pixel
+// at x and y, clipped to clip. Textures committed before are rasterized
+// first.
+void render_blit(struct render *rd, const struct bufctx *src, coord_t x, coord_t y);
+
+// Rasterize textures in tiles on nthread threads, including caller. Frames
+// come out same as rasterized by one thread. Committed textures are queued
+// until target changes, so their edges and colors must live until then.
+// Memface must be thread safe if nthread is above one. One, the default,
+// rasterizes textures as they are committed.
+// Return false if threads can't be started, textures are rasterized by
+// caller then.
+bool render_set_threads(struct render *rd, size_t nthread);
+
+// Select rasterizer engine for textures committed later, see raster.h.
+// RasterEngineScanline is the default.
+void render_set_engine(struct render *rd, enum raster_engine engine);
+
+// Work of rasterizer since render was created.
+struct render_stat {
+	size_t ntexture;
+	size_t nedge;
+	// Lines edges are flattened into, curves are flattened to within a
+	// tenth of a pixel.
+	size_t nline;
+	// Pixels composited, a pixel covered by n colors counts n times.
+	size_t npixel;
+};
+
+const struct render_stat *render_stat(struct render *rd);
+
+enum gradient_spread {
+	GradientSpreadPad,
+	GradientSpreadReflect,
+	GradientSpreadRepeat,
+};
+
+// invmat maps twips of target into gradient square, which spans -16384 to
+// 16384 on both axes. ramps are premultiplied. focal is focal point of
+// radial gradient on x axis of unit circle, zero for plain radial gradient.
 struct gradient {
 	struct matrix invmat;
+	enum gradient_spread spread;
+	fixed_t focal;
 	struct rgba8 ramps[256];
 };
 
@@ -38,7 +113,6 @@ enum color_type {
 	ColorTypeNumber
 };
 
-// XXX If type is Gradient, return value's invmat is a revert matrix.
 union color *render_malloc_color(struct render *rd, enum color_type type);
 void render_dealloc_color(struct render *rd, union color *co);
 
@@ -46,10 +120,13 @@ struct cinfo {
 	bool transparent;
 };
 void render_change_cinfo(struct render *rd, union color *co, struct cinfo *ci);
+bool render_color_transparent(struct render *rd, const union color *co);
 
 void render_set_fillcolor(struct render *rd, union color *fill0, union color *fill1);
-void render_set_linewidth(struct render *rd, uintreg_t width);
 
+// Path between render_start_stroke() and render_close_stroke() is a stroke
+// expanded into fill, which is filled in co by nonzero rule. co is a stroke
+// color only.
 void render_start_stroke(struct render *rd, union color *co);
 void render_close_stroke(struct render *rd);
 
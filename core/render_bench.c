@@ -0,0 +1,489 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "bench.h"
+#include "player.h"
+#include "muplex.h"
+#include "render.h"
+#include "common.h"
+#include <base/hash.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH		1280
+#define HEIGHT		720
+#define NFRAME		60
+
+// Star polygons of npoint points, or blobs of npoint/2 curves, scattered
+// over stage and moved every frame. Gradient fills alternate linear and
+// radial ones across shape. If stroke is not zero, shapes are instead
+// polylines wandering within radius, stroked stroke twips wide.
+static void
+build_movie(struct swfgen *sg, size_t nshape, size_t npoint, intreg_t radius, bool curved, bool gradient, uintreg_t stroke) {
+	uint32_t seed = 29;
+	intreg_t *pts = malloc(sizeof(intreg_t)*2*npoint);
+	swfgen_init(sg, WIDTH*20, HEIGHT*20, NFRAME);
+	for (size_t i=0; i<nshape; i++) {
+		if (stroke != 0) {
+			double a = 2*3.14159265358979*(double)(bench_random(&seed)%360)/360;
+			double step = 2*(double)radius/(double)npoint;
+			pts[0] = pts[1] = 0;
+			for (size_t j=1; j<npoint; j++) {
+				a += ((double)(bench_random(&seed)%100) - 50)/100;
+				pts[2*j] = pts[2*j-2] + (intreg_t)(step*cos(a));
+				pts[2*j+1] = pts[2*j-1] + (intreg_t)(step*sin(a));
+			}
+			swfgen_stroke(sg, (uintreg_t)i+1, pts, npoint, stroke, bench_random(&seed));
+			continue;
+		}
+		for (size_t j=0; j<npoint; j++) {
+			double a = 2*3.14159265358979*(double)j/(double)npoint;
+			double r = (double)radius * ((j%2) ? 0.5 + (double)(bench_random(&seed)%50)/100 : 1.0);
+			pts[2*j] = (intreg_t)(r*cos(a));
+			pts[2*j+1] = (intreg_t)(r*sin(a));
+		}
+		struct swfgen_fill fill = {.type = FillStyleSolid, .rgb = bench_random(&seed)};
+		if (gradient) {
+			fill.type = i%2 ? FillStyleRadialGradient : FillStyleLinearGradient;
+			fill.rgb2 = bench_random(&seed);
+			fill.size = 2*radius;
+		}
+		swfgen_shape_fill(sg, (uintreg_t)i+1, pts, npoint, &fill, curved);
+	}
+	for (size_t f=0; f<NFRAME; f++) {
+		for (size_t i=0; i<nshape; i++) {
+			intreg_t tx = (intreg_t)(bench_random(&seed) % (WIDTH*20));
+			intreg_t ty = (intreg_t)(bench_random(&seed) % (HEIGHT*20));
+			swfgen_place(sg, f == 0 ? (uintreg_t)i+1 : 0, (uintreg_t)i+1, tx, ty);
+		}
+		swfgen_show(sg);
+	}
+	swfgen_finish(sg);
+	free(pts);
+}
+
+static const char *EngineNames[] = {
+	[RasterEngineScanline] = "scanline",
+	[RasterEngineAccumulate] = "accumulate",
+};
+
+// Render movie by nthread threads, return hash of all frames. Whole stage
+// is redrawn every frame, unless damaged is true.
+static uint64_t
+bench_play(const char *name, const struct swfgen *sg, enum raster_engine engine, size_t nthread, bool damaged) {
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, sg->buf, StreamData);
+	if (!player_set_threads(pl, nthread)) {
+		fprintf(stderr, "fail to start %zu threads.\n", nthread);
+		exit(1);
+	}
+	player_set_engine(pl, engine);
+
+	struct bufctx bx;
+	bx.width = bx.stride = WIDTH;
+	bx.height = HEIGHT;
+	bx.pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	struct transform tsm;
+	matrix_identify(&tsm.matrix);
+	cxform_identify(&tsm.cxform);
+
+	struct render_stat before = *player_render_stat(pl);
+	double total = 0;
+	uint64_t hash = 0;
+	for (size_t f=0; f<NFRAME; f++) {
+		player_advance(pl);
+		struct rectangle rt = {0, WIDTH, 0, HEIGHT};
+		if (damaged) {
+			rt = (struct rectangle){0, 0, 0, 0};
+		}
+		double beg = bench_now();
+		player_render(pl, tsm, &bx, &rt);
+		total += bench_now() - beg;
+		hash = hash*31 + hash_bytes(bx.pixels, sizeof(struct rgba8)*WIDTH*HEIGHT);
+	}
+	const struct render_stat *after = player_render_stat(pl);
+	double sec = total/1e3;
+	double nedge = (double)(after->nedge - before.nedge);
+	double npixel = (double)(after->npixel - before.npixel);
+	printf("\t%-24s %-10s %zu threads %8.3f ms/frame, %8.1f Mpixels/s stage, %8.1f Mpixels/s filled, %8.2f Medges/s%s\n",
+		name, EngineNames[engine], nthread, total/NFRAME, (double)WIDTH*HEIGHT*NFRAME/sec/1e6, npixel/sec/1e6, nedge/sec/1e6, damaged ? ", damaged" : "");
+
+	free(bx.pixels);
+	player_delete(pl);
+	mux->delete_muplex(mux->muplex);
+	return hash;
+}
+
+// Frames rendered by threads must be bit-exact with single-threaded ones.
+static void
+bench_threads(const char *name, const struct swfgen *sg) {
+	static const size_t Threads[] = {1, 2, 4, 8};
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		uint64_t hash = 0;
+		for (size_t i=0; i<sizeof(Threads)/sizeof(Threads[0]); i++) {
+			uint64_t h = bench_play(name, sg, (enum raster_engine)engine, Threads[i], false);
+			if (i == 0) {
+				hash = h;
+			} else if (h != hash) {
+				fprintf(stderr, "%s: frames of %zu threads differ from single-threaded ones of %s engine.\n", name, Threads[i], EngineNames[engine]);
+				exit(1);
+			}
+		}
+	}
+}
+
+static void
+bench_render(const char *name, size_t nshape, size_t npoint, intreg_t radius, bool curved, bool gradient, uintreg_t stroke) {
+	struct swfgen sg;
+	build_movie(&sg, nshape, npoint, radius, curved, gradient, stroke);
+	bench_threads(name, &sg);
+	swfgen_free(&sg);
+}
+
+// Layers of opaque panels, rectangles and rotated octagons, each over
+// nblob blobs, panels sliding every frame. Most blobs are hidden by
+// panels above them.
+static void
+bench_skin(const char *name, size_t nlayer, size_t nblob) {
+	uint32_t seed = 41;
+	intreg_t pts[2*16];
+	struct swfgen sg;
+	swfgen_init(&sg, WIDTH*20, HEIGHT*20, NFRAME);
+	uintreg_t id = 0;
+	for (size_t l=0; l<nlayer; l++) {
+		for (size_t i=0; i<nblob; i++) {
+			for (size_t j=0; j<16; j++) {
+				double a = 2*3.14159265358979*(double)j/16;
+				double r = 400 * ((j%2) ? 0.5 + (double)(bench_random(&seed)%50)/100 : 1.0);
+				pts[2*j] = (intreg_t)(r*cos(a));
+				pts[2*j+1] = (intreg_t)(r*sin(a));
+			}
+			swfgen_shape(&sg, ++id, pts, 16, bench_random(&seed), true);
+		}
+		if (l%2 == 0) {
+			intreg_t w = WIDTH*15, h = HEIGHT*15;
+			intreg_t panel[8] = {0, 0, w, 0, w, h, 0, h};
+			swfgen_polygon(&sg, ++id, panel, 4, bench_random(&seed));
+		} else {
+			double phase = (double)(bench_random(&seed)%100)/100;
+			for (size_t j=0; j<8; j++) {
+				double a = 2*3.14159265358979*((double)j + phase)/8;
+				pts[2*j] = (intreg_t)(HEIGHT*8*cos(a));
+				pts[2*j+1] = (intreg_t)(HEIGHT*8*sin(a));
+			}
+			swfgen_polygon(&sg, ++id, pts, 8, bench_random(&seed));
+		}
+	}
+	for (size_t f=0; f<NFRAME; f++) {
+		for (uintreg_t i=1; i<=id; i++) {
+			bool panel = i%(nblob+1) == 0;
+			if (f != 0 && !panel) {
+				continue;
+			}
+			intreg_t tx = (intreg_t)(bench_random(&seed) % (WIDTH*20));
+			intreg_t ty = (intreg_t)(bench_random(&seed) % (HEIGHT*20));
+			if (panel) {
+				// Panels stay over most of stage.
+				tx = tx/4;
+				ty = ty/4;
+				if ((i/(nblob+1))%2 == 0) {
+					// Octagons are centered.
+					tx += WIDTH*20/2 - WIDTH*20/8;
+					ty += HEIGHT*20/2 - HEIGHT*20/8;
+				}
+			}
+			swfgen_place(&sg, f == 0 ? i : 0, i, tx, ty);
+		}
+		swfgen_show(&sg);
+	}
+	swfgen_finish(&sg);
+	bench_threads(name, &sg);
+	swfgen_free(&sg);
+}
+
+// Polygons scattered over stage, of which nmove ones move every frame.
+// Frames redrawn by damage must be bit-exact with ones redrawn whole.
+static void
+bench_damage(const char *name, size_t nshape, size_t nmove) {
+	uint32_t seed = 37;
+	intreg_t pts[2*16];
+	struct swfgen sg;
+	swfgen_init(&sg, WIDTH*20, HEIGHT*20, NFRAME);
+	for (size_t i=0; i<nshape; i++) {
+		for (size_t j=0; j<16; j++) {
+			double a = 2*3.14159265358979*(double)j/16;
+			double r = 600 * ((j%2) ? 0.5 + (double)(bench_random(&seed)%50)/100 : 1.0);
+			pts[2*j] = (intreg_t)(r*cos(a));
+			pts[2*j+1] = (intreg_t)(r*sin(a));
+		}
+		swfgen_polygon(&sg, (uintreg_t)i+1, pts, 16, bench_random(&seed));
+	}
+	for (size_t f=0; f<NFRAME; f++) {
+		for (size_t i=0; i<nshape; i++) {
+			if (f != 0 && i >= nmove) {
+				break;
+			}
+			intreg_t tx = (intreg_t)(bench_random(&seed) % (WIDTH*20));
+			intreg_t ty = (intreg_t)(bench_random(&seed) % (HEIGHT*20));
+			swfgen_place(&sg, f == 0 ? (uintreg_t)i+1 : 0, (uintreg_t)i+1, tx, ty);
+		}
+		swfgen_show(&sg);
+	}
+	swfgen_finish(&sg);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		uint64_t whole = bench_play(name, &sg, (enum raster_engine)engine, 1, false);
+		uint64_t damaged = bench_play(name, &sg, (enum raster_engine)engine, 1, true);
+		if (whole != damaged) {
+			fprintf(stderr, "%s: frames redrawn by damage differ from whole ones of %s engine.\n", name, EngineNames[engine]);
+			exit(1);
+		}
+	}
+	swfgen_free(&sg);
+}
+
+// Map of ngrid x ngrid tile sprites, each of ntile polygons, eight times
+// as large as stage and scrolled under it. Tiles off stage are skipped
+// whole. Frames redrawn by damage must be bit-exact with ones redrawn
+// whole.
+static void
+bench_scroll(const char *name, size_t ngrid, size_t ntile) {
+	uint32_t seed = 43;
+	intreg_t pts[2*16];
+	intreg_t tilew = WIDTH*20*8/(intreg_t)ngrid;
+	intreg_t tileh = HEIGHT*20*8/(intreg_t)ngrid;
+	struct swfgen sg;
+	swfgen_init(&sg, WIDTH*20, HEIGHT*20, NFRAME);
+	uintreg_t id = 0;
+	for (size_t i=0; i<ngrid*ngrid; i++) {
+		uintreg_t first = id+1;
+		for (size_t j=0; j<ntile; j++) {
+			for (size_t k=0; k<16; k++) {
+				double a = 2*3.14159265358979*(double)k/16;
+				double r = 600 * ((k%2) ? 0.5 + (double)(bench_random(&seed)%50)/100 : 1.0);
+				pts[2*k] = (intreg_t)(r*cos(a));
+				pts[2*k+1] = (intreg_t)(r*sin(a));
+			}
+			swfgen_polygon(&sg, ++id, pts, 16, bench_random(&seed));
+		}
+		size_t pos = swfgen_begin_sprite(&sg, ++id, 1);
+		for (uintreg_t j=first; j<id; j++) {
+			intreg_t tx = (intreg_t)(bench_random(&seed) % (uint32_t)tilew);
+			intreg_t ty = (intreg_t)(bench_random(&seed) % (uint32_t)tileh);
+			swfgen_place(&sg, j, j-first+1, tx, ty);
+		}
+		swfgen_show(&sg);
+		swfgen_end_sprite(&sg, pos);
+	}
+	uintreg_t map = id+1;
+	size_t pos = swfgen_begin_sprite(&sg, map, 1);
+	for (size_t i=0; i<ngrid*ngrid; i++) {
+		uintreg_t tile = (uintreg_t)(i+1)*((uintreg_t)ntile+1);
+		swfgen_place(&sg, tile, (uintreg_t)i+1, (intreg_t)(i%ngrid)*tilew, (intreg_t)(i/ngrid)*tileh);
+	}
+	swfgen_show(&sg);
+	swfgen_end_sprite(&sg, pos);
+	for (size_t f=0; f<NFRAME; f++) {
+		intreg_t tx = -WIDTH*20*7/2 + (intreg_t)f*97;
+		intreg_t ty = -HEIGHT*20*7/2 + (intreg_t)f*61;
+		swfgen_place(&sg, f == 0 ? map : 0, 1, tx, ty);
+		swfgen_show(&sg);
+	}
+	swfgen_finish(&sg);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		uint64_t whole = bench_play(name, &sg, (enum raster_engine)engine, 1, false);
+		uint64_t damaged = bench_play(name, &sg, (enum raster_engine)engine, 1, true);
+		if (whole != damaged) {
+			fprintf(stderr, "%s: frames redrawn by damage differ from whole ones of %s engine.\n", name, EngineNames[engine]);
+			exit(1);
+		}
+	}
+	swfgen_free(&sg);
+}
+
+// Panels of nblob curved blobs slide over stage, they are placed with
+// cacheAsBitmap if cached. Frames redrawn by damage must be bit-exact with
+// ones redrawn whole.
+static void
+build_panels(struct swfgen *sg, size_t npanel, size_t nblob, bool cached) {
+	uint32_t seed = 47;
+	intreg_t pts[2*32];
+	swfgen_init(sg, WIDTH*20, HEIGHT*20, NFRAME);
+	uintreg_t id = 0;
+	for (size_t i=0; i<npanel; i++) {
+		uintreg_t first = id+1;
+		for (size_t j=0; j<nblob; j++) {
+			for (size_t k=0; k<32; k++) {
+				double a = 2*3.14159265358979*(double)k/32;
+				double r = 400 * ((k%2) ? 0.5 + (double)(bench_random(&seed)%50)/100 : 1.0);
+				pts[2*k] = (intreg_t)(r*cos(a));
+				pts[2*k+1] = (intreg_t)(r*sin(a));
+			}
+			swfgen_shape(sg, ++id, pts, 32, bench_random(&seed), true);
+		}
+		size_t pos = swfgen_begin_sprite(sg, ++id, 1);
+		for (uintreg_t j=first; j<id; j++) {
+			intreg_t tx = (intreg_t)(bench_random(&seed) % (WIDTH*20/3));
+			intreg_t ty = (intreg_t)(bench_random(&seed) % (HEIGHT*20/3));
+			swfgen_place(sg, j, j-first+1, tx, ty);
+		}
+		swfgen_show(sg);
+		swfgen_end_sprite(sg, pos);
+	}
+	for (size_t f=0; f<NFRAME; f++) {
+		for (size_t i=0; i<npanel; i++) {
+			uintreg_t panel = (uintreg_t)(i+1)*((uintreg_t)nblob+1);
+			intreg_t tx = (intreg_t)((i*WIDTH*20/npanel + f*(37+i*13)) % (WIDTH*20*2/3));
+			intreg_t ty = (intreg_t)((i*HEIGHT*20/npanel + f*(23+i*7)) % (HEIGHT*20*2/3));
+			if (f != 0) {
+				swfgen_place(sg, 0, (uintreg_t)i+1, tx, ty);
+			} else if (cached) {
+				swfgen_place_cached(sg, panel, (uintreg_t)i+1, tx, ty);
+			} else {
+				swfgen_place(sg, panel, (uintreg_t)i+1, tx, ty);
+			}
+		}
+		swfgen_show(sg);
+	}
+	swfgen_finish(sg);
+}
+
+static void
+bench_panels(const char *name, size_t npanel, size_t nblob) {
+	for (int cached=0; cached<2; cached++) {
+		struct swfgen sg;
+		build_panels(&sg, npanel, nblob, cached != 0);
+		printf("	%s%s:\n", name, cached ? ", cached as bitmap" : "");
+		for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+			uint64_t whole = bench_play(name, &sg, (enum raster_engine)engine, 1, false);
+			uint64_t damaged = bench_play(name, &sg, (enum raster_engine)engine, 1, true);
+			if (whole != damaged) {
+				fprintf(stderr, "%s: frames redrawn by damage differ from whole ones of %s engine.\n", name, EngineNames[engine]);
+				exit(1);
+			}
+		}
+		swfgen_free(&sg);
+	}
+}
+
+// Grid of blobs around origin of stage, rendered once at each zoom level
+// around center of target. Edges of shapes are counted before and after
+// curves are flattened.
+static void
+bench_zoom(const char *name, size_t ngrid, size_t npoint, intreg_t radius) {
+	static const double Zooms[] = {0.25, 1, 4, 16};
+	uint32_t seed = 31;
+	intreg_t *pts = malloc(sizeof(intreg_t)*2*npoint);
+	struct swfgen sg;
+	swfgen_init(&sg, WIDTH*20, HEIGHT*20, 1);
+	size_t nshape = ngrid*ngrid;
+	for (size_t i=0; i<nshape; i++) {
+		for (size_t j=0; j<npoint; j++) {
+			double a = 2*3.14159265358979*(double)j/(double)npoint;
+			double r = (double)radius * ((j%2) ? 0.5 + (double)(bench_random(&seed)%50)/100 : 1.0);
+			pts[2*j] = (intreg_t)(r*cos(a));
+			pts[2*j+1] = (intreg_t)(r*sin(a));
+		}
+		struct swfgen_fill fill = {.type = FillStyleSolid, .rgb = bench_random(&seed)};
+		swfgen_shape_fill(&sg, (uintreg_t)i+1, pts, npoint, &fill, true);
+		intreg_t tx = ((intreg_t)(i%ngrid)*2 - (intreg_t)ngrid + 1)*radius;
+		intreg_t ty = ((intreg_t)(i/ngrid)*2 - (intreg_t)ngrid + 1)*radius;
+		swfgen_place(&sg, (uintreg_t)i+1, (uintreg_t)i+1, tx, ty);
+	}
+	swfgen_show(&sg);
+	swfgen_finish(&sg);
+	free(pts);
+
+	struct bufctx bx;
+	bx.width = bx.stride = WIDTH;
+	bx.height = HEIGHT;
+	bx.pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	for (size_t i=0; i<sizeof(Zooms)/sizeof(Zooms[0]); i++) {
+		struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+		struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+		player_load0(pl, sg.buf, StreamData);
+		player_advance(pl);
+		struct transform tsm;
+		matrix_identify(&tsm.matrix);
+		cxform_identify(&tsm.cxform);
+		tsm.matrix.sx = tsm.matrix.sy = (scale_t)(Zooms[i]*FIXED_1);
+		tsm.matrix.tx = WIDTH*10;
+		tsm.matrix.ty = HEIGHT*10;
+		struct rectangle rt = {0, WIDTH, 0, HEIGHT};
+		double beg = bench_now();
+		player_render(pl, tsm, &bx, &rt);
+		double msec = bench_now() - beg;
+		const struct render_stat *st = player_render_stat(pl);
+		printf("\t%-24s zoom %5.2f %8.3f ms, %8.1f edges/shape, %8.1f lines/shape\n",
+			name, Zooms[i], msec, (double)st->nedge/(double)nshape, (double)st->nline/(double)nshape);
+		player_delete(pl);
+		mux->delete_muplex(mux->muplex);
+	}
+	free(bx.pixels);
+	swfgen_free(&sg);
+}
+
+// Star of npoint points built straight into a texture, and its storage.
+// Stars wider than 65535 twips take 32 bits coordinates.
+static void
+bench_texture(const char *name, size_t npoint, intreg_t radius, bool curved) {
+	uint32_t seed = 37;
+	struct render *rd = render_create(&BenchMemface, &BenchLogface, &BenchErrface);
+	union color *co = render_malloc_color(rd, ColorTypeSolid);
+	co->solid = (struct rgba8){255, 0, 0, 255};
+	struct point *pts = malloc(sizeof(struct point)*npoint);
+	for (size_t j=0; j<npoint; j++) {
+		double a = 2*3.14159265358979*(double)j/(double)npoint;
+		double r = (double)radius * ((j%2) ? 0.5 + (double)(bench_random(&seed)%50)/100 : 1.0);
+		pts[j].x = (coord_t)(r*cos(a));
+		pts[j].y = (coord_t)(r*sin(a));
+	}
+	double beg = bench_now();
+	render_set_fillcolor(rd, co, NULL);
+	render_move_to(rd, &pts[npoint-1]);
+	for (size_t j=0; j<npoint; j++) {
+		if (curved && j%2 == 0) {
+			render_curve_to(rd, &pts[j], &pts[(j+1)%npoint]);
+			j++;
+		} else {
+			render_line_to(rd, &pts[j]);
+		}
+	}
+	struct texture *tu = render_return_texture(rd);
+	double msec = bench_now() - beg;
+	struct texture_report rp;
+	render_texture_report(tu, &rp);
+	printf("\t%-24s %8.3f ms built, %zu edges, %zu bits coordinates, %zu bytes, %6.2f bytes/edge\n",
+		name, msec, rp.nedge, rp.precision, rp.size, (double)rp.size/(double)rp.nedge);
+	render_delete_texture(rd, tu);
+	render_dealloc_color(rd, co);
+	render_delete(rd);
+	free(pts);
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	printf("Rasterizing %dx%d stage, start.\n", WIDTH, HEIGHT);
+	bench_render("100 large polygons", 100, 16, 4000, false, false, 0);
+	bench_render("1000 small polygons", 1000, 16, 400, false, false, 0);
+	bench_render("200 curved blobs", 200, 32, 2000, true, false, 0);
+	bench_render("50 detailed stars", 50, 512, 3000, false, false, 0);
+	bench_render("100 gradient blobs", 100, 32, 4000, true, true, 0);
+	bench_render("3000 glyph-sized blobs", 3000, 24, 160, true, false, 0);
+	bench_render("400 stroked roads", 400, 24, 3000, false, false, 60);
+	bench_render("100k edges in 20 stars", 20, 5000, 3000, false, false, 0);
+	bench_render("100k edges in 4000 polygons", 4000, 25, 600, false, false, 0);
+	bench_skin("5 layers of skin", 5, 200);
+	bench_damage("500 polygons, 10 moving", 500, 10);
+	bench_scroll("32x32 tiles scrolled", 32, 8);
+	bench_panels("4 sliding panels", 4, 300);
+	bench_zoom("8x8 zoomed blobs", 8, 32, 100);
+	bench_texture("100k-edge star", 100000, 30000, false);
+	bench_texture("100k-edge curved star", 100000, 30000, true);
+	bench_texture("100k-edge huge star", 100000, 300000, false);
+	printf("Rasterizing, done.\n");
+	return 0;
+}
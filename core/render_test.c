@@ -0,0 +1,875 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "bench.h"
+#include "player.h"
+#include "muplex.h"
+#include "render.h"
+#include "raster.h"
+#include "edge.h"
+#include "common.h"
+#include <base/hash.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Stage spans several tile rows of tiler.
+#define WIDTH		320
+#define HEIGHT		192
+#define NFRAME		6
+
+// Render movie, return hash of all frames, and hashes of frames in frames
+// if it is not NULL. Whole stage is redrawn every frame, unless damaged is
+// true.
+static uint64_t
+render_test_play(const struct swfgen *sg, enum raster_engine engine, size_t nthread, bool damaged, uint64_t *frames, struct render_stat *st) {
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, sg->buf, StreamData);
+	bool started = player_set_threads(pl, nthread);
+	assert(started);
+	(void)started;
+	player_set_engine(pl, engine);
+
+	struct bufctx bx;
+	bx.width = bx.stride = WIDTH;
+	bx.height = HEIGHT;
+	bx.pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	struct transform tsm;
+	matrix_identify(&tsm.matrix);
+	cxform_identify(&tsm.cxform);
+	uint64_t hash = 0;
+	for (size_t f=0; f<NFRAME; f++) {
+		player_advance(pl);
+		struct rectangle rt = {0, WIDTH, 0, HEIGHT};
+		if (damaged) {
+			rt = (struct rectangle){0, 0, 0, 0};
+		}
+		player_render(pl, tsm, &bx, &rt);
+		uint64_t h = hash_bytes(bx.pixels, sizeof(struct rgba8)*WIDTH*HEIGHT);
+		if (frames != NULL) {
+			frames[f] = h;
+		}
+		hash = hash*31 + h;
+	}
+	if (st != NULL) {
+		*st = *player_render_stat(pl);
+	}
+	free(bx.pixels);
+	player_delete(pl);
+	mux->delete_muplex(mux->muplex);
+	return hash;
+}
+
+// Star of npoint points, or blob of npoint/2 curves.
+static void
+render_test_star(intreg_t *pts, size_t npoint, intreg_t radius, uint32_t *seed) {
+	for (size_t j=0; j<npoint; j++) {
+		double a = 2*3.14159265358979*(double)j/(double)npoint;
+		double r = (double)radius * ((j%2) ? 0.5 + (double)(bench_random(seed)%50)/100 : 1.0);
+		pts[2*j] = (intreg_t)(r*cos(a));
+		pts[2*j+1] = (intreg_t)(r*sin(a));
+	}
+}
+
+// Stars and blobs taller than tiles, moved every frame.
+static void
+render_test_threads(void) {
+	printf("render_test_threads(), start.\n");
+	uint32_t seed = 17;
+	intreg_t pts[2*64];
+	struct swfgen sg;
+	swfgen_init(&sg, WIDTH*20, HEIGHT*20, NFRAME);
+	for (uintreg_t i=1; i<=8; i++) {
+		render_test_star(pts, 64, 1200 + (intreg_t)i*200, &seed);
+		swfgen_shape(&sg, i, pts, 64, bench_random(&seed), i%2 == 0);
+	}
+	for (size_t f=0; f<NFRAME; f++) {
+		for (uintreg_t i=1; i<=8; i++) {
+			intreg_t tx = (intreg_t)(bench_random(&seed) % (WIDTH*20));
+			intreg_t ty = (intreg_t)(bench_random(&seed) % (HEIGHT*20));
+			swfgen_place(&sg, f == 0 ? i : 0, i, tx, ty);
+		}
+		swfgen_show(&sg);
+	}
+	swfgen_finish(&sg);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		uint64_t single = render_test_play(&sg, (enum raster_engine)engine, 1, false, NULL, NULL);
+		uint64_t tiled = render_test_play(&sg, (enum raster_engine)engine, 3, false, NULL, NULL);
+		assert(tiled == single);
+		(void)single; (void)tiled;
+	}
+	swfgen_free(&sg);
+	printf("render_test_threads(), done.\n");
+}
+
+// Texture of a star built at (dx, dy), or at origin and translated by
+// (dx, dy) if translate is true, rastered in clips of strip rows. Return
+// hash of pixels.
+static uint64_t
+render_test_texture(enum raster_engine engine, intreg_t radius, coord_t dx, coord_t dy, bool translate, coord_t strip, struct texture_report *rp) {
+	uint32_t seed = 23;
+	intreg_t pts[2*48];
+	render_test_star(pts, 48, radius, &seed);
+	struct render *rd = render_create(&BenchMemface, &BenchLogface, &BenchErrface);
+	render_set_engine(rd, engine);
+	union color *co = render_malloc_color(rd, ColorTypeSolid);
+	co->solid = (struct rgba8){255, 0, 0, 255};
+	render_set_fillcolor(rd, co, NULL);
+	coord_t ox = translate ? 0 : dx, oy = translate ? 0 : dy;
+	struct point pt = {(coord_t)pts[2*47] + ox, (coord_t)pts[2*47+1] + oy};
+	render_move_to(rd, &pt);
+	for (size_t j=0; j<48; j+=2) {
+		struct point control = {(coord_t)pts[2*j] + ox, (coord_t)pts[2*j+1] + oy};
+		struct point anchor = {(coord_t)pts[2*j+2] + ox, (coord_t)pts[2*j+3] + oy};
+		render_curve_to(rd, &control, &anchor);
+	}
+	struct texture *tu = render_return_texture(rd);
+	if (translate) {
+		render_translate_texture(rd, tu, dx, dy);
+	}
+	render_texture_report(tu, rp);
+
+	struct bufctx bx;
+	bx.width = bx.stride = WIDTH;
+	bx.height = HEIGHT;
+	bx.pixels = calloc(WIDTH*HEIGHT, sizeof(struct rgba8));
+	for (coord_t y=0; y<HEIGHT; y+=strip) {
+		struct rectangle rt = {0, WIDTH, y, y+strip < HEIGHT ? y+strip : HEIGHT};
+		render_set_target(rd, &bx, &rt);
+		render_commit_texture(rd, tu);
+		render_set_target(rd, NULL, NULL);
+	}
+	uint64_t hash = hash_bytes(bx.pixels, sizeof(struct rgba8)*WIDTH*HEIGHT);
+	free(bx.pixels);
+	render_delete_texture(rd, tu);
+	render_dealloc_color(rd, co);
+	render_delete(rd);
+	return hash;
+}
+
+// Textures moved are same as ones built where they are moved to, with 16
+// and 32 bits coordinates.
+static void
+render_test_translate(void) {
+	printf("render_test_translate(), start.\n");
+	static const intreg_t Radius[] = {1500, 40000};
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		for (size_t i=0; i<sizeof(Radius)/sizeof(Radius[0]); i++) {
+			struct texture_report built, moved;
+			uint64_t a = render_test_texture((enum raster_engine)engine, Radius[i], 3217, 1905, false, HEIGHT, &built);
+			uint64_t b = render_test_texture((enum raster_engine)engine, Radius[i], 3217, 1905, true, HEIGHT, &moved);
+			assert(built.precision == (i == 0 ? 16 : 32));
+			assert(a == b);
+			(void)a; (void)b;
+		}
+	}
+	printf("render_test_translate(), done.\n");
+}
+
+// Distance from (px, py) to segment from (x0, y0) to (x1, y1).
+static double
+render_test_segment_distance(double px, double py, double x0, double y0, double x1, double y1) {
+	double dx = x1 - x0, dy = y1 - y0;
+	double dd = dx*dx + dy*dy;
+	double t = dd == 0 ? 0 : ((px - x0)*dx + (py - y0)*dy)/dd;
+	t = t < 0 ? 0 : (t > 1 ? 1 : t);
+	return hypot(px - (x0 + t*dx), py - (y0 + t*dy));
+}
+
+// Curve of a texture scaled by scale, flattened into lines. Return number
+// of lines of its pieces, and largest distance in pixels between pieces and
+// their lines in *deviation.
+static size_t
+render_test_flatten_curve(coord_t scale, double *deviation) {
+	struct render *rd = render_create(&BenchMemface, &BenchLogface, &BenchErrface);
+	union color *co = render_malloc_color(rd, ColorTypeSolid);
+	co->solid = (struct rgba8){255, 0, 0, 255};
+	render_set_fillcolor(rd, co, NULL);
+	struct point start = {0, 0};
+	struct point control = {200*scale, 400*scale};
+	struct point anchor = {400*scale, 0};
+	render_move_to(rd, &start);
+	render_curve_to(rd, &control, &anchor);
+	render_line_to(rd, &start);
+	struct texture *tu = render_return_texture(rd);
+	struct rasterline *lines = malloc(sizeof(struct rasterline)*tu->nline);
+	size_t nline = raster_flatten_texture(tu, lines);
+	assert(nline == tu->nline);
+	(void)nline;
+	// Lines of a piece join its points at equal steps of t.
+	size_t ncurve = 0;
+	double worst = 0;
+	const struct rasterline *ln = lines;
+	struct edgeiter it;
+	struct edge ee;
+	texture_iterate(tu, &it);
+	while (edgeiter_next(&it, &ee)) {
+		size_t n = raster_edge_lines(&ee);
+		if (ee.ee_edge_type != EdgeTypeCurve) {
+			ln += n;
+			continue;
+		}
+		double x0 = ee.ee_anchor0.x, y0 = ee.ee_anchor0.y;
+		double cx = ee.ee_control.x, cy = ee.ee_control.y;
+		double x1 = ee.ee_anchor1.x, y1 = ee.ee_anchor1.y;
+		for (size_t i=0; i<n; i++, ln++) {
+			for (size_t k=0; k<=32; k++) {
+				double t = ((double)i + (double)k/32)/(double)n;
+				double px = (1-t)*(1-t)*x0 + 2*(1-t)*t*cx + t*t*x1;
+				double py = (1-t)*(1-t)*y0 + 2*(1-t)*t*cy + t*t*y1;
+				double d = render_test_segment_distance(px, py, ln->x0, ln->y0, ln->x1, ln->y1);
+				worst = d > worst ? d : worst;
+			}
+		}
+		ncurve += n;
+	}
+	assert(ln == lines + tu->nline);
+	*deviation = worst/20;
+	free(lines);
+	render_delete_texture(rd, tu);
+	render_dealloc_color(rd, co);
+	render_delete(rd);
+	return ncurve;
+}
+
+// Curves are flattened into lines within RASTER_CURVE_TOLERANCE pixels of
+// them, and not much closer. Lines grow by square root of scale, as
+// deviation of a curve grows by its scale.
+static void
+render_test_flatten(void) {
+	printf("render_test_flatten(), start.\n");
+	size_t last = 0;
+	for (coord_t scale=1; scale<=256; scale*=4) {
+		double deviation;
+		size_t n = render_test_flatten_curve(scale, &deviation);
+		assert(deviation <= RASTER_CURVE_TOLERANCE + 1e-9);
+		if (scale >= 4) {
+			assert(deviation > RASTER_CURVE_TOLERANCE/4);
+			assert(2*n >= 3*last && 2*n <= 5*last);
+		}
+		last = n;
+	}
+	assert(last > 64);
+	printf("render_test_flatten(), done.\n");
+}
+
+// Translucent squares of red and blue overlapping each other in a texture,
+// red edges first, blue color allocated first. Return pixels.
+static struct rgba8 *
+render_test_overlap_pixels(enum raster_engine engine, size_t nthread) {
+	static const coord_t Square[2][4] = {{200, 200, 800, 800}, {500, 500, 1100, 1100}};
+	struct render *rd = render_create(&BenchMemface, &BenchLogface, &BenchErrface);
+	render_set_engine(rd, engine);
+	bool started = render_set_threads(rd, nthread);
+	assert(started);
+	(void)started;
+	union color *cos[2];
+	cos[1] = render_malloc_color(rd, ColorTypeSolid);
+	cos[0] = render_malloc_color(rd, ColorTypeSolid);
+	cos[0]->solid = (struct rgba8){255, 0, 0, 128};
+	cos[1]->solid = (struct rgba8){0, 0, 255, 128};
+	for (size_t i=0; i<2; i++) {
+		struct cinfo ci = {true};
+		render_change_cinfo(rd, cos[i], &ci);
+		render_set_fillcolor(rd, cos[i], NULL);
+		const coord_t *sq = Square[i];
+		struct point pts[4] = {{sq[0], sq[1]}, {sq[2], sq[1]}, {sq[2], sq[3]}, {sq[0], sq[3]}};
+		render_move_to(rd, &pts[3]);
+		for (size_t j=0; j<4; j++) {
+			render_line_to(rd, &pts[j]);
+		}
+	}
+	struct texture *tu = render_return_texture(rd);
+	struct bufctx bx;
+	bx.width = bx.stride = WIDTH;
+	bx.height = HEIGHT;
+	bx.pixels = calloc(WIDTH*HEIGHT, sizeof(struct rgba8));
+	struct rectangle rt = {0, WIDTH, 0, HEIGHT};
+	render_set_target(rd, &bx, &rt);
+	render_commit_texture(rd, tu);
+	render_set_target(rd, NULL, NULL);
+	render_delete_texture(rd, tu);
+	render_dealloc_color(rd, cos[0]);
+	render_dealloc_color(rd, cos[1]);
+	render_delete(rd);
+	return bx.pixels;
+}
+
+// Overlapping colors are all painted, later colors of texture over earlier
+// ones, whatever order they are allocated in. Engines and threads draw
+// same pixels.
+static void
+render_test_overlap(void) {
+	printf("render_test_overlap(), start.\n");
+	struct rgba8 *want = render_test_overlap_pixels(RasterEngineScanline, 1);
+	const struct rgba8 *px = &want[35*WIDTH + 35];
+	assert(px->b == 128 && px->r > 0 && px->r < 128);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		for (size_t nthread=1; nthread<=3; nthread+=2) {
+			struct rgba8 *got = render_test_overlap_pixels((enum raster_engine)engine, nthread);
+			assert(memcmp(got, want, sizeof(struct rgba8)*WIDTH*HEIGHT) == 0);
+			free(got);
+		}
+	}
+	free(want);
+	printf("render_test_overlap(), done.\n");
+}
+
+// Frames redrawn by damage are same as ones redrawn whole.
+static void
+render_test_same_damaged(const struct swfgen *sg) {
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		uint64_t whole = render_test_play(sg, (enum raster_engine)engine, 1, false, NULL, NULL);
+		uint64_t damaged = render_test_play(sg, (enum raster_engine)engine, 1, true, NULL, NULL);
+		assert(whole == damaged);
+		(void)whole; (void)damaged;
+	}
+}
+
+// Polygons scattered over stage, of which few move every frame.
+static void
+render_test_damage(void) {
+	printf("render_test_damage(), start.\n");
+	uint32_t seed = 37;
+	intreg_t pts[2*16];
+	struct swfgen sg;
+	swfgen_init(&sg, WIDTH*20, HEIGHT*20, NFRAME);
+	for (uintreg_t i=1; i<=40; i++) {
+		render_test_star(pts, 16, 400, &seed);
+		swfgen_polygon(&sg, i, pts, 16, bench_random(&seed));
+	}
+	for (size_t f=0; f<NFRAME; f++) {
+		for (uintreg_t i=1; i<=40; i++) {
+			if (f != 0 && i > 3) {
+				break;
+			}
+			intreg_t tx = (intreg_t)(bench_random(&seed) % (WIDTH*20));
+			intreg_t ty = (intreg_t)(bench_random(&seed) % (HEIGHT*20));
+			swfgen_place(&sg, f == 0 ? i : 0, i, tx, ty);
+		}
+		swfgen_show(&sg);
+	}
+	swfgen_finish(&sg);
+	render_test_same_damaged(&sg);
+	swfgen_free(&sg);
+	printf("render_test_damage(), done.\n");
+}
+
+enum render_test_panel {
+	PanelConvex,
+	PanelSplit,
+	PanelOuter,
+};
+
+// Polygon of swfgen_polygon() if panel is PanelConvex. PanelSplit moves to
+// its second point again, PanelOuter fills it on outer side. Both draw same
+// pixels, and keep it from being taken as convex hull.
+static void
+render_test_panel_polygon(struct swfgen *sg, uintreg_t id, const intreg_t *pts, size_t npt, uint32_t rgb, enum render_test_panel panel) {
+	if (panel == PanelConvex) {
+		swfgen_polygon(sg, id, pts, npt, rgb);
+		return;
+	}
+	size_t cap = 96 + npt*12;
+	byte_t *body = malloc(cap);
+	bitval_t bv;
+	bitval_init_write(bv, body, cap);
+	bitval_write_uint16(bv, id);
+	bitval_write_bounds(bv, pts, npt, 0);
+	bitval_write_uint8(bv, 1);
+	struct swfgen_fill fill = {.type = FillStyleSolid, .rgb = rgb};
+	bitval_write_fill(bv, &fill);
+	bitval_write_uint8(bv, 0);
+	bitval_write_uint8(bv, 1 << 4);
+	uintreg_t side = swfgen_inner_fill(pts, npt);
+	if (panel == PanelOuter) {
+		side ^= 0x02 | 0x04;
+	}
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, side | 0x01, 5);
+	bitval_write_moveto(bv, pts[0], pts[1]);
+	bitval_write_ubits(bv, 1, 1);
+	for (size_t i=1; i<=npt; i++) {
+		size_t j = i % npt;
+		bitval_write_straight(bv, pts[2*j] - pts[2*i-2], pts[2*j+1] - pts[2*i-1]);
+		if (i == 1 && panel == PanelSplit) {
+			bitval_write_ubits(bv, 0, 1);
+			bitval_write_ubits(bv, 0x01, 5);
+			bitval_write_moveto(bv, pts[2], pts[3]);
+		}
+	}
+	bitval_write_ubits(bv, 0, 6);
+	bitval_sync(bv);
+	swfgen_tag(sg, SwftagDefineShape, body, (size_t)(bitval_write_cursor(bv) - body));
+	free(body);
+}
+
+// Blobs under an opaque panel sliding over them.
+static void
+render_test_build_cull(struct swfgen *sg, enum render_test_panel panel) {
+	uint32_t seed = 41;
+	intreg_t pts[2*16];
+	swfgen_init(sg, WIDTH*20, HEIGHT*20, NFRAME);
+	for (uintreg_t i=1; i<=30; i++) {
+		render_test_star(pts, 16, 300, &seed);
+		swfgen_shape(sg, i, pts, 16, bench_random(&seed), true);
+	}
+	intreg_t w = WIDTH*20*3/4, h = HEIGHT*20*3/4;
+	intreg_t square[8] = {0, 0, w, 0, w, h, 0, h};
+	render_test_panel_polygon(sg, 31, square, 4, 0x336699, panel);
+	for (size_t f=0; f<NFRAME; f++) {
+		for (uintreg_t i=1; i<=30 && f == 0; i++) {
+			intreg_t tx = (intreg_t)(bench_random(&seed) % (WIDTH*20));
+			intreg_t ty = (intreg_t)(bench_random(&seed) % (HEIGHT*20));
+			swfgen_place(sg, i, i, tx, ty);
+		}
+		swfgen_place(sg, f == 0 ? 31 : 0, 31, WIDTH*20/8 + (intreg_t)f*37, HEIGHT*20/8 + (intreg_t)f*23);
+		swfgen_show(sg);
+	}
+	swfgen_finish(sg);
+}
+
+// Blobs culled under convex panel are not drawn, and frames are same as
+// ones with all blobs drawn under a panel not taken as convex.
+static void
+render_test_cull(void) {
+	printf("render_test_cull(), start.\n");
+	struct swfgen convex, split;
+	render_test_build_cull(&convex, PanelConvex);
+	render_test_build_cull(&split, PanelSplit);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		struct render_stat culled, drawn;
+		uint64_t a = render_test_play(&convex, (enum raster_engine)engine, 1, false, NULL, &culled);
+		uint64_t b = render_test_play(&split, (enum raster_engine)engine, 1, false, NULL, &drawn);
+		assert(a == b);
+		assert(culled.npixel < drawn.npixel);
+		(void)a; (void)b;
+	}
+	swfgen_free(&convex);
+	swfgen_free(&split);
+	printf("render_test_cull(), done.\n");
+}
+
+// Convex panel filled on outer side is not a hull, blobs under it are
+// drawn as ones under split panel.
+static void
+render_test_cull_outer(void) {
+	printf("render_test_cull_outer(), start.\n");
+	struct swfgen outer, split;
+	render_test_build_cull(&outer, PanelOuter);
+	render_test_build_cull(&split, PanelSplit);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		struct render_stat kept, drawn;
+		uint64_t a = render_test_play(&outer, (enum raster_engine)engine, 1, false, NULL, &kept);
+		uint64_t b = render_test_play(&split, (enum raster_engine)engine, 1, false, NULL, &drawn);
+		assert(a == b);
+		assert(kept.npixel == drawn.npixel);
+		(void)a; (void)b;
+	}
+	swfgen_free(&outer);
+	swfgen_free(&split);
+	printf("render_test_cull_outer(), done.\n");
+}
+
+// Map of NGRID x NGRID tiles of NTILE polygons each, four times as large
+// as stage and scrolled under it. Tiles are sprites skipped whole off
+// stage if sprites is true, or polygons are placed on stage one by one.
+static void
+render_test_build_map(struct swfgen *sg, bool sprites) {
+	enum { NGRID = 4, NTILE = 3 };
+	uint32_t seed = 43;
+	intreg_t pts[2*16];
+	intreg_t tilew = WIDTH*20*4/NGRID, tileh = HEIGHT*20*4/NGRID;
+	intreg_t offsets[2*NGRID*NGRID*NTILE];
+	swfgen_init(sg, WIDTH*20, HEIGHT*20, NFRAME);
+	for (uintreg_t i=1; i<=NGRID*NGRID*NTILE; i++) {
+		render_test_star(pts, 16, 600, &seed);
+		swfgen_polygon(sg, i, pts, 16, bench_random(&seed));
+		offsets[2*i-2] = (intreg_t)(bench_random(&seed) % (uint32_t)tilew);
+		offsets[2*i-1] = (intreg_t)(bench_random(&seed) % (uint32_t)tileh);
+	}
+	uintreg_t map = NGRID*NGRID*NTILE + NGRID*NGRID + 1;
+	if (sprites) {
+		for (uintreg_t t=0; t<NGRID*NGRID; t++) {
+			size_t pos = swfgen_begin_sprite(sg, NGRID*NGRID*NTILE + t + 1, 1);
+			for (uintreg_t j=1; j<=NTILE; j++) {
+				uintreg_t id = t*NTILE + j;
+				swfgen_place(sg, id, j, offsets[2*id-2], offsets[2*id-1]);
+			}
+			swfgen_show(sg);
+			swfgen_end_sprite(sg, pos);
+		}
+		size_t pos = swfgen_begin_sprite(sg, map, 1);
+		for (uintreg_t t=0; t<NGRID*NGRID; t++) {
+			swfgen_place(sg, NGRID*NGRID*NTILE + t + 1, t+1, (intreg_t)(t%NGRID)*tilew, (intreg_t)(t/NGRID)*tileh);
+		}
+		swfgen_show(sg);
+		swfgen_end_sprite(sg, pos);
+	}
+	for (size_t f=0; f<NFRAME; f++) {
+		intreg_t tx = -WIDTH*20*3/2 + (intreg_t)f*97;
+		intreg_t ty = -HEIGHT*20*3/2 + (intreg_t)f*61;
+		if (sprites) {
+			swfgen_place(sg, f == 0 ? map : 0, 1, tx, ty);
+		} else {
+			for (uintreg_t id=1; id<=NGRID*NGRID*NTILE; id++) {
+				uintreg_t t = (id-1)/NTILE;
+				intreg_t x = tx + (intreg_t)(t%NGRID)*tilew + offsets[2*id-2];
+				intreg_t y = ty + (intreg_t)(t/NGRID)*tileh + offsets[2*id-1];
+				swfgen_place(sg, f == 0 ? id : 0, id, x, y);
+			}
+		}
+		swfgen_show(sg);
+	}
+	swfgen_finish(sg);
+}
+
+// Frames of map of sprites, some skipped off stage, are same as ones of
+// its polygons placed on stage, redrawn whole or by damage.
+static void
+render_test_viewport(void) {
+	printf("render_test_viewport(), start.\n");
+	struct swfgen map, flat;
+	render_test_build_map(&map, true);
+	render_test_build_map(&flat, false);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		uint64_t a = render_test_play(&map, (enum raster_engine)engine, 1, false, NULL, NULL);
+		uint64_t b = render_test_play(&flat, (enum raster_engine)engine, 1, false, NULL, NULL);
+		assert(a == b);
+		(void)a; (void)b;
+	}
+	render_test_same_damaged(&map);
+	swfgen_free(&map);
+	swfgen_free(&flat);
+	printf("render_test_viewport(), done.\n");
+}
+
+// Sprites of curved blobs placed with cacheAsBitmap, sliding over stage
+// and over each other by whole pixels. If moving is false, they stay
+// where they slide to in last frame.
+static void
+render_test_build_panels(struct swfgen *sg, bool moving) {
+	enum { NPANEL = 3, NBLOB = 12 };
+	uint32_t seed = 47;
+	intreg_t pts[2*16];
+	swfgen_init(sg, WIDTH*20, HEIGHT*20, NFRAME);
+	uintreg_t id = 0;
+	for (size_t i=0; i<NPANEL; i++) {
+		uintreg_t first = id+1;
+		for (size_t j=0; j<NBLOB; j++) {
+			render_test_star(pts, 16, 400, &seed);
+			swfgen_shape(sg, ++id, pts, 16, bench_random(&seed), true);
+		}
+		size_t pos = swfgen_begin_sprite(sg, ++id, 1);
+		for (uintreg_t j=first; j<id; j++) {
+			intreg_t tx = (intreg_t)(bench_random(&seed) % (WIDTH*20/3));
+			intreg_t ty = (intreg_t)(bench_random(&seed) % (HEIGHT*20/3));
+			swfgen_place(sg, j, j-first+1, tx, ty);
+		}
+		swfgen_show(sg);
+		swfgen_end_sprite(sg, pos);
+	}
+	for (size_t f=0; f<NFRAME; f++) {
+		intreg_t step = (intreg_t)(moving ? f : NFRAME-1);
+		for (size_t i=0; i<NPANEL; i++) {
+			uintreg_t panel = (uintreg_t)(i+1)*(NBLOB+1);
+			intreg_t tx = (intreg_t)i*WIDTH*20/NPANEL/2 + 7 + step*(140 + (intreg_t)i*20);
+			intreg_t ty = (intreg_t)i*HEIGHT*20/NPANEL/2 + 3 + step*(80 + (intreg_t)i*40);
+			if (f == 0) {
+				swfgen_place_cached(sg, panel, (uintreg_t)i+1, tx, ty);
+			} else {
+				swfgen_place(sg, 0, (uintreg_t)i+1, tx, ty);
+			}
+		}
+		swfgen_show(sg);
+	}
+	swfgen_finish(sg);
+}
+
+// Layers moved by whole pixels are same as ones drawn where they are
+// moved to, and frames redrawn by damage are same as ones redrawn whole.
+static void
+render_test_layer(void) {
+	printf("render_test_layer(), start.\n");
+	struct swfgen moving, still;
+	render_test_build_panels(&moving, true);
+	render_test_build_panels(&still, false);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		uint64_t moved[NFRAME], drawn[NFRAME];
+		render_test_play(&moving, (enum raster_engine)engine, 1, false, moved, NULL);
+		render_test_play(&still, (enum raster_engine)engine, 1, false, drawn, NULL);
+		assert(moved[NFRAME-1] == drawn[0]);
+		(void)moved; (void)drawn;
+	}
+	render_test_same_damaged(&moving);
+	swfgen_free(&moving);
+	swfgen_free(&still);
+	printf("render_test_layer(), done.\n");
+}
+
+// Edges bucketed by rows they start on, entering clip above it or in it,
+// fill same pixels whatever rows clip spans.
+static void
+render_test_strips(void) {
+	printf("render_test_strips(), start.\n");
+	static const coord_t Strips[] = {1, 7, 32};
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		struct texture_report rp;
+		uint64_t whole = render_test_texture((enum raster_engine)engine, 1800, 3217, 1905, false, HEIGHT, &rp);
+		for (size_t i=0; i<sizeof(Strips)/sizeof(Strips[0]); i++) {
+			uint64_t stripped = render_test_texture((enum raster_engine)engine, 1800, 3217, 1905, false, Strips[i], &rp);
+			assert(stripped == whole);
+			(void)stripped;
+		}
+		(void)whole;
+	}
+	printf("render_test_strips(), done.\n");
+}
+
+// Render first frame of movie into pixels of stage.
+static void
+render_test_frame(const struct swfgen *sg, enum raster_engine engine, struct rgba8 *pixels) {
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, sg->buf, StreamData);
+	player_set_engine(pl, engine);
+	struct bufctx bx;
+	bx.width = bx.stride = WIDTH;
+	bx.height = HEIGHT;
+	bx.pixels = pixels;
+	struct transform tsm;
+	matrix_identify(&tsm.matrix);
+	cxform_identify(&tsm.cxform);
+	player_advance(pl);
+	struct rectangle rt = {0, WIDTH, 0, HEIGHT};
+	player_render(pl, tsm, &bx, &rt);
+	player_delete(pl);
+	mux->delete_muplex(mux->muplex);
+}
+
+static bool
+render_test_pixel(const struct rgba8 *pixels, size_t x, size_t y, uint32_t rgb, uint8_t a, int tolerance) {
+	const struct rgba8 *px = &pixels[y*WIDTH + x];
+	int want[4] = {(int)((rgb>>16)&0xFF)*a/255, (int)((rgb>>8)&0xFF)*a/255, (int)(rgb&0xFF)*a/255, a};
+	int got[4] = {px->r, px->g, px->b, px->a};
+	for (size_t i=0; i<4; i++) {
+		if (abs(got[i] - want[i]) > tolerance) {
+			fprintf(stderr, "pixel (%zu, %zu) is (%d, %d, %d, %d), want (%d, %d, %d, %d).\n", x, y, got[0], got[1], got[2], got[3], want[0], want[1], want[2], want[3]);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Opaque rectangle from pixel 10 to pixel 30.5 has exact fill color inside
+// it and on its left edge, which is on pixel boundary, and half coverage on
+// its right edge.
+static void
+render_test_coverage(void) {
+	printf("render_test_coverage(), start.\n");
+	static const intreg_t rect[] = {200, 200, 610, 200, 610, 600, 200, 600};
+	struct swfgen sg;
+	swfgen_init(&sg, WIDTH*20, HEIGHT*20, 1);
+	swfgen_polygon(&sg, 1, rect, 4, 0x3366CC);
+	swfgen_place(&sg, 1, 1, 0, 0);
+	swfgen_show(&sg);
+	swfgen_finish(&sg);
+	struct rgba8 *pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		render_test_frame(&sg, (enum raster_engine)engine, pixels);
+		assert(render_test_pixel(pixels, 20, 20, 0x3366CC, 255, 0));
+		assert(render_test_pixel(pixels, 10, 15, 0x3366CC, 255, 0));
+		assert(render_test_pixel(pixels, 29, 25, 0x3366CC, 255, 0));
+		assert(render_test_pixel(pixels, 30, 20, 0x3366CC, 128, 3));
+		assert(render_test_pixel(pixels, 9, 20, 0, 0, 0));
+		assert(render_test_pixel(pixels, 31, 20, 0, 0, 0));
+		assert(render_test_pixel(pixels, 20, 30, 0, 0, 0));
+	}
+	free(pixels);
+	swfgen_free(&sg);
+	printf("render_test_coverage(), done.\n");
+}
+
+// Square mask from pixel 20 to 50 clips a rectangle over 0 to 80 at depth
+// above it, objects above clip depth are not clipped. Mask slides right
+// frame by frame.
+static void
+render_test_build_mask(struct swfgen *sg) {
+	static const intreg_t square[] = {400, 400, 1000, 400, 1000, 1000, 400, 1000};
+	static const intreg_t plane[] = {0, 0, 1600, 0, 1600, 1600, 0, 1600};
+	static const intreg_t dot[] = {1200, 1200, 1400, 1200, 1400, 1400, 1200, 1400};
+	swfgen_init(sg, WIDTH*20, HEIGHT*20, NFRAME);
+	swfgen_polygon(sg, 1, square, 4, 0x000000);
+	swfgen_polygon(sg, 2, plane, 4, 0xFF0000);
+	swfgen_polygon(sg, 3, dot, 4, 0x00FF00);
+	for (size_t f=0; f<NFRAME; f++) {
+		intreg_t tx = (intreg_t)f*130;
+		if (f == 0) {
+			swfgen_place_mask(sg, 1, 1, 2, tx, 0);
+			swfgen_place(sg, 2, 2, 0, 0);
+			swfgen_place(sg, 3, 3, 0, 0);
+		} else {
+			swfgen_place(sg, 0, 1, tx, 0);
+		}
+		swfgen_show(sg);
+	}
+	swfgen_finish(sg);
+}
+
+// Clipped rectangle is drawn inside mask only, mask itself is not drawn.
+// Frames are same redrawn whole, by damage, or on threads.
+static void
+render_test_mask(void) {
+	printf("render_test_mask(), start.\n");
+	struct swfgen sg;
+	render_test_build_mask(&sg);
+	struct rgba8 *pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		render_test_frame(&sg, (enum raster_engine)engine, pixels);
+		assert(render_test_pixel(pixels, 35, 35, 0xFF0000, 255, 0));
+		assert(render_test_pixel(pixels, 20, 20, 0xFF0000, 255, 0));
+		assert(render_test_pixel(pixels, 10, 35, 0, 0, 0));
+		assert(render_test_pixel(pixels, 55, 35, 0, 0, 0));
+		assert(render_test_pixel(pixels, 35, 10, 0, 0, 0));
+		assert(render_test_pixel(pixels, 65, 65, 0x00FF00, 255, 0));
+		uint64_t single = render_test_play(&sg, (enum raster_engine)engine, 1, false, NULL, NULL);
+		uint64_t tiled = render_test_play(&sg, (enum raster_engine)engine, 3, false, NULL, NULL);
+		assert(single == tiled);
+		(void)single; (void)tiled;
+	}
+	render_test_same_damaged(&sg);
+	free(pixels);
+	swfgen_free(&sg);
+	printf("render_test_mask(), done.\n");
+}
+
+// Polyline from pixel (40, 150) right to (120, 150), then down to (120,
+// 180), stroked 10 pixels wide.
+static void
+render_test_build_stroke(struct swfgen *sg) {
+	static const intreg_t pts[] = {800, 3000, 2400, 3000, 2400, 3600};
+	swfgen_init(sg, WIDTH*20, HEIGHT*20, 1);
+	swfgen_stroke(sg, 1, pts, 3, 200, 0x3366CC);
+	swfgen_place(sg, 1, 1, 0, 0);
+	swfgen_show(sg);
+	swfgen_finish(sg);
+}
+
+// Strokes are as wide as their line styles, with round caps and joins, and
+// overlapping pieces of them fill their union.
+static void
+render_test_stroke(void) {
+	printf("render_test_stroke(), start.\n");
+	struct swfgen sg;
+	render_test_build_stroke(&sg);
+	struct rgba8 *pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		render_test_frame(&sg, (enum raster_engine)engine, pixels);
+		// Band of segment covers rows 145 to 154.
+		assert(render_test_pixel(pixels, 80, 145, 0x3366CC, 255, 0));
+		assert(render_test_pixel(pixels, 80, 154, 0x3366CC, 255, 0));
+		assert(render_test_pixel(pixels, 80, 144, 0, 0, 0));
+		assert(render_test_pixel(pixels, 80, 155, 0, 0, 0));
+		// Round cap, not butt cap, fills pixel before start, not square
+		// cap's corner.
+		assert(render_test_pixel(pixels, 36, 150, 0x3366CC, 255, 0));
+		assert(render_test_pixel(pixels, 35, 145, 0, 0, 0));
+		// Round join fills outer corner within radius, not bevel, but not
+		// miter's corner.
+		assert(render_test_pixel(pixels, 122, 147, 0x3366CC, 255, 0));
+		assert(render_test_pixel(pixels, 124, 145, 0, 0, 0));
+		// Inner corner is covered by both bands, and still filled.
+		assert(render_test_pixel(pixels, 118, 152, 0x3366CC, 255, 0));
+	}
+	free(pixels);
+	swfgen_free(&sg);
+	printf("render_test_stroke(), done.\n");
+}
+
+// DefineShape2 of a line from pixel (40, 60) to (120, 60) 10 pixels wide,
+// then new styles of a square from (60, 40) to (100, 80).
+static void
+render_test_build_stroke_layers(struct swfgen *sg) {
+	static const intreg_t bounds[] = {800, 800, 2400, 1600};
+	swfgen_init(sg, WIDTH*20, HEIGHT*20, 1);
+	byte_t body[128];
+	bitval_t bv;
+	bitval_init_write(bv, body, sizeof(body));
+	bitval_write_uint16(bv, 1);
+	bitval_write_bounds(bv, bounds, 2, 100);
+	bitval_write_uint8(bv, 0);	// No fills.
+	bitval_write_uint8(bv, 1);	// One line style.
+	bitval_write_uint16(bv, 200);
+	bitval_write_rgb(bv, 0xFF0000);
+	bitval_write_uint8(bv, 1);	// Zero fill bits, one line bit.
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, 0x08 | 0x01, 5);
+	bitval_write_moveto(bv, 800, 1200);
+	bitval_write_ubits(bv, 1, 1);
+	bitval_write_straight(bv, 1600, 0);
+	// New styles: one fill, no line styles.
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, 0x10, 5);
+	bitval_sync(bv);
+	bitval_write_uint8(bv, 1);
+	struct swfgen_fill fill = {.type = FillStyleSolid, .rgb = 0x0000FF};
+	bitval_write_fill(bv, &fill);
+	bitval_write_uint8(bv, 0);
+	bitval_write_uint8(bv, 1 << 4);
+	bitval_write_ubits(bv, 0, 1);
+	bitval_write_ubits(bv, 0x02 | 0x01, 5);
+	bitval_write_moveto(bv, 1200, 800);
+	bitval_write_ubits(bv, 1, 1);
+	bitval_write_straight(bv, 800, 0);
+	bitval_write_straight(bv, 0, 800);
+	bitval_write_straight(bv, -800, 0);
+	bitval_write_straight(bv, 0, -800);
+	bitval_write_ubits(bv, 0, 6);
+	bitval_sync(bv);
+	swfgen_tag(sg, SwftagDefineShape2, body, (size_t)(bitval_write_cursor(bv) - body));
+	swfgen_place(sg, 1, 1, 0, 0);
+	swfgen_show(sg);
+	swfgen_finish(sg);
+}
+
+// Strokes of a style layer are drawn after its fills, and under fills of
+// style layers after it.
+static void
+render_test_stroke_layers(void) {
+	printf("render_test_stroke_layers(), start.\n");
+	struct swfgen sg;
+	render_test_build_stroke_layers(&sg);
+	struct rgba8 *pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	for (int engine=RasterEngineScanline; engine<=RasterEngineAccumulate; engine++) {
+		render_test_frame(&sg, (enum raster_engine)engine, pixels);
+		assert(render_test_pixel(pixels, 80, 60, 0x0000FF, 255, 0));
+		assert(render_test_pixel(pixels, 50, 60, 0xFF0000, 255, 0));
+		assert(render_test_pixel(pixels, 110, 60, 0xFF0000, 255, 0));
+		assert(render_test_pixel(pixels, 80, 45, 0x0000FF, 255, 0));
+	}
+	free(pixels);
+	swfgen_free(&sg);
+	printf("render_test_stroke_layers(), done.\n");
+}
+
+int
+main(void) {
+	render_test_threads();
+	render_test_translate();
+	render_test_flatten();
+	render_test_damage();
+	render_test_cull();
+	render_test_cull_outer();
+	render_test_viewport();
+	render_test_layer();
+	render_test_strips();
+	render_test_coverage();
+	render_test_mask();
+	render_test_overlap();
+	render_test_stroke();
+	render_test_stroke_layers();
+	return 0;
+}
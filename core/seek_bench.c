@@ -0,0 +1,93 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "bench.h"
+#include "player.h"
+#include "muplex.h"
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NOBJECT objects are placed in first frame and moved in every frame, one of
+// them is replaced every REPLACE frames.
+#define NFRAME		5000
+#define NOBJECT		32
+#define REPLACE		10
+#define NSEEK		200
+
+static void
+build_movie(struct swfgen *sg) {
+	uint32_t seed = 11;
+	intreg_t pts[2*8];
+	swfgen_init(sg, 550*20, 400*20, NFRAME);
+	for (size_t j=0; j<8; j++) {
+		pts[2*j] = (intreg_t)(bench_random(&seed) % 2000);
+		pts[2*j+1] = (intreg_t)(bench_random(&seed) % 2000);
+	}
+	swfgen_polygon(sg, 1, pts, 8, 0xFF0000);
+	for (size_t i=0; i<NFRAME; i++) {
+		for (uintreg_t d=1; d<=NOBJECT; d++) {
+			intreg_t tx = (intreg_t)(bench_random(&seed) % 8000);
+			intreg_t ty = (intreg_t)(bench_random(&seed) % 6000);
+			if (i == 0) {
+				swfgen_place(sg, 1, d, tx, ty);
+			} else if (i%REPLACE == 0 && d == i/REPLACE%NOBJECT + 1) {
+				swfgen_remove(sg, d);
+				swfgen_place(sg, 1, d, tx, ty);
+			} else {
+				swfgen_place(sg, 0, d, tx, ty);
+			}
+		}
+		swfgen_show(sg);
+	}
+	swfgen_finish(sg);
+}
+
+static void
+bench_seek(const struct swfgen *sg, size_t interval, size_t maxsize) {
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_set_snapshot(pl, interval, maxsize);
+	player_load0(pl, sg->buf, StreamData);
+	// First pass takes snapshots.
+	for (size_t i=0; i<NFRAME; i++) {
+		player_advance(pl);
+	}
+
+	uint32_t seed = 5;
+	double total = 0, worst = 0;
+	for (size_t i=0; i<NSEEK; i++) {
+		player_goto_frame(pl, NFRAME-1);
+		intreg_t to = (intreg_t)(bench_random(&seed) % (NFRAME-1));
+		double beg = bench_now();
+		player_goto_frame(pl, to);
+		double t = bench_now() - beg;
+		total += t;
+		worst = t > worst ? t : worst;
+	}
+	char cap[32] = "unlimited";
+	if (maxsize != SIZE_MAX) {
+		snprintf(cap, sizeof(cap), "%zuK", maxsize/1024);
+	}
+	printf("\tinterval %5zu, cap %9s: backward seek average %8.3f ms, worst %8.3f ms, snapshots %8zu bytes\n",
+		interval, cap, total/NSEEK, worst, player_snapshot_size(pl));
+	player_delete(pl);
+	mux->delete_muplex(mux->muplex);
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	struct swfgen sg;
+	build_movie(&sg);
+	printf("Seek latency, %d frames, %d objects, start.\n", NFRAME, NOBJECT);
+	bench_seek(&sg, 0, 0);
+	bench_seek(&sg, 16, SIZE_MAX);
+	bench_seek(&sg, 64, SIZE_MAX);
+	bench_seek(&sg, 256, SIZE_MAX);
+	bench_seek(&sg, 64, 256*1024);
+	printf("Seek latency, done.\n");
+	swfgen_free(&sg);
+	return 0;
+}
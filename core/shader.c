@@ -0,0 +1,340 @@
+#include "shader.h"
+#include <base/compat.h>
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHADER_X86
+#include <immintrin.h>
+#define SHADER_TARGET(isa)	__attribute__((target(isa)))
+#endif
+
+// Twips per pixel.
+#define SHADER_TWIPS		20
+// Positions are clamped to this before converting to integer, it is a
+// multiple of spread period so index doesn't change.
+#define SHADER_LIMIT		16777216.0f
+// Focal point on unit circle makes rays degenerate.
+#define SHADER_FOCAL_LIMIT	0.99
+
+// Every version computes position of pixel x as position of pixel 0 of
+// row plus x steps, by same float operations in same order, so they paint
+// identical pixels, wherever spans start.
+
+static inline uint32_t
+shader_index(float v, enum gradient_spread spread) {
+	if (spread == GradientSpreadPad) {
+		v = v < 0 ? 0 : v > 255 ? 255 : v;
+		return (uint32_t)(int32_t)v;
+	}
+	v = v < -SHADER_LIMIT ? -SHADER_LIMIT : v > SHADER_LIMIT ? SHADER_LIMIT : v;
+	int32_t i = (int32_t)v;
+	if ((float)i > v) {
+		i--;
+	}
+	if (spread == GradientSpreadRepeat) {
+		return (uint32_t)i & 255;
+	}
+	uint32_t u = (uint32_t)i & 511;
+	return u > 255 ? 511 - u : u;
+}
+
+// Scalar loops paint pixels [x+i, x+n) into out[i] to out[n-1], vector
+// versions finish their spans with them.
+
+static void
+shader_linear_from(const struct shade *sh, struct rgba8 *out, int32_t x, size_t i, size_t n) {
+	for (; i<n; i++) {
+		float v = sh->x + (float)(x + (int32_t)i)*sh->dx;
+		out[i] = sh->ramps[shader_index(v, sh->spread)];
+	}
+}
+
+static void
+shader_radial_from(const struct shade *sh, struct rgba8 *out, int32_t x, size_t i, size_t n) {
+	for (; i<n; i++) {
+		float px = sh->x + (float)(x + (int32_t)i)*sh->dx;
+		float py = sh->y + (float)(x + (int32_t)i)*sh->dy;
+		float v = sqrtf(px*px + py*py);
+		out[i] = sh->ramps[shader_index(v, sh->spread)];
+	}
+}
+
+// Pixel p is at ratio t of ray from focal point f to unit circle, that is
+// |f + (p - f)/t| = 1, solved for positive t.
+static void
+shader_focal_from(const struct shade *sh, struct rgba8 *out, int32_t x, size_t i, size_t n) {
+	for (; i<n; i++) {
+		float px = (sh->x + (float)(x + (int32_t)i)*sh->dx) - sh->focal_x;
+		float py = sh->y + (float)(x + (int32_t)i)*sh->dy;
+		float fx = sh->focal*px;
+		float v = (fx + sqrtf(fx*fx + (px*px + py*py)*sh->focal_a))*sh->focal_ra;
+		out[i] = sh->ramps[shader_index(v, sh->spread)];
+	}
+}
+
+static void
+shader_scalar_linear(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n) {
+	shader_linear_from(sh, out, x, 0, n);
+}
+
+static void
+shader_scalar_radial(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n) {
+	shader_radial_from(sh, out, x, 0, n);
+}
+
+static void
+shader_scalar_focal(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n) {
+	shader_focal_from(sh, out, x, 0, n);
+}
+
+static const struct shaderface ShaderScalar = {
+	.name = "scalar",
+	.linear = shader_scalar_linear,
+	.radial = shader_scalar_radial,
+	.focal = shader_scalar_focal,
+};
+
+#ifdef SHADER_X86
+
+// SSE2 has no gather, indices are computed in lanes and looked up one by
+// one.
+
+SHADER_TARGET("sse2") static inline __m128i
+shader_sse2_index(__m128 v, enum gradient_spread spread) {
+	if (spread == GradientSpreadPad) {
+		v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(255));
+		return _mm_cvttps_epi32(v);
+	}
+	v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-SHADER_LIMIT)), _mm_set1_ps(SHADER_LIMIT));
+	__m128i i = _mm_cvttps_epi32(v);
+	i = _mm_add_epi32(i, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(i), v)));
+	if (spread == GradientSpreadRepeat) {
+		return _mm_and_si128(i, _mm_set1_epi32(255));
+	}
+	i = _mm_and_si128(i, _mm_set1_epi32(511));
+	__m128i m = _mm_cmpgt_epi32(i, _mm_set1_epi32(255));
+	return _mm_or_si128(_mm_and_si128(m, _mm_sub_epi32(_mm_set1_epi32(511), i)), _mm_andnot_si128(m, i));
+}
+
+SHADER_TARGET("sse2") static inline void
+shader_sse2_lookup(const struct rgba8 *ramps, __m128i index, struct rgba8 *out) {
+	int32_t idx[4];
+	_mm_storeu_si128((__m128i *)idx, index);
+	out[0] = ramps[idx[0]];
+	out[1] = ramps[idx[1]];
+	out[2] = ramps[idx[2]];
+	out[3] = ramps[idx[3]];
+}
+
+SHADER_TARGET("sse2") static void
+shader_sse2_linear(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n) {
+	__m128 fi = _mm_add_ps(_mm_set1_ps((float)x), _mm_setr_ps(0, 1, 2, 3));
+	__m128 x0 = _mm_set1_ps(sh->x), dx = _mm_set1_ps(sh->dx);
+	size_t i = 0;
+	for (; i+4 <= n; i += 4) {
+		__m128 v = _mm_add_ps(x0, _mm_mul_ps(fi, dx));
+		shader_sse2_lookup(sh->ramps, shader_sse2_index(v, sh->spread), out+i);
+		fi = _mm_add_ps(fi, _mm_set1_ps(4));
+	}
+	shader_linear_from(sh, out, x, i, n);
+}
+
+SHADER_TARGET("sse2") static void
+shader_sse2_radial(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n) {
+	__m128 fi = _mm_add_ps(_mm_set1_ps((float)x), _mm_setr_ps(0, 1, 2, 3));
+	__m128 x0 = _mm_set1_ps(sh->x), dx = _mm_set1_ps(sh->dx);
+	__m128 y0 = _mm_set1_ps(sh->y), dy = _mm_set1_ps(sh->dy);
+	size_t i = 0;
+	for (; i+4 <= n; i += 4) {
+		__m128 px = _mm_add_ps(x0, _mm_mul_ps(fi, dx));
+		__m128 py = _mm_add_ps(y0, _mm_mul_ps(fi, dy));
+		__m128 v = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)));
+		shader_sse2_lookup(sh->ramps, shader_sse2_index(v, sh->spread), out+i);
+		fi = _mm_add_ps(fi, _mm_set1_ps(4));
+	}
+	shader_radial_from(sh, out, x, i, n);
+}
+
+SHADER_TARGET("sse2") static void
+shader_sse2_focal(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n) {
+	__m128 fi = _mm_add_ps(_mm_set1_ps((float)x), _mm_setr_ps(0, 1, 2, 3));
+	__m128 x0 = _mm_set1_ps(sh->x), dx = _mm_set1_ps(sh->dx);
+	__m128 y0 = _mm_set1_ps(sh->y), dy = _mm_set1_ps(sh->dy);
+	__m128 f = _mm_set1_ps(sh->focal), fx0 = _mm_set1_ps(sh->focal_x);
+	__m128 a = _mm_set1_ps(sh->focal_a), ra = _mm_set1_ps(sh->focal_ra);
+	size_t i = 0;
+	for (; i+4 <= n; i += 4) {
+		__m128 px = _mm_sub_ps(_mm_add_ps(x0, _mm_mul_ps(fi, dx)), fx0);
+		__m128 py = _mm_add_ps(y0, _mm_mul_ps(fi, dy));
+		__m128 fx = _mm_mul_ps(f, px);
+		__m128 d = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), a);
+		__m128 v = _mm_mul_ps(_mm_add_ps(fx, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(fx, fx), d))), ra);
+		shader_sse2_lookup(sh->ramps, shader_sse2_index(v, sh->spread), out+i);
+		fi = _mm_add_ps(fi, _mm_set1_ps(4));
+	}
+	shader_focal_from(sh, out, x, i, n);
+}
+
+static const struct shaderface ShaderSse2 = {
+	.name = "sse2",
+	.linear = shader_sse2_linear,
+	.radial = shader_sse2_radial,
+	.focal = shader_sse2_focal,
+};
+
+// AVX2 versions look ramps up by gather.
+
+SHADER_TARGET("avx2") static inline __m256i
+shader_avx2_index(__m256 v, enum gradient_spread spread) {
+	if (spread == GradientSpreadPad) {
+		v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(255));
+		return _mm256_cvttps_epi32(v);
+	}
+	v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-SHADER_LIMIT)), _mm256_set1_ps(SHADER_LIMIT));
+	__m256i i = _mm256_cvttps_epi32(v);
+	i = _mm256_add_epi32(i, _mm256_castps_si256(_mm256_cmp_ps(_mm256_cvtepi32_ps(i), v, _CMP_GT_OQ)));
+	if (spread == GradientSpreadRepeat) {
+		return _mm256_and_si256(i, _mm256_set1_epi32(255));
+	}
+	i = _mm256_and_si256(i, _mm256_set1_epi32(511));
+	return _mm256_min_epi32(i, _mm256_sub_epi32(_mm256_set1_epi32(511), i));
+}
+
+SHADER_TARGET("avx2") static inline void
+shader_avx2_lookup(const struct rgba8 *ramps, __m256i index, struct rgba8 *out) {
+	__m256i c = _mm256_i32gather_epi32((const int *)ramps, index, 4);
+	_mm256_storeu_si256((__m256i *)out, c);
+}
+
+SHADER_TARGET("avx2") static void
+shader_avx2_linear(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n) {
+	__m256 fi = _mm256_add_ps(_mm256_set1_ps((float)x), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+	__m256 x0 = _mm256_set1_ps(sh->x), dx = _mm256_set1_ps(sh->dx);
+	size_t i = 0;
+	for (; i+8 <= n; i += 8) {
+		__m256 v = _mm256_add_ps(x0, _mm256_mul_ps(fi, dx));
+		shader_avx2_lookup(sh->ramps, shader_avx2_index(v, sh->spread), out+i);
+		fi = _mm256_add_ps(fi, _mm256_set1_ps(8));
+	}
+	shader_linear_from(sh, out, x, i, n);
+}
+
+SHADER_TARGET("avx2") static void
+shader_avx2_radial(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n) {
+	__m256 fi = _mm256_add_ps(_mm256_set1_ps((float)x), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+	__m256 x0 = _mm256_set1_ps(sh->x), dx = _mm256_set1_ps(sh->dx);
+	__m256 y0 = _mm256_set1_ps(sh->y), dy = _mm256_set1_ps(sh->dy);
+	size_t i = 0;
+	for (; i+8 <= n; i += 8) {
+		__m256 px = _mm256_add_ps(x0, _mm256_mul_ps(fi, dx));
+		__m256 py = _mm256_add_ps(y0, _mm256_mul_ps(fi, dy));
+		__m256 v = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(px, px), _mm256_mul_ps(py, py)));
+		shader_avx2_lookup(sh->ramps, shader_avx2_index(v, sh->spread), out+i);
+		fi = _mm256_add_ps(fi, _mm256_set1_ps(8));
+	}
+	shader_radial_from(sh, out, x, i, n);
+}
+
+SHADER_TARGET("avx2") static void
+shader_avx2_focal(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n) {
+	__m256 fi = _mm256_add_ps(_mm256_set1_ps((float)x), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+	__m256 x0 = _mm256_set1_ps(sh->x), dx = _mm256_set1_ps(sh->dx);
+	__m256 y0 = _mm256_set1_ps(sh->y), dy = _mm256_set1_ps(sh->dy);
+	__m256 f = _mm256_set1_ps(sh->focal), fx0 = _mm256_set1_ps(sh->focal_x);
+	__m256 a = _mm256_set1_ps(sh->focal_a), ra = _mm256_set1_ps(sh->focal_ra);
+	size_t i = 0;
+	for (; i+8 <= n; i += 8) {
+		__m256 px = _mm256_sub_ps(_mm256_add_ps(x0, _mm256_mul_ps(fi, dx)), fx0);
+		__m256 py = _mm256_add_ps(y0, _mm256_mul_ps(fi, dy));
+		__m256 fx = _mm256_mul_ps(f, px);
+		__m256 d = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(px, px), _mm256_mul_ps(py, py)), a);
+		__m256 v = _mm256_mul_ps(_mm256_add_ps(fx, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(fx, fx), d))), ra);
+		shader_avx2_lookup(sh->ramps, shader_avx2_index(v, sh->spread), out+i);
+		fi = _mm256_add_ps(fi, _mm256_set1_ps(8));
+	}
+	shader_focal_from(sh, out, x, i, n);
+}
+
+static const struct shaderface ShaderAvx2 = {
+	.name = "avx2",
+	.linear = shader_avx2_linear,
+	.radial = shader_avx2_radial,
+	.focal = shader_avx2_focal,
+};
+
+#endif
+
+const struct shaderface *
+shader_face(enum span_isa isa) {
+	// span_face knows whether cpu supports isa.
+	if (span_face(isa) == NULL) {
+		return NULL;
+	}
+	switch (isa) {
+	case SpanIsaScalar:
+		return &ShaderScalar;
+#ifdef SHADER_X86
+	case SpanIsaSse2:
+		return &ShaderSse2;
+	case SpanIsaAvx2:
+		return &ShaderAvx2;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+const struct shaderface *
+shader_best(void) {
+	for (int isa=SpanIsaCount; isa-- > 0;) {
+		const struct shaderface *sf = shader_face((enum span_isa)isa);
+		if (sf != NULL) {
+			return sf;
+		}
+	}
+	return &ShaderScalar;
+}
+
+void
+shader_paint(const struct shaderface *sf, const struct gradient *gd, enum color_type type, int32_t x, int32_t y, struct rgba8 *out, size_t n) {
+	// Center of pixel 0 of row in twips of target, mapped by inverse matrix
+	// of gradient.
+	const struct matrix *mx = &gd->invmat;
+	double sx = mx->sx/65536.0, sy = mx->sy/65536.0;
+	double shx = mx->shx/65536.0, shy = mx->shy/65536.0;
+	double px = 0.5*SHADER_TWIPS, py = ((double)y + 0.5)*SHADER_TWIPS;
+	double gx = sx*px + shy*py + mx->tx;
+	double gy = shx*px + sy*py + mx->ty;
+	double gdx = sx*SHADER_TWIPS, gdy = shx*SHADER_TWIPS;
+
+	struct shade sh;
+	sh.spread = gd->spread;
+	sh.ramps = gd->ramps;
+	if (type == ColorTypeLinearGradient) {
+		// -16384 to 16384 maps to ramps 0 to 256.
+		sh.x = (float)(gx/128 + 128);
+		sh.dx = (float)(gdx/128);
+		sh.y = sh.dy = 0;
+		sf->linear(&sh, out, x, n);
+		return;
+	}
+	// Radius 16384 maps to ramps 256.
+	sh.x = (float)(gx/64);
+	sh.y = (float)(gy/64);
+	sh.dx = (float)(gdx/64);
+	sh.dy = (float)(gdy/64);
+	if (gd->focal == 0) {
+		sf->radial(&sh, out, x, n);
+		return;
+	}
+	double f = gd->focal/65536.0;
+	f = f > SHADER_FOCAL_LIMIT ? SHADER_FOCAL_LIMIT : f < -SHADER_FOCAL_LIMIT ? -SHADER_FOCAL_LIMIT : f;
+	sh.focal = (float)f;
+	sh.focal_x = (float)(f*256);
+	sh.focal_a = (float)(1 - f*f);
+	sh.focal_ra = (float)(1/(1 - f*f));
+	sf->focal(&sh, out, x, n);
+}
@@ -0,0 +1,49 @@
+#ifndef __CORE_SHADER_H
+#define __CORE_SHADER_H
+
+#include "render.h"
+#include <base/span.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Span shaders paint gradients into rows of premultiplied pixels. Position
+// of first pixel center of row in gradient space is computed once per span,
+// pixels step from it, so a pixel costs a few multiply-adds and a ramp
+// lookup. A pixel is painted same whichever span it is in.
+
+// Gradient space position of pixel 0 of a row, scaled so that ramp index is
+// x for linear gradient, and length of (x, y) for radial gradient.
+struct shade {
+	float x;
+	float y;
+	float dx;
+	float dy;
+	// Focal point f on x axis of unit circle, its x in same scale, 1 - f*f
+	// and its reciprocal.
+	float focal;
+	float focal_x;
+	float focal_a;
+	float focal_ra;
+	enum gradient_spread spread;
+	const struct rgba8 *ramps;
+};
+
+// Shaders paint pixels x to x+n-1 of row into out.
+struct shaderface {
+	const char *name;
+	void (*linear)(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n);
+	void (*radial)(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n);
+	void (*focal)(const struct shade *sh, struct rgba8 *out, int32_t x, size_t n);
+};
+
+// Shaders built for isa, NULL if either build or cpu lacks it.
+const struct shaderface *shader_face(enum span_isa isa);
+
+// Fastest shaders cpu supports.
+const struct shaderface *shader_best(void);
+
+// Paint n pixels of gradient of type, starting at pixel (x, y) of target.
+void shader_paint(const struct shaderface *sf, const struct gradient *gd, enum color_type type, int32_t x, int32_t y, struct rgba8 *out, size_t n);
+
+#endif
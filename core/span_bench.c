@@ -0,0 +1,118 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "shader.h"
+#include <base/span.h>
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Kernels over a full 1080p frame, row by row.
+#define WIDTH		1920
+#define HEIGHT		1080
+#define NFRAME		50
+
+static double
+bench_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec*1e3 + (double)ts.tv_nsec/1e6;
+}
+
+// Antialiased edges: full cover inside, partial cover near both ends and
+// empty pixels around.
+static void
+fill_cover(uint16_t *cover) {
+	for (size_t i=0; i<WIDTH; i++) {
+		size_t k = i%64;
+		cover[i] = (uint16_t)(k < 8 ? 0 : k < 12 ? (k-7)*50 : k > 60 ? (64-k)*60 : 256);
+	}
+}
+
+static void
+bench_span(const struct spanface *sf, struct rgba8 *frame, uint16_t *cover) {
+	struct rgba8 opaque = {200, 100, 50, 255};
+	struct rgba8 translucent = {100, 50, 25, 128};
+	double beg = bench_now();
+	for (size_t f=0; f<NFRAME; f++) {
+		for (size_t y=0; y<HEIGHT; y++) {
+			sf->fill(frame+y*WIDTH, WIDTH, opaque);
+		}
+	}
+	double fill = bench_now() - beg;
+	beg = bench_now();
+	for (size_t f=0; f<NFRAME; f++) {
+		for (size_t y=0; y<HEIGHT; y++) {
+			sf->blend(frame+y*WIDTH, WIDTH, translucent);
+		}
+	}
+	double blend = bench_now() - beg;
+	double cover_opaque = 0, cover_translucent = 0;
+	for (size_t f=0; f<NFRAME; f++) {
+		for (size_t y=0; y<HEIGHT; y++) {
+			fill_cover(cover);
+			beg = bench_now();
+			sf->blend_cover(frame+y*WIDTH, cover, WIDTH, (f%2) ? translucent : opaque);
+			*((f%2) ? &cover_translucent : &cover_opaque) += bench_now() - beg;
+		}
+	}
+	printf("\t%-8s fill %7.3f ms/frame, blend %7.3f ms/frame, cover opaque %7.3f ms/frame, cover translucent %7.3f ms/frame\n",
+		sf->name, fill/NFRAME, blend/NFRAME, cover_opaque/(NFRAME/2), cover_translucent/(NFRAME/2));
+}
+
+// Gradient rotated and scaled over frame, as paint of skins.
+static void
+bench_shader(const struct shaderface *sf, struct rgba8 *frame) {
+	struct gradient gd;
+	matrix_identify(&gd.invmat);
+	gd.invmat.sx = gd.invmat.sy = FIXED_1/2;
+	gd.invmat.shx = FIXED_1/8;
+	gd.invmat.shy = -FIXED_1/8;
+	gd.invmat.tx = gd.invmat.ty = -10000;
+	gd.spread = GradientSpreadReflect;
+	for (size_t i=0; i<256; i++) {
+		gd.ramps[i] = (struct rgba8){(uint8_t)i, (uint8_t)(255-i), 128, 255};
+	}
+	enum color_type types[3] = {ColorTypeLinearGradient, ColorTypeRadialGradient, ColorTypeRadialGradient};
+	fixed_t focals[3] = {0, 0, FIXED_1/2};
+	double ms[3];
+	for (size_t k=0; k<3; k++) {
+		gd.focal = focals[k];
+		double beg = bench_now();
+		for (size_t f=0; f<NFRAME; f++) {
+			for (size_t y=0; y<HEIGHT; y++) {
+				shader_paint(sf, &gd, types[k], 0, (int32_t)y, frame+y*WIDTH, WIDTH);
+			}
+		}
+		ms[k] = (bench_now() - beg)/NFRAME;
+	}
+	printf("\t%-8s linear %7.3f ms/frame, radial %7.3f ms/frame, focal %7.3f ms/frame\n", sf->name, ms[0], ms[1], ms[2]);
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	struct rgba8 *frame = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	uint16_t *cover = malloc(sizeof(uint16_t)*WIDTH);
+	printf("Span kernels on %dx%d frame, start.\n", WIDTH, HEIGHT);
+	for (int isa=0; isa<SpanIsaCount; isa++) {
+		const struct spanface *sf = span_face((enum span_isa)isa);
+		if (sf != NULL) {
+			bench_span(sf, frame, cover);
+		}
+	}
+	printf("\tbest: %s\n", span_best()->name);
+	printf("Span kernels, done.\n");
+	printf("Gradient shaders on %dx%d frame, start.\n", WIDTH, HEIGHT);
+	for (int isa=0; isa<SpanIsaCount; isa++) {
+		const struct shaderface *sf = shader_face((enum span_isa)isa);
+		if (sf != NULL) {
+			bench_shader(sf, frame);
+		}
+	}
+	printf("Gradient shaders, done.\n");
+	free(cover);
+	free(frame);
+	return 0;
+}
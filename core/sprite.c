@@ -1,11 +1,13 @@
 #include "player.h"
 #include "muplex.h"
+#include "render.h"
 #include "define.h"
 #include "common.h"
 #include <base/compat.h>
 #include <base/intreg.h>
 #include <base/helper.h>
 #include <base/slab.h>
+#include <base/region.h>
 
 #include <stddef.h>
 #include <stdint.h>
@@ -41,6 +43,7 @@ typedef uint16_t obtype_t;
 	uint16_t issource:1;			\
 	uint16_t dirty:1;			\
 	uint16_t stopped:1;			\
+	uint16_t bitmapcache:1;			\
 	uint16_t clipdepth;			\
 	uint16_t stepratio;			\
 	depth_t depth;				\
@@ -64,6 +67,9 @@ typedef uint16_t obtype_t;
 	struct sprite *children;		\
 	struct source *source;			\
 	struct source *scroot;			\
+	struct snapshot **snapshots;		\
+	struct rectangle drawn;			\
+	struct layer *layer;			\
 	bool fastforwarding
 
 struct dictionary;
@@ -75,6 +81,7 @@ struct dictionary;
 #define obj2obname(ob)		((struct obname *)(ob))
 #define obj2sprite(ob)		((struct sprite *)(ob))
 #define obj2source(ob)		((struct source *)(ob))
+#define obj2shape(ob)		((struct shape *)(ob))
 #define obj2object(ob)		((struct object *)(ob))
 
 bool
@@ -99,6 +106,16 @@ struct sprite {
 	SpriteFields;
 };
 
+// Timeline objects of a sprite after frame, and position of next frame.
+// Seeking backward starts from the nearest snapshot instead of the first
+// frame.
+struct snapshot {
+	intreg_t frame;
+	size_t size;
+	size_t nplace;
+	struct place_info places[];
+};
+
 struct source {
 	SourceFields;
 };
@@ -121,12 +138,74 @@ struct player {
 	struct memface *mem;
 	struct logface *log;
 	struct errface *err;
+	// Snapshots are taken every snapshot_interval frames, until they
+	// take snapshot_maxsize bytes.
+	size_t snapshot_interval;
+	size_t snapshot_maxsize;
+	size_t snapshot_size;
+	struct render *render;
+	// Pixels to redraw in next frame, and ones redrawn in last frame.
+	struct region damage;
+	struct region redrawn;
+	// Target and transform of last frame, changing them redraws all.
+	bool rendered;
+	struct bufctx target;
+	struct transform target_transform;
+	// Shapes over clip being drawn, from bottom to top.
+	struct drawitem *drawlist;
+	size_t ndraw;
+	size_t drawcap;
+	// Mask groups being collected.
+	size_t ngroup;
+	// Pixels of layers take layer_size bytes, no more than layer_maxsize.
+	size_t layer_maxsize;
+	size_t layer_size;
 	// struct object *drag_object;
 	// struct point drag_spoint;
 };
 
+// Graph is built for character graphchar, which is rebuilt if character
+// is replaced, or stale after shape is changed. Shape is drawn over pixels
+// drawn of target, empty before shape is first drawn.
 struct shape {
 	ObjectFields;
+	struct graph *graph;
+	uintptr_t graphchar;
+	bool stale;
+	struct rectangle drawn;
+	// Pixels wholly covered by opaque fill, which hide shapes under them.
+	struct rectangle opaque;
+};
+
+// Pixels of sprite cached as bitmap, drawn at transform with top left
+// pixel at x and y of target. They are reused while objects of sprite are
+// not changed and transform is only translated, then moved by whole
+// pixels. Layer is stale once an object is removed from sprite.
+struct layer {
+	struct bufctx bx;
+	size_t size;
+	struct transform transform;
+	coord_t x;
+	coord_t y;
+	bool stale;
+};
+
+// Shape, or layer of sprite if shape is NULL. Hidden items are culled.
+// Item is a shape, a sprite drawn into its layer, or head of mask group,
+// which is followed by nmask items of mask and nmasked items clipped by
+// it, drawn within clip.
+struct drawitem {
+	struct shape *shape;
+	struct sprite *sprite;
+	struct stream *stream;
+	struct transform transform;
+	size_t nmask;
+	size_t nmasked;
+	struct rectangle clip;
+	// Items of mask groups are not drawn to target directly, they don't
+	// hide items under them.
+	bool grouped;
+	bool hidden;
 };
 
 struct morphshape {
@@ -221,9 +300,11 @@ object_import_place(struct object *ob, const struct place_info *pi) {
 	assert(object_type(ob) == pi->type);
 	ob->type = (obtype_t)pi->type;
 	ob->character = pi->character;
+	ob->depth = pi->chardepth;
 	ob->clipdepth = pi->clipdepth;
 	ob->stepratio = pi->stepratio;
 	ob->transform = pi->transform;
+	ob->bitmapcache = (pi->flag & PlaceFlagHasCacheAsBit) != 0 && pi->bitmapcache != 0;
 
 	if (object_type(ob) == CharacterSprite && (pi->flag & PlaceFlagHasName) != 0) {
 		struct sprite *si = obj2sprite(ob);
@@ -238,6 +319,7 @@ object_export_place(const struct object *ob, struct place_info *pi) {
 	pi->character = ob->character;
 	pi->clipdepth = ob->clipdepth;
 	pi->transform = ob->transform;
+	pi->bitmapcache = ob->bitmapcache;
 }
 
 static void
@@ -256,6 +338,9 @@ object_change_place(struct object *ob, const struct place_info *pi) {
 		if ((flag & PlaceFlagHasRatio)) {
 			ob->stepratio = pi->stepratio;
 		}
+		if ((flag & PlaceFlagHasCacheAsBit)) {
+			ob->bitmapcache = pi->bitmapcache != 0;
+		}
 		object_timeline_change(ob);
 	}
 }
@@ -265,10 +350,42 @@ player_create_object(struct player *pl, uintreg_t type) {
 	assert(type < CharacterTypeNumber);
 	assert(pl->object_slab[type] != NULL);
 	struct object *ob = slab_alloc(pl->object_slab[type]);
+	memset(ob, 0, sizeof(*ob));
 	ob->type = (obtype_t)type;
+	// New object damages pixels it is drawn over.
+	ob->dirty = 1;
+	if (type == CharacterShape) {
+		struct shape *sh = obj2shape(ob);
+		sh->graph = NULL;
+		sh->stale = true;
+		sh->drawn = (struct rectangle){0, 0, 0, 0};
+		sh->opaque = (struct rectangle){0, 0, 0, 0};
+	}
 	return ob;
 }
 
+// Pixels drawn by object are redrawn in next frame.
+static void
+player_damage_object(struct player *pl, struct object *ob) {
+	switch (object_type(ob)) {
+	case CharacterShape:
+		region_add(&pl->damage, &obj2shape(ob)->drawn);
+		break;
+	case CharacterSprite:
+		// Shapes of layer may be moved since drawn.
+		if (obj2sprite(ob)->layer != NULL) {
+			region_add(&pl->damage, &obj2sprite(ob)->drawn);
+			break;
+		}
+		for (struct object *o = obj2sprite(ob)->display; o != NULL; o = o->above) {
+			player_damage_object(pl, o);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
 static inline void
 player_delete_object(struct player *pl, struct object *ob) {
 	uintreg_t type = object_type(ob);
@@ -380,6 +497,7 @@ player_remove_level(struct player *pl, uintreg_t lvl) {
 		return;
 	}
 	struct source *sc = player_umount_level(pl, lvl);
+	player_damage_object(pl, obj2object(sc));
 	player_detach_source(pl, sc);
 }
 
@@ -461,16 +579,55 @@ sprite_del_child(struct sprite *si, struct sprite *child) {
 	*ss = child->sibling;
 }
 
+// Position of first tag of frame, or zero if frame is not indexed.
+static inline uintptr_t
+sprite_frame_tagpos(const struct sprite *si, intreg_t frame) {
+	if (frame == 0) {
+		return si->define.tagbeg;
+	}
+	const uint32_t *frames = si->define.frames;
+	if (frames == NULL || frame < 0 || frame > si->define.nframe || frames[frame] == 0) {
+		return 0;
+	}
+	return si->define.tagbeg + frames[frame];
+}
+
 static inline void
 sprite_initz(struct sprite *si, struct source *sc, struct player *pl) {
-	si->tagpos = si->define.tagbeg;
+	si->tagpos = sprite_frame_tagpos(si, 0);
+	si->cframe = -1;
+	si->display = NULL;
+	si->children = NULL;
+	si->snapshots = NULL;
+	si->drawn = (struct rectangle){0, 0, 0, 0};
+	si->layer = NULL;
+	si->fastforwarding = false;
 	si->source = si->scroot = sc;
 	player_attach_thread(pl, &si->thread);
 	player_attach_obname(pl, obj2obname(si));
 }
 
+static void sprite_delete_snapshots(struct sprite *si);
+
+static void
+sprite_delete_layer(struct sprite *si) {
+	struct layer *ly = si->layer;
+	if (ly == NULL) {
+		return;
+	}
+	struct player *pl = player_from_thread(&si->thread);
+	if (ly->bx.pixels != NULL) {
+		pl->mem->dealloc(pl->mem->ctx, ly->bx.pixels, __FILE__, __LINE__);
+	}
+	pl->layer_size -= ly->size;
+	pl->mem->dealloc(pl->mem->ctx, ly, __FILE__, __LINE__);
+	si->layer = NULL;
+}
+
 static inline void
 sprite_finiz(struct sprite *si) {
+	sprite_delete_snapshots(si);
+	sprite_delete_layer(si);
 	struct player *pl = player_from_thread(&si->thread);
 	player_detach_thread(pl, &si->thread);
 	player_detach_obname(pl, obj2obname(si));
@@ -526,9 +683,32 @@ sprite_create_object(struct sprite *si, const struct place_info *pi) {
 	return ob;
 }
 
+static void
+shape_delete_graph(struct shape *sh, struct stream *stm, struct render *rd) {
+	if (sh->graph != NULL) {
+		stream_delete_graph(stm, rd, sh->graph);
+		sh->graph = NULL;
+	}
+}
+
+// Layers of si and sprites containing it miss removed objects.
+static void
+sprite_stale_layers(struct sprite *si) {
+	for (; si != NULL; si = obj2sprite(si->parent)) {
+		if (si->layer != NULL) {
+			si->layer->stale = true;
+		}
+	}
+}
+
 static void
 sprite_delete_object(struct sprite *si, struct object *ob) {
 	struct player *pl = player_from_thread(&si->thread);
+	sprite_stale_layers(si);
+	if (object_type(ob) == CharacterShape) {
+		shape_delete_graph(obj2shape(ob), si->source->stream, pl->render);
+	}
+	player_damage_object(pl, ob);
 	sprite_detach_object(si, ob);
 	player_delete_object(pl, ob);
 }
@@ -560,7 +740,7 @@ sprite_clone(struct sprite *si, uintreg_t depth, const char *name, size_t len) {
 	if (sprite_clonable(si)) {
 		struct place_info pi;
 		object_export_place((struct object *)si, &pi);
-		pi.flag = PlaceFlagHasName;
+		pi.flag = PlaceFlagHasName | PlaceFlagHasCacheAsBit;
 		pi.chardepth = depth;
 		// Cloned sprite may be placed with depth fallen into timeline zone.
 		// Special stepratio value do discriminate it from timeline sprites.
@@ -629,6 +809,7 @@ sprite_merge_old(struct sprite *si, struct object *old) {
 			if (object_compatible(ob, old) && object_type(ob) == CharacterSprite) {
 				if (!object_script_changed(old)) {
 					old->transform = ob->transform;
+					object_timeline_change(old);
 				}
 				// Use old instead of new.
 				struct object *tmp = old->above;
@@ -674,19 +855,137 @@ sprite_stop_fastforward(struct sprite *si) {
 	si->fastforwarding = 0;
 }
 
+static inline bool
+object_snapshotable(const struct object *ob) {
+	return depth_classify(ob->depth) == DepthClassTimeline && !object_script_created(ob);
+}
+
+static void
+sprite_delete_snapshots(struct sprite *si) {
+	if (si->snapshots == NULL) {
+		return;
+	}
+	struct player *pl = player_from_thread(&si->thread);
+	size_t n = (size_t)si->define.nframe / pl->snapshot_interval;
+	for (size_t i=0; i<n; i++) {
+		struct snapshot *ss = si->snapshots[i];
+		if (ss != NULL) {
+			pl->snapshot_size -= ss->size;
+			pl->mem->dealloc(pl->mem->ctx, ss, __FILE__, __LINE__);
+		}
+	}
+	pl->snapshot_size -= sizeof(struct snapshot *)*n;
+	pl->mem->dealloc(pl->mem->ctx, si->snapshots, __FILE__, __LINE__);
+	si->snapshots = NULL;
+}
+
+// Snapshot of frame k*interval is kept in slot k-1. Restoring resumes from
+// the indexed position of next frame, so frames not ending where index says
+// are not snapshotted.
+static void
+sprite_take_snapshot(struct sprite *si) {
+	struct player *pl = player_from_thread(&si->thread);
+	size_t interval = pl->snapshot_interval;
+	if (interval == 0 || si->cframe <= 0 || (size_t)si->cframe % interval != 0) {
+		return;
+	}
+	if (sprite_frame_tagpos(si, si->cframe+1) != si->tagpos) {
+		return;
+	}
+	size_t nslot = (size_t)si->define.nframe / interval;
+	size_t slot = (size_t)si->cframe / interval - 1;
+	if (slot >= nslot) {
+		return;
+	}
+	if (si->snapshots == NULL) {
+		size_t size = sizeof(struct snapshot *)*nslot;
+		if (pl->snapshot_size + size > pl->snapshot_maxsize) {
+			return;
+		}
+		si->snapshots = pl->mem->zalloc(pl->mem->ctx, size, __FILE__, __LINE__);
+		pl->snapshot_size += size;
+	}
+	if (si->snapshots[slot] != NULL) {
+		return;
+	}
+	size_t nplace = 0;
+	for (struct object *ob = si->display; ob != NULL; ob = ob->above) {
+		nplace += object_snapshotable(ob);
+	}
+	size_t size = sizeof(struct snapshot) + sizeof(struct place_info)*nplace;
+	if (pl->snapshot_size + size > pl->snapshot_maxsize) {
+		return;
+	}
+	struct snapshot *ss = pl->mem->alloc(pl->mem->ctx, size, __FILE__, __LINE__);
+	ss->frame = si->cframe;
+	ss->size = size;
+	ss->nplace = nplace;
+	struct place_info *pi = ss->places;
+	for (struct object *ob = si->display; ob != NULL; ob = ob->above) {
+		if (!object_snapshotable(ob)) {
+			continue;
+		}
+		object_export_place(ob, pi);
+		pi->flag = PlaceFlagHasCacheAsBit;
+		pi->chardepth = ob->depth;
+		pi->stepratio = ob->stepratio;
+		if (object_type(ob) == CharacterSprite && !obj2sprite(ob)->slabname) {
+			pi->flag |= PlaceFlagHasName;
+			pi->moviename = obj2sprite(ob)->name;
+		}
+		pi++;
+	}
+	si->snapshots[slot] = ss;
+	pl->snapshot_size += size;
+}
+
+// Rebuild timeline objects from the nearest snapshot not after frame,
+// or rewind to the first frame if there is none.
+static void
+sprite_restore_snapshot(struct sprite *si, intreg_t frame) {
+	if (si->snapshots != NULL) {
+		struct player *pl = player_from_thread(&si->thread);
+		size_t slot = (size_t)frame / pl->snapshot_interval;
+		while (slot-- > 0) {
+			const struct snapshot *ss = si->snapshots[slot];
+			if (ss == NULL) {
+				continue;
+			}
+			// Mount from top to bottom, so each object lands at bottom.
+			for (size_t i=ss->nplace; i-- > 0;) {
+				sprite_create_object(si, &ss->places[i]);
+			}
+			si->tagpos = sprite_frame_tagpos(si, ss->frame+1);
+			si->cframe = ss->frame;
+			return;
+		}
+	}
+	si->tagpos = sprite_frame_tagpos(si, 0);
+	si->cframe = -1;
+}
+
+// Progress no more than n frames, stop if stream holds on frames not
+// loaded yet.
 static void
 sprite_progress_frames(struct sprite *si, uintreg_t n) {
-	uintptr_t tagpos = si->tagpos;
+	if (n == 0) {
+		return;
+	}
 	struct stream *stm = si->source->stream;
-	if (n > 1) {
-		sprite_start_fastforward(si);
-		do {
-			tagpos = stream_progress_frame(stm, si, tagpos);
-		} while(--n > 1);
-		sprite_stop_fastforward(si);
+	sprite_start_fastforward(si);
+	for (uintreg_t i=0; i<n; i++) {
+		if (i+1 == n) {
+			sprite_stop_fastforward(si);
+		}
+		uintptr_t tagpos = stream_progress_frame(stm, si, si->tagpos);
+		if (tagpos == si->tagpos) {
+			sprite_stop_fastforward(si);
+			return;
+		}
+		si->tagpos = tagpos;
+		si->cframe++;
+		sprite_take_snapshot(si);
 	}
-	assert(n == 1);
-	si->tagpos = stream_progress_frame(stm, si, tagpos);
 }
 
 static void
@@ -694,14 +993,12 @@ sprite_goto_frame(struct sprite *si, intreg_t frame) {
 	if (frame < si->cframe) {
 		struct object *old = si->display;
 		si->display = NULL;
-		si->cframe = -1;
-		si->tagpos = si->define.tagbeg;
-		sprite_progress_frames(si, frame+1);
+		sprite_restore_snapshot(si, frame);
+		sprite_progress_frames(si, (uintreg_t)(frame - si->cframe));
 		sprite_merge_old(si, old);
 	} else if (frame > si->cframe) {
-		sprite_progress_frames(si, frame-si->cframe);
+		sprite_progress_frames(si, (uintreg_t)(frame - si->cframe));
 	}
-	si->cframe = frame;
 }
 
 static void
@@ -818,6 +1115,605 @@ sprite_search_target(const struct sprite *si, const char *path, const char *pend
 	return (void *)si;
 }
 
+void
+player_goto_frame(struct player *pl, intreg_t frame) {
+	struct sprite *si = obj2sprite(pl);
+	if (pl->threads == NULL || frame < 0 || frame >= si->define.nframe) {
+		return;
+	}
+	sprite_goto_frame(si, frame);
+}
+
+void
+player_set_layer_cache(struct player *pl, size_t maxsize) {
+	pl->layer_maxsize = maxsize;
+}
+
+size_t
+player_layer_size(const struct player *pl) {
+	return pl->layer_size;
+}
+
+void
+player_set_snapshot(struct player *pl, size_t interval, size_t maxsize) {
+	assert(pl->threads == NULL);
+	pl->snapshot_interval = interval;
+	pl->snapshot_maxsize = maxsize;
+}
+
+size_t
+player_snapshot_size(const struct player *pl) {
+	return pl->snapshot_size;
+}
+
+static void
+transform_concat(struct transform *tsm, const struct transform *in) {
+	matrix_concat(&tsm->matrix, &in->matrix);
+	cxform_concat(&tsm->cxform, &in->cxform);
+}
+
+// Twips of target are rounded out to pixels, with one more pixel around
+// for antialiasing.
+static void
+rectangle_twips_pixels(struct rectangle *rt) {
+	rt->xmin = (rt->xmin >= 0 ? rt->xmin/20 : (rt->xmin-19)/20) - 1;
+	rt->ymin = (rt->ymin >= 0 ? rt->ymin/20 : (rt->ymin-19)/20) - 1;
+	rt->xmax = (rt->xmax >= 0 ? (rt->xmax+19)/20 : rt->xmax/20) + 1;
+	rt->ymax = (rt->ymax >= 0 ? (rt->ymax+19)/20 : rt->ymax/20) + 1;
+}
+
+// Pixels wholly inside twips of target, but one pixel around, as they
+// may be antialiased.
+static void
+rectangle_twips_inner_pixels(struct rectangle *rt) {
+	rt->xmin = (rt->xmin >= 0 ? (rt->xmin+19)/20 : rt->xmin/20) + 1;
+	rt->ymin = (rt->ymin >= 0 ? (rt->ymin+19)/20 : rt->ymin/20) + 1;
+	rt->xmax = (rt->xmax >= 0 ? rt->xmax/20 : (rt->xmax-19)/20) - 1;
+	rt->ymax = (rt->ymax >= 0 ? rt->ymax/20 : (rt->ymax-19)/20) - 1;
+}
+
+static void
+shape_struct_graph(struct shape *sh, struct stream *stm, struct render *rd, const struct transform *tsm) {
+	if (sh->graphchar != sh->character) {
+		shape_delete_graph(sh, stm, rd);
+	}
+	sh->graph = stream_struct_graph(stm, rd, tsm, sh->character, sh->graph);
+	sh->graphchar = sh->character;
+	sh->stale = false;
+}
+
+// Damage off stage is clipped anyway.
+static inline void
+player_damage_stage(struct player *pl, const struct rectangle *rt, const struct rectangle *stage) {
+	if (rectangle_intersect(rt, stage)) {
+		region_add(&pl->damage, rt);
+	}
+}
+
+// Changed shape damages pixels drawn before and pixels it will be drawn
+// over. Its graph is rebuilt at once if it is on stage, for opaque pixels
+// of it. Shapes of layers have NULL stage, they only bound pixels drawn,
+// which are damaged by their layers.
+static void
+shape_damage(struct shape *sh, struct stream *stm, struct player *pl, const struct transform *tsm, const struct rectangle *stage) {
+	struct rectangle rt;
+	stream_bound_graph(stm, tsm, sh->character, &rt);
+	rectangle_twips_pixels(&rt);
+	if (stage != NULL) {
+		player_damage_stage(pl, &sh->drawn, stage);
+		player_damage_stage(pl, &rt, stage);
+	}
+	sh->drawn = rt;
+	sh->stale = true;
+	sh->opaque = (struct rectangle){0, 0, 0, 0};
+	if (stage != NULL && rectangle_intersect(&rt, stage)) {
+		shape_struct_graph(sh, stm, pl->render, tsm);
+		if (stream_opaque_graph(stm, sh->graph, &rt)) {
+			rectangle_twips_inner_pixels(&rt);
+			sh->opaque = rt;
+		}
+	}
+}
+
+static void
+sprite_union_drawn(struct sprite *si, const struct rectangle *rt) {
+	if (rectangle_empty(rt)) {
+		return;
+	}
+	if (rectangle_empty(&si->drawn)) {
+		si->drawn = *rt;
+	} else {
+		rectangle_union(&si->drawn, rt);
+	}
+}
+
+static void layer_damage(struct sprite *si, struct player *pl, const struct transform *tsm, const struct rectangle *stage, bool changed);
+
+// Objects changed since last frame are dirty, objects in changed sprites
+// are changed too. Pixels drawn by sprite bound ones of its shapes. Masks
+// are not drawn, changed masks damage pixels of objects clipped by them.
+static void
+sprite_damage(struct sprite *si, struct player *pl, const struct transform *tsm, const struct rectangle *stage, bool changed) {
+	struct stream *stm = si->source->stream;
+	si->drawn = (struct rectangle){0, 0, 0, 0};
+	for (struct object *ob = si->display; ob != NULL; ob = ob->above) {
+		bool obchanged = changed || ob->dirty;
+		ob->dirty = 0;
+		struct transform tx = *tsm;
+		transform_concat(&tx, &ob->transform);
+		switch (object_type(ob)) {
+		case CharacterShape:
+			if (obchanged) {
+				shape_damage(obj2shape(ob), stm, pl, &tx, stage);
+			}
+			if (ob->clipdepth == 0) {
+				sprite_union_drawn(si, &obj2shape(ob)->drawn);
+			}
+			break;
+		case CharacterSprite:
+			// Sprites in layers are drawn into them.
+			if (ob->bitmapcache && ob->clipdepth == 0 && stage != NULL) {
+				layer_damage(obj2sprite(ob), pl, &tx, stage, obchanged);
+			} else {
+				if (obj2sprite(ob)->layer != NULL) {
+					player_damage_object(pl, ob);
+					sprite_delete_layer(obj2sprite(ob));
+					obchanged = true;
+				}
+				sprite_damage(obj2sprite(ob), pl, &tx, stage, obchanged);
+			}
+			if (ob->clipdepth == 0) {
+				sprite_union_drawn(si, &obj2sprite(ob)->drawn);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void
+player_append_draw(struct player *pl, struct shape *sh, struct sprite *si, struct stream *stm, const struct transform *tsm) {
+	if (pl->ndraw == pl->drawcap) {
+		size_t cap = pl->drawcap == 0 ? 64 : 2*pl->drawcap;
+		pl->drawlist = pl->mem->realloc(pl->mem->ctx, pl->drawlist, sizeof(struct drawitem)*cap, __FILE__, __LINE__);
+		pl->drawcap = cap;
+	}
+	struct drawitem *di = &pl->drawlist[pl->ndraw++];
+	di->shape = sh;
+	di->sprite = si;
+	di->stream = stm;
+	di->transform = *tsm;
+	di->nmask = di->nmasked = 0;
+	di->clip = (struct rectangle){0, 0, 0, 0};
+	di->grouped = pl->ngroup != 0;
+	di->hidden = false;
+}
+
+static inline void
+rectangle_clip(struct rectangle *rt, const struct rectangle *clip) {
+	rt->xmin = rt->xmin < clip->xmin ? clip->xmin : rt->xmin;
+	rt->xmax = rt->xmax > clip->xmax ? clip->xmax : rt->xmax;
+	rt->ymin = rt->ymin < clip->ymin ? clip->ymin : rt->ymin;
+	rt->ymax = rt->ymax > clip->ymax ? clip->ymax : rt->ymax;
+}
+
+static const struct rectangle *
+object_drawn(struct object *ob) {
+	switch (object_type(ob)) {
+	case CharacterShape:
+		return &obj2shape(ob)->drawn;
+	case CharacterSprite:
+		return &obj2sprite(ob)->drawn;
+	default:
+		return NULL;
+	}
+}
+
+static void sprite_collect(struct sprite *si, struct player *pl, const struct transform *tsm, const struct rectangle *clip);
+static struct object *sprite_collect_objects(struct sprite *si, struct object *ob, depth_t until, struct player *pl, const struct transform *tsm, const struct rectangle *clip);
+
+// Mask clips objects above it up to its clip depth. They are listed after
+// items of mask in a group, see player_draw_group(), and are skipped where
+// mask is off clip. Return object above them.
+static struct object *
+sprite_collect_mask(struct sprite *si, struct object *mask, struct player *pl, const struct transform *tsm, const struct rectangle *clip) {
+	struct stream *stm = si->source->stream;
+	depth_t until = mask->clipdepth;
+	struct object *ob = mask->above;
+	const struct rectangle *drawn = object_drawn(mask);
+	if (drawn == NULL || !rectangle_intersect(drawn, clip)) {
+		while (ob != NULL && ob->depth <= until) {
+			ob = ob->above;
+		}
+		return ob;
+	}
+	struct rectangle rt = *drawn;
+	rectangle_clip(&rt, clip);
+	// Items are indexed, drawlist moves as it grows.
+	size_t head = pl->ndraw;
+	player_append_draw(pl, NULL, NULL, stm, tsm);
+	pl->ngroup++;
+	struct transform tx = *tsm;
+	transform_concat(&tx, &mask->transform);
+	if (object_type(mask) == CharacterShape) {
+		player_append_draw(pl, obj2shape(mask), NULL, stm, &tx);
+	} else {
+		sprite_collect(obj2sprite(mask), pl, &tx, &rt);
+	}
+	size_t nmask = pl->ndraw - head - 1;
+	ob = sprite_collect_objects(si, ob, until, pl, tsm, &rt);
+	pl->ngroup--;
+	size_t nmasked = pl->ndraw - head - 1 - nmask;
+	if (nmask == 0 || nmasked == 0) {
+		pl->ndraw = head;
+	} else {
+		struct drawitem *di = &pl->drawlist[head];
+		di->nmask = nmask;
+		di->nmasked = nmasked;
+		di->clip = rt;
+	}
+	return ob;
+}
+
+// Objects of si from ob up to depth until are listed from bottom to top,
+// tsm is transform of si's space. Shapes and sprites drawn out of clip are
+// skipped whole. Return object above them.
+static struct object *
+sprite_collect_objects(struct sprite *si, struct object *ob, depth_t until, struct player *pl, const struct transform *tsm, const struct rectangle *clip) {
+	struct stream *stm = si->source->stream;
+	while (ob != NULL && ob->depth <= until) {
+		if (ob->clipdepth != 0) {
+			ob = sprite_collect_mask(si, ob, pl, tsm, clip);
+			continue;
+		}
+		const struct rectangle *drawn = object_drawn(ob);
+		if (drawn != NULL && rectangle_intersect(drawn, clip)) {
+			struct transform tx = *tsm;
+			transform_concat(&tx, &ob->transform);
+			if (object_type(ob) == CharacterShape) {
+				player_append_draw(pl, obj2shape(ob), NULL, stm, &tx);
+			} else if (obj2sprite(ob)->layer != NULL) {
+				player_append_draw(pl, NULL, obj2sprite(ob), stm, &tx);
+			} else {
+				sprite_collect(obj2sprite(ob), pl, &tx, clip);
+			}
+		}
+		ob = ob->above;
+	}
+	return ob;
+}
+
+// Shapes over clip are listed from bottom to top, tsm is transform of
+// si's space.
+static void
+sprite_collect(struct sprite *si, struct player *pl, const struct transform *tsm, const struct rectangle *clip) {
+	sprite_collect_objects(si, si->display, (depth_t)-1, pl, tsm, clip);
+}
+
+static void player_draw_items(struct player *pl, struct bufctx *bx, const struct rectangle *clip, size_t beg, size_t end, bool restruct);
+
+static void
+pixels_copy(struct rgba8 *dst, size_t dststride, const struct rgba8 *src, size_t srcstride, size_t width, size_t height) {
+	for (size_t j=0; j<height; j++) {
+		memcpy(dst + j*dststride, src + j*srcstride, sizeof(struct rgba8)*width);
+	}
+}
+
+// Masked items and items of mask are drawn in turn over transparent pixels
+// within clip of group, target pixels there are saved before and restored
+// after. Masked pixels scaled by alpha of mask are composited over target.
+// Flash ignores alpha of mask fills, they are taken as coverage here.
+static void
+player_draw_group(struct player *pl, struct bufctx *bx, const struct rectangle *clip, size_t head, bool restruct) {
+	const struct drawitem *di = &pl->drawlist[head];
+	struct rectangle rt = di->clip;
+	rectangle_clip(&rt, clip);
+	if (rectangle_empty(&rt)) {
+		return;
+	}
+	size_t width = (size_t)(rt.xmax - rt.xmin);
+	size_t height = (size_t)(rt.ymax - rt.ymin);
+	size_t n = width*height;
+	struct rgba8 *saved = pl->mem->alloc(pl->mem->ctx, 3*sizeof(struct rgba8)*n, __FILE__, __LINE__);
+	struct rgba8 *masked = saved + n;
+	struct rgba8 *mask = masked + n;
+	struct rgba8 *pixels = bx->pixels + (size_t)rt.ymin*bx->stride + (size_t)rt.xmin;
+	size_t beg = head + 1 + di->nmask;
+	size_t end = beg + di->nmasked;
+
+	render_set_target(pl->render, NULL, NULL);
+	pixels_copy(saved, width, pixels, bx->stride, width, height);
+	for (size_t k=0; k<2; k++) {
+		for (size_t j=0; j<height; j++) {
+			memset(pixels + j*bx->stride, 0, sizeof(struct rgba8)*width);
+		}
+		render_set_target(pl->render, bx, &rt);
+		if (k == 0) {
+			player_draw_items(pl, bx, &rt, beg, end, restruct);
+		} else {
+			player_draw_items(pl, bx, &rt, head+1, beg, restruct);
+		}
+		render_set_target(pl->render, NULL, NULL);
+		pixels_copy(k == 0 ? masked : mask, width, pixels, bx->stride, width, height);
+	}
+	pixels_copy(pixels, bx->stride, saved, width, width, height);
+
+	for (size_t i=0; i<n; i++) {
+		uint32_t a = mask[i].a;
+		if (a != 255) {
+			struct rgba8 *px = &masked[i];
+			px->r = (uint8_t)((px->r*a + 127)/255);
+			px->g = (uint8_t)((px->g*a + 127)/255);
+			px->b = (uint8_t)((px->b*a + 127)/255);
+			px->a = (uint8_t)((px->a*a + 127)/255);
+		}
+	}
+	render_set_target(pl->render, bx, clip);
+	struct bufctx src = {.pixels = masked, .width = width, .height = height, .stride = width};
+	render_blit(pl->render, &src, rt.xmin, rt.ymin);
+	pl->mem->dealloc(pl->mem->ctx, saved, __FILE__, __LINE__);
+}
+
+// Items from beg to end are drawn into bx, which is target clipped to
+// clip. Graphs of shapes are rebuilt if they are stale, or restruct.
+static void
+player_draw_items(struct player *pl, struct bufctx *bx, const struct rectangle *clip, size_t beg, size_t end, bool restruct) {
+	for (size_t i=beg; i<end; i++) {
+		struct drawitem *di = &pl->drawlist[i];
+		if (di->nmask != 0) {
+			player_draw_group(pl, bx, clip, i, restruct);
+			i += di->nmask + di->nmasked;
+			continue;
+		}
+		if (di->hidden) {
+			continue;
+		}
+		if (di->shape == NULL) {
+			render_blit(pl->render, &di->sprite->layer->bx, di->sprite->drawn.xmin, di->sprite->drawn.ymin);
+			continue;
+		}
+		if (restruct || di->shape->stale) {
+			shape_struct_graph(di->shape, di->stream, pl->render, &di->transform);
+		}
+		stream_render_graph(di->stream, pl->render, di->shape->graph);
+	}
+}
+
+// Shapes are culled from top to bottom, ones within opaque pixels of
+// shapes above them are not drawn. Only topmost PLAYER_NOCCLUDER opaque
+// rectangles are tried.
+#define PLAYER_NOCCLUDER	16
+
+static void
+player_draw(struct player *pl, struct bufctx *bx, const struct rectangle *clip) {
+	struct rectangle occluders[PLAYER_NOCCLUDER];
+	size_t noccluder = 0;
+	for (size_t i=pl->ndraw; i-- > 0; ) {
+		struct drawitem *di = &pl->drawlist[i];
+		if (di->nmask != 0) {
+			continue;
+		}
+		struct rectangle rt = di->shape != NULL ? di->shape->drawn : di->sprite->drawn;
+		rectangle_clip(&rt, clip);
+		for (size_t j=0; j<noccluder; j++) {
+			if (rectangle_contain(&occluders[j], &rt)) {
+				di->hidden = true;
+				break;
+			}
+		}
+		if (di->hidden || di->shape == NULL || di->grouped) {
+			continue;
+		}
+		rt = di->shape->opaque;
+		rectangle_clip(&rt, clip);
+		if (!rectangle_empty(&rt) && noccluder < PLAYER_NOCCLUDER) {
+			occluders[noccluder++] = rt;
+		}
+	}
+	player_draw_items(pl, bx, clip, 0, pl->ndraw, false);
+	pl->ndraw = 0;
+}
+
+// Whether objects of si, or of sprites in it, are changed since last frame.
+static bool
+sprite_dirty(const struct sprite *si) {
+	for (const struct object *ob = si->display; ob != NULL; ob = ob->above) {
+		if (ob->dirty) {
+			return true;
+		}
+		if (object_type(ob) == CharacterSprite && sprite_dirty(obj2sprite(ob))) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool
+layer_reusable(const struct layer *ly, const struct transform *tsm) {
+	const struct matrix *mx = &ly->transform.matrix;
+	if (ly->stale || mx->sx != tsm->matrix.sx || mx->sy != tsm->matrix.sy || mx->shx != tsm->matrix.shx || mx->shy != tsm->matrix.shy) {
+		return false;
+	}
+	return memcmp(&ly->transform.cxform, &tsm->cxform, sizeof(tsm->cxform)) == 0;
+}
+
+static inline coord_t
+twips_round_pixels(coord_t twips) {
+	return twips >= 0 ? (twips+10)/20 : -((9-twips)/20);
+}
+
+// Layer is at most LAYER_MAXSIDE pixels wide and high, larger sprites are
+// drawn shape by shape.
+#define LAYER_MAXSIDE	1600
+
+// Draw shapes of si, drawn over si->drawn, into its layer. Return false if
+// layer is off stage, too large, or exceeds memory of layers.
+static bool
+layer_draw(struct sprite *si, struct player *pl, const struct transform *tsm, const struct rectangle *stage) {
+	struct rectangle rt = si->drawn;
+	if (!rectangle_intersect(&rt, stage)) {
+		return false;
+	}
+	size_t width = (size_t)(rt.xmax - rt.xmin);
+	size_t height = (size_t)(rt.ymax - rt.ymin);
+	if (width > LAYER_MAXSIDE || height > LAYER_MAXSIDE) {
+		return false;
+	}
+	size_t size = sizeof(struct rgba8)*width*height;
+	struct layer *ly = si->layer;
+	size_t old = ly != NULL ? ly->size : 0;
+	if (pl->layer_size - old + size > pl->layer_maxsize) {
+		return false;
+	}
+	if (ly == NULL) {
+		ly = pl->mem->alloc(pl->mem->ctx, sizeof(*ly), __FILE__, __LINE__);
+		ly->bx.pixels = NULL;
+		ly->size = 0;
+		si->layer = ly;
+	}
+	if (ly->size != size) {
+		if (ly->bx.pixels != NULL) {
+			pl->mem->dealloc(pl->mem->ctx, ly->bx.pixels, __FILE__, __LINE__);
+		}
+		ly->bx.pixels = pl->mem->alloc(pl->mem->ctx, size, __FILE__, __LINE__);
+		pl->layer_size = pl->layer_size - old + size;
+		ly->size = size;
+	}
+	ly->bx.width = ly->bx.stride = width;
+	ly->bx.height = height;
+	memset(ly->bx.pixels, 0, size);
+	ly->transform = *tsm;
+	ly->x = rt.xmin;
+	ly->y = rt.ymin;
+	ly->stale = false;
+
+	struct transform local = *tsm;
+	local.matrix.tx -= rt.xmin*20;
+	local.matrix.ty -= rt.ymin*20;
+	sprite_collect(si, pl, &local, &rt);
+	// Clips of mask groups are in pixels of stage.
+	for (size_t i=0; i<pl->ndraw; i++) {
+		struct rectangle *gc = &pl->drawlist[i].clip;
+		gc->xmin -= rt.xmin;
+		gc->xmax -= rt.xmin;
+		gc->ymin -= rt.ymin;
+		gc->ymax -= rt.ymin;
+	}
+	struct rectangle clip = {0, (coord_t)width, 0, (coord_t)height};
+	render_set_target(pl->render, &ly->bx, &clip);
+	player_draw_items(pl, &ly->bx, &clip, 0, pl->ndraw, true);
+	render_set_target(pl->render, NULL, NULL);
+	pl->ndraw = 0;
+	return true;
+}
+
+// Sprite cached as bitmap is drawn into its layer when objects of it are
+// changed, or it is scaled, rotated, skewed or colored differently.
+// Otherwise its layer is moved by translation rounded to pixels.
+static void
+layer_damage(struct sprite *si, struct player *pl, const struct transform *tsm, const struct rectangle *stage, bool changed) {
+	struct layer *ly = si->layer;
+	bool dirty = sprite_dirty(si);
+	if (ly != NULL && !dirty && layer_reusable(ly, tsm)) {
+		if (changed) {
+			struct rectangle rt;
+			rt.xmin = ly->x + twips_round_pixels(tsm->matrix.tx - ly->transform.matrix.tx);
+			rt.ymin = ly->y + twips_round_pixels(tsm->matrix.ty - ly->transform.matrix.ty);
+			rt.xmax = rt.xmin + (coord_t)ly->bx.width;
+			rt.ymax = rt.ymin + (coord_t)ly->bx.height;
+			if (memcmp(&rt, &si->drawn, sizeof(rt)) != 0) {
+				player_damage_stage(pl, &si->drawn, stage);
+				player_damage_stage(pl, &rt, stage);
+				si->drawn = rt;
+			}
+		}
+		return;
+	}
+	if (ly == NULL && !dirty && !changed) {
+		return;
+	}
+	player_damage_stage(pl, &si->drawn, stage);
+	sprite_damage(si, pl, tsm, NULL, true);
+	if (layer_draw(si, pl, tsm, stage)) {
+		player_damage_stage(pl, &si->drawn, stage);
+	} else {
+		// Shapes are drawn one by one.
+		sprite_delete_layer(si);
+		sprite_damage(si, pl, tsm, stage, true);
+	}
+}
+
+static bool
+player_target_changed(const struct player *pl, const struct transform *tsm, const struct bufctx *bx) {
+	if (!pl->rendered) {
+		return true;
+	}
+	const struct bufctx *old = &pl->target;
+	if (old->pixels != bx->pixels || old->width != bx->width || old->height != bx->height || old->stride != bx->stride) {
+		return true;
+	}
+	return memcmp(&pl->target_transform, tsm, sizeof(*tsm)) != 0;
+}
+
+void
+player_render(struct player *pl, struct transform tsm, struct bufctx *bx, struct rectangle *rt) {
+	struct rectangle stage = {0, (coord_t)bx->width, 0, (coord_t)bx->height};
+	bool changed = player_target_changed(pl, &tsm, bx);
+	if (changed) {
+		region_clear(&pl->damage);
+		region_add(&pl->damage, &stage);
+	}
+	region_add(&pl->damage, rt);
+	if (pl->threads != NULL) {
+		for (struct object *ob = obj2object(pl); ob != NULL; ob = ob->above) {
+			sprite_damage(obj2sprite(ob), pl, &tsm, &stage, changed);
+		}
+	}
+	region_clip(&pl->damage, &stage);
+	for (size_t i=0; i<pl->damage.n; i++) {
+		const struct rectangle *clip = &pl->damage.rects[i];
+		for (coord_t y=clip->ymin; y<clip->ymax; y++) {
+			struct rgba8 *row = bx->pixels + (size_t)y*bx->stride;
+			memset(row+clip->xmin, 0, sizeof(*row)*(size_t)(clip->xmax-clip->xmin));
+		}
+		if (pl->threads != NULL) {
+			for (struct object *ob = obj2object(pl); ob != NULL; ob = ob->above) {
+				sprite_collect(obj2sprite(ob), pl, &tsm, clip);
+			}
+			render_set_target(pl->render, bx, clip);
+			player_draw(pl, bx, clip);
+			render_set_target(pl->render, NULL, NULL);
+		}
+	}
+	region_bounds(&pl->damage, rt);
+	pl->redrawn = pl->damage;
+	region_clear(&pl->damage);
+	pl->rendered = true;
+	pl->target = *bx;
+	pl->target_transform = tsm;
+}
+
+const struct region *
+player_damage(const struct player *pl) {
+	return &pl->redrawn;
+}
+
+bool
+player_set_threads(struct player *pl, size_t nthread) {
+	return render_set_threads(pl->render, nthread);
+}
+
+void
+player_set_engine(struct player *pl, enum raster_engine engine) {
+	render_set_engine(pl->render, engine);
+}
+
+const struct render_stat *
+player_render_stat(const struct player *pl) {
+	return render_stat(pl->render);
+}
+
 void
 player_advance(struct player *pl) {
 	for (struct thread *td = pl->threads; td != NULL; td = td->tdnext) {
@@ -826,6 +1722,9 @@ player_advance(struct player *pl) {
 	// TODO Execute script
 }
 
+// Default memory of layers, as pixels of 4096x4096.
+#define PLAYER_LAYER_MAXSIZE	((size_t)64 << 20)
+
 static inline void
 player_inita(struct player *pl, struct muface *mux, struct memface *mem, struct logface *log, struct errface *err) {
 	memset(pl, 0, sizeof(*pl));
@@ -836,14 +1735,15 @@ player_inita(struct player *pl, struct muface *mux, struct memface *mem, struct
 	pl->unnamed_instances = 0;
 	pl->sapool = NULL;
 	pl->threads = NULL;
+	pl->layer_maxsize = PLAYER_LAYER_MAXSIZE;
 }
 
 static inline void
 player_initz(struct player * restrict pl) {
-	sprite_initz(obj2sprite(pl), obj2source(pl), pl);
 	pl->sapool = slab_pool_create(pl->mem, 10);
 	pl->object_slab[CharacterShape] = slab_pool_alloc(pl->sapool, 20, sizeof(struct shape));
 	pl->object_slab[CharacterSprite] = slab_pool_alloc(pl->sapool, 10, sizeof(struct sprite));
+	sprite_initz(obj2sprite(pl), obj2source(pl), pl);
 }
 
 void
@@ -851,21 +1751,60 @@ player_load0(struct player *pl, const void *ud, enum stream_type ut) {
 	// XXX How to reflect rate/size to outside ?
 	struct stream_define def;
 	pl->stream = pl->mux->create_stream(pl->mux->muplex, ud, ut, &def);
+	if (pl->stream == NULL || def.tagbeg == 0) {
+		return;
+	}
 	pl->define.nframe = def.nframe;
 	pl->define.tagbeg = def.tagbeg;
+	pl->define.frames = def.frames;
 	player_initz(pl);
 }
 
+bool
+player_feed(struct player *pl, const void *data, size_t size) {
+	if (pl->stream == NULL) {
+		return false;
+	}
+	struct stream_define def;
+	def.tagbeg = 0;
+	if (!pl->mux->feed_stream(pl->mux->muplex, pl->stream, data, size, &def)) {
+		return false;
+	}
+	// Timeline starts once stream header is fed.
+	if (pl->define.tagbeg == 0 && def.tagbeg != 0) {
+		pl->define.nframe = def.nframe;
+		pl->define.tagbeg = def.tagbeg;
+		pl->define.frames = def.frames;
+		player_initz(pl);
+	}
+	return true;
+}
+
 struct player *
 player_create(struct muface *mux, struct memface *mem, struct logface *log, struct errface *err) {
 	struct player *pl = mem->alloc(mem->ctx, sizeof(*pl), __FILE__, __LINE__);
 	player_inita(pl, mux, mem, log, err);
+	pl->render = render_create(mem, log, err);
 	return pl;
 }
 
 void
 player_delete(struct player *pl) {
 	// TODO delete all streams associated with sources.
+	for (struct thread *td = pl->threads; td != NULL; td = td->tdnext) {
+		struct sprite *si = sprite_from_thread(td);
+		sprite_delete_snapshots(si);
+		sprite_delete_layer(si);
+		for (struct object *ob = si->display; ob != NULL; ob = ob->above) {
+			if (object_type(ob) == CharacterShape) {
+				shape_delete_graph(obj2shape(ob), si->source->stream, pl->render);
+			}
+		}
+	}
+	render_delete(pl->render);
+	if (pl->drawlist != NULL) {
+		pl->mem->dealloc(pl->mem->ctx, pl->drawlist, __FILE__, __LINE__);
+	}
 	if (pl->stream) {
 		pl->mux->delete_stream(pl->mux->muplex, pl->stream);
 	}
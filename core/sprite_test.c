@@ -0,0 +1,165 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "bench.h"
+#include "player.h"
+#include "muplex.h"
+#include "render.h"
+#include "common.h"
+#include <base/hash.h>
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH		160
+#define HEIGHT		120
+#define NFRAME		64
+#define NOBJECT		6
+
+// Objects placed in first frame and moved in every frame, one of them is
+// replaced by another shape or removed every few frames.
+static void
+sprite_test_movie(struct swfgen *sg) {
+	uint32_t seed = 13;
+	static const intreg_t square[] = {0, 0, 600, 0, 600, 600, 0, 600};
+	static const intreg_t wedge[] = {0, 0, 800, 200, 200, 700};
+	swfgen_init(sg, WIDTH*20, HEIGHT*20, NFRAME);
+	swfgen_polygon(sg, 1, square, 4, 0xFF0000);
+	swfgen_polygon(sg, 2, wedge, 3, 0x00FF00);
+	for (size_t i=0; i<NFRAME; i++) {
+		for (uintreg_t d=1; d<=NOBJECT; d++) {
+			intreg_t tx = (intreg_t)(bench_random(&seed) % (WIDTH*20));
+			intreg_t ty = (intreg_t)(bench_random(&seed) % (HEIGHT*20));
+			if (i == 0) {
+				swfgen_place(sg, 1, d, tx, ty);
+			} else if (i%5 == 0 && d == i/5%NOBJECT + 1) {
+				swfgen_remove(sg, d);
+				if (i%3 != 0) {
+					swfgen_place(sg, 1 + i%2, d, tx, ty);
+				}
+			} else if (i%5 == 0 && d == (i/5+2)%NOBJECT + 1) {
+				swfgen_place(sg, 0, d, tx, ty);
+				swfgen_replace(sg, 1 + i%2, d);
+			} else {
+				swfgen_place(sg, 0, d, tx, ty);
+			}
+		}
+		swfgen_show(sg);
+	}
+	swfgen_finish(sg);
+}
+
+static uint64_t
+sprite_test_render(struct player *pl, struct bufctx *bx) {
+	struct transform tsm;
+	matrix_identify(&tsm.matrix);
+	cxform_identify(&tsm.cxform);
+	struct rectangle rt = {0, WIDTH, 0, HEIGHT};
+	player_render(pl, tsm, bx, &rt);
+	return hash_bytes(bx->pixels, sizeof(struct rgba8)*WIDTH*HEIGHT);
+}
+
+// Seeks backward restore nearest snapshot or rewind, and replay to same
+// frames as played forward from start.
+static void
+sprite_test_snapshot(void) {
+	printf("sprite_test_snapshot(), start.\n");
+	struct swfgen sg;
+	sprite_test_movie(&sg);
+	struct bufctx bx;
+	bx.width = bx.stride = WIDTH;
+	bx.height = HEIGHT;
+	bx.pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+
+	uint64_t linear[NFRAME];
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_load0(pl, sg.buf, StreamData);
+	for (size_t i=0; i<NFRAME; i++) {
+		player_advance(pl);
+		linear[i] = sprite_test_render(pl, &bx);
+	}
+	player_delete(pl);
+
+	static const size_t Intervals[] = {0, 1, 8, 13};
+	for (size_t n=0; n<sizeof(Intervals)/sizeof(Intervals[0]); n++) {
+		pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+		player_set_snapshot(pl, Intervals[n], SIZE_MAX);
+		player_load0(pl, sg.buf, StreamData);
+		player_goto_frame(pl, NFRAME-1);
+		assert(sprite_test_render(pl, &bx) == linear[NFRAME-1]);
+		assert((player_snapshot_size(pl) != 0) == (Intervals[n] != 0));
+		uint32_t seed = 29;
+		for (size_t i=0; i<3*NFRAME; i++) {
+			intreg_t to = (intreg_t)(bench_random(&seed) % NFRAME);
+			player_goto_frame(pl, to);
+			assert(sprite_test_render(pl, &bx) == linear[to]);
+		}
+		// Advancing from last frame loops to first one.
+		player_goto_frame(pl, NFRAME-1);
+		player_advance(pl);
+		assert(sprite_test_render(pl, &bx) == linear[0]);
+		player_delete(pl);
+	}
+
+	mux->delete_muplex(mux->muplex);
+	free(bx.pixels);
+	swfgen_free(&sg);
+	printf("sprite_test_snapshot(), done.\n");
+}
+
+// Snapshots stop being taken once they occupy maximum size, seeks beyond
+// them replay from nearest one taken.
+static void
+sprite_test_snapshot_cap(void) {
+	printf("sprite_test_snapshot_cap(), start.\n");
+	struct swfgen sg;
+	sprite_test_movie(&sg);
+	struct bufctx bx;
+	bx.width = bx.stride = WIDTH;
+	bx.height = HEIGHT;
+	bx.pixels = malloc(sizeof(struct rgba8)*WIDTH*HEIGHT);
+	struct muface *mux = muplex_create_default(&BenchMemface, &BenchLogface, &BenchErrface);
+
+	struct player *pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_set_snapshot(pl, 4, SIZE_MAX);
+	player_load0(pl, sg.buf, StreamData);
+	player_goto_frame(pl, NFRAME-1);
+	size_t full = player_snapshot_size(pl);
+	uint64_t frames[NFRAME];
+	for (intreg_t i=NFRAME; i-- > 0;) {
+		player_goto_frame(pl, i);
+		frames[i] = sprite_test_render(pl, &bx);
+	}
+	player_delete(pl);
+
+	pl = player_create(mux, &BenchMemface, &BenchLogface, &BenchErrface);
+	player_set_snapshot(pl, 4, full/2);
+	player_load0(pl, sg.buf, StreamData);
+	player_goto_frame(pl, NFRAME-1);
+	assert(player_snapshot_size(pl) != 0);
+	assert(player_snapshot_size(pl) <= full/2);
+	for (intreg_t i=NFRAME; i-- > 0;) {
+		player_goto_frame(pl, i);
+		assert(sprite_test_render(pl, &bx) == frames[i]);
+	}
+	player_delete(pl);
+
+	mux->delete_muplex(mux->muplex);
+	free(bx.pixels);
+	swfgen_free(&sg);
+	printf("sprite_test_snapshot_cap(), done.\n");
+}
+
+int
+main(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);
+	setvbuf(stderr, NULL, _IONBF, 0);
+
+	printf("Test sprite, start.\n");
+	sprite_test_snapshot();
+	sprite_test_snapshot_cap();
+	printf("Test sprite, done.\n");
+	return 0;
+}
@@ -1,18 +1,58 @@
 #ifndef __CORE_STREAM_H
 #define __CORE_STREAM_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 struct pxface;
+struct inflow;
+struct codebook;
 struct dictionary;
+struct cache_header;
+
+// Progress of resource's loading. Resource is loaded incrementally when
+// it is decompressed on demand, otherwise it is loaded at creation.
+struct loading {
+	// Bytes available from resource.
+	size_t nbyte;
+	// Number of completely available frames of main timeline,
+	// and end of the last one.
+	size_t nframe;
+	uintptr_t frameend;
+	// First tag of main timeline not yet known to be complete.
+	uintptr_t scanpos;
+	// Positions of main timeline's frames relative to its first tag,
+	// indexed while scanning. Capacity is one more than frame count in
+	// header, the extra one is end of the last frame.
+	uintptr_t tagbeg;
+	uint32_t *frames;
+	size_t maxframe;
+	// Non-NULL if resource is decompressed by parser.
+	struct inflow *inflow;
+};
 
 struct stream {
 	int type;
 	int version;
 	struct dictionary *dictionary;
+	struct codebook *codebook;
 	struct pxface *pxface;
 	uintptr_t resource;
 	uintptr_t userdef;
+	// Bytes addressable from resource.
+	size_t ressize;
+	// For StreamFile, end of range which had been advised to read ahead.
+	uintptr_t readahead;
+	struct loading loading;
+	// Key and size of stream content if it is cacheable, and mapped
+	// cache of it if any, see core/cache.h.
+	uint64_t contentkey;
+	size_t contentsize;
+	const struct cache_header *cache;
+	size_t cachesize;
+	// Cached frame and character expected to be restored next.
+	size_t cachecode;
+	size_t cachechar;
 };
 
 #endif
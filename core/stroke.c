@@ -0,0 +1,338 @@
+#include "stroke.h"
+#include "outline.h"
+#include <base/compat.h>
+#include <base/helper.h>
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define STROKE_PI		3.14159265358979323846
+// Largest angle a piece of curve turns before its sides are offset, and
+// largest angle a curve of arc spans.
+#define STROKE_MAX_TURN		(STROKE_PI/8)
+#define STROKE_MAX_ARC		(STROKE_PI/4)
+// Joins whose pies are thinner than this in twips are left out.
+#define STROKE_MIN_JOIN		0.5
+
+struct vec {
+	double x;
+	double y;
+};
+
+struct piece {
+	struct vec p0;
+	struct vec c;
+	struct vec p1;
+	bool curve;
+};
+
+struct stroking {
+	struct memface *mc;
+	struct outline *ol;
+	size_t maxrecord;
+	// Half of width.
+	double h;
+	// Segments of current path, which has a zero length one if dot is true.
+	struct piece *path;
+	size_t npath;
+	size_t pathcap;
+	bool dot;
+	struct vec dotpt;
+};
+
+static inline struct vec
+vec_make(double x, double y) {
+	return (struct vec){x, y};
+}
+
+static inline struct vec
+vec_point(const struct point *pt) {
+	return vec_make((double)pt->x, (double)pt->y);
+}
+
+static inline struct vec
+vec_add(struct vec a, struct vec b) {
+	return vec_make(a.x + b.x, a.y + b.y);
+}
+
+static inline struct vec
+vec_sub(struct vec a, struct vec b) {
+	return vec_make(a.x - b.x, a.y - b.y);
+}
+
+static inline struct vec
+vec_scale(struct vec a, double s) {
+	return vec_make(a.x*s, a.y*s);
+}
+
+static inline double
+vec_dot(struct vec a, struct vec b) {
+	return a.x*b.x + a.y*b.y;
+}
+
+static inline double
+vec_cross(struct vec a, struct vec b) {
+	return a.x*b.y - a.y*b.x;
+}
+
+static inline struct vec
+vec_unit(struct vec a) {
+	return vec_scale(a, 1/hypot(a.x, a.y));
+}
+
+// Normal at left of unit vector a.
+static inline struct vec
+vec_normal(struct vec a) {
+	return vec_make(-a.y, a.x);
+}
+
+static inline struct vec
+vec_polar(double angle) {
+	return vec_make(cos(angle), sin(angle));
+}
+
+static inline double
+vec_angle(struct vec a) {
+	return atan2(a.y, a.x);
+}
+
+static inline struct vec
+piece_start_tangent(const struct piece *pc) {
+	if (pc->curve && (pc->c.x != pc->p0.x || pc->c.y != pc->p0.y)) {
+		return vec_unit(vec_sub(pc->c, pc->p0));
+	}
+	return vec_unit(vec_sub(pc->p1, pc->p0));
+}
+
+static inline struct vec
+piece_end_tangent(const struct piece *pc) {
+	if (pc->curve && (pc->c.x != pc->p1.x || pc->c.y != pc->p1.y)) {
+		return vec_unit(vec_sub(pc->p1, pc->c));
+	}
+	return vec_unit(vec_sub(pc->p1, pc->p0));
+}
+
+static void
+stroking_record(struct stroking *sk, uintreg_t verb, struct vec control, struct vec anchor) {
+	struct outline *ol = sk->ol;
+	if (ol->nrecord == sk->maxrecord) {
+		sk->maxrecord = sk->maxrecord*2 + 16;
+		ol->records = sk->mc->realloc(sk->mc->ctx, ol->records, sizeof(struct outline_record)*sk->maxrecord, __FILE__, __LINE__);
+	}
+	struct outline_record *rc = &ol->records[ol->nrecord++];
+	rc->verb = verb;
+	rc->u.edge.control = (struct point){(coord_t)lround(control.x), (coord_t)lround(control.y)};
+	rc->u.edge.anchor = (struct point){(coord_t)lround(anchor.x), (coord_t)lround(anchor.y)};
+}
+
+static inline void
+stroking_move(struct stroking *sk, struct vec p) {
+	stroking_record(sk, OutlineVerbMove, p, p);
+}
+
+static inline void
+stroking_line(struct stroking *sk, struct vec p) {
+	stroking_record(sk, OutlineVerbLine, p, p);
+}
+
+static inline void
+stroking_curve(struct stroking *sk, struct vec c, struct vec p) {
+	stroking_record(sk, OutlineVerbCurve, c, p);
+}
+
+// Pie around o from angle a down to a-sweep, traversed clockwise as bands
+// are.
+static void
+stroking_pie(struct stroking *sk, struct vec o, double a, double sweep) {
+	size_t n = (size_t)ceil(sweep/STROKE_MAX_ARC);
+	double step = sweep/(double)n;
+	// Control of arc is where tangents at its ends meet.
+	double reach = sk->h/cos(step/2);
+	stroking_move(sk, o);
+	stroking_line(sk, vec_add(o, vec_scale(vec_polar(a), sk->h)));
+	for (size_t i=0; i<n; i++) {
+		struct vec c = vec_add(o, vec_scale(vec_polar(a - step/2), reach));
+		a -= step;
+		stroking_curve(sk, c, vec_add(o, vec_scale(vec_polar(a), sk->h)));
+	}
+	stroking_line(sk, o);
+}
+
+// Band of line, left side forward, right side backward.
+static void
+stroking_line_band(struct stroking *sk, const struct piece *pc) {
+	struct vec n = vec_scale(vec_normal(vec_unit(vec_sub(pc->p1, pc->p0))), sk->h);
+	stroking_move(sk, vec_add(pc->p0, n));
+	stroking_line(sk, vec_add(pc->p1, n));
+	stroking_line(sk, vec_sub(pc->p1, n));
+	stroking_line(sk, vec_sub(pc->p0, n));
+	stroking_line(sk, vec_add(pc->p0, n));
+}
+
+static inline struct vec
+curve_point(const struct piece *pc, double t) {
+	double u = 1 - t;
+	return vec_add(vec_add(vec_scale(pc->p0, u*u), vec_scale(pc->c, 2*u*t)), vec_scale(pc->p1, t*t));
+}
+
+static inline struct vec
+curve_derivative(const struct piece *pc, double t) {
+	return vec_scale(vec_add(vec_scale(vec_sub(pc->c, pc->p0), 1-t), vec_scale(vec_sub(pc->p1, pc->c), t)), 2);
+}
+
+// Curve is cut into pieces turning a little, sides of a piece are offset
+// as curves whose controls are where offset tangents at ends meet.
+static void
+stroking_curve_band(struct stroking *sk, const struct piece *pc) {
+	double turn = acos(fmax(-1.0, fmin(1.0, vec_dot(piece_start_tangent(pc), piece_end_tangent(pc)))));
+	size_t n = 1 + (size_t)(turn/STROKE_MAX_TURN);
+	for (size_t i=0; i<n; i++) {
+		double a = (double)i/(double)n, b = (double)(i+1)/(double)n;
+		struct piece sub;
+		sub.p0 = curve_point(pc, a);
+		sub.p1 = i+1 == n ? pc->p1 : curve_point(pc, b);
+		sub.c = vec_add(sub.p0, vec_scale(curve_derivative(pc, a), (b-a)/2));
+		sub.curve = true;
+		struct vec m0 = vec_normal(piece_start_tangent(&sub));
+		struct vec m1 = vec_normal(piece_end_tangent(&sub));
+		struct vec miter = vec_scale(vec_add(m0, m1), sk->h/(1 + vec_dot(m0, m1)));
+		m0 = vec_scale(m0, sk->h);
+		m1 = vec_scale(m1, sk->h);
+		stroking_move(sk, vec_add(sub.p0, m0));
+		stroking_curve(sk, vec_add(sub.c, miter), vec_add(sub.p1, m1));
+		stroking_line(sk, vec_sub(sub.p1, m1));
+		stroking_curve(sk, vec_sub(sub.c, miter), vec_sub(sub.p0, m0));
+		stroking_line(sk, vec_add(sub.p0, m0));
+	}
+}
+
+// Pie at outer side of turn from a to b.
+static void
+stroking_join(struct stroking *sk, const struct piece *a, const struct piece *b) {
+	struct vec ta = piece_end_tangent(a), tb = piece_start_tangent(b);
+	struct vec na = vec_normal(ta), nb = vec_normal(tb);
+	double cross = vec_cross(ta, tb);
+	if (cross == 0) {
+		if (vec_dot(ta, tb) < 0) {
+			// Path turns back, join is cap.
+			stroking_pie(sk, a->p1, vec_angle(na), STROKE_PI);
+		}
+		return;
+	}
+	// Outer side is right side if path turns left.
+	struct vec oa = cross > 0 ? vec_scale(na, -1) : na;
+	struct vec ob = cross > 0 ? vec_scale(nb, -1) : nb;
+	double a0 = vec_angle(oa), a1 = vec_angle(ob);
+	double sweep = a1 - a0;
+	sweep = sweep > STROKE_PI ? sweep - 2*STROKE_PI : sweep <= -STROKE_PI ? sweep + 2*STROKE_PI : sweep;
+	if (fabs(sweep)*sk->h < STROKE_MIN_JOIN) {
+		return;
+	}
+	stroking_pie(sk, a->p1, sweep > 0 ? a1 : a0, fabs(sweep));
+}
+
+static void
+stroking_end_path(struct stroking *sk) {
+	size_t n = sk->npath;
+	if (n == 0) {
+		if (sk->dot) {
+			stroking_pie(sk, sk->dotpt, 0, 2*STROKE_PI);
+		}
+		sk->dot = false;
+		return;
+	}
+	struct piece *path = sk->path;
+	for (size_t i=0; i<n; i++) {
+		if (path[i].curve) {
+			stroking_curve_band(sk, &path[i]);
+		} else {
+			stroking_line_band(sk, &path[i]);
+		}
+		if (i+1 < n) {
+			stroking_join(sk, &path[i], &path[i+1]);
+		}
+	}
+	if (path[n-1].p1.x == path[0].p0.x && path[n-1].p1.y == path[0].p0.y) {
+		stroking_join(sk, &path[n-1], &path[0]);
+	} else {
+		stroking_pie(sk, path[0].p0, vec_angle(vec_normal(piece_start_tangent(&path[0]))) + STROKE_PI, STROKE_PI);
+		stroking_pie(sk, path[n-1].p1, vec_angle(vec_normal(piece_end_tangent(&path[n-1]))), STROKE_PI);
+	}
+	sk->npath = 0;
+	sk->dot = false;
+}
+
+static void
+stroking_add(struct stroking *sk, struct vec p0, struct vec c, struct vec p1, bool curve) {
+	bool degenerate = p0.x == p1.x && p0.y == p1.y;
+	if (degenerate && (!curve || (c.x == p0.x && c.y == p0.y))) {
+		sk->dot = true;
+		sk->dotpt = p0;
+		return;
+	}
+	if (sk->npath == sk->pathcap) {
+		sk->pathcap = sk->pathcap*2 + 16;
+		sk->path = sk->mc->realloc(sk->mc->ctx, sk->path, sizeof(struct piece)*sk->pathcap, __FILE__, __LINE__);
+	}
+	sk->path[sk->npath++] = (struct piece){p0, c, p1, curve};
+}
+
+struct outline *
+stroke_expand(struct memface *mc, const struct outline *ol, size_t palette, size_t line, coord_t width) {
+	struct stroking sk;
+	sk.mc = mc;
+	sk.ol = mc->alloc(mc->ctx, sizeof(struct outline), __FILE__, __LINE__);
+	sk.ol->nrecord = 0;
+	sk.ol->npalette = 0;
+	sk.ol->borrowed = false;
+	sk.ol->records = NULL;
+	sk.ol->palettes = NULL;
+	sk.maxrecord = 0;
+	sk.h = (double)width/2;
+	sk.path = NULL;
+	sk.npath = sk.pathcap = 0;
+	sk.dot = false;
+
+	size_t pal = 0, cur = 0;
+	struct vec pen = vec_make(0, 0);
+	const struct outline_record *rc = ol->records;
+	for (size_t i=0, n=ol->nrecord; i<n; i++, rc++) {
+		switch (rc->verb) {
+		case OutlineVerbStyle:
+			stroking_end_path(&sk);
+			if ((rc->u.style.flag & RecordStateNewStyles)) {
+				pal = rc->u.style.palette + 1;
+			}
+			cur = rc->u.style.line;
+			break;
+		case OutlineVerbMove:
+			stroking_end_path(&sk);
+			pen = vec_point(&rc->u.edge.anchor);
+			break;
+		case OutlineVerbLine:
+		case OutlineVerbCurve: {
+			struct vec anchor = vec_point(&rc->u.edge.anchor);
+			if (pal == palette && cur == line) {
+				bool curve = rc->verb == OutlineVerbCurve;
+				struct vec control = curve ? vec_point(&rc->u.edge.control) : anchor;
+				stroking_add(&sk, pen, control, anchor, curve);
+			} else {
+				stroking_end_path(&sk);
+			}
+			pen = anchor;
+			break;
+		}
+		}
+	}
+	stroking_end_path(&sk);
+	if (sk.path != NULL) {
+		mc->dealloc(mc->ctx, sk.path, __FILE__, __LINE__);
+	}
+	if (sk.ol->nrecord == 0) {
+		outline_delete(mc, sk.ol);
+		return NULL;
+	}
+	return sk.ol;
+}
@@ -0,0 +1,25 @@
+#ifndef __CORE_STROKE_H
+#define __CORE_STROKE_H
+
+#include <base/geometry.h>
+
+#include <stddef.h>
+
+struct memface;
+struct outline;
+
+// Strokes of shape outlines expanded into fills.
+//
+// Line styles of DefineShape to DefineShape3 have round caps and joins.
+// Segments are expanded into bands along them, and round caps and outer
+// sides of joins into pies. All contours are wound same way, so that they
+// fill union of strokes by nonzero rule.
+
+// Expand segments of ol drawn by line style line of palette into contours
+// of width wide strokes, in shape space. palette counts styles replaced by
+// RecordStateNewStyles, zero is styles of shape tag.
+// Returned outline has only move, line and curve records, NULL if no
+// segment is drawn by line style.
+struct outline *stroke_expand(struct memface *mc, const struct outline *ol, size_t palette, size_t line, coord_t width);
+
+#endif
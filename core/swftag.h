@@ -85,4 +85,7 @@ enum swftag {
 	SwftagDefineStartSound2		= 89,
 	SwftagDefineBitsJPEG4		= 90,
 };
+
+// Tag codes are 10 bits in tag header.
+#define SWFTAG_NCODE	1024
 #endif
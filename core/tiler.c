@@ -0,0 +1,461 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "tiler.h"
+#include "raster.h"
+#include "render.h"
+#include "edge.h"
+#include <base/compat.h>
+#include <base/helper.h>
+#include <base/geometry.h>
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// Tile size in pixels. Every tile walks all segments crossing its rows, so
+// tiles are as wide as common targets, rows are not split among threads.
+#define TILER_TILE_WIDTH	2048
+#define TILER_TILE_HEIGHT	32
+// Twips per pixel.
+#define TILER_TWIPS		20
+
+// Queued texture, and pixels its edges span. Bounds are widened by a pixel,
+// since segments step away from their exact positions a bit.
+//
+// Texture overlapping more than one tile is flattened once per flush, into
+// lines[line] to lines[line+nline-1], and its lines crossing tile row row+r
+// are lines[line+banded[k]], bands[band+r] <= k < bands[band+r+1].
+struct tiletex {
+	const struct texture *texture;
+	int32_t xmin;
+	int32_t xmax;
+	int32_t ymin;
+	int32_t ymax;
+	bool flat;
+	size_t line;
+	size_t nline;
+	size_t row;
+	size_t band;
+};
+
+// Tiles [head, tail) left to a thread. Owner takes from head, thieves take
+// from tail.
+struct tiledeque {
+	pthread_mutex_t lock;
+	size_t head;
+	size_t tail;
+};
+
+struct tileworker {
+	struct tiler *tiler;
+	size_t index;
+	pthread_t thread;
+	struct raster *raster;
+	struct tiledeque deque;
+};
+
+struct tiler {
+	struct memface *memface;
+	// workers[0] is caller of tiler_flush(), others run their own threads.
+	struct tileworker *workers;
+	size_t nthread;
+	pthread_mutex_t lock;
+	// Signaled when a flush starts or workers quit.
+	pthread_cond_t wakeup;
+	// Signaled when last worker finishes its flush.
+	pthread_cond_t done;
+	bool quit;
+	uint64_t generation;
+	size_t nbusy;
+	struct tiletex *texes;
+	size_t ntex;
+	size_t texcap;
+	// Textures of tile t are binned[bins[t]] to binned[bins[t+1]-1], in
+	// queued order.
+	size_t *bins;
+	size_t bincap;
+	size_t *cursors;
+	size_t curcap;
+	size_t *binned;
+	size_t binnedcap;
+	// Flattened lines of textures, and their bands, see struct tiletex.
+	struct rasterline *lines;
+	size_t linecap;
+	size_t *bands;
+	size_t bandcap;
+	size_t *banded;
+	size_t bandedcap;
+	// Target, clip and tiles of current flush.
+	struct bufctx *target;
+	int32_t cx0;
+	int32_t cx1;
+	int32_t cy0;
+	int32_t cy1;
+	size_t ncol;
+	struct render_stat stat;
+};
+
+static inline void *
+tiler_malloc(struct tiler *tl, size_t size) {
+	return tl->memface->alloc(tl->memface->ctx, size, __FILE__, __LINE__);
+}
+
+static inline void
+tiler_dealloc(struct tiler *tl, void *ptr) {
+	if (ptr != NULL) {
+		tl->memface->dealloc(tl->memface->ctx, ptr, __FILE__, __LINE__);
+	}
+}
+
+// Grow array at *ptr to hold n items of isize bytes, keeping its items.
+static void
+tiler_reserve(struct tiler *tl, void **ptr, size_t *cap, size_t n, size_t isize) {
+	if (n <= *cap) {
+		return;
+	}
+	size_t ncap = *cap*2 > n ? *cap*2 : n + 16;
+	void *p = tiler_malloc(tl, ncap*isize);
+	if (*cap != 0) {
+		memcpy(p, *ptr, *cap*isize);
+	}
+	tiler_dealloc(tl, *ptr);
+	*ptr = p;
+	*cap = ncap;
+}
+
+static bool
+tiler_take(struct tiler *tl, size_t self, size_t *tile) {
+	for (size_t i=0; i<tl->nthread; i++) {
+		struct tiledeque *dq = &tl->workers[(self+i)%tl->nthread].deque;
+		bool taken = false;
+		pthread_mutex_lock(&dq->lock);
+		if (dq->head < dq->tail) {
+			*tile = i == 0 ? dq->head++ : --dq->tail;
+			taken = true;
+		}
+		pthread_mutex_unlock(&dq->lock);
+		if (taken) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void
+tiler_fill_tile(struct tiler *tl, struct raster *ra, size_t tile) {
+	struct rectangle clip;
+	clip.xmin = tl->cx0 + (coord_t)(tile%tl->ncol)*TILER_TILE_WIDTH;
+	clip.ymin = tl->cy0 + (coord_t)(tile/tl->ncol)*TILER_TILE_HEIGHT;
+	clip.xmax = clip.xmin + TILER_TILE_WIDTH > tl->cx1 ? tl->cx1 : clip.xmin + TILER_TILE_WIDTH;
+	clip.ymax = clip.ymin + TILER_TILE_HEIGHT > tl->cy1 ? tl->cy1 : clip.ymin + TILER_TILE_HEIGHT;
+	size_t row = tile/tl->ncol;
+	for (size_t i=tl->bins[tile]; i<tl->bins[tile+1]; i++) {
+		const struct tiletex *tx = &tl->texes[tl->binned[i]];
+		if (tx->flat) {
+			const size_t *band = &tl->bands[tx->band + row - tx->row];
+			raster_fill_lines(ra, tx->texture, tl->lines + tx->line, tl->banded + band[0], band[1] - band[0], tl->target, &clip);
+		} else {
+			raster_fill_texture(ra, tx->texture, tl->target, &clip);
+		}
+	}
+}
+
+static void
+tiler_work(struct tiler *tl, size_t self) {
+	struct raster *ra = tl->workers[self].raster;
+	size_t tile;
+	while (tiler_take(tl, self, &tile)) {
+		tiler_fill_tile(tl, ra, tile);
+	}
+}
+
+static void *
+tiler_main(void *arg) {
+	struct tileworker *tw = arg;
+	struct tiler *tl = tw->tiler;
+	uint64_t generation = 0;
+	pthread_mutex_lock(&tl->lock);
+	for (;;) {
+		while (!tl->quit && tl->generation == generation) {
+			pthread_cond_wait(&tl->wakeup, &tl->lock);
+		}
+		if (tl->quit) {
+			break;
+		}
+		generation = tl->generation;
+		pthread_mutex_unlock(&tl->lock);
+
+		tiler_work(tl, tw->index);
+
+		pthread_mutex_lock(&tl->lock);
+		if (--tl->nbusy == 0) {
+			pthread_cond_signal(&tl->done);
+		}
+	}
+	pthread_mutex_unlock(&tl->lock);
+	return NULL;
+}
+
+static void
+tiler_stop(struct tiler *tl, size_t nstarted) {
+	pthread_mutex_lock(&tl->lock);
+	tl->quit = true;
+	pthread_cond_broadcast(&tl->wakeup);
+	pthread_mutex_unlock(&tl->lock);
+	for (size_t i=1; i<nstarted; i++) {
+		pthread_join(tl->workers[i].thread, NULL);
+	}
+	for (size_t i=0; i<tl->nthread; i++) {
+		pthread_mutex_destroy(&tl->workers[i].deque.lock);
+		raster_delete(tl->workers[i].raster);
+	}
+	pthread_cond_destroy(&tl->done);
+	pthread_cond_destroy(&tl->wakeup);
+	pthread_mutex_destroy(&tl->lock);
+	tiler_dealloc(tl, tl->banded);
+	tiler_dealloc(tl, tl->bands);
+	tiler_dealloc(tl, tl->lines);
+	tiler_dealloc(tl, tl->binned);
+	tiler_dealloc(tl, tl->cursors);
+	tiler_dealloc(tl, tl->bins);
+	tiler_dealloc(tl, tl->texes);
+	tiler_dealloc(tl, tl->workers);
+	tiler_dealloc(tl, tl);
+}
+
+struct tiler *
+tiler_create(struct memface *mc, size_t nthread) {
+	assert(nthread != 0);
+	struct tiler *tl = mc->zalloc(mc->ctx, sizeof(*tl), __FILE__, __LINE__);
+	tl->memface = mc;
+	tl->nthread = nthread;
+	tl->workers = mc->zalloc(mc->ctx, sizeof(struct tileworker)*nthread, __FILE__, __LINE__);
+	pthread_mutex_init(&tl->lock, NULL);
+	pthread_cond_init(&tl->wakeup, NULL);
+	pthread_cond_init(&tl->done, NULL);
+	for (size_t i=0; i<nthread; i++) {
+		struct tileworker *tw = &tl->workers[i];
+		tw->tiler = tl;
+		tw->index = i;
+		tw->raster = raster_create(mc);
+		pthread_mutex_init(&tw->deque.lock, NULL);
+	}
+	for (size_t i=1; i<nthread; i++) {
+		if (pthread_create(&tl->workers[i].thread, NULL, tiler_main, &tl->workers[i]) != 0) {
+			tiler_stop(tl, i);
+			return NULL;
+		}
+	}
+	return tl;
+}
+
+void
+tiler_delete(struct tiler *tl) {
+	tiler_stop(tl, tl->nthread);
+}
+
+// Largest integer not above v/TILER_TWIPS.
+static inline int32_t
+tiler_pixel_floor(int32_t v) {
+	return v >= 0 ? v/TILER_TWIPS : -((-v + TILER_TWIPS - 1)/TILER_TWIPS);
+}
+
+void
+tiler_queue(struct tiler *tl, const struct texture *tu) {
+	if (tu == NULL) {
+		return;
+	}
+	tiler_reserve(tl, (void **)&tl->texes, &tl->texcap, tl->ntex+1, sizeof(struct tiletex));
+	struct tiletex *tx = &tl->texes[tl->ntex++];
+	tx->texture = tu;
+	tx->xmin = tiler_pixel_floor(tu->origin.x) - 1;
+	tx->ymin = tiler_pixel_floor(tu->origin.y) - 1;
+	tx->xmax = tiler_pixel_floor(tu->origin.x + tu->width) + 2;
+	tx->ymax = tiler_pixel_floor(tu->origin.y + tu->height) + 2;
+}
+
+// Tiles columns [*c0, *c1) and rows [*r0, *r1) overlapped by tx.
+static bool
+tiler_tile_range(const struct tiler *tl, const struct tiletex *tx, size_t *c0, size_t *c1, size_t *r0, size_t *r1) {
+	int32_t xmin = tx->xmin < tl->cx0 ? tl->cx0 : tx->xmin;
+	int32_t xmax = tx->xmax > tl->cx1 ? tl->cx1 : tx->xmax;
+	int32_t ymin = tx->ymin < tl->cy0 ? tl->cy0 : tx->ymin;
+	int32_t ymax = tx->ymax > tl->cy1 ? tl->cy1 : tx->ymax;
+	if (xmin >= xmax || ymin >= ymax) {
+		return false;
+	}
+	*c0 = (size_t)(xmin - tl->cx0)/TILER_TILE_WIDTH;
+	*c1 = (size_t)(xmax - tl->cx0 - 1)/TILER_TILE_WIDTH + 1;
+	*r0 = (size_t)(ymin - tl->cy0)/TILER_TILE_HEIGHT;
+	*r1 = (size_t)(ymax - tl->cy0 - 1)/TILER_TILE_HEIGHT + 1;
+	return true;
+}
+
+// Tile rows [*lr0, *lr1) among [r0, r1) crossed by ln, widened as texture
+// bounds are.
+static void
+tiler_line_rows(const struct tiler *tl, const struct rasterline *ln, size_t r0, size_t r1, size_t *lr0, size_t *lr1) {
+	double ymin = floor(fmin(ln->y0, ln->y1)/TILER_TWIPS) - 1;
+	double ymax = floor(fmax(ln->y0, ln->y1)/TILER_TWIPS) + 2;
+	double lo = (double)tl->cy0 + (double)r0*TILER_TILE_HEIGHT;
+	double hi = (double)tl->cy0 + (double)r1*TILER_TILE_HEIGHT;
+	ymin = ymin < lo ? lo : ymin;
+	ymax = ymax > hi ? hi : ymax;
+	if (ymin >= ymax) {
+		*lr0 = *lr1 = r0;
+		return;
+	}
+	*lr0 = (size_t)(ymin - tl->cy0)/TILER_TILE_HEIGHT;
+	*lr1 = (size_t)(ymax - tl->cy0 - 1)/TILER_TILE_HEIGHT + 1;
+}
+
+// Flatten tx once, and bin its lines by tile rows [r0, r1) it overlaps.
+// Lines keep their order in every row, so pixels of a tile are same as
+// rastering whole texture clipped to it.
+static void
+tiler_flatten(struct tiler *tl, struct tiletex *tx, size_t *nline, size_t *nband, size_t *nbanded, size_t r0, size_t r1) {
+	const struct texture *tu = tx->texture;
+	tiler_reserve(tl, (void **)&tl->lines, &tl->linecap, *nline + tu->nline, sizeof(struct rasterline));
+	struct rasterline *lines = tl->lines + *nline;
+	size_t n = raster_flatten_texture(tu, lines);
+	assert(n == tu->nline);
+	size_t nrow = r1 - r0;
+	tx->flat = true;
+	tx->line = *nline;
+	tx->nline = n;
+	tx->row = r0;
+	tx->band = *nband;
+	*nline += n;
+	*nband += nrow + 1;
+	tiler_reserve(tl, (void **)&tl->bands, &tl->bandcap, *nband, sizeof(size_t));
+	size_t *bands = tl->bands + tx->band;
+	memset(bands, 0, sizeof(size_t)*(nrow+1));
+	size_t lr0, lr1;
+	for (size_t i=0; i<n; i++) {
+		tiler_line_rows(tl, &lines[i], r0, r1, &lr0, &lr1);
+		for (size_t r=lr0; r<lr1; r++) {
+			bands[r - r0 + 1]++;
+		}
+	}
+	for (size_t r=0; r<nrow; r++) {
+		bands[r+1] += bands[r];
+	}
+	tiler_reserve(tl, (void **)&tl->banded, &tl->bandedcap, *nbanded + bands[nrow], sizeof(size_t));
+	tiler_reserve(tl, (void **)&tl->cursors, &tl->curcap, nrow, sizeof(size_t));
+	for (size_t r=0; r<nrow; r++) {
+		bands[r] += *nbanded;
+		tl->cursors[r] = bands[r];
+	}
+	bands[nrow] += *nbanded;
+	*nbanded = bands[nrow];
+	for (size_t i=0; i<n; i++) {
+		tiler_line_rows(tl, &lines[i], r0, r1, &lr0, &lr1);
+		for (size_t r=lr0; r<lr1; r++) {
+			tl->banded[tl->cursors[r - r0]++] = i;
+		}
+	}
+}
+
+static size_t
+tiler_bin(struct tiler *tl) {
+	size_t nrow = (size_t)(tl->cy1 - tl->cy0 + TILER_TILE_HEIGHT - 1)/TILER_TILE_HEIGHT;
+	tl->ncol = (size_t)(tl->cx1 - tl->cx0 + TILER_TILE_WIDTH - 1)/TILER_TILE_WIDTH;
+	size_t ntile = tl->ncol*nrow;
+	tiler_reserve(tl, (void **)&tl->bins, &tl->bincap, ntile+1, sizeof(size_t));
+	size_t c0, c1, r0, r1;
+	size_t nline = 0, nband = 0, nbanded = 0;
+	for (size_t i=0; i<tl->ntex; i++) {
+		struct tiletex *tx = &tl->texes[i];
+		tx->flat = false;
+		if (tiler_tile_range(tl, tx, &c0, &c1, &r0, &r1) && (r1 - r0)*(c1 - c0) > 1) {
+			tiler_flatten(tl, tx, &nline, &nband, &nbanded, r0, r1);
+		}
+	}
+	memset(tl->bins, 0, sizeof(size_t)*(ntile+1));
+	for (size_t i=0; i<tl->ntex; i++) {
+		if (!tiler_tile_range(tl, &tl->texes[i], &c0, &c1, &r0, &r1)) {
+			continue;
+		}
+		for (size_t r=r0; r<r1; r++) {
+			for (size_t c=c0; c<c1; c++) {
+				tl->bins[r*tl->ncol + c + 1]++;
+			}
+		}
+	}
+	tiler_reserve(tl, (void **)&tl->cursors, &tl->curcap, ntile, sizeof(size_t));
+	for (size_t t=0; t<ntile; t++) {
+		tl->bins[t+1] += tl->bins[t];
+		tl->cursors[t] = tl->bins[t];
+	}
+	tiler_reserve(tl, (void **)&tl->binned, &tl->binnedcap, tl->bins[ntile], sizeof(size_t));
+	for (size_t i=0; i<tl->ntex; i++) {
+		if (!tiler_tile_range(tl, &tl->texes[i], &c0, &c1, &r0, &r1)) {
+			continue;
+		}
+		for (size_t r=r0; r<r1; r++) {
+			for (size_t c=c0; c<c1; c++) {
+				tl->binned[tl->cursors[r*tl->ncol + c]++] = i;
+			}
+		}
+	}
+	return ntile;
+}
+
+void
+tiler_flush(struct tiler *tl, struct bufctx *bx, const struct rectangle *clip) {
+	if (tl->ntex == 0) {
+		return;
+	}
+	tl->cx0 = clip->xmin < 0 ? 0 : clip->xmin;
+	tl->cy0 = clip->ymin < 0 ? 0 : clip->ymin;
+	tl->cx1 = clip->xmax > (coord_t)bx->width ? (coord_t)bx->width : clip->xmax;
+	tl->cy1 = clip->ymax > (coord_t)bx->height ? (coord_t)bx->height : clip->ymax;
+	if (tl->cx0 < tl->cx1 && tl->cy0 < tl->cy1) {
+		for (size_t i=0; i<tl->ntex; i++) {
+			tl->stat.nedge += tl->texes[i].texture->nedge;
+			tl->stat.nline += tl->texes[i].texture->nline;
+		}
+		tl->stat.ntexture += tl->ntex;
+		tl->target = bx;
+		size_t ntile = tiler_bin(tl);
+		// Threads start with neighbouring tiles, which share edges.
+		for (size_t i=0; i<tl->nthread; i++) {
+			tl->workers[i].deque.head = ntile*i/tl->nthread;
+			tl->workers[i].deque.tail = ntile*(i+1)/tl->nthread;
+		}
+		pthread_mutex_lock(&tl->lock);
+		tl->nbusy = tl->nthread - 1;
+		tl->generation++;
+		pthread_cond_broadcast(&tl->wakeup);
+		pthread_mutex_unlock(&tl->lock);
+
+		tiler_work(tl, 0);
+
+		pthread_mutex_lock(&tl->lock);
+		while (tl->nbusy != 0) {
+			pthread_cond_wait(&tl->done, &tl->lock);
+		}
+		pthread_mutex_unlock(&tl->lock);
+		tl->target = NULL;
+	}
+	tl->ntex = 0;
+}
+
+void
+tiler_set_engine(struct tiler *tl, enum raster_engine engine) {
+	for (size_t i=0; i<tl->nthread; i++) {
+		raster_set_engine(tl->workers[i].raster, engine);
+	}
+}
+
+void
+tiler_stat(const struct tiler *tl, struct render_stat *st) {
+	st->ntexture += tl->stat.ntexture;
+	st->nedge += tl->stat.nedge;
+	st->nline += tl->stat.nline;
+	for (size_t i=0; i<tl->nthread; i++) {
+		st->npixel += raster_stat(tl->workers[i].raster)->npixel;
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef __CORE_TILER_H
+#define __CORE_TILER_H
+
+#include "common.h"
+#include <stddef.h>
+
+struct memface;
+struct texture;
+struct bufctx;
+struct rectangle;
+struct render_stat;
+struct tiler;
+
+// Tiled rasterization on a pool of threads.
+//
+// Queued textures are binned by screen tiles their edges overlap, and tiles
+// are rasterized in parallel, textures of a tile in queued order. Threads
+// run out of tiles steal from others. Pixels are same as rasterizing
+// textures one by one into whole clip.
+// Memface must be safe to be called from worker threads. Edges and colors
+// of queued textures must outlive flushing.
+
+// nthread threads rasterize, including caller of tiler_flush().
+// Return NULL if worker threads can't be started.
+struct tiler *tiler_create(struct memface *mc, size_t nthread);
+// Stop workers, queued textures are discarded.
+void tiler_delete(struct tiler *tl);
+
+void tiler_set_engine(struct tiler *tl, enum raster_engine engine);
+
+void tiler_queue(struct tiler *tl, const struct texture *tu);
+
+// Rasterize queued textures into bx inside clip, which is in pixels, and
+// empty queue.
+void tiler_flush(struct tiler *tl, struct bufctx *bx, const struct rectangle *clip);
+
+// Add work of rasterizers to st.
+void tiler_stat(const struct tiler *tl, struct render_stat *st);
+
+#endif
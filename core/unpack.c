@@ -0,0 +1,192 @@
+#include "unpack.h"
+#include <base/compat.h>
+#include <base/helper.h>
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zlib.h>
+#include <lzma.h>
+
+struct unpack {
+	enum unpack_type type;
+	void *memctx;
+	MemfaceAllocFunc_t malloc;
+	MemfaceDeallocFunc_t dealloc;
+	union {
+		z_stream zlib;
+		struct {
+			lzma_stream stream;
+			lzma_allocator allocator;
+		} lzma;
+	} u;
+};
+
+static voidpf
+zlib_alloc(voidpf opaque, uInt items, uInt size) {
+	struct unpack *up = opaque;
+	return up->malloc(up->memctx, (size_t)items*size, __FILE__, __LINE__);
+}
+
+static void
+zlib_free(voidpf opaque, voidpf ptr) {
+	struct unpack *up = opaque;
+	up->dealloc(up->memctx, ptr, __FILE__, __LINE__);
+}
+
+static bool
+zlib_init(struct unpack *up) {
+	z_stream *zs = &up->u.zlib;
+	memset(zs, 0, sizeof(*zs));
+	zs->zalloc = zlib_alloc;
+	zs->zfree = zlib_free;
+	zs->opaque = up;
+	return inflateInit(zs) == Z_OK;
+}
+
+// Each round of inflate() takes no more than UINT_MAX bytes.
+static inline uInt
+zlib_clamp(size_t n) {
+	return n > UINT_MAX ? UINT_MAX : (uInt)n;
+}
+
+static enum unpack_status
+zlib_run(struct unpack *up, const uint8_t **in, size_t *inlen, uint8_t **out, size_t *outlen) {
+	z_stream *zs = &up->u.zlib;
+	for (;;) {
+		zs->next_in = (Bytef *)*in;
+		zs->avail_in = zlib_clamp(*inlen);
+		zs->next_out = *out;
+		zs->avail_out = zlib_clamp(*outlen);
+		uInt availin = zs->avail_in, availout = zs->avail_out;
+		int err = inflate(zs, Z_NO_FLUSH);
+		*in += availin - zs->avail_in;
+		*inlen -= availin - zs->avail_in;
+		*out += availout - zs->avail_out;
+		*outlen -= availout - zs->avail_out;
+		switch (err) {
+		case Z_STREAM_END:
+			return UnpackStatusEnd;
+		case Z_OK:
+			if (*inlen != 0 && *outlen != 0) {
+				continue;
+			}
+			return UnpackStatusMore;
+		case Z_BUF_ERROR:
+			return UnpackStatusMore;
+		default:
+			return UnpackStatusError;
+		}
+	}
+}
+
+static void *
+lzma_alloc(void *opaque, size_t nmemb, size_t size) {
+	struct unpack *up = opaque;
+	return up->malloc(up->memctx, nmemb*size, __FILE__, __LINE__);
+}
+
+static void
+lzma_free(void *opaque, void *ptr) {
+	struct unpack *up = opaque;
+	if (ptr != NULL) {
+		up->dealloc(up->memctx, ptr, __FILE__, __LINE__);
+	}
+}
+
+static bool
+lzma_init(struct unpack *up, const uint8_t *prop, size_t proplen) {
+	lzma_allocator *al = &up->u.lzma.allocator;
+	al->alloc = lzma_alloc;
+	al->free = lzma_free;
+	al->opaque = up;
+	lzma_filter filters[2] = {
+		{.id = LZMA_FILTER_LZMA1, .options = NULL},
+		{.id = LZMA_VLI_UNKNOWN, .options = NULL},
+	};
+	if (lzma_properties_decode(&filters[0], al, prop, proplen) != LZMA_OK) {
+		return false;
+	}
+	lzma_stream *ls = &up->u.lzma.stream;
+	memset(ls, 0, sizeof(*ls));
+	ls->allocator = al;
+	lzma_ret ret = lzma_raw_decoder(ls, filters);
+	// Options are copied by decoder.
+	lzma_free(up, filters[0].options);
+	if (ret != LZMA_OK) {
+		lzma_end(ls);
+		return false;
+	}
+	return true;
+}
+
+static enum unpack_status
+lzma_run(struct unpack *up, const uint8_t **in, size_t *inlen, uint8_t **out, size_t *outlen) {
+	lzma_stream *ls = &up->u.lzma.stream;
+	ls->next_in = *in;
+	ls->avail_in = *inlen;
+	ls->next_out = *out;
+	ls->avail_out = *outlen;
+	lzma_ret ret = lzma_code(ls, LZMA_RUN);
+	*in = ls->next_in;
+	*inlen = ls->avail_in;
+	*out = ls->next_out;
+	*outlen = ls->avail_out;
+	switch (ret) {
+	case LZMA_STREAM_END:
+		return UnpackStatusEnd;
+	case LZMA_OK:
+	case LZMA_BUF_ERROR:
+		return UnpackStatusMore;
+	default:
+		return UnpackStatusError;
+	}
+}
+
+struct unpack *
+unpack_create(struct memface *mc, enum unpack_type type, const uint8_t *prop, size_t proplen) {
+	struct unpack *up = mc->alloc(mc->ctx, sizeof(*up), __FILE__, __LINE__);
+	up->type = type;
+	up->memctx = mc->ctx;
+	up->malloc = mc->alloc;
+	up->dealloc = mc->dealloc;
+	bool ok = false;
+	switch (type) {
+	case UnpackZlib:
+		ok = zlib_init(up);
+		break;
+	case UnpackLzma:
+		ok = lzma_init(up, prop, proplen);
+		break;
+	}
+	if (!ok) {
+		up->dealloc(up->memctx, up, __FILE__, __LINE__);
+		return NULL;
+	}
+	return up;
+}
+
+void
+unpack_delete(struct unpack *up) {
+	switch (up->type) {
+	case UnpackZlib:
+		inflateEnd(&up->u.zlib);
+		break;
+	case UnpackLzma:
+		lzma_end(&up->u.lzma.stream);
+		break;
+	}
+	up->dealloc(up->memctx, up, __FILE__, __LINE__);
+}
+
+enum unpack_status
+unpack_run(struct unpack *up, const uint8_t **in, size_t *inlen, uint8_t **out, size_t *outlen) {
+	switch (up->type) {
+	case UnpackZlib:
+		return zlib_run(up, in, inlen, out, outlen);
+	case UnpackLzma:
+		return lzma_run(up, in, inlen, out, outlen);
+	}
+	return UnpackStatusError;
+}
@@ -0,0 +1,32 @@
+#ifndef __CORE_UNPACK_H
+#define __CORE_UNPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct memface;
+struct unpack;
+
+enum unpack_type {
+	UnpackZlib,
+	UnpackLzma,	// Raw LZMA1 data, whose properties are given separately.
+};
+
+enum unpack_status {
+	UnpackStatusMore,	// More output can be produced by feeding more input.
+	UnpackStatusEnd,	// End of compressed data.
+	UnpackStatusError,	// Corrupted data.
+};
+
+// Properties are needed by UnpackLzma only, it is 5 bytes lzma properties
+// header.
+// Return NULL if decompressor can't be initialized.
+struct unpack *unpack_create(struct memface *mc, enum unpack_type type, const uint8_t *prop, size_t proplen);
+void unpack_delete(struct unpack *up);
+
+// Decompress from [*in, *in+*inlen) to [*out, *out+*outlen).
+// Both ranges are advanced past consumed/produced bytes.
+// Decompressing stops when either input or output is exhausted.
+enum unpack_status unpack_run(struct unpack *up, const uint8_t **in, size_t *inlen, uint8_t **out, size_t *outlen);
+
+#endif